@@ -16,8 +16,13 @@
 
 #include "tink/aead/aead_wrapper.h"
 
+#include <string.h>
+
+#include "absl/strings/match.h"
 #include "tink/aead.h"
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -28,6 +33,8 @@ namespace tink {
 
 namespace {
 
+using crypto::tink::internal::FunctionMonitor;
+
 util::Status Validate(PrimitiveSet<Aead>* aead_set) {
   if (aead_set == nullptr) {
     return util::Status(util::error::INTERNAL, "aead_set must be non-NULL");
@@ -41,8 +48,12 @@ util::Status Validate(PrimitiveSet<Aead>* aead_set) {
 
 class AeadSetWrapper : public Aead {
  public:
-  explicit AeadSetWrapper(std::unique_ptr<PrimitiveSet<Aead>> aead_set)
-      : aead_set_(std::move(aead_set)) {}
+  AeadSetWrapper(std::unique_ptr<PrimitiveSet<Aead>> aead_set,
+                 FunctionMonitor encrypt_monitor,
+                 FunctionMonitor decrypt_monitor)
+      : aead_set_(std::move(aead_set)),
+        encrypt_monitor_(std::move(encrypt_monitor)),
+        decrypt_monitor_(std::move(decrypt_monitor)) {}
 
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
@@ -56,6 +67,8 @@ class AeadSetWrapper : public Aead {
 
  private:
   std::unique_ptr<PrimitiveSet<Aead>> aead_set_;
+  const FunctionMonitor encrypt_monitor_;
+  const FunctionMonitor decrypt_monitor_;
 };
 
 util::StatusOr<std::string> AeadSetWrapper::Encrypt(
@@ -66,10 +79,16 @@ util::StatusOr<std::string> AeadSetWrapper::Encrypt(
   plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
 
-  auto encrypt_result = aead_set_->get_primary()->get_primitive()
-      .Encrypt(plaintext, associated_data);
-  if (!encrypt_result.ok()) return encrypt_result.status();
-  const std::string& key_id = aead_set_->get_primary()->get_identifier();
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+  const auto* primary = aead_set_->get_primary();
+  auto encrypt_result =
+      primary->get_primitive().Encrypt(plaintext, associated_data);
+  if (!encrypt_result.ok()) {
+    call.LogFailure();
+    return encrypt_result.status();
+  }
+  call.Log(primary->get_key_id(), plaintext.size());
+  const std::string& key_id = primary->get_identifier();
   return key_id + encrypt_result.ValueOrDie();
 }
 
@@ -80,6 +99,7 @@ util::StatusOr<std::string> AeadSetWrapper::Decrypt(
   // regardless of whether the size is 0.
   associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
 
+  FunctionMonitor::Call call = decrypt_monitor_.StartCall();
   if (ciphertext.length() > CryptoFormat::kNonRawPrefixSize) {
     const std::string& key_id = std::string(
         ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize));
@@ -88,12 +108,15 @@ util::StatusOr<std::string> AeadSetWrapper::Decrypt(
       absl::string_view raw_ciphertext =
           ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& aead_entry : *(primitives_result.ValueOrDie())) {
-        Aead& aead = aead_entry->get_primitive();
+        auto aead_result = aead_entry->get_shared_primitive();
+        if (!aead_result.ok()) continue;
+        Aead& aead = *aead_result.ValueOrDie();
         auto decrypt_result = aead.Decrypt(raw_ciphertext, associated_data);
         if (decrypt_result.ok()) {
+          call.Log(aead_entry->get_key_id(), ciphertext.size());
           return std::move(decrypt_result.ValueOrDie());
         } else {
-          // LOG that a matching key didn't decrypt the ciphertext.
+          call.LogKeyFailure(aead_entry->get_key_id());
         }
       }
     }
@@ -103,23 +126,142 @@ util::StatusOr<std::string> AeadSetWrapper::Decrypt(
   auto raw_primitives_result = aead_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& aead_entry : *(raw_primitives_result.ValueOrDie())) {
-      Aead& aead = aead_entry->get_primitive();
+      auto aead_result = aead_entry->get_shared_primitive();
+      if (!aead_result.ok()) continue;
+      Aead& aead = *aead_result.ValueOrDie();
       auto decrypt_result = aead.Decrypt(ciphertext, associated_data);
       if (decrypt_result.ok()) {
+        call.Log(aead_entry->get_key_id(), ciphertext.size());
         return std::move(decrypt_result.ValueOrDie());
       }
+      call.LogKeyFailure(aead_entry->get_key_id());
     }
   }
+  call.LogFailure();
   return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
 }
 
+// An Aead for a set whose only key is the primary.  It holds the primitive
+// and the ciphertext prefix of the key directly, so that its operations
+// neither look up the set nor copy the identifier of the key, and behave
+// otherwise like those of AeadSetWrapper.
+class SingleKeyAead : public Aead {
+ public:
+  SingleKeyAead(std::shared_ptr<Aead> aead, absl::string_view prefix,
+                uint32_t key_id, FunctionMonitor encrypt_monitor,
+                FunctionMonitor decrypt_monitor)
+      : aead_(std::move(aead)),
+        prefix_size_(prefix.size()),
+        key_id_(key_id),
+        encrypt_monitor_(std::move(encrypt_monitor)),
+        decrypt_monitor_(std::move(decrypt_monitor)) {
+    memcpy(prefix_, prefix.data(), prefix_size_);
+  }
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+  ~SingleKeyAead() override {}
+
+ private:
+  const std::shared_ptr<Aead> aead_;
+  char prefix_[CryptoFormat::kNonRawPrefixSize];
+  const size_t prefix_size_;  // 0 for RAW keys.
+  const uint32_t key_id_;
+  const FunctionMonitor encrypt_monitor_;
+  const FunctionMonitor decrypt_monitor_;
+};
+
+util::StatusOr<std::string> SingleKeyAead::Encrypt(
+    absl::string_view plaintext,
+    absl::string_view associated_data) const {
+  plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+  auto encrypt_result = aead_->Encrypt(plaintext, associated_data);
+  if (!encrypt_result.ok()) {
+    call.LogFailure();
+    return encrypt_result;
+  }
+  call.Log(key_id_, plaintext.size());
+  if (prefix_size_ == 0) return encrypt_result;
+  const std::string& raw_ciphertext = encrypt_result.ValueOrDie();
+  std::string ciphertext;
+  ciphertext.reserve(prefix_size_ + raw_ciphertext.size());
+  ciphertext.append(prefix_, prefix_size_);
+  ciphertext.append(raw_ciphertext);
+  return std::move(ciphertext);
+}
+
+util::StatusOr<std::string> SingleKeyAead::Decrypt(
+    absl::string_view ciphertext,
+    absl::string_view associated_data) const {
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+
+  FunctionMonitor::Call call = decrypt_monitor_.StartCall();
+  absl::string_view raw_ciphertext = ciphertext;
+  if (prefix_size_ > 0) {
+    if (ciphertext.length() <= prefix_size_ ||
+        !absl::StartsWith(ciphertext,
+                          absl::string_view(prefix_, prefix_size_))) {
+      call.LogFailure();
+      return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+    }
+    raw_ciphertext.remove_prefix(prefix_size_);
+  }
+  auto decrypt_result = aead_->Decrypt(raw_ciphertext, associated_data);
+  if (!decrypt_result.ok()) {
+    call.LogKeyFailure(key_id_);
+    call.LogFailure();
+    return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+  }
+  call.Log(key_id_, ciphertext.size());
+  return decrypt_result;
+}
+
 }  // anonymous namespace
 
 util::StatusOr<std::unique_ptr<Aead>> AeadWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<Aead>> aead_set) const {
+  return WrapWithMonitoring(std::move(aead_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<Aead>> AeadWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<Aead>> aead_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(aead_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<Aead> aead(new AeadSetWrapper(std::move(aead_set)));
+  auto encrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, aead_set.get(), "aead", "encrypt");
+  if (!encrypt_monitor_result.ok()) return encrypt_monitor_result.status();
+  auto decrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, aead_set.get(), "aead", "decrypt");
+  if (!decrypt_monitor_result.ok()) return decrypt_monitor_result.status();
+  if (aead_set->size() == 1) {
+    // Single-key sets, which are the most common ones, get a wrapper
+    // without per-operation lookups.
+    const auto* primary = aead_set->get_primary();
+    auto primary_result = primary->get_shared_primitive();
+    if (primary_result.ok() &&
+        primary->get_identifier().size() <= CryptoFormat::kNonRawPrefixSize) {
+      std::unique_ptr<Aead> aead(new SingleKeyAead(
+          std::move(primary_result.ValueOrDie()), primary->get_identifier(),
+          primary->get_key_id(),
+          std::move(encrypt_monitor_result.ValueOrDie()),
+          std::move(decrypt_monitor_result.ValueOrDie())));
+      return std::move(aead);
+    }
+  }
+  std::unique_ptr<Aead> aead(
+      new AeadSetWrapper(std::move(aead_set),
+                         std::move(encrypt_monitor_result.ValueOrDie()),
+                         std::move(decrypt_monitor_result.ValueOrDie())));
   return std::move(aead);
 }
 
@@ -19,6 +19,7 @@
 
 #include "absl/strings/string_view.h"
 #include "tink/aead.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/util/statusor.h"
@@ -38,6 +39,14 @@ class AeadWrapper : public PrimitiveWrapper<Aead> {
   // which must be non-NULL and must contain a primary instance.
   util::StatusOr<std::unique_ptr<Aead>> Wrap(
       std::unique_ptr<PrimitiveSet<Aead>> aead_set) const override;
+
+  // Like Wrap(), but the returned Aead reports its operations
+  // to clients created by 'monitoring_factory' (if not null).
+  util::StatusOr<std::unique_ptr<Aead>> WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<Aead>> aead_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
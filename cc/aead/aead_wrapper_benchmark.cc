@@ -0,0 +1,125 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of AEADs obtained from keysets, i.e. of the primitive set
+// wrapper on top of the AEAD primitives, with keysets of 1 to 256 keys
+// with TINK or RAW output prefixes.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/keyset_handle.h"
+#include "tink/subtle/random.h"
+#include "tink/util/allocation_counter.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AllocationCounter;
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::GetShared;
+using crypto::tink::test::NewKeysetHandle;
+using crypto::tink::test::SetAllocationCounters;
+using crypto::tink::test::SetThroughput;
+using crypto::tink::test::ThreadCounts;
+using google::crypto::tink::OutputPrefixType;
+
+// Returns the AES128-GCM Aead for a keyset of 'num_keys' keys
+// with 'output_prefix_type', shared by all the threads.
+util::StatusOr<Aead*> GetAead(int num_keys,
+                              OutputPrefixType output_prefix_type) {
+  return GetShared<Aead>(
+      absl::StrCat(num_keys, "/", output_prefix_type),
+      [=]() -> util::StatusOr<std::unique_ptr<Aead>> {
+        auto status = AeadConfig::Register();
+        if (!status.ok()) return status;
+        auto handle_result = NewKeysetHandle(AeadKeyTemplates::Aes128Gcm(),
+                                             num_keys, output_prefix_type);
+        if (!handle_result.ok()) return handle_result.status();
+        return handle_result.ValueOrDie()->GetPrimitive<Aead>();
+      });
+}
+
+// Arguments: the number of keys, the output prefix type,
+// and the message size.
+void WrapperArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int num_keys : {1, 16, 256}) {
+    for (int prefix : {OutputPrefixType::TINK, OutputPrefixType::RAW}) {
+      for (int message_size : {64, 16 << 10}) {
+        benchmark->Args({num_keys, prefix, message_size});
+      }
+    }
+  }
+}
+
+void BM_WrappedAeadEncrypt(benchmark::State& state) {
+  auto aead_result = GetAead(
+      state.range(0), static_cast<OutputPrefixType>(state.range(1)));
+  if (!CheckOk(aead_result.status(), &state)) return;
+  const Aead& aead = *aead_result.ValueOrDie();
+  std::string plaintext = subtle::Random::GetRandomBytes(state.range(2));
+  std::string associated_data = subtle::Random::GetRandomBytes(16);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto encrypt_result = aead.Encrypt(plaintext, associated_data);
+    if (!CheckOk(encrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(encrypt_result.ValueOrDie().data());
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(state.range(2), &state);
+}
+
+void BM_WrappedAeadDecrypt(benchmark::State& state) {
+  auto aead_result = GetAead(
+      state.range(0), static_cast<OutputPrefixType>(state.range(1)));
+  if (!CheckOk(aead_result.status(), &state)) return;
+  const Aead& aead = *aead_result.ValueOrDie();
+  std::string associated_data = subtle::Random::GetRandomBytes(16);
+  auto encrypt_result = aead.Encrypt(
+      subtle::Random::GetRandomBytes(state.range(2)), associated_data);
+  if (!CheckOk(encrypt_result.status(), &state)) return;
+  const std::string& ciphertext = encrypt_result.ValueOrDie();
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto decrypt_result = aead.Decrypt(ciphertext, associated_data);
+    if (!CheckOk(decrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(decrypt_result.ValueOrDie().data());
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(state.range(2), &state);
+}
+
+BENCHMARK(BM_WrappedAeadEncrypt)->Apply(WrapperArgs);
+BENCHMARK(BM_WrappedAeadDecrypt)->Apply(WrapperArgs);
+BENCHMARK(BM_WrappedAeadEncrypt)
+    ->Args({1, OutputPrefixType::TINK, 1 << 10})
+    ->Apply(ThreadCounts);
+BENCHMARK(BM_WrappedAeadDecrypt)
+    ->Args({1, OutputPrefixType::TINK, 1 << 10})
+    ->Apply(ThreadCounts);
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -15,12 +15,18 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "tink/aead/aead_wrapper.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tink/aead.h"
+#include "tink/crypto_format.h"
 #include "tink/primitive_set.h"
+#include "tink/util/allocation_matchers.h"
+#include "tink/util/monitoring_counters.h"
 #include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
 
+using crypto::tink::test::AllocatesAtMostMoreThan;
 using crypto::tink::test::DummyAead;
 using google::crypto::tink::Keyset;
 using google::crypto::tink::KeyStatusType;
@@ -30,6 +36,32 @@ namespace crypto {
 namespace tink {
 namespace {
 
+// Returns a set with a DummyAead named 'aead_name' for a key with the given
+// 'output_prefix_type' as the primary and, if 'add_other_key' is true,
+// another key.
+std::unique_ptr<PrimitiveSet<Aead>> GetAeadSet(
+    const std::string& aead_name, OutputPrefixType output_prefix_type,
+    bool add_other_key) {
+  auto aead_set = absl::make_unique<PrimitiveSet<Aead>>();
+  Keyset::Key key;
+  key.set_status(KeyStatusType::ENABLED);
+  if (add_other_key) {
+    key.set_output_prefix_type(OutputPrefixType::TINK);
+    key.set_key_id(42);
+    auto entry_result =
+        aead_set->AddPrimitive(absl::make_unique<DummyAead>("other"), key);
+    EXPECT_TRUE(entry_result.ok()) << entry_result.status();
+  }
+  key.set_output_prefix_type(output_prefix_type);
+  key.set_key_id(1234543);
+  auto entry_result =
+      aead_set->AddPrimitive(absl::make_unique<DummyAead>(aead_name), key);
+  EXPECT_TRUE(entry_result.ok()) << entry_result.status();
+  auto status = aead_set->set_primary(entry_result.ValueOrDie());
+  EXPECT_TRUE(status.ok()) << status;
+  return aead_set;
+}
+
 TEST(AeadSetWrapperTest, WrapNullptr) {
   AeadWrapper wrapper;
   auto aead_result = wrapper.Wrap(nullptr);
@@ -111,6 +143,111 @@ TEST(AeadSetWrapperTest, Basic) {
                       decrypt_result.status().error_message());
 }
 
+TEST(AeadSetWrapperTest, SingleKeySets) {
+  std::string plaintext = "some_plaintext";
+  std::string aad = "some_aad";
+  for (OutputPrefixType output_prefix_type :
+       {OutputPrefixType::TINK, OutputPrefixType::LEGACY,
+        OutputPrefixType::CRUNCHY, OutputPrefixType::RAW}) {
+    SCOPED_TRACE(OutputPrefixType_Name(output_prefix_type));
+    AeadWrapper wrapper;
+    auto single_result =
+        wrapper.Wrap(GetAeadSet("aead", output_prefix_type, false));
+    ASSERT_TRUE(single_result.ok()) << single_result.status();
+    auto single_aead = std::move(single_result.ValueOrDie());
+    auto multi_result =
+        wrapper.Wrap(GetAeadSet("aead", output_prefix_type, true));
+    ASSERT_TRUE(multi_result.ok()) << multi_result.status();
+    auto multi_aead = std::move(multi_result.ValueOrDie());
+
+    // The ciphertexts of a single-key set are the same as those of a set
+    // with more keys, and each of them can decrypt those of the other.
+    auto encrypt_result = single_aead->Encrypt(plaintext, aad);
+    ASSERT_TRUE(encrypt_result.ok()) << encrypt_result.status();
+    std::string ciphertext = encrypt_result.ValueOrDie();
+    encrypt_result = multi_aead->Encrypt(plaintext, aad);
+    ASSERT_TRUE(encrypt_result.ok()) << encrypt_result.status();
+    EXPECT_EQ(ciphertext, encrypt_result.ValueOrDie());
+    for (Aead* aead : {single_aead.get(), multi_aead.get()}) {
+      auto decrypt_result = aead->Decrypt(ciphertext, aad);
+      ASSERT_TRUE(decrypt_result.ok()) << decrypt_result.status();
+      EXPECT_EQ(plaintext, decrypt_result.ValueOrDie());
+    }
+
+    // Ciphertexts with a wrong prefix or of a wrong size are rejected.
+    std::string wrong_prefix = ciphertext;
+    wrong_prefix[0] ^= 1;
+    for (const std::string& bad_ciphertext :
+         {wrong_prefix, ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize),
+          std::string("")}) {
+      auto decrypt_result = single_aead->Decrypt(bad_ciphertext, aad);
+      EXPECT_EQ(util::error::INVALID_ARGUMENT,
+                decrypt_result.status().error_code());
+      EXPECT_PRED_FORMAT2(testing::IsSubstring, "decryption failed",
+                          decrypt_result.status().error_message());
+    }
+  }
+}
+
+TEST(AeadSetWrapperTest, Allocations) {
+  std::string plaintext = "some_plaintext";
+  std::string aad = "some_aad";
+  DummyAead raw_aead("aead");
+  std::string raw_ciphertext = raw_aead.Encrypt(plaintext, aad).ValueOrDie();
+
+  for (bool add_other_key : {false, true}) {
+    SCOPED_TRACE(add_other_key ? "two keys" : "one key");
+    auto aead_result = AeadWrapper().Wrap(
+        GetAeadSet("aead", OutputPrefixType::TINK, add_other_key));
+    ASSERT_TRUE(aead_result.ok()) << aead_result.status();
+    auto aead = std::move(aead_result.ValueOrDie());
+    std::string ciphertext = aead->Encrypt(plaintext, aad).ValueOrDie();
+
+    // Wrapping adds at most the allocation of the prefixed ciphertext
+    // when encrypting, and of the key identifier when decrypting.
+    EXPECT_THAT([&]() { aead->Encrypt(plaintext, aad); },
+                AllocatesAtMostMoreThan(
+                    [&]() { raw_aead.Encrypt(plaintext, aad); }, 1));
+    EXPECT_THAT([&]() { aead->Decrypt(ciphertext, aad); },
+                AllocatesAtMostMoreThan(
+                    [&]() { raw_aead.Decrypt(raw_ciphertext, aad); },
+                    add_other_key ? 1 : 0));
+  }
+}
+
+TEST(AeadSetWrapperTest, Monitoring) {
+  for (bool add_other_key : {false, true}) {
+    SCOPED_TRACE(add_other_key ? "two keys" : "one key");
+    util::MonitoringCounters counters;
+    auto aead_result = AeadWrapper().WrapWithMonitoring(
+        GetAeadSet("aead", OutputPrefixType::TINK, add_other_key),
+        &counters);
+    ASSERT_TRUE(aead_result.ok()) << aead_result.status();
+    auto aead = std::move(aead_result.ValueOrDie());
+
+    std::string plaintext = "some_plaintext";
+    std::string aad = "some_aad";
+    auto encrypt_result = aead->Encrypt(plaintext, aad);
+    ASSERT_TRUE(encrypt_result.ok()) << encrypt_result.status();
+    std::string ciphertext = encrypt_result.ValueOrDie();
+    ASSERT_TRUE(aead->Encrypt(plaintext, aad).ok());
+    ASSERT_TRUE(aead->Decrypt(ciphertext, aad).ok());
+    EXPECT_FALSE(aead->Decrypt("some bad ciphertext", aad).ok());
+
+    auto counts = counters.GetCounts();
+    ASSERT_EQ(2, counts.size());
+    const auto& encrypt_counts = counts[{"aead", "encrypt"}];
+    EXPECT_EQ(add_other_key ? 2 : 1, encrypt_counts.keys.size());
+    EXPECT_EQ(2, encrypt_counts.keys.at(1234543).calls);
+    EXPECT_EQ(2 * plaintext.size(), encrypt_counts.keys.at(1234543).bytes);
+    EXPECT_EQ(0, encrypt_counts.failures);
+    const auto& decrypt_counts = counts[{"aead", "decrypt"}];
+    EXPECT_EQ(1, decrypt_counts.keys.at(1234543).calls);
+    EXPECT_EQ(ciphertext.size(), decrypt_counts.keys.at(1234543).bytes);
+    EXPECT_EQ(1, decrypt_counts.failures);
+  }
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
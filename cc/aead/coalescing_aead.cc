@@ -0,0 +1,147 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/coalescing_aead.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "openssl/mem.h"
+#include "tink/aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+// Starts an asynchronous call via 'start_call', and returns its result
+// once the call has completed.
+template <typename StartCall>
+util::StatusOr<std::string> WaitForCall(const StartCall& start_call) {
+  absl::Notification done;
+  util::StatusOr<std::string> result;
+  start_call([&result, &done](util::StatusOr<std::string> call_result) {
+    result = call_result;
+    done.Notify();
+  });
+  done.WaitForNotification();
+  return result;
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<CoalescingAead>> CoalescingAead::New(
+    std::unique_ptr<Aead> remote_aead, const Options& options) {
+  if (remote_aead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "remote_aead must be non-null");
+  }
+  if (options.max_concurrent_calls <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "max_concurrent_calls must be positive");
+  }
+  std::unique_ptr<CoalescingAead> aead(
+      new CoalescingAead(std::move(remote_aead), options));
+  return std::move(aead);
+}
+
+util::StatusOr<std::string> CoalescingAead::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  return WaitForCall([&](Callback done) {
+    EncryptAsync(plaintext, associated_data, std::move(done));
+  });
+}
+
+util::StatusOr<std::string> CoalescingAead::Decrypt(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  return WaitForCall([&](Callback done) {
+    DecryptAsync(ciphertext, associated_data, std::move(done));
+  });
+}
+
+void CoalescingAead::EncryptAsync(absl::string_view plaintext,
+                                  absl::string_view associated_data,
+                                  Callback done) const {
+  // The plaintext is usually a key.  The task shares a single copy of it,
+  // so that copying the task does not copy the plaintext, and the copy
+  // is wiped once the task is destroyed.
+  std::shared_ptr<std::string> plaintext_copy(
+      new std::string(plaintext), [](std::string* s) {
+        OPENSSL_cleanse(&(*s)[0], s->size());
+        delete s;
+      });
+  std::string associated_data_copy(associated_data);
+  pool_.Schedule([this, plaintext_copy, associated_data_copy, done]() {
+    done(remote_aead_->Encrypt(*plaintext_copy, associated_data_copy));
+  });
+}
+
+void CoalescingAead::DecryptAsync(absl::string_view ciphertext,
+                                  absl::string_view associated_data,
+                                  Callback done) const {
+  std::string flight_key = absl::StrCat(associated_data.size(), ":",
+                                        associated_data, ciphertext);
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = flights_.find(flight_key);
+    if (it != flights_.end()) {
+      // Join the call in flight.
+      it->second.push_back(std::move(done));
+      coalesced_count_++;
+      return;
+    }
+    flights_[flight_key].push_back(std::move(done));
+  }
+  std::string ciphertext_copy(ciphertext);
+  std::string associated_data_copy(associated_data);
+  pool_.Schedule([this, flight_key, ciphertext_copy, associated_data_copy]() {
+    FinishDecryption(flight_key, remote_aead_->Decrypt(ciphertext_copy,
+                                                       associated_data_copy));
+  });
+}
+
+void CoalescingAead::FinishDecryption(
+    const std::string& flight_key,
+    const util::StatusOr<std::string>& result) const {
+  std::vector<Callback> callbacks;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = flights_.find(flight_key);
+    callbacks = std::move(it->second);
+    // Later decryptions of the same ciphertext make a new call.
+    flights_.erase(it);
+  }
+  for (const auto& callback : callbacks) {
+    callback(result);
+  }
+}
+
+int64_t CoalescingAead::coalesced_count() const {
+  absl::MutexLock lock(&mutex_);
+  return coalesced_count_;
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,133 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_AEAD_COALESCING_AEAD_H_
+#define TINK_AEAD_COALESCING_AEAD_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/util/statusor.h"
+#include "tink/util/thread_pool.h"
+
+namespace crypto {
+namespace tink {
+
+// An Aead that forwards its calls to a remote AEAD, such as an AwsKmsAead
+// or a GcpKmsAead, whose calls are synchronous RPCs.
+//
+// The calls are made on a pool of Options::max_concurrent_calls threads,
+// which bounds the number of outstanding RPCs; further calls are queued
+// in FIFO order.  Besides the (blocking) Aead interface, the calls can be
+// started asynchronously via EncryptAsync() and DecryptAsync(), so that
+// a single caller can have several calls in flight without blocking a
+// thread of its own for each of them.  The blocking Encrypt() and Decrypt()
+// are implemented on top of these, so each of them occupies both the
+// calling thread and a thread of the pool until the RPC has completed:
+// they bound the outstanding RPCs, but do not free any threads, hence
+// callers with many concurrent calls should use the asynchronous methods.
+//
+// The copy of a plaintext kept for an encryption is wiped once the call
+// is done.  The decrypted plaintexts passed to the callbacks and returned
+// by Decrypt() are not wiped by CoalescingAead, nor is any copy made by
+// the remote AEAD.
+//
+// Concurrent decryptions of the same ciphertext with the same associated
+// data (e.g. of the same wrapped DEK, by several threads that decrypt
+// envelope ciphertexts) are coalesced into a single call, whose result
+// is returned to all of the callers.  Encryptions are never coalesced.
+//
+// CoalescingAead is thread safe.  Its destructor waits for all the
+// pending calls, and runs their callbacks.
+class CoalescingAead : public Aead {
+ public:
+  struct Options {
+    Options() : max_concurrent_calls(8) {}
+    // The maximal number of concurrent calls to the remote AEAD,
+    // must be positive.
+    int max_concurrent_calls;
+  };
+
+  // Receives the result of an asynchronous call.
+  typedef std::function<void(crypto::tink::util::StatusOr<std::string>)>
+      Callback;
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<CoalescingAead>> New(
+      std::unique_ptr<Aead> remote_aead, const Options& options);
+
+  // Encrypt() and Decrypt() block until the call has completed.
+  // They must not be called from a Callback.
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+  // Starts the encryption of 'plaintext', and returns without waiting
+  // for it.  'done' is called with the result on one of the threads
+  // of the pool, hence should not block.
+  void EncryptAsync(absl::string_view plaintext,
+                    absl::string_view associated_data, Callback done) const;
+
+  // Starts the decryption of 'ciphertext', and returns without waiting
+  // for it.  'done' is called with the result on one of the threads
+  // of the pool, hence should not block.
+  void DecryptAsync(absl::string_view ciphertext,
+                    absl::string_view associated_data, Callback done) const
+      LOCKS_EXCLUDED(mutex_);
+
+  // The number of decryptions that joined a call which was in flight
+  // instead of making their own.
+  int64_t coalesced_count() const LOCKS_EXCLUDED(mutex_);
+
+  ~CoalescingAead() override {}
+
+ private:
+  CoalescingAead(std::unique_ptr<Aead> remote_aead, const Options& options)
+      : remote_aead_(std::move(remote_aead)),
+        coalesced_count_(0),
+        pool_(options.max_concurrent_calls) {}
+
+  // Completes the decryption with the key 'flight_key' in 'flights_',
+  // by passing 'result' to the callbacks of all its callers.
+  void FinishDecryption(const std::string& flight_key,
+                        const crypto::tink::util::StatusOr<std::string>& result)
+      const LOCKS_EXCLUDED(mutex_);
+
+  const std::unique_ptr<Aead> remote_aead_;
+  mutable absl::Mutex mutex_;
+  // The callbacks of the decryptions in flight, by ciphertext
+  // and associated data.
+  mutable std::unordered_map<std::string, std::vector<Callback>> flights_
+      GUARDED_BY(mutex_);
+  mutable int64_t coalesced_count_ GUARDED_BY(mutex_);
+  // Declared last, so that the pending calls complete before the other
+  // members are destroyed.
+  mutable crypto::tink::util::ThreadPool pool_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_COALESCING_AEAD_H_
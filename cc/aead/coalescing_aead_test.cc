@@ -0,0 +1,299 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/coalescing_aead.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::DummyAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+// A local stand-in for a KMS, which counts the calls made to it and their
+// concurrency, and which can hold the calls back until released.
+class FakeKms {
+ public:
+  FakeKms()
+      : held_(false),
+        encryptions_(0),
+        decryptions_(0),
+        calls_in_progress_(0),
+        max_calls_in_progress_(0) {}
+
+  // Returns a remote AEAD whose calls go to this KMS,
+  // which must outlive the AEAD.
+  std::unique_ptr<Aead> NewAead();
+
+  // Makes the subsequent calls wait until Release() is called.
+  void Hold() {
+    absl::MutexLock lock(&mutex_);
+    held_ = true;
+  }
+
+  // Lets the held calls proceed.
+  void Release() {
+    absl::MutexLock lock(&mutex_);
+    held_ = false;
+    cond_.SignalAll();
+  }
+
+  // Waits until 'count' calls are in progress.
+  void WaitForCallsInProgress(int count) {
+    absl::MutexLock lock(&mutex_);
+    while (calls_in_progress_ < count) cond_.Wait(&mutex_);
+  }
+
+  // Called by the AEADs of this KMS around each call.
+  void StartCall(bool encryption) {
+    absl::MutexLock lock(&mutex_);
+    (encryption ? encryptions_ : decryptions_)++;
+    calls_in_progress_++;
+    max_calls_in_progress_ =
+        std::max(max_calls_in_progress_, calls_in_progress_);
+    cond_.SignalAll();
+    while (held_) cond_.Wait(&mutex_);
+  }
+
+  void EndCall() {
+    absl::MutexLock lock(&mutex_);
+    calls_in_progress_--;
+  }
+
+  int encryptions() {
+    absl::MutexLock lock(&mutex_);
+    return encryptions_;
+  }
+
+  int decryptions() {
+    absl::MutexLock lock(&mutex_);
+    return decryptions_;
+  }
+
+  int max_calls_in_progress() {
+    absl::MutexLock lock(&mutex_);
+    return max_calls_in_progress_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  absl::CondVar cond_;
+  bool held_ GUARDED_BY(mutex_);
+  int encryptions_ GUARDED_BY(mutex_);
+  int decryptions_ GUARDED_BY(mutex_);
+  int calls_in_progress_ GUARDED_BY(mutex_);
+  int max_calls_in_progress_ GUARDED_BY(mutex_);
+};
+
+class FakeKmsAead : public Aead {
+ public:
+  explicit FakeKmsAead(FakeKms* kms) : kms_(kms), aead_("fake-kms") {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    kms_->StartCall(true);
+    auto result = aead_.Encrypt(plaintext, associated_data);
+    kms_->EndCall();
+    return result;
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    kms_->StartCall(false);
+    auto result = aead_.Decrypt(ciphertext, associated_data);
+    kms_->EndCall();
+    return result;
+  }
+
+ private:
+  FakeKms* kms_;
+  DummyAead aead_;
+};
+
+std::unique_ptr<Aead> FakeKms::NewAead() {
+  return absl::make_unique<FakeKmsAead>(this);
+}
+
+std::unique_ptr<CoalescingAead> NewCoalescingAead(FakeKms* kms,
+                                                  int max_concurrent_calls) {
+  CoalescingAead::Options options;
+  options.max_concurrent_calls = max_concurrent_calls;
+  auto aead_result = CoalescingAead::New(kms->NewAead(), options);
+  EXPECT_THAT(aead_result.status(), IsOk());
+  return std::move(aead_result.ValueOrDie());
+}
+
+TEST(CoalescingAeadTest, InvalidArguments) {
+  EXPECT_THAT(
+      CoalescingAead::New(nullptr, CoalescingAead::Options()).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  CoalescingAead::Options options;
+  options.max_concurrent_calls = 0;
+  EXPECT_THAT(CoalescingAead::New(absl::make_unique<DummyAead>("remote"),
+                                  options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(CoalescingAeadTest, EncryptDecrypt) {
+  FakeKms kms;
+  auto aead = NewCoalescingAead(&kms, 2);
+  std::string plaintext = "some dek";
+  std::string aad = "some aad";
+  auto encrypt_result = aead->Encrypt(plaintext, aad);
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  std::string ciphertext = encrypt_result.ValueOrDie();
+  for (int i = 0; i < 2; i++) {
+    auto decrypt_result = aead->Decrypt(ciphertext, aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(plaintext, decrypt_result.ValueOrDie());
+  }
+  EXPECT_FALSE(aead->Decrypt(ciphertext, "wrong aad").ok());
+  EXPECT_FALSE(aead->Decrypt("some bad ciphertext", aad).ok());
+
+  // Decryptions that do not overlap are not coalesced.
+  EXPECT_EQ(1, kms.encryptions());
+  EXPECT_EQ(4, kms.decryptions());
+  EXPECT_EQ(0, aead->coalesced_count());
+}
+
+TEST(CoalescingAeadTest, CoalescesConcurrentDecryptions) {
+  FakeKms kms;
+  auto aead = NewCoalescingAead(&kms, 4);
+  std::string aad = "some aad";
+  std::string ciphertext = aead->Encrypt("some dek", aad).ValueOrDie();
+  std::string other_ciphertext = aead->Encrypt("other dek", aad).ValueOrDie();
+
+  kms.Hold();
+  const int num_calls = 10;
+  absl::BlockingCounter done(2 * num_calls + 1);
+  absl::Mutex mutex;
+  std::vector<std::string> plaintexts;
+  auto callback = [&](util::StatusOr<std::string> result) {
+    EXPECT_THAT(result.status(), IsOk());
+    {
+      absl::MutexLock lock(&mutex);
+      plaintexts.push_back(result.ValueOrDie());
+    }
+    done.DecrementCount();
+  };
+  for (int i = 0; i < num_calls; i++) {
+    aead->DecryptAsync(ciphertext, aad, callback);
+    // With other associated data, the decryptions are not coalesced.
+    aead->DecryptAsync(ciphertext, "other aad",
+                       [&](util::StatusOr<std::string> result) {
+                         EXPECT_FALSE(result.ok());
+                         done.DecrementCount();
+                       });
+  }
+  aead->DecryptAsync(other_ciphertext, aad, callback);
+  kms.WaitForCallsInProgress(3);
+  kms.Release();
+  done.Wait();
+
+  EXPECT_EQ(3, kms.decryptions());
+  EXPECT_EQ(2 * (num_calls - 1), aead->coalesced_count());
+  absl::MutexLock lock(&mutex);
+  EXPECT_EQ(num_calls + 1, plaintexts.size());
+  EXPECT_EQ(num_calls, std::count(plaintexts.begin(), plaintexts.end(),
+                                  std::string("some dek")));
+}
+
+TEST(CoalescingAeadTest, CoalescesBlockingDecryptions) {
+  FakeKms kms;
+  auto aead = NewCoalescingAead(&kms, 4);
+  std::string ciphertext = aead->Encrypt("some dek", "").ValueOrDie();
+
+  // The first decryption is held until all the threads have started
+  // theirs, which are then coalesced with it.
+  kms.Hold();
+  const int num_threads = 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < num_threads; i++) {
+    threads.push_back(std::thread([&]() {
+      auto decrypt_result = aead->Decrypt(ciphertext, "");
+      ASSERT_THAT(decrypt_result.status(), IsOk());
+      EXPECT_EQ("some dek", decrypt_result.ValueOrDie());
+    }));
+  }
+  kms.WaitForCallsInProgress(1);
+  while (aead->coalesced_count() < num_threads - 1) {
+    std::this_thread::yield();
+  }
+  kms.Release();
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(1, kms.decryptions());
+}
+
+TEST(CoalescingAeadTest, BoundsConcurrentCalls) {
+  FakeKms kms;
+  const int max_concurrent_calls = 3;
+  auto aead = NewCoalescingAead(&kms, max_concurrent_calls);
+  kms.Hold();
+  const int num_calls = 20;
+  absl::BlockingCounter done(num_calls);
+  for (int i = 0; i < num_calls; i++) {
+    aead->EncryptAsync(absl::StrCat("dek ", i), "",
+                       [&](util::StatusOr<std::string> result) {
+                         EXPECT_THAT(result.status(), IsOk());
+                         done.DecrementCount();
+                       });
+  }
+  kms.WaitForCallsInProgress(max_concurrent_calls);
+  kms.Release();
+  done.Wait();
+  EXPECT_EQ(num_calls, kms.encryptions());
+  EXPECT_EQ(max_concurrent_calls, kms.max_calls_in_progress());
+}
+
+TEST(CoalescingAeadTest, DestructorCompletesPendingCalls) {
+  FakeKms kms;
+  auto aead = NewCoalescingAead(&kms, 2);
+  std::string ciphertext = aead->Encrypt("some dek", "").ValueOrDie();
+  int completed = 0;  // Only accessed by the single worker thread.
+  {
+    auto single_threaded_aead = NewCoalescingAead(&kms, 1);
+    for (int i = 0; i < 5; i++) {
+      single_threaded_aead->DecryptAsync(
+          ciphertext, absl::StrCat(i),
+          [&completed](util::StatusOr<std::string>) { completed++; });
+    }
+  }
+  EXPECT_EQ(5, completed);
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
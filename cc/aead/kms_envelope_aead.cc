@@ -18,6 +18,8 @@
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/mem.h"
 #include "tink/aead.h"
 #include "tink/registry.h"
 #include "tink/util/errors.h"
@@ -63,45 +65,163 @@ std::string GetEnvelopeCiphertext(absl::string_view encrypted_dek,
       encrypted_dek, encrypted_plaintext);
 }
 
-}  // namespace
+// Overwrites the contents of 's', which holds key material.
+void WipeString(std::string* s) {
+  OPENSSL_cleanse(&(*s)[0], s->size());
+}
 
+}  // namespace
 
 // static
 util::StatusOr<std::unique_ptr<Aead>> KmsEnvelopeAead::New(
       const google::crypto::tink::KeyTemplate& dek_template,
       std::unique_ptr<Aead> remote_aead) {
+  return New(dek_template, std::move(remote_aead), Options());
+}
+
+// static
+util::StatusOr<std::unique_ptr<Aead>> KmsEnvelopeAead::New(
+      const google::crypto::tink::KeyTemplate& dek_template,
+      std::unique_ptr<Aead> remote_aead, const Options& options) {
   if (remote_aead == nullptr) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "remote_aead must be non-null");
   }
+  if (options.max_messages_per_dek <= 0 || options.max_bytes_per_dek < 0 ||
+      options.max_dek_lifetime <= Clock::duration::zero() ||
+      options.max_cached_decryption_deks < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid DEK cache options");
+  }
   auto km_result = Registry::get_key_manager<Aead>(dek_template.type_url());
   if (!km_result.ok()) return km_result.status();
   std::unique_ptr<Aead> envelope_aead(
-      new KmsEnvelopeAead(dek_template, std::move(remote_aead)));
+      new KmsEnvelopeAead(dek_template, std::move(remote_aead), options));
   return std::move(envelope_aead);
 }
 
-util::StatusOr<std::string> KmsEnvelopeAead::Encrypt(
-    absl::string_view plaintext, absl::string_view associated_data) const {
+util::StatusOr<std::shared_ptr<const KmsEnvelopeAead::Dek>>
+KmsEnvelopeAead::NewDek() const {
   // Generate DEK.
   auto dek_result = Registry::NewKeyData(dek_template_);
   if (!dek_result.ok()) return dek_result.status();
   auto dek = std::move(dek_result.ValueOrDie());
 
+  std::string serialized_dek = dek->SerializeAsString();
+  auto aead_result = Registry::GetPrimitive<Aead>(*dek);
+  WipeString(dek->mutable_value());
+  if (!aead_result.ok()) {
+    WipeString(&serialized_dek);
+    return aead_result.status();
+  }
+
   // Wrap DEK with remote.
   auto dek_encrypt_result = remote_aead_->Encrypt(
-      dek->SerializeAsString(), kEmptyAssociatedData);
+      serialized_dek, kEmptyAssociatedData);
+  WipeString(&serialized_dek);
   if (!dek_encrypt_result.ok()) return dek_encrypt_result.status();
 
+  auto new_dek = std::make_shared<Dek>();
+  new_dek->encrypted_dek = std::move(dek_encrypt_result.ValueOrDie());
+  new_dek->aead = std::move(aead_result.ValueOrDie());
+  return std::shared_ptr<const Dek>(std::move(new_dek));
+}
+
+bool KmsEnvelopeAead::CanUseEncryptionDek(int64_t message_size) const {
+  return encryption_dek_ != nullptr &&
+      encryption_dek_messages_ < options_.max_messages_per_dek &&
+      (options_.max_bytes_per_dek == 0 ||
+       encryption_dek_bytes_ + message_size <= options_.max_bytes_per_dek) &&
+      (encryption_dek_expiry_ == Clock::time_point::max() ||
+       Clock::now() < encryption_dek_expiry_);
+}
+
+util::StatusOr<std::shared_ptr<const KmsEnvelopeAead::Dek>>
+KmsEnvelopeAead::GetEncryptionDek(int64_t message_size) const {
+  {
+    absl::MutexLock lock(&mutex_);
+    // Wait for the DEK being generated, rather than wrapping another one
+    // with the KMS.
+    while (generating_encryption_dek_ && !CanUseEncryptionDek(message_size)) {
+      encryption_dek_generated_.Wait(&mutex_);
+    }
+    if (CanUseEncryptionDek(message_size)) {
+      encryption_dek_messages_++;
+      encryption_dek_bytes_ += message_size;
+      return encryption_dek_;
+    }
+    generating_encryption_dek_ = true;
+  }
+  auto dek_result = NewDek();
+  Clock::time_point now = Clock::now();
+  Clock::time_point expiry = Clock::time_point::max();
+  if (options_.max_dek_lifetime < Clock::time_point::max() - now) {
+    expiry = now + options_.max_dek_lifetime;
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    generating_encryption_dek_ = false;
+    // On failure one of the waiting threads tries again.
+    encryption_dek_generated_.SignalAll();
+    if (!dek_result.ok()) return dek_result.status();
+    encryption_dek_ = dek_result.ValueOrDie();
+    encryption_dek_messages_ = 1;
+    encryption_dek_bytes_ = message_size;
+    encryption_dek_expiry_ = expiry;
+  }
+  // The ciphertexts of a reused DEK are likely to be decrypted
+  // by this AEAD as well.
+  CacheDecryptionDek(dek_result.ValueOrDie());
+  return dek_result;
+}
+
+std::shared_ptr<const KmsEnvelopeAead::Dek>
+KmsEnvelopeAead::FindDecryptionDek(absl::string_view encrypted_dek) const {
+  if (options_.max_cached_decryption_deks == 0) return nullptr;
+  absl::MutexLock lock(&mutex_);
+  auto it = decryption_dek_index_.find(encrypted_dek);
+  if (it == decryption_dek_index_.end()) return nullptr;
+  decryption_deks_.splice(decryption_deks_.begin(), decryption_deks_,
+                          it->second);
+  return *it->second;
+}
+
+void KmsEnvelopeAead::CacheDecryptionDek(
+    std::shared_ptr<const Dek> dek) const {
+  if (options_.max_cached_decryption_deks == 0) return;
+  absl::string_view encrypted_dek = dek->encrypted_dek;
+  absl::MutexLock lock(&mutex_);
+  auto it = decryption_dek_index_.find(encrypted_dek);
+  if (it != decryption_dek_index_.end()) {
+    // Unwrapped concurrently by another thread.
+    decryption_deks_.splice(decryption_deks_.begin(), decryption_deks_,
+                            it->second);
+    return;
+  }
+  if (decryption_deks_.size() >=
+      static_cast<size_t>(options_.max_cached_decryption_deks)) {
+    // The primitive of the evicted DEK lives on while an encryption
+    // still uses it.
+    decryption_dek_index_.erase(decryption_deks_.back()->encrypted_dek);
+    decryption_deks_.pop_back();
+  }
+  decryption_deks_.push_front(std::move(dek));
+  decryption_dek_index_[encrypted_dek] = decryption_deks_.begin();
+}
+
+util::StatusOr<std::string> KmsEnvelopeAead::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  auto dek_result =
+      reuses_deks() ? GetEncryptionDek(plaintext.size()) : NewDek();
+  if (!dek_result.ok()) return dek_result.status();
+  std::shared_ptr<const Dek> dek = std::move(dek_result.ValueOrDie());
+
   // Encrypt plaintext using DEK.
-  auto aead_result = Registry::GetPrimitive<Aead>(*dek);
-  if (!aead_result.ok()) return aead_result.status();
-  auto aead = std::move(aead_result.ValueOrDie());
-  auto encrypt_result = aead->Encrypt(plaintext, associated_data);
+  auto encrypt_result = dek->aead->Encrypt(plaintext, associated_data);
   if (!encrypt_result.ok()) return encrypt_result.status();
 
   // Build and return ciphertext.
-  return GetEnvelopeCiphertext(dek_encrypt_result.ValueOrDie(),
+  return GetEnvelopeCiphertext(dek->encrypted_dek,
                                encrypt_result.ValueOrDie());
 }
 
@@ -119,28 +239,45 @@ util::StatusOr<std::string> KmsEnvelopeAead::Decrypt(
     return util::Status(util::error::INVALID_ARGUMENT,
                         "invalid ciphertext");
   }
-  // Decrypt the DEK with remote.
-  auto dek_decrypt_result = remote_aead_->Decrypt(
-      ciphertext.substr(kEncryptedDekPrefixSize, enc_dek_size),
-      kEmptyAssociatedData);
-  if (!dek_decrypt_result.ok()) {
-    return util::Status(
-        util::error::INVALID_ARGUMENT,
-        absl::StrCat("invalid ciphertext: ",
-                     dek_decrypt_result.status().error_message()));
-  }
+  absl::string_view encrypted_dek =
+      ciphertext.substr(kEncryptedDekPrefixSize, enc_dek_size);
+  std::shared_ptr<Aead> aead;
+  auto cached_dek = FindDecryptionDek(encrypted_dek);
+  if (cached_dek != nullptr) {
+    aead = cached_dek->aead;
+  } else {
+    // Decrypt the DEK with remote.
+    auto dek_decrypt_result = remote_aead_->Decrypt(
+        encrypted_dek, kEmptyAssociatedData);
+    if (!dek_decrypt_result.ok()) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::StrCat("invalid ciphertext: ",
+                       dek_decrypt_result.status().error_message()));
+    }
 
-  // Create AEAD from DEK.
-  google::crypto::tink::KeyData dek;
-  if (!dek.ParseFromString(dek_decrypt_result.ValueOrDie())) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "invalid ciphertext");
+    // Create AEAD from DEK.
+    google::crypto::tink::KeyData dek;
+    bool parsed = dek.ParseFromString(dek_decrypt_result.ValueOrDie());
+    WipeString(&dek_decrypt_result.ValueOrDie());
+    if (!parsed) {
+      WipeString(dek.mutable_value());
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "invalid ciphertext");
+    }
+    auto aead_result = Registry::GetPrimitive<Aead>(dek);
+    WipeString(dek.mutable_value());
+    if (!aead_result.ok()) return aead_result.status();
+    aead = std::move(aead_result.ValueOrDie());
+    if (options_.max_cached_decryption_deks > 0) {
+      auto new_dek = std::make_shared<Dek>();
+      new_dek->encrypted_dek = std::string(encrypted_dek);
+      new_dek->aead = aead;
+      CacheDecryptionDek(std::move(new_dek));
+    }
   }
 
-  // Encrypt plaintext using DEK.
-  auto aead_result = Registry::GetPrimitive<Aead>(dek);
-  if (!aead_result.ok()) return aead_result.status();
-  auto aead = std::move(aead_result.ValueOrDie());
+  // Decrypt ciphertext using DEK.
   return aead->Decrypt(
       ciphertext.substr(kEncryptedDekPrefixSize + enc_dek_size),
       associated_data);
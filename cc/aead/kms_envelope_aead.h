@@ -15,9 +15,14 @@
 #ifndef TINK_AEAD_KMS_ENVELOPE_AEAD_H_
 #define TINK_AEAD_KMS_ENVELOPE_AEAD_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <list>
 #include <memory>
+#include <string>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/aead.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -40,12 +45,51 @@ namespace tink {
 //  - Encrypted DEK: variable length that is equal to the value
 //    specified in the last 4 bytes.
 //  - AEAD payload: variable length.
+//
+// By default every encryption generates a fresh DEK, and every encryption
+// and decryption makes a call to the KMS to wrap or unwrap it.  Callers
+// for whom these calls are the bottleneck can opt into reusing DEKs via
+// Options: a wrapped DEK is then used for several messages, and the
+// primitives of unwrapped DEKs are cached for decrypting further messages
+// with the same encrypted DEK.  Both trade some of the isolation between
+// messages for fewer calls to the KMS.  When a reused DEK is used up,
+// concurrent encryptions wait for a single replacement rather than each
+// wrapping one of their own.  A 'remote_aead' wrapped in
+// a CoalescingAead additionally bounds the concurrent calls to the KMS,
+// and makes concurrent unwrappings of the same DEK share a single call.
 class KmsEnvelopeAead : public Aead {
  public:
+  typedef std::chrono::steady_clock Clock;
+
+  struct Options {
+    Options()
+        : max_messages_per_dek(1),
+          max_bytes_per_dek(0),
+          max_dek_lifetime(Clock::duration::max()),
+          max_cached_decryption_deks(0) {}
+    // The maximal number of messages encrypted with a DEK, must be
+    // positive.  The default of 1 generates a fresh DEK for each message.
+    int64_t max_messages_per_dek;
+    // The maximal number of plaintext bytes encrypted with a DEK, or 0
+    // if unlimited.  A message larger than this gets a DEK of its own.
+    int64_t max_bytes_per_dek;
+    // The time after its generation beyond which a DEK is no longer used
+    // for encryption, must be positive.
+    Clock::duration max_dek_lifetime;
+    // The maximal number of unwrapped DEKs cached for decryption, or 0
+    // to unwrap the DEK of every ciphertext with the KMS.
+    int max_cached_decryption_deks;
+  };
+
   static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
       const google::crypto::tink::KeyTemplate& dek_template,
       std::unique_ptr<Aead> remote_aead);
 
+  // Like New() above, but reuses and caches DEKs according to 'options'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+      const google::crypto::tink::KeyTemplate& dek_template,
+      std::unique_ptr<Aead> remote_aead, const Options& options);
+
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
       absl::string_view associated_data) const override;
@@ -57,12 +101,69 @@ class KmsEnvelopeAead : public Aead {
   ~KmsEnvelopeAead() override {}
 
  private:
+  // A DEK, in the form stored in ciphertexts, with the primitive for
+  // encrypting and decrypting with it. The plaintext key material is
+  // wiped as soon as the primitive is created and is never cached.
+  struct Dek {
+    std::string encrypted_dek;
+    std::shared_ptr<Aead> aead;
+  };
+
+  typedef std::list<std::shared_ptr<const Dek>> LruList;
+
   KmsEnvelopeAead(const google::crypto::tink::KeyTemplate& dek_template,
-                  std::unique_ptr<Aead> remote_aead) :
-      dek_template_(dek_template), remote_aead_(std::move(remote_aead)) {}
+                  std::unique_ptr<Aead> remote_aead, const Options& options)
+      : dek_template_(dek_template),
+        remote_aead_(std::move(remote_aead)),
+        options_(options),
+        encryption_dek_messages_(0),
+        encryption_dek_bytes_(0),
+        generating_encryption_dek_(false) {}
+
+  bool reuses_deks() const { return options_.max_messages_per_dek > 1; }
+
+  // Generates a DEK and wraps it with the remote AEAD.
+  crypto::tink::util::StatusOr<std::shared_ptr<const Dek>> NewDek() const;
+
+  // Returns the DEK for encrypting a message of 'message_size' bytes and
+  // accounts for the message.  If the current DEK cannot be used, a single
+  // thread generates the next one, while the others wait for it.
+  crypto::tink::util::StatusOr<std::shared_ptr<const Dek>> GetEncryptionDek(
+      int64_t message_size) const LOCKS_EXCLUDED(mutex_);
+
+  // Returns true iff the current DEK can encrypt a further message of
+  // 'message_size' bytes.
+  bool CanUseEncryptionDek(int64_t message_size) const
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns the cached DEK with the given encrypted DEK, or null.
+  std::shared_ptr<const Dek> FindDecryptionDek(
+      absl::string_view encrypted_dek) const LOCKS_EXCLUDED(mutex_);
+
+  // Adds 'dek' to the DEKs cached for decryption.
+  void CacheDecryptionDek(std::shared_ptr<const Dek> dek) const
+      LOCKS_EXCLUDED(mutex_);
 
   google::crypto::tink::KeyTemplate dek_template_;
   std::unique_ptr<Aead> remote_aead_;
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  // The DEK used for encryption, with the number of messages and bytes
+  // it has encrypted, and the time after which it must not be used.
+  mutable std::shared_ptr<const Dek> encryption_dek_ GUARDED_BY(mutex_);
+  mutable int64_t encryption_dek_messages_ GUARDED_BY(mutex_);
+  mutable int64_t encryption_dek_bytes_ GUARDED_BY(mutex_);
+  mutable Clock::time_point encryption_dek_expiry_ GUARDED_BY(mutex_);
+  // Whether a thread is generating the next DEK for encryption, and
+  // the condition signalled when it is done.
+  mutable bool generating_encryption_dek_ GUARDED_BY(mutex_);
+  mutable absl::CondVar encryption_dek_generated_;
+  // The DEKs cached for decryption, the most recently used first,
+  // and indexed by their encrypted DEKs (which the keys point into).
+  mutable LruList decryption_deks_ GUARDED_BY(mutex_);
+  mutable absl::flat_hash_map<absl::string_view, LruList::iterator>
+      decryption_dek_index_ GUARDED_BY(mutex_);
 };
 
 }  // namespace tink
@@ -14,11 +14,14 @@
 
 #include "tink/aead/kms_envelope_aead.h"
 
+#include <chrono>  // NOLINT(build/c++11)
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/registry.h"
 #include "tink/aead/aead_config.h"
 #include "tink/aead/aead_key_templates.h"
@@ -39,6 +42,93 @@ using crypto::tink::test::StatusIs;
 using crypto::tink::test::DummyAead;
 using testing::HasSubstr;
 
+// The numbers of calls to a CountingAead.
+struct RemoteCalls {
+  RemoteCalls() : encryptions(0), decryptions(0) {}
+  int encryptions;
+  int decryptions;
+};
+
+// A remote AEAD which counts its calls in 'calls'.
+class CountingAead : public Aead {
+ public:
+  explicit CountingAead(RemoteCalls* calls)
+      : aead_("kms-backed-aead"), calls_(calls) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    calls_->encryptions++;
+    return aead_.Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    calls_->decryptions++;
+    return aead_.Decrypt(ciphertext, associated_data);
+  }
+
+ private:
+  DummyAead aead_;
+  RemoteCalls* calls_;
+};
+
+// A remote AEAD whose encryptions block until Open() is called.
+class GatedAead : public Aead {
+ public:
+  GatedAead() : aead_("kms-backed-aead"), open_(false), encryptions_(0) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    {
+      absl::MutexLock lock(&mutex_);
+      encryptions_++;
+      mutex_.Await(absl::Condition(&open_));
+    }
+    return aead_.Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    return aead_.Decrypt(ciphertext, associated_data);
+  }
+
+  // Waits until an encryption has started.
+  void AwaitEncryption() const {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](int* encryptions) { return *encryptions > 0; }, &encryptions_));
+  }
+
+  void Open() {
+    absl::MutexLock lock(&mutex_);
+    open_ = true;
+  }
+
+  int encryptions() const {
+    absl::MutexLock lock(&mutex_);
+    return encryptions_;
+  }
+
+ private:
+  DummyAead aead_;
+  mutable absl::Mutex mutex_;
+  bool open_ GUARDED_BY(mutex_);
+  mutable int encryptions_ GUARDED_BY(mutex_);
+};
+
+std::unique_ptr<Aead> NewEnvelopeAead(
+    const KmsEnvelopeAead::Options& options, RemoteCalls* calls) {
+  auto aead_result =
+      KmsEnvelopeAead::New(AeadKeyTemplates::Aes128Gcm(),
+                           absl::make_unique<CountingAead>(calls), options);
+  EXPECT_THAT(aead_result.status(), IsOk());
+  return std::move(aead_result.ValueOrDie());
+}
+
 TEST(KmsEnvelopeAeadTest, BasicEncryptDecrypt) {
   EXPECT_THAT(AeadConfig::Register(), IsOk());
 
@@ -131,6 +221,181 @@ TEST(KmsEnvelopeAeadTest, DecryptionErrors) {
                        HasSubstr("Authentication failed")));
 }
 
+TEST(KmsEnvelopeAeadTest, InvalidOptions) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  std::vector<KmsEnvelopeAead::Options> invalid_options(4);
+  invalid_options[0].max_messages_per_dek = 0;
+  invalid_options[1].max_bytes_per_dek = -1;
+  invalid_options[2].max_dek_lifetime = std::chrono::seconds(0);
+  invalid_options[3].max_cached_decryption_deks = -1;
+  for (const auto& options : invalid_options) {
+    auto aead_result = KmsEnvelopeAead::New(
+        AeadKeyTemplates::Aes128Gcm(),
+        absl::make_unique<DummyAead>("kms-backed-aead"), options);
+    EXPECT_THAT(aead_result.status(), StatusIs(util::error::INVALID_ARGUMENT,
+                                               HasSubstr("options")));
+  }
+}
+
+TEST(KmsEnvelopeAeadTest, NoDekReuseByDefault) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  RemoteCalls calls;
+  auto aead = NewEnvelopeAead(KmsEnvelopeAead::Options(), &calls);
+  std::string aad = "Some data to authenticate.";
+  std::string ct = aead->Encrypt("message", aad).ValueOrDie();
+  EXPECT_NE(ct, aead->Encrypt("message", aad).ValueOrDie());
+  EXPECT_EQ(2, calls.encryptions);
+  for (int i = 0; i < 2; i++) {
+    EXPECT_EQ("message", aead->Decrypt(ct, aad).ValueOrDie());
+  }
+  EXPECT_EQ(2, calls.decryptions);
+}
+
+TEST(KmsEnvelopeAeadTest, DekReuseByMessages) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  KmsEnvelopeAead::Options options;
+  options.max_messages_per_dek = 3;
+  RemoteCalls calls;
+  auto aead = NewEnvelopeAead(options, &calls);
+  std::string aad = "Some data to authenticate.";
+  std::vector<std::string> ciphertexts;
+  for (int i = 0; i < 7; i++) {
+    auto encrypt_result = aead->Encrypt(absl::StrCat("message ", i), aad);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    ciphertexts.push_back(encrypt_result.ValueOrDie());
+  }
+  EXPECT_EQ(3, calls.encryptions);
+  for (int i = 0; i < 7; i++) {
+    auto decrypt_result = aead->Decrypt(ciphertexts[i], aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(absl::StrCat("message ", i), decrypt_result.ValueOrDie());
+  }
+  // Without a decryption cache each DEK is unwrapped with the KMS.
+  EXPECT_EQ(7, calls.decryptions);
+}
+
+TEST(KmsEnvelopeAeadTest, DekReuseByBytes) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  KmsEnvelopeAead::Options options;
+  options.max_messages_per_dek = 1000;
+  options.max_bytes_per_dek = 100;
+  RemoteCalls calls;
+  auto aead = NewEnvelopeAead(options, &calls);
+  std::string message(40, 'm');
+  for (int i = 0; i < 5; i++) {
+    ASSERT_THAT(aead->Encrypt(message, "aad").status(), IsOk());
+  }
+  // Two messages per DEK.
+  EXPECT_EQ(3, calls.encryptions);
+
+  // A message larger than the limit gets a DEK of its own.
+  ASSERT_THAT(aead->Encrypt(std::string(150, 'm'), "aad").status(), IsOk());
+  EXPECT_EQ(4, calls.encryptions);
+  ASSERT_THAT(aead->Encrypt(message, "aad").status(), IsOk());
+  EXPECT_EQ(5, calls.encryptions);
+}
+
+TEST(KmsEnvelopeAeadTest, DekReuseByLifetime) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  KmsEnvelopeAead::Options options;
+  options.max_messages_per_dek = 1000;
+  options.max_dek_lifetime = std::chrono::milliseconds(50);
+  RemoteCalls calls;
+  auto aead = NewEnvelopeAead(options, &calls);
+  ASSERT_THAT(aead->Encrypt("message", "aad").status(), IsOk());
+  ASSERT_THAT(aead->Encrypt("message", "aad").status(), IsOk());
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  ASSERT_THAT(aead->Encrypt("message", "aad").status(), IsOk());
+  EXPECT_EQ(2, calls.encryptions);
+}
+
+TEST(KmsEnvelopeAeadTest, ConcurrentEncryptionsShareNewDek) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  KmsEnvelopeAead::Options options;
+  options.max_messages_per_dek = 1000;
+  auto remote_aead = absl::make_unique<GatedAead>();
+  GatedAead* gated_aead = remote_aead.get();
+  auto aead_result = KmsEnvelopeAead::New(AeadKeyTemplates::Aes128Gcm(),
+                                          std::move(remote_aead), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+
+  std::vector<std::thread> threads;
+  std::vector<util::Status> results(8);
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&aead, &results, i]() {
+      results[i] = aead->Encrypt("message", "aad").status();
+    });
+  }
+  // Let the other threads find that a DEK is being generated.
+  gated_aead->AwaitEncryption();
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  gated_aead->Open();
+  for (auto& thread : threads) thread.join();
+  for (const auto& status : results) EXPECT_THAT(status, IsOk());
+  EXPECT_EQ(1, gated_aead->encryptions());
+}
+
+TEST(KmsEnvelopeAeadTest, DecryptionDekCache) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  RemoteCalls encrypt_calls;
+  auto encrypting_aead =
+      NewEnvelopeAead(KmsEnvelopeAead::Options(), &encrypt_calls);
+  std::string aad = "Some data to authenticate.";
+  std::vector<std::string> ciphertexts;
+  for (int i = 0; i < 3; i++) {
+    ciphertexts.push_back(
+        encrypting_aead->Encrypt(absl::StrCat("message ", i), aad)
+            .ValueOrDie());
+  }
+
+  KmsEnvelopeAead::Options options;
+  options.max_cached_decryption_deks = 2;
+  RemoteCalls calls;
+  auto aead = NewEnvelopeAead(options, &calls);
+  for (int i : {0, 0, 1, 0, 1}) {
+    auto decrypt_result = aead->Decrypt(ciphertexts[i], aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(absl::StrCat("message ", i), decrypt_result.ValueOrDie());
+  }
+  EXPECT_EQ(2, calls.decryptions);
+
+  // The DEK of the first ciphertext is the least recently used one,
+  // hence evicted by that of the third.
+  ASSERT_THAT(aead->Decrypt(ciphertexts[2], aad).status(), IsOk());
+  EXPECT_EQ(3, calls.decryptions);
+  ASSERT_THAT(aead->Decrypt(ciphertexts[1], aad).status(), IsOk());
+  EXPECT_EQ(3, calls.decryptions);
+  ASSERT_THAT(aead->Decrypt(ciphertexts[0], aad).status(), IsOk());
+  EXPECT_EQ(4, calls.decryptions);
+
+  // A cached DEK still authenticates the payload.
+  std::string corrupted_ct = ciphertexts[0];
+  corrupted_ct.back() ^= 1;
+  EXPECT_FALSE(aead->Decrypt(corrupted_ct, aad).ok());
+  EXPECT_FALSE(aead->Decrypt(ciphertexts[0], "wrong aad").ok());
+  EXPECT_EQ(4, calls.decryptions);
+}
+
+TEST(KmsEnvelopeAeadTest, ReusedDeksAreCachedForDecryption) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  KmsEnvelopeAead::Options options;
+  options.max_messages_per_dek = 10;
+  options.max_cached_decryption_deks = 4;
+  RemoteCalls calls;
+  auto aead = NewEnvelopeAead(options, &calls);
+  std::string aad = "Some data to authenticate.";
+  for (int i = 0; i < 20; i++) {
+    std::string message = absl::StrCat("message ", i);
+    auto encrypt_result = aead->Encrypt(message, aad);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    auto decrypt_result = aead->Decrypt(encrypt_result.ValueOrDie(), aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(message, decrypt_result.ValueOrDie());
+  }
+  EXPECT_EQ(2, calls.encryptions);
+  EXPECT_EQ(0, calls.decryptions);
+}
 
 }  // namespace
 }  // namespace tink
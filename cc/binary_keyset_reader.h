@@ -40,6 +40,9 @@ class BinaryKeysetReader : public KeysetReader {
   crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::Keyset>>
   Read() override;
 
+  crypto::tink::util::StatusOr<google::crypto::tink::Keyset*> ReadIntoArena(
+      google::protobuf::Arena* arena) override;
+
   crypto::tink::util::StatusOr<
     std::unique_ptr<google::crypto::tink::EncryptedKeyset>>
   ReadEncrypted() override;
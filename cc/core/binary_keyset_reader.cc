@@ -61,6 +61,16 @@ util::StatusOr<std::unique_ptr<Keyset>> BinaryKeysetReader::Read() {
   return std::move(keyset);
 }
 
+util::StatusOr<Keyset*> BinaryKeysetReader::ReadIntoArena(
+    google::protobuf::Arena* arena) {
+  Keyset* keyset = google::protobuf::Arena::CreateMessage<Keyset>(arena);
+  if (!keyset->ParseFromString(serialized_keyset_)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Could not parse the input stream as a Keyset-proto.");
+  }
+  return keyset;
+}
+
 util::StatusOr<std::unique_ptr<EncryptedKeyset>>
 BinaryKeysetReader::ReadEncrypted() {
   auto enc_keyset = absl::make_unique<EncryptedKeyset>();
@@ -21,6 +21,7 @@
 #include "tink/keyset_handle.h"
 #include "tink/keyset_reader.h"
 #include "tink/util/errors.h"
+#include "tink/util/secret_arena.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
@@ -34,14 +35,15 @@ namespace tink {
 // static
 util::StatusOr<std::unique_ptr<KeysetHandle>> CleartextKeysetHandle::Read(
     std::unique_ptr<KeysetReader> reader) {
-  auto keyset_result = reader->Read();
+  auto arena = std::make_shared<util::SecretArena>();
+  auto keyset_result = reader->ReadIntoArena(arena->get());
   if (!keyset_result.ok()) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Error reading keyset data: %s",
                      keyset_result.status().error_message().c_str());
   }
-  std::unique_ptr<KeysetHandle> handle(
-      new KeysetHandle(std::move(keyset_result.ValueOrDie())));
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle(
+      std::shared_ptr<const Keyset>(arena, keyset_result.ValueOrDie())));
   return std::move(handle);
 }
 
@@ -58,9 +60,10 @@ crypto::tink::util::Status CleartextKeysetHandle::Write(
 // static
 std::unique_ptr<KeysetHandle> CleartextKeysetHandle::GetKeysetHandle(
     const Keyset& keyset) {
-  auto unique_keyset = absl::make_unique<Keyset>(keyset);
-  std::unique_ptr<KeysetHandle> handle =
-      absl::WrapUnique(new KeysetHandle(std::move(unique_keyset)));
+  auto keyset_copy = util::SecretArena::MakeShared<Keyset>();
+  keyset_copy->CopyFrom(keyset);
+  std::unique_ptr<KeysetHandle> handle = absl::WrapUnique(
+      new KeysetHandle(std::shared_ptr<const Keyset>(std::move(keyset_copy))));
   return handle;
 }
 
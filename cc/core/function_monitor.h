@@ -0,0 +1,125 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_CORE_FUNCTION_MONITOR_H_
+#define TINK_CORE_FUNCTION_MONITOR_H_
+
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/monitoring.h"
+#include "tink/primitive_set.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// The monitoring of one function of a wrapped primitive.  Wrappers keep
+// a FunctionMonitor per function, and report each call through a Call:
+//
+//   FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+//   ...
+//   call.Log(key_id, plaintext.size());  // or call.LogFailure();
+//
+// A disabled (default-constructed) monitor costs a null check per report.
+class FunctionMonitor {
+ public:
+  typedef std::chrono::steady_clock Clock;
+
+  class Call {
+   public:
+    void Log(uint32_t key_id, int64_t num_bytes) const {
+      if (client_ == nullptr) return;
+      client_->Log(key_id, num_bytes);
+      if (timed_) LogLatency();
+    }
+
+    void LogFailure() const {
+      if (client_ == nullptr) return;
+      client_->LogFailure();
+      if (timed_) LogLatency();
+    }
+
+    void LogKeyFailure(uint32_t key_id) const {
+      if (client_ != nullptr) client_->LogKeyFailure(key_id);
+    }
+
+   private:
+    friend class FunctionMonitor;
+
+    Call(MonitoringClient* client, bool timed)
+        : client_(client), timed_(timed) {
+      if (timed_) start_ = Clock::now();
+    }
+
+    void LogLatency() const {
+      client_->LogLatency(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              Clock::now() - start_)
+                              .count());
+    }
+
+    MonitoringClient* const client_;
+    const bool timed_;
+    Clock::time_point start_;
+  };
+
+  // Constructs a disabled monitor.
+  FunctionMonitor() : records_latency_(false) {}
+
+  // Returns a monitor of 'api_function' of the 'primitive' wrapping
+  // 'primitive_set', which reports to a client created by 'factory',
+  // or a disabled monitor if 'factory' is null.
+  template <class P>
+  static crypto::tink::util::StatusOr<FunctionMonitor> New(
+      MonitoringClientFactory* factory, PrimitiveSet<P>* primitive_set,
+      absl::string_view primitive, absl::string_view api_function) {
+    if (factory == nullptr) return FunctionMonitor();
+    MonitoringContext context;
+    context.primitive = std::string(primitive);
+    context.api_function = std::string(api_function);
+    for (const auto* entry : primitive_set->get_all()) {
+      context.key_ids.push_back(entry->get_key_id());
+    }
+    context.primary_key_id = primitive_set->get_primary() == nullptr
+                                 ? 0
+                                 : primitive_set->get_primary()->get_key_id();
+    auto client_result = factory->New(context);
+    if (!client_result.ok()) return client_result.status();
+    return FunctionMonitor(std::move(client_result.ValueOrDie()));
+  }
+
+  bool enabled() const { return client_ != nullptr; }
+
+  Call StartCall() const { return Call(client_.get(), records_latency_); }
+
+ private:
+  explicit FunctionMonitor(std::unique_ptr<MonitoringClient> client)
+      : client_(std::move(client)),
+        records_latency_(client_ != nullptr && client_->records_latency()) {}
+
+  std::unique_ptr<MonitoringClient> client_;
+  bool records_latency_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_CORE_FUNCTION_MONITOR_H_
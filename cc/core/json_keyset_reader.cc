@@ -16,14 +16,18 @@
 
 #include "tink/json_keyset_reader.h"
 
+#include <cassert>
+#include <cstdint>
 #include <iostream>
 #include <istream>
 #include <sstream>
 
 #include "absl/memory/memory.h"
-#include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
 #include "include/rapidjson/document.h"
 #include "include/rapidjson/error/en.h"
+#include "include/rapidjson/reader.h"
+#include "tink/util/base64.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
 #include "tink/util/protobuf_helper.h"
@@ -116,14 +120,12 @@ tinkutil::StatusOr<std::unique_ptr<EncryptedKeyset>>
 EncryptedKeysetFromJson(const rapidjson::Document& json_doc) {
   auto status = ValidateEncryptedKeyset(json_doc);
   if (!status.ok()) return status;
-  std::string enc_keyset;
-  if (!absl::Base64Unescape(
-          json_doc["encryptedKeyset"].GetString(), &enc_keyset)) {
+  auto encrypted_keyset = absl::make_unique<EncryptedKeyset>();
+  if (!tinkutil::Base64Decode(json_doc["encryptedKeyset"].GetString(),
+                          encrypted_keyset->mutable_encrypted_keyset())) {
     return tinkutil::Status(tinkutil::error::INVALID_ARGUMENT,
                             "Invalid JSON EncryptedKeyset");
   }
-  auto encrypted_keyset = absl::make_unique<EncryptedKeyset>();
-  encrypted_keyset->set_encrypted_keyset(enc_keyset);
   if (json_doc.HasMember("keysetInfo")) {
     auto keyset_info_result =
         KeysetInfoFromJson(json_doc["keysetInfo"]);
@@ -136,93 +138,263 @@ EncryptedKeysetFromJson(const rapidjson::Document& json_doc) {
   return std::move(encrypted_keyset);
 }
 
-// Helpers for validating and parsing JSON strings with Keyset-protos.
-tinkutil::Status ValidateKeyset(const rapidjson::Document& json_doc) {
-  if (!json_doc.HasMember("primaryKeyId") ||
-      !json_doc["primaryKeyId"].IsUint() ||
-      !json_doc.HasMember("key") ||
-      !json_doc["key"].IsArray() ||
-      json_doc["key"].Size() < 1) {
-    return tinkutil::Status(tinkutil::error::INVALID_ARGUMENT,
-                            "Invalid JSON Keyset");
+// A rapidjson input stream that reads directly from a std::streambuf,
+// so that a keyset stream is parsed as it is read, without first
+// copying all of it to a string.
+class StreambufReadStream {
+ public:
+  typedef char Ch;
+
+  explicit StreambufReadStream(std::streambuf* buffer)
+      : buffer_(buffer), count_(0) {}
+
+  Ch Peek() const {
+    int c = buffer_->sgetc();
+    return c == std::char_traits<char>::eof() ? '\0' : static_cast<Ch>(c);
   }
-  return tinkutil::Status::OK;
-}
 
-tinkutil::Status ValidateKey(const rapidjson::Value& json_value) {
-  if (!json_value.HasMember("keyData") ||
-      !json_value["keyData"].IsObject() ||
-      !json_value.HasMember("status") ||
-      !json_value["status"].IsString() ||
-      !json_value.HasMember("keyId") ||
-      !json_value["keyId"].IsUint() ||
-      !json_value.HasMember("outputPrefixType") ||
-      !json_value["outputPrefixType"].IsString()) {
-    return tinkutil::Status(tinkutil::error::INVALID_ARGUMENT,
-                            "Invalid JSON Key");
+  Ch Take() {
+    int c = buffer_->sbumpc();
+    if (c == std::char_traits<char>::eof()) return '\0';
+    count_++;
+    return static_cast<Ch>(c);
   }
-  return tinkutil::Status::OK;
-}
 
-tinkutil::Status ValidateKeyData(const rapidjson::Value& json_value) {
-  if (!json_value.HasMember("typeUrl") ||
-      !json_value["typeUrl"].IsString() ||
-      !json_value.HasMember("value") ||
-      !json_value["value"].IsString() ||
-      !json_value.HasMember("keyMaterialType") ||
-      !json_value["keyMaterialType"].IsString()) {
-    return tinkutil::Status(tinkutil::error::INVALID_ARGUMENT,
-                            "Invalid JSON KeyData");
+  size_t Tell() const { return count_; }
+
+  // Writing is used only by in-situ parsing, which is not supported.
+  Ch* PutBegin() { assert(false); return nullptr; }
+  void Put(Ch) { assert(false); }
+  void Flush() { assert(false); }
+  size_t PutEnd(Ch*) { assert(false); return 0; }
+
+ private:
+  std::streambuf* buffer_;
+  size_t count_;
+};
+
+// A rapidjson SAX handler that fills in a Keyset directly from the tokens
+// of its JSON representation, without building a DOM of the document,
+// and decodes the key values straight into the KeyData-protos.
+// Members with unknown names are skipped, whatever their values.
+class KeysetHandler
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, KeysetHandler> {
+ public:
+  explicit KeysetHandler(Keyset* keyset)
+      : keyset_(keyset), key_(nullptr), level_(Level::kDocument),
+        field_(Field::kNone), skip_depth_(0), keyset_fields_(0),
+        key_fields_(0), key_data_fields_(0) {}
+
+  bool StartObject() {
+    if (skip_depth_ > 0 || StartSkipping()) {
+      skip_depth_++;
+      return true;
+    }
+    if (level_ == Level::kDocument) {
+      level_ = Level::kKeyset;
+      return true;
+    }
+    if (level_ == Level::kKeyList) {
+      level_ = Level::kKey;
+      key_ = keyset_->add_key();
+      key_fields_ = 0;
+      return true;
+    }
+    if (level_ == Level::kKey && field_ == Field::kKeyData) {
+      level_ = Level::kKeyData;
+      field_ = Field::kNone;
+      key_data_fields_ = 0;
+      return true;
+    }
+    return Fail();
   }
-  return tinkutil::Status::OK;
-}
 
-tinkutil::StatusOr<std::unique_ptr<KeyData>>
-KeyDataFromJson(const rapidjson::Value& json_value) {
-  auto status = ValidateKeyData(json_value);
-  if (!status.ok()) return status;
-  std::string value_field;
-  if (!absl::Base64Unescape(json_value["value"].GetString(), &value_field)) {
-    return tinkutil::Status(tinkutil::error::INVALID_ARGUMENT,
-                            "Invalid JSON KeyData");
+  bool EndObject(rapidjson::SizeType member_count) {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return true;
+    }
+    switch (level_) {
+      case Level::kKeyset:
+        if (keyset_fields_ != KeysetFields()) return Fail();
+        level_ = Level::kDone;
+        return true;
+      case Level::kKey:
+        if (key_fields_ != KeyFields()) return Fail();
+        level_ = Level::kKeyList;
+        return true;
+      case Level::kKeyData:
+        if (key_data_fields_ != KeyDataFields()) return Fail();
+        level_ = Level::kKey;
+        field_ = Field::kKeyData;
+        return SetField(&key_fields_);
+      default:
+        return Fail();
+    }
   }
-  auto key_data = absl::make_unique<KeyData>();
-  key_data->set_type_url(json_value["typeUrl"].GetString());
-  key_data->set_value(value_field);
-  key_data->set_key_material_type(
-      Enums::KeyMaterial(json_value["keyMaterialType"].GetString()));
-  return std::move(key_data);
-}
 
-tinkutil::StatusOr<std::unique_ptr<Keyset::Key>>
-KeyFromJson(const rapidjson::Value& json_value) {
-  auto status = ValidateKey(json_value);
-  if (!status.ok()) return status;
-  auto key_data_result = KeyDataFromJson(json_value["keyData"]);
-  if (!key_data_result.ok()) return key_data_result.status();
+  bool StartArray() {
+    if (skip_depth_ > 0 || StartSkipping()) {
+      skip_depth_++;
+      return true;
+    }
+    if (level_ != Level::kKeyset || field_ != Field::kKeyList) return Fail();
+    level_ = Level::kKeyList;
+    field_ = Field::kNone;
+    return true;
+  }
 
-  auto key = absl::make_unique<Keyset::Key>();
-  key->set_key_id(json_value["keyId"].GetUint());
-  key->set_status(Enums::KeyStatus(json_value["status"].GetString()));
-  key->set_output_prefix_type(
-      Enums::OutputPrefix(json_value["outputPrefixType"].GetString()));
-  *(key->mutable_key_data()) = *(key_data_result.ValueOrDie());
-  return std::move(key);
-}
+  bool EndArray(rapidjson::SizeType element_count) {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return true;
+    }
+    if (level_ != Level::kKeyList || element_count < 1) return Fail();
+    level_ = Level::kKeyset;
+    field_ = Field::kKeyList;
+    return SetField(&keyset_fields_);
+  }
 
-tinkutil::StatusOr<std::unique_ptr<Keyset>>
-KeysetFromJson(const rapidjson::Document& json_doc) {
-  auto status = ValidateKeyset(json_doc);
-  if (!status.ok()) return status;
-  auto keyset = absl::make_unique<Keyset>();
-  keyset->set_primary_key_id(json_doc["primaryKeyId"].GetUint());
-  for (const auto& json_key : json_doc["key"].GetArray()) {
-    auto key_result = KeyFromJson(json_key);
-    if (!key_result.ok()) return key_result.status();
-    *(keyset->add_key()) = *(key_result.ValueOrDie());
+  bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+    if (skip_depth_ > 0) return true;
+    absl::string_view name(str, length);
+    field_ = Field::kUnknown;
+    if (level_ == Level::kKeyset) {
+      if (name == "primaryKeyId") field_ = Field::kPrimaryKeyId;
+      if (name == "key") field_ = Field::kKeyList;
+    } else if (level_ == Level::kKey) {
+      if (name == "keyData") field_ = Field::kKeyData;
+      if (name == "status") field_ = Field::kStatus;
+      if (name == "keyId") field_ = Field::kKeyId;
+      if (name == "outputPrefixType") field_ = Field::kOutputPrefixType;
+    } else if (level_ == Level::kKeyData) {
+      if (name == "typeUrl") field_ = Field::kTypeUrl;
+      if (name == "value") field_ = Field::kValue;
+      if (name == "keyMaterialType") field_ = Field::kKeyMaterialType;
+    }
+    return true;
+  }
+
+  bool String(const char* str, rapidjson::SizeType length, bool copy) {
+    if (skip_depth_ > 0) return true;
+    absl::string_view value(str, length);
+    switch (field_) {
+      case Field::kStatus:
+        key_->set_status(Enums::KeyStatus(value));
+        return SetField(&key_fields_);
+      case Field::kOutputPrefixType:
+        key_->set_output_prefix_type(Enums::OutputPrefix(value));
+        return SetField(&key_fields_);
+      case Field::kTypeUrl:
+        key_->mutable_key_data()->set_type_url(str, length);
+        return SetField(&key_data_fields_);
+      case Field::kValue:
+        if (!tinkutil::Base64Decode(value,
+                                key_->mutable_key_data()->mutable_value())) {
+          return Fail();
+        }
+        return SetField(&key_data_fields_);
+      case Field::kKeyMaterialType:
+        key_->mutable_key_data()->set_key_material_type(
+            Enums::KeyMaterial(value));
+        return SetField(&key_data_fields_);
+      default:
+        return Default();
+    }
+  }
+
+  bool Uint(unsigned value) {
+    if (skip_depth_ > 0) return true;
+    switch (field_) {
+      case Field::kPrimaryKeyId:
+        keyset_->set_primary_key_id(value);
+        return SetField(&keyset_fields_);
+      case Field::kKeyId:
+        key_->set_key_id(value);
+        return SetField(&key_fields_);
+      default:
+        return Default();
+    }
+  }
+
+  // Handles all the other values, which are valid only within
+  // the values of unknown members.
+  bool Default() {
+    if (skip_depth_ > 0) return true;
+    if (field_ != Field::kUnknown) return Fail();
+    field_ = Field::kNone;
+    return true;
+  }
+
+  const tinkutil::Status& status() const { return status_; }
+
+ private:
+  // The JSON object (or array) that is currently being parsed.
+  enum class Level { kDocument, kKeyset, kKeyList, kKey, kKeyData, kDone };
+
+  // The member whose value is expected next.
+  enum class Field {
+    kNone,
+    kUnknown,
+    kPrimaryKeyId,
+    kKeyList,
+    kKeyData,
+    kStatus,
+    kKeyId,
+    kOutputPrefixType,
+    kTypeUrl,
+    kValue,
+    kKeyMaterialType,
+  };
+
+  static uint32_t Bit(Field field) { return 1u << static_cast<int>(field); }
+
+  // The required members of each level.
+  static uint32_t KeysetFields() {
+    return Bit(Field::kPrimaryKeyId) | Bit(Field::kKeyList);
+  }
+  static uint32_t KeyFields() {
+    return Bit(Field::kKeyData) | Bit(Field::kStatus) | Bit(Field::kKeyId) |
+           Bit(Field::kOutputPrefixType);
+  }
+  static uint32_t KeyDataFields() {
+    return Bit(Field::kTypeUrl) | Bit(Field::kValue) |
+           Bit(Field::kKeyMaterialType);
+  }
+
+  // Records that the value of the current member has been parsed.
+  bool SetField(uint32_t* fields) {
+    *fields |= Bit(field_);
+    field_ = Field::kNone;
+    return true;
+  }
+
+  // Returns true if the object or array that starts is the value
+  // of an unknown member, and hence has to be skipped.
+  bool StartSkipping() {
+    if (field_ != Field::kUnknown) return false;
+    field_ = Field::kNone;
+    return true;
   }
-  return std::move(keyset);
-}
+
+  bool Fail() {
+    const char* message = "Invalid JSON Keyset";
+    if (level_ == Level::kKey) message = "Invalid JSON Key";
+    if (level_ == Level::kKeyData) message = "Invalid JSON KeyData";
+    status_ = tinkutil::Status(tinkutil::error::INVALID_ARGUMENT, message);
+    return false;
+  }
+
+  Keyset* keyset_;
+  Keyset::Key* key_;
+  Level level_;
+  Field field_;
+  int skip_depth_;
+  uint32_t keyset_fields_;
+  uint32_t key_fields_;
+  uint32_t key_data_fields_;
+  tinkutil::Status status_;
+};
 
 }  // namespace
 
@@ -247,23 +419,38 @@ tinkutil::StatusOr<std::unique_ptr<KeysetReader>> JsonKeysetReader::New(
 }
 
 tinkutil::StatusOr<std::unique_ptr<Keyset>> JsonKeysetReader::Read() {
-  std::string serialized_keyset_from_stream;
-  std::string* serialized_keyset;
+  auto keyset = absl::make_unique<Keyset>();
+  auto status = ReadInto(keyset.get());
+  if (!status.ok()) return status;
+  return std::move(keyset);
+}
+
+tinkutil::StatusOr<Keyset*> JsonKeysetReader::ReadIntoArena(
+    google::protobuf::Arena* arena) {
+  Keyset* keyset = google::protobuf::Arena::CreateMessage<Keyset>(arena);
+  auto status = ReadInto(keyset);
+  if (!status.ok()) return status;
+  return keyset;
+}
+
+tinkutil::Status JsonKeysetReader::ReadInto(Keyset* keyset) {
+  KeysetHandler handler(keyset);
+  rapidjson::Reader reader;
   if (keyset_stream_ == nullptr) {
-    serialized_keyset = &serialized_keyset_;
+    rapidjson::StringStream stream(serialized_keyset_.c_str());
+    reader.Parse(stream, handler);
   } else {
-    serialized_keyset_from_stream = std::string(
-        std::istreambuf_iterator<char>(*keyset_stream_), {});
-    serialized_keyset = &serialized_keyset_from_stream;
+    StreambufReadStream stream(keyset_stream_->rdbuf());
+    reader.Parse(stream, handler);
   }
-  rapidjson::Document json_doc(rapidjson::kObjectType);
-  if (json_doc.Parse(serialized_keyset->c_str()).HasParseError()) {
+  if (!handler.status().ok()) return handler.status();
+  if (reader.HasParseError()) {
     return ToStatusF(tinkutil::error::INVALID_ARGUMENT,
                      "Invalid JSON Keyset: Error (offset %u): %s",
-                     static_cast<unsigned>(json_doc.GetErrorOffset()),
-                     rapidjson::GetParseError_En(json_doc.GetParseError()));
+                     static_cast<unsigned>(reader.GetErrorOffset()),
+                     rapidjson::GetParseError_En(reader.GetParseErrorCode()));
   }
-  return KeysetFromJson(json_doc);
+  return tinkutil::Status::OK;
 }
 
 tinkutil::StatusOr<std::unique_ptr<EncryptedKeyset>>
@@ -21,6 +21,7 @@
 #include <sstream>
 
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "tink/util/protobuf_helper.h"
 #include "tink/util/test_util.h"
 #include "gtest/gtest.h"
@@ -274,6 +275,116 @@ TEST_F(JsonKeysetReaderTest, testReadEncryptedFromStream) {
   }
 }
 
+TEST_F(JsonKeysetReaderTest, testReadLargeKeyset) {
+  Keyset keyset;
+  std::string json_keys;
+  for (uint32_t key_id = 1; key_id <= 1000; key_id++) {
+    AesGcmKey key;
+    key.set_key_value(absl::StrCat("gcm key value ", key_id));
+    key.set_version(0);
+    AddRawKey("type.googleapis.com/google.crypto.tink.AesGcmKey", key_id, key,
+              KeyStatusType::ENABLED, KeyData::SYMMETRIC, &keyset);
+    absl::StrAppend(
+        &json_keys, key_id == 1 ? "" : ",",
+        "{\"keyData\": {"
+        "\"typeUrl\": \"type.googleapis.com/google.crypto.tink.AesGcmKey\","
+        "\"keyMaterialType\": \"SYMMETRIC\","
+        "\"value\": \"", absl::Base64Escape(key.SerializeAsString()), "\"},"
+        "\"outputPrefixType\": \"RAW\", \"keyId\": ", key_id, ","
+        "\"status\": \"ENABLED\"}");
+  }
+  keyset.set_primary_key_id(500);
+  std::string json_keyset =
+      absl::StrCat("{\"primaryKeyId\": 500, \"key\": [", json_keys, "]}");
+
+  auto reader = std::move(JsonKeysetReader::New(json_keyset).ValueOrDie());
+  auto read_result = reader->Read();
+  ASSERT_TRUE(read_result.ok()) << read_result.status();
+  EXPECT_EQ(keyset.SerializeAsString(),
+            read_result.ValueOrDie()->SerializeAsString());
+
+  std::unique_ptr<std::istream> json_stream(new std::stringstream(
+      json_keyset, std::ios_base::in));
+  auto stream_reader = std::move(
+      JsonKeysetReader::New(std::move(json_stream)).ValueOrDie());
+  auto stream_read_result = stream_reader->Read();
+  ASSERT_TRUE(stream_read_result.ok()) << stream_read_result.status();
+  EXPECT_EQ(keyset.SerializeAsString(),
+            stream_read_result.ValueOrDie()->SerializeAsString());
+}
+
+TEST_F(JsonKeysetReaderTest, testUnknownMembersAreIgnored) {
+  std::string unknown_members =
+      "\"unknownNumber\": -1.5, \"unknownNull\": null, \"unknownBool\": true,"
+      "\"unknownObject\": {\"key\": [{\"keyId\": \"nested\"}], \"value\": 1},"
+      "\"unknownArray\": [[], {}, [{\"status\": 0}], \"string\"],";
+  std::string json_keyset = good_json_keyset;
+  for (const std::string& object_start :
+       {"\"primaryKeyId\"", "\"keyData\"", "\"typeUrl\""}) {
+    for (size_t pos = json_keyset.find(object_start); pos != std::string::npos;
+         pos = json_keyset.find(object_start, pos + unknown_members.size() +
+                                                   object_start.size())) {
+      json_keyset.insert(pos, unknown_members);
+    }
+  }
+
+  auto reader = std::move(JsonKeysetReader::New(json_keyset).ValueOrDie());
+  auto read_result = reader->Read();
+  ASSERT_TRUE(read_result.ok()) << read_result.status();
+  EXPECT_EQ(keyset_.SerializeAsString(),
+            read_result.ValueOrDie()->SerializeAsString());
+}
+
+TEST_F(JsonKeysetReaderTest, testReadInvalidKeysets) {
+  std::string key_data =
+      "\"keyData\": {\"typeUrl\": \"some type url\","
+      " \"keyMaterialType\": \"SYMMETRIC\", \"value\": \"dmFsdWU=\"}";
+  std::string key_fields = "\"outputPrefixType\": \"TINK\", \"keyId\": 42";
+  std::string key = absl::StrCat(
+      "{", key_data, ", ", key_fields, ", \"status\": \"ENABLED\"}");
+  std::string valid_keyset =
+      absl::StrCat("{\"primaryKeyId\": 42, \"key\": [", key, "]}");
+  ASSERT_TRUE(JsonKeysetReader::New(valid_keyset).ValueOrDie()->Read().ok());
+
+  for (const std::string& invalid_keyset : {
+           std::string(""),
+           std::string("[]"),
+           std::string("\"keyset\""),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [", key, "]"),
+           absl::StrCat("{\"key\": [", key, "]}"),
+           std::string("{\"primaryKeyId\": 42}"),
+           std::string("{\"primaryKeyId\": 42, \"key\": []}"),
+           absl::StrCat("{\"primaryKeyId\": -42, \"key\": [", key, "]}"),
+           absl::StrCat("{\"primaryKeyId\": \"42\", \"key\": [", key, "]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": ", key, "}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [[", key, "]]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [", key, ", 1]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [{", key_data, ", ",
+                        key_fields, "}]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [{", key_data, ", ",
+                        key_fields, ", \"status\": 1}]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [{", key_fields,
+                        ", \"status\": \"ENABLED\"}]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [{",
+                        "\"keyData\": {\"typeUrl\": \"some type url\", "
+                        "\"keyMaterialType\": \"SYMMETRIC\"}, ",
+                        key_fields, ", \"status\": \"ENABLED\"}]}"),
+           absl::StrCat("{\"primaryKeyId\": 42, \"key\": [{",
+                        "\"keyData\": {\"typeUrl\": \"some type url\", "
+                        "\"keyMaterialType\": \"SYMMETRIC\", "
+                        "\"value\": \"not base64!\"}, ",
+                        key_fields, ", \"status\": \"ENABLED\"}]}"),
+           absl::StrCat(valid_keyset, " trailing garbage"),
+       }) {
+    SCOPED_TRACE(invalid_keyset);
+    auto reader = std::move(JsonKeysetReader::New(invalid_keyset).ValueOrDie());
+    auto read_result = reader->Read();
+    EXPECT_FALSE(read_result.ok());
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              read_result.status().error_code());
+  }
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
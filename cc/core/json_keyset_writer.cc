@@ -20,9 +20,9 @@
 #include <istream>
 #include <sstream>
 
-#include "absl/strings/escaping.h"
 #include "include/rapidjson/document.h"
 #include "include/rapidjson/prettywriter.h"
+#include "tink/util/base64.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
 #include "tink/util/protobuf_helper.h"
@@ -58,7 +58,7 @@ tinkutil::Status ToJson(const KeyData& key_data,
   json_key_data->AddMember("keyMaterialType", material_type, *allocator);
 
   std::string base64_string;
-  absl::Base64Escape(key_data.value(), &base64_string);
+  tinkutil::Base64Encode(key_data.value(), &base64_string);
   rapidjson::Value key_value(rapidjson::kStringType);
   key_value.SetString(base64_string.c_str(), *allocator);
   json_key_data->AddMember("value", key_value, *allocator);
@@ -156,7 +156,7 @@ tinkutil::StatusOr<std::string> ToJsonString(const EncryptedKeyset& keyset) {
   auto& allocator = json_doc.GetAllocator();
 
   std::string base64_string;
-  absl::Base64Escape(keyset.encrypted_keyset(), &base64_string);
+  tinkutil::Base64Encode(keyset.encrypted_keyset(), &base64_string);
   rapidjson::Value encrypted_keyset(rapidjson::kStringType);
   encrypted_keyset.SetString(base64_string.c_str(), allocator);
   json_doc.AddMember("encryptedKeyset", encrypted_keyset, allocator);
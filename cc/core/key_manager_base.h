@@ -25,6 +25,7 @@
 #include "tink/key_manager.h"
 #include "tink/util/constants.h"
 #include "tink/util/errors.h"
+#include "tink/util/secret_arena.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
 
@@ -92,13 +93,16 @@ class KeyManagerBase : public KeyManager<Primitive> {
   crypto::tink::util::StatusOr<std::unique_ptr<Primitive>> GetPrimitive(
       const google::crypto::tink::KeyData& key_data) const override {
     if (this->DoesSupport(key_data.type_url())) {
-      KeyProto key_proto;
-      if (!key_proto.ParseFromString(key_data.value())) {
+      // The key is parsed into a stack buffer, which is wiped afterwards.
+      alignas(8) char arena_block[util::SecretArena::kInitialBlockSize];
+      util::SecretArena arena(arena_block, sizeof(arena_block));
+      KeyProto* key_proto = arena.Create<KeyProto>();
+      if (!key_proto->ParseFromString(key_data.value())) {
         return ToStatusF(util::error::INVALID_ARGUMENT,
                          "Could not parse key_data.value as key type '%s'.",
                          key_data.type_url().c_str());
       }
-      return GetPrimitiveFromKey(key_proto);
+      return GetPrimitiveFromKey(*key_proto);
     } else {
       return ToStatusF(util::error::INVALID_ARGUMENT,
                        "Key type '%s' is not supported by this manager.",
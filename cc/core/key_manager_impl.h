@@ -17,6 +17,7 @@
 #include "tink/core/internal_key_manager.h"
 #include "tink/core/key_manager_base.h"
 #include "tink/key_manager.h"
+#include "tink/util/secret_arena.h"
 #include "tink/util/status.h"
 #include "proto/tink.pb.h"
 
@@ -171,17 +172,21 @@ class KeyManagerImpl<Primitive, InternalKeyManager<KeyProto, KeyFormatProto,
                        "Key type '%s' is not supported by this manager.",
                        key_data.type_url().c_str());
     }
-    KeyProto key_proto;
-    if (!key_proto.ParseFromString(key_data.value())) {
+    // The key is parsed into a stack buffer, which is wiped afterwards.
+    alignas(8) char arena_block[util::SecretArena::kInitialBlockSize];
+    util::SecretArena arena(arena_block, sizeof(arena_block));
+    KeyProto* key_proto = arena.Create<KeyProto>();
+    if (!key_proto->ParseFromString(key_data.value())) {
       return ToStatusF(util::error::INVALID_ARGUMENT,
                        "Could not parse key_data.value as key type '%s'.",
                        key_data.type_url().c_str());
     }
-    auto validation = internal_key_manager_->ValidateKey(key_proto);
+    auto validation = internal_key_manager_->ValidateKey(*key_proto);
     if (!validation.ok()) {
       return validation;
     }
-    return internal_key_manager_->template GetPrimitive<Primitive>(key_proto);
+    return internal_key_manager_->template GetPrimitive<Primitive>(
+        *key_proto);
   }
 
   crypto::tink::util::StatusOr<std::unique_ptr<Primitive>> GetPrimitive(
@@ -15,13 +15,16 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "tink/keyset_handle.h"
 
-#include <random>
+#include <string.h>
+
 #include "absl/memory/memory.h"
 #include "tink/aead.h"
 #include "tink/keyset_reader.h"
 #include "tink/keyset_writer.h"
 #include "tink/registry.h"
+#include "tink/subtle/random.h"
 #include "tink/util/errors.h"
+#include "tink/util/secret_arena.h"
 #include "proto/tink.pb.h"
 
 using google::crypto::tink::EncryptedKeyset;
@@ -45,12 +48,13 @@ Encrypt(const Keyset& keyset, const Aead& master_key_aead) {
   return std::move(enc_keyset);
 }
 
-util::StatusOr<std::unique_ptr<Keyset>>
+// The decrypted keyset is parsed into a SecretArena of its own.
+util::StatusOr<std::shared_ptr<Keyset>>
 Decrypt(const EncryptedKeyset& enc_keyset, const Aead& master_key_aead) {
   auto decrypt_result = master_key_aead.Decrypt(
           enc_keyset.encrypted_keyset(), /* associated_data= */ "");
   if (!decrypt_result.ok()) return decrypt_result.status();
-  auto keyset = absl::make_unique<Keyset>();
+  auto keyset = util::SecretArena::MakeShared<Keyset>();
   if (!keyset->ParseFromString(decrypt_result.ValueOrDie())) {
     return util::Status(util::error::INVALID_ARGUMENT,
         "Could not parse the decrypted data as a Keyset-proto.");
@@ -59,10 +63,10 @@ Decrypt(const EncryptedKeyset& enc_keyset, const Aead& master_key_aead) {
 }
 
 uint32_t NewKeyId() {
-  std::random_device rd;
-  std::minstd_rand0 gen(rd());
-  std::uniform_int_distribution<uint32_t> dist;
-  return dist(gen);
+  std::string random = subtle::Random::GetRandomBytes(sizeof(uint32_t));
+  uint32_t key_id;
+  memcpy(&key_id, random.data(), sizeof(uint32_t));
+  return key_id;
 }
 
 uint32_t GenerateUnusedKeyId(const Keyset& keyset) {
@@ -113,22 +117,23 @@ util::StatusOr<std::unique_ptr<KeysetHandle>> KeysetHandle::Read(
                      keyset_result.status().error_message().c_str());
   }
 
-  std::unique_ptr<KeysetHandle> handle(
-      new KeysetHandle(std::move(keyset_result.ValueOrDie())));
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle(
+      std::shared_ptr<const Keyset>(std::move(keyset_result.ValueOrDie()))));
   return std::move(handle);
 }
 
 // static
 util::StatusOr<std::unique_ptr<KeysetHandle>> KeysetHandle::ReadNoSecret(
     const std::string& serialized_keyset) {
-  Keyset keyset;
-  if (!keyset.ParseFromString(serialized_keyset)) {
+  auto keyset = util::SecretArena::MakeShared<Keyset>();
+  if (!keyset->ParseFromString(serialized_keyset)) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Could not parse the input string as a Keyset-proto.");
   }
-  util::Status validation = ValidateNoSecret(keyset);
+  util::Status validation = ValidateNoSecret(*keyset);
   if (!validation.ok()) return validation;
-  return absl::WrapUnique(new KeysetHandle(std::move(keyset)));
+  return absl::WrapUnique(
+      new KeysetHandle(std::shared_ptr<const Keyset>(std::move(keyset))));
 }
 
 util::Status KeysetHandle::Write(KeysetWriter* writer,
@@ -216,13 +221,16 @@ crypto::tink::util::StatusOr<uint32_t> KeysetHandle::AddToKeyset(
 }
 
 KeysetHandle::KeysetHandle(Keyset keyset)
-    : keyset_(std::move(keyset)) {}
+    : keyset_(std::make_shared<Keyset>(std::move(keyset))) {}
 
 KeysetHandle::KeysetHandle(std::unique_ptr<Keyset> keyset)
-    : keyset_(std::move(*keyset)) {}
+    : keyset_(std::move(keyset)) {}
+
+KeysetHandle::KeysetHandle(std::shared_ptr<const Keyset> keyset)
+    : keyset_(std::move(keyset)) {}
 
 const Keyset& KeysetHandle::get_keyset() const {
-  return keyset_;
+  return *keyset_;
 }
 
 }  // namespace tink
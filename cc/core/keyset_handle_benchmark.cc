@@ -0,0 +1,102 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of obtaining primitives from keysets, and of registering
+// the key managers of all the primitives at startup.
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/config/tink_config.h"
+#include "tink/keyset_handle.h"
+#include "tink/registry.h"
+#include "tink/util/allocation_counter.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AllocationCounter;
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::GetShared;
+using crypto::tink::test::NewKeysetHandle;
+using crypto::tink::test::SetAllocationCounters;
+using crypto::tink::test::ThreadCounts;
+using google::crypto::tink::OutputPrefixType;
+
+// Measures KeysetHandle::GetPrimitive() for an AES128-GCM keyset
+// with state.range(0) keys.
+void BM_GetPrimitive(benchmark::State& state) {
+  int num_keys = state.range(0);
+  auto handle_result = GetShared<KeysetHandle>(
+      absl::StrCat(num_keys), [=]() {
+        auto status = AeadConfig::Register();
+        if (!status.ok()) {
+          return util::StatusOr<std::unique_ptr<KeysetHandle>>(status);
+        }
+        return NewKeysetHandle(AeadKeyTemplates::Aes128Gcm(), num_keys,
+                               OutputPrefixType::TINK);
+      });
+  if (!CheckOk(handle_result.status(), &state)) return;
+  const KeysetHandle& handle = *handle_result.ValueOrDie();
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto aead_result = handle.GetPrimitive<Aead>();
+    if (!CheckOk(aead_result.status(), &state)) break;
+    benchmark::DoNotOptimize(aead_result.ValueOrDie().get());
+  }
+  SetAllocationCounters(allocations, &state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Measures TinkConfig::Register() in a freshly reset registry.
+// Since it resets the global registry, it must run after all the other
+// benchmarks, and it registers TinkConfig again when it is done.
+void BM_TinkConfigRegister(benchmark::State& state) {
+  int64_t allocations = 0;
+  int64_t allocated_bytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Registry::Reset();
+    state.ResumeTiming();
+    AllocationCounter counter;
+    if (!CheckOk(TinkConfig::Register(), &state)) break;
+    allocations += counter.allocations();
+    allocated_bytes += counter.bytes();
+  }
+  state.counters["allocs"] =
+      benchmark::Counter(allocations, benchmark::Counter::kAvgIterations);
+  state.counters["alloc_bytes"] =
+      benchmark::Counter(allocated_bytes, benchmark::Counter::kAvgIterations);
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_GetPrimitive)->Arg(1)->Arg(16)->Arg(256);
+BENCHMARK(BM_GetPrimitive)->Arg(1)->Apply(ThreadCounts);
+BENCHMARK(BM_TinkConfigRegister);
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
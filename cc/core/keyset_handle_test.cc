@@ -24,6 +24,7 @@
 #include "tink/binary_keyset_reader.h"
 #include "tink/cleartext_keyset_handle.h"
 #include "tink/config/tink_config.h"
+#include "tink/crypto_format.h"
 #include "tink/json_keyset_reader.h"
 #include "tink/json_keyset_writer.h"
 #include "tink/signature/ecdsa_sign_key_manager.h"
@@ -32,6 +33,7 @@
 #include "tink/util/test_keyset_handle.h"
 #include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
+#include "tink/util/thread_pool.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
@@ -386,12 +388,12 @@ TEST_F(KeysetHandleTest, GetPrimitive) {
   KeyData key_data_0 =
       *Registry::NewKeyData(AeadKeyTemplates::Aes128Gcm()).ValueOrDie();
   AddKeyData(key_data_0, /*key_id=*/0,
-             google::crypto::tink::OutputPrefixType::TINK,
+             OutputPrefixType::TINK,
              KeyStatusType::ENABLED, &keyset);
   KeyData key_data_1 =
       *Registry::NewKeyData(AeadKeyTemplates::Aes256Gcm()).ValueOrDie();
   AddKeyData(key_data_1, /*key_id=*/1,
-             google::crypto::tink::OutputPrefixType::TINK,
+             OutputPrefixType::TINK,
              KeyStatusType::ENABLED, &keyset);
   KeyData key_data_2 =
       *Registry::NewKeyData(AeadKeyTemplates::Aes256Gcm()).ValueOrDie();
@@ -424,7 +426,7 @@ TEST_F(KeysetHandleTest, GetPrimitive) {
 TEST_F(KeysetHandleTest, GetPrimitiveNullptrKeyManager) {
   Keyset keyset;
   AddKeyData(*Registry::NewKeyData(AeadKeyTemplates::Aes128Gcm()).ValueOrDie(),
-             /*key_id=*/0, google::crypto::tink::OutputPrefixType::TINK,
+             /*key_id=*/0, OutputPrefixType::TINK,
              KeyStatusType::ENABLED, &keyset);
   keyset.set_primary_key_id(0);
   std::unique_ptr<KeysetHandle> keyset_handle =
@@ -450,6 +452,112 @@ TEST_F(KeysetHandleTest, GetPrimitiveCustomKeyManager) {
   ASSERT_TRUE(handle->GetPrimitive<Aead>(&key_manager).ok());
 }
 
+TEST_F(KeysetHandleTest, GetPrimitiveInParallel) {
+  Keyset keyset;
+  for (int key_id = 0; key_id < 20; key_id++) {
+    AddKeyData(
+        *Registry::NewKeyData(AeadKeyTemplates::Aes128Gcm()).ValueOrDie(),
+        key_id, OutputPrefixType::TINK,
+        KeyStatusType::ENABLED, &keyset);
+  }
+  keyset.set_primary_key_id(7);
+  std::unique_ptr<KeysetHandle> keyset_handle =
+      TestKeysetHandle::GetKeysetHandle(keyset);
+  auto aead_result = keyset_handle->GetPrimitive<Aead>();
+  ASSERT_THAT(aead_result.status(), IsOk());
+  std::unique_ptr<Aead> aead = std::move(aead_result.ValueOrDie());
+
+  util::ThreadPool thread_pool(4);
+  for (util::ThreadPool* pool : {&thread_pool,
+                                 static_cast<util::ThreadPool*>(nullptr)}) {
+    auto parallel_aead_result =
+        keyset_handle->GetPrimitiveInParallel<Aead>(pool);
+    ASSERT_THAT(parallel_aead_result.status(), IsOk());
+    std::unique_ptr<Aead> parallel_aead =
+        std::move(parallel_aead_result.ValueOrDie());
+
+    // Both use the same primary, and can decrypt each other's ciphertexts.
+    std::string ciphertext = aead->Encrypt("plaintext", "aad").ValueOrDie();
+    std::string parallel_ciphertext =
+        parallel_aead->Encrypt("plaintext", "aad").ValueOrDie();
+    EXPECT_EQ(ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize),
+              parallel_ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize));
+    EXPECT_EQ("plaintext",
+              parallel_aead->Decrypt(ciphertext, "aad").ValueOrDie());
+    EXPECT_EQ("plaintext",
+              aead->Decrypt(parallel_ciphertext, "aad").ValueOrDie());
+  }
+}
+
+TEST_F(KeysetHandleTest, GetPrimitiveInParallelReturnsFirstError) {
+  Keyset keyset;
+  for (int key_id = 0; key_id < 10; key_id++) {
+    KeyData key_data =
+        *Registry::NewKeyData(AeadKeyTemplates::Aes128Gcm()).ValueOrDie();
+    if (key_id == 3) key_data.set_type_url("type.googleapis.com/UnknownKey");
+    if (key_id == 8) key_data.set_value("invalid key");
+    AddKeyData(key_data, key_id, OutputPrefixType::TINK,
+               KeyStatusType::ENABLED, &keyset);
+  }
+  keyset.set_primary_key_id(0);
+  std::unique_ptr<KeysetHandle> keyset_handle =
+      TestKeysetHandle::GetKeysetHandle(keyset);
+  auto status = keyset_handle->GetPrimitive<Aead>().status();
+  EXPECT_THAT(status, StatusIs(util::error::NOT_FOUND));
+
+  util::ThreadPool thread_pool(4);
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(status,
+              keyset_handle->GetPrimitiveInParallel<Aead>(&thread_pool)
+                  .status());
+  }
+}
+
+TEST_F(KeysetHandleTest, GetLazyPrimitive) {
+  Keyset keyset;
+  for (int key_id = 0; key_id < 5; key_id++) {
+    AddKeyData(
+        *Registry::NewKeyData(AeadKeyTemplates::Aes128Gcm()).ValueOrDie(),
+        key_id, OutputPrefixType::TINK, KeyStatusType::ENABLED, &keyset);
+  }
+  keyset.set_primary_key_id(4);
+  std::unique_ptr<KeysetHandle> keyset_handle =
+      TestKeysetHandle::GetKeysetHandle(keyset);
+  auto lazy_aead_result = keyset_handle->GetLazyPrimitive<Aead>();
+  ASSERT_THAT(lazy_aead_result.status(), IsOk());
+  std::unique_ptr<Aead> lazy_aead =
+      std::move(lazy_aead_result.ValueOrDie());
+
+  // Ciphertexts of the non-primary keys can be decrypted.
+  for (int primary_key_id = 0; primary_key_id < 5; primary_key_id++) {
+    keyset.set_primary_key_id(primary_key_id);
+    auto aead = TestKeysetHandle::GetKeysetHandle(keyset)
+                    ->GetPrimitive<Aead>().ValueOrDie();
+    std::string ciphertext = aead->Encrypt("plaintext", "aad").ValueOrDie();
+    EXPECT_EQ("plaintext",
+              lazy_aead->Decrypt(ciphertext, "aad").ValueOrDie());
+    EXPECT_EQ("plaintext",
+              aead->Decrypt(lazy_aead->Encrypt("plaintext", "aad")
+                                .ValueOrDie(), "aad").ValueOrDie());
+  }
+
+  // Invalid non-primary keys are not noticed until they are used.
+  keyset.mutable_key(1)->mutable_key_data()->set_value("invalid key");
+  keyset.set_primary_key_id(4);
+  keyset_handle = TestKeysetHandle::GetKeysetHandle(keyset);
+  EXPECT_FALSE(keyset_handle->GetPrimitive<Aead>().ok());
+  auto partially_invalid_result = keyset_handle->GetLazyPrimitive<Aead>();
+  ASSERT_THAT(partially_invalid_result.status(), IsOk());
+  lazy_aead = std::move(partially_invalid_result.ValueOrDie());
+  std::string ciphertext = lazy_aead->Encrypt("plaintext", "aad").ValueOrDie();
+  EXPECT_EQ("plaintext", lazy_aead->Decrypt(ciphertext, "aad").ValueOrDie());
+
+  // The primary key is created upfront.
+  keyset.set_primary_key_id(1);
+  keyset_handle = TestKeysetHandle::GetKeysetHandle(keyset);
+  EXPECT_FALSE(keyset_handle->GetLazyPrimitive<Aead>().ok());
+}
+
 // Compile time check: ensures that the KeysetHandle can be copied.
 TEST_F(KeysetHandleTest, Copiable) {
   auto handle_result = KeysetHandle::GenerateNew(AeadKeyTemplates::Aes128Eax());
@@ -17,26 +17,42 @@
 #include "tink/keyset_manager.h"
 
 #include <inttypes.h>
-#include <random>
+#include <string.h>
+
+#include <unordered_set>
 
 #include "absl/memory/memory.h"
 #include "tink/keyset_handle.h"
 #include "tink/keyset_reader.h"
 #include "tink/registry.h"
+#include "tink/subtle/random.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
+#include "tink/util/secret_arena.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
 namespace tink {
 
+using google::crypto::tink::KeyData;
 using google::crypto::tink::Keyset;
 using google::crypto::tink::KeyStatusType;
 using google::crypto::tink::KeyTemplate;
+using google::crypto::tink::OutputPrefixType;
 using crypto::tink::util::Enums;
 using crypto::tink::util::Status;
 using crypto::tink::util::StatusOr;
 
+namespace {
+
+Status KeyNotFoundError(uint32_t key_id) {
+  return ToStatusF(util::error::NOT_FOUND,
+                   "No key with key_id %" PRIu32 " found in the keyset.",
+                   key_id);
+}
+
+}  // namespace
+
 // static
 StatusOr<std::unique_ptr<KeysetManager>> KeysetManager::New(
     const KeyTemplate& key_template) {
@@ -52,14 +68,18 @@ StatusOr<std::unique_ptr<KeysetManager>> KeysetManager::New(
   auto manager = absl::make_unique<KeysetManager>();
   absl::MutexLock lock(&manager->keyset_mutex_);
   manager->keyset_ = keyset_handle.get_keyset();
+  manager->RebuildIndex();
   return std::move(manager);
 }
 
 std::unique_ptr<KeysetHandle> KeysetManager::GetKeysetHandle() {
-  absl::MutexLock lock(&keyset_mutex_);
-  std::unique_ptr<Keyset> keyset_copy(new Keyset(keyset_));
+  auto keyset_copy = util::SecretArena::MakeShared<Keyset>();
+  {
+    absl::MutexLock lock(&keyset_mutex_);
+    keyset_copy->CopyFrom(keyset_);
+  }
   std::unique_ptr<KeysetHandle> handle(
-      new KeysetHandle(std::move(keyset_copy)));
+      new KeysetHandle(std::shared_ptr<const Keyset>(std::move(keyset_copy))));
   return handle;
 }
 
@@ -69,8 +89,40 @@ StatusOr<uint32_t> KeysetManager::Add(const KeyTemplate& key_template) {
 
 crypto::tink::util::StatusOr<uint32_t> KeysetManager::Add(
     const google::crypto::tink::KeyTemplate& key_template, bool as_primary) {
+  // The key material is generated without holding the lock.
+  auto key_data_result = Registry::NewKeyData(key_template);
+  if (!key_data_result.ok()) return key_data_result.status();
+  absl::MutexLock lock(&keyset_mutex_);
+  uint32_t key_id = NewKeyIds(1)[0];
+  AppendKey(key_id, key_data_result.ValueOrDie().get(),
+            key_template.output_prefix_type());
+  if (as_primary) {
+    keyset_.set_primary_key_id(key_id);
+  }
+  return key_id;
+}
+
+StatusOr<std::vector<uint32_t>> KeysetManager::AddKeys(
+    const KeyTemplate& key_template, int count) {
+  if (count < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot add a negative number of keys (%d).", count);
+  }
+  std::vector<std::unique_ptr<KeyData>> keys_data;
+  keys_data.reserve(count);
+  for (int i = 0; i < count; i++) {
+    auto key_data_result = Registry::NewKeyData(key_template);
+    if (!key_data_result.ok()) return key_data_result.status();
+    keys_data.push_back(std::move(key_data_result.ValueOrDie()));
+  }
   absl::MutexLock lock(&keyset_mutex_);
-  return KeysetHandle::AddToKeyset(key_template, as_primary, &keyset_);
+  std::vector<uint32_t> key_ids = NewKeyIds(count);
+  keyset_.mutable_key()->Reserve(keyset_.key_size() + count);
+  for (int i = 0; i < count; i++) {
+    AppendKey(key_ids[i], keys_data[i].get(),
+              key_template.output_prefix_type());
+  }
+  return key_ids;
 }
 
 StatusOr<uint32_t> KeysetManager::Rotate(const KeyTemplate& key_template) {
@@ -80,22 +132,17 @@ StatusOr<uint32_t> KeysetManager::Rotate(const KeyTemplate& key_template) {
 
 Status KeysetManager::Enable(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  for (auto& key : *(keyset_.mutable_key())) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::DISABLED &&
-          key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "Cannot enable key with key_id %" PRIu32
-                         " and status %s.",
-                         key_id, Enums::KeyStatusName(key.status()));
-      }
-      key.set_status(KeyStatusType::ENABLED);
-      return Status::OK;
-    }
+  Keyset::Key* key = FindKey(key_id);
+  if (key == nullptr) return KeyNotFoundError(key_id);
+  if (key->status() != KeyStatusType::DISABLED &&
+      key->status() != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot enable key with key_id %" PRIu32
+                     " and status %s.",
+                     key_id, Enums::KeyStatusName(key->status()));
   }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %" PRIu32 " found in the keyset.",
-                   key_id);
+  key->set_status(KeyStatusType::ENABLED);
+  return Status::OK;
 }
 
 Status KeysetManager::Disable(uint32_t key_id) {
@@ -105,22 +152,17 @@ Status KeysetManager::Disable(uint32_t key_id) {
                      "Cannot disable primary key (key_id %" PRIu32 ").",
                      key_id);
   }
-  for (auto& key : *(keyset_.mutable_key())) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::DISABLED &&
-          key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "Cannot disable key with key_id %" PRIu32
-                         " and status %s.",
-                         key_id, Enums::KeyStatusName(key.status()));
-      }
-      key.set_status(KeyStatusType::DISABLED);
-      return Status::OK;
-    }
+  Keyset::Key* key = FindKey(key_id);
+  if (key == nullptr) return KeyNotFoundError(key_id);
+  if (key->status() != KeyStatusType::DISABLED &&
+      key->status() != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot disable key with key_id %" PRIu32
+                     " and status %s.",
+                     key_id, Enums::KeyStatusName(key->status()));
   }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %" PRIu32 " found in the keyset.",
-                   key_id);
+  key->set_status(KeyStatusType::DISABLED);
+  return Status::OK;
 }
 
 Status KeysetManager::Delete(uint32_t key_id) {
@@ -130,19 +172,37 @@ Status KeysetManager::Delete(uint32_t key_id) {
                      "Cannot delete primary key (key_id %" PRIu32 ").",
                      key_id);
   }
-  auto key_field = keyset_.mutable_key();
-  for (auto key_iter = key_field->begin();
-       key_iter != key_field->end();
-       key_iter++) {
-    auto key = *key_iter;
-    if (key.key_id() == key_id) {
-      keyset_.mutable_key()->erase(key_iter);
-      return Status::OK;
+  auto index_iter = key_index_.find(key_id);
+  if (index_iter == key_index_.end()) return KeyNotFoundError(key_id);
+  keyset_.mutable_key()->DeleteSubrange(index_iter->second, 1);
+  RebuildIndex();
+  return Status::OK;
+}
+
+Status KeysetManager::DeleteKeys(const std::vector<uint32_t>& key_ids) {
+  absl::MutexLock lock(&keyset_mutex_);
+  std::unordered_set<uint32_t> to_delete;
+  to_delete.reserve(key_ids.size());
+  for (uint32_t key_id : key_ids) {
+    if (keyset_.primary_key_id() == key_id) {
+      return ToStatusF(util::error::INVALID_ARGUMENT,
+                       "Cannot delete primary key (key_id %" PRIu32 ").",
+                       key_id);
     }
+    if (key_index_.count(key_id) == 0) return KeyNotFoundError(key_id);
+    to_delete.insert(key_id);
   }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %" PRIu32 " found in the keyset.",
-                   key_id);
+  // Move the remaining keys to the front, preserving their order.
+  auto* keys = keyset_.mutable_key();
+  int kept = 0;
+  for (int i = 0; i < keys->size(); i++) {
+    if (to_delete.count(keys->Get(i).key_id()) > 0) continue;
+    if (kept != i) keys->SwapElements(kept, i);
+    kept++;
+  }
+  keys->DeleteSubrange(kept, keys->size() - kept);
+  RebuildIndex();
+  return Status::OK;
 }
 
 Status KeysetManager::Destroy(uint32_t key_id) {
@@ -152,42 +212,32 @@ Status KeysetManager::Destroy(uint32_t key_id) {
                      "Cannot destroy primary key (key_id %" PRIu32 ").",
                      key_id);
   }
-  for (auto& key : *(keyset_.mutable_key())) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::DISABLED &&
-          key.status() != KeyStatusType::DESTROYED &&
-          key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "Cannot destroy key with key_id %" PRIu32
-                         " and status %s.",
-                         key_id, Enums::KeyStatusName(key.status()));
-      }
-      key.clear_key_data();
-      key.set_status(KeyStatusType::DESTROYED);
-      return Status::OK;
-    }
+  Keyset::Key* key = FindKey(key_id);
+  if (key == nullptr) return KeyNotFoundError(key_id);
+  if (key->status() != KeyStatusType::DISABLED &&
+      key->status() != KeyStatusType::DESTROYED &&
+      key->status() != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot destroy key with key_id %" PRIu32
+                     " and status %s.",
+                     key_id, Enums::KeyStatusName(key->status()));
   }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %" PRIu32 " found in the keyset.",
-                   key_id);
+  key->clear_key_data();
+  key->set_status(KeyStatusType::DESTROYED);
+  return Status::OK;
 }
 
 Status KeysetManager::SetPrimary(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  for (auto& key : keyset_.key()) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "The candidate for the primary key must be ENABLED"
-                         " (key_id %" PRIu32 ").", key_id);
-      }
-      keyset_.set_primary_key_id(key_id);
-      return Status::OK;
-    }
+  const Keyset::Key* key = FindKey(key_id);
+  if (key == nullptr) return KeyNotFoundError(key_id);
+  if (key->status() != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "The candidate for the primary key must be ENABLED"
+                     " (key_id %" PRIu32 ").", key_id);
   }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %" PRIu32 " found in the keyset.",
-                   key_id);
+  keyset_.set_primary_key_id(key_id);
+  return Status::OK;
 }
 
 
@@ -196,5 +246,51 @@ int KeysetManager::KeyCount() const {
   return keyset_.key_size();
 }
 
+Keyset::Key* KeysetManager::FindKey(uint32_t key_id) {
+  auto index_iter = key_index_.find(key_id);
+  if (index_iter == key_index_.end()) return nullptr;
+  return keyset_.mutable_key(index_iter->second);
+}
+
+std::vector<uint32_t> KeysetManager::NewKeyIds(int count) {
+  std::vector<uint32_t> key_ids;
+  key_ids.reserve(count);
+  std::unordered_set<uint32_t> new_ids;
+  while (key_ids.size() < static_cast<size_t>(count)) {
+    // Draw the candidates for all the missing key_ids at once; collisions
+    // are so rare that this loop practically never repeats.
+    int missing = count - key_ids.size();
+    std::string random = subtle::Random::GetRandomBytes(
+        missing * sizeof(uint32_t));
+    for (int i = 0; i < missing; i++) {
+      uint32_t key_id;
+      memcpy(&key_id, &random[i * sizeof(uint32_t)], sizeof(uint32_t));
+      if (key_index_.count(key_id) > 0) continue;
+      if (!new_ids.insert(key_id).second) continue;
+      key_ids.push_back(key_id);
+    }
+  }
+  return key_ids;
+}
+
+void KeysetManager::AppendKey(uint32_t key_id, KeyData* key_data,
+                              OutputPrefixType output_prefix_type) {
+  Keyset::Key* key = keyset_.add_key();
+  key->mutable_key_data()->Swap(key_data);
+  key->set_status(KeyStatusType::ENABLED);
+  key->set_key_id(key_id);
+  key->set_output_prefix_type(output_prefix_type);
+  key_index_.emplace(key_id, keyset_.key_size() - 1);
+}
+
+void KeysetManager::RebuildIndex() {
+  key_index_.clear();
+  key_index_.reserve(keyset_.key_size());
+  for (int i = 0; i < keyset_.key_size(); i++) {
+    // emplace() keeps the first key with a given key_id.
+    key_index_.emplace(keyset_.key(i).key_id(), i);
+  }
+}
+
 }  // namespace tink
 }  // namespace crypto
@@ -15,6 +15,9 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "tink/keyset_manager.h"
 
+#include <set>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "tink/aead/aead_config.h"
 #include "tink/aead/aes_gcm_key_manager.h"
@@ -230,5 +233,81 @@ TEST_F(KeysetManagerTest, testBasicOperations) {
   EXPECT_EQ(1, keyset_manager->KeyCount());
 }
 
+TEST_F(KeysetManagerTest, testBulkOperations) {
+  AesGcmKeyFormat key_format;
+  key_format.set_key_size(16);
+  KeyTemplate key_template;
+  key_template.set_type_url(AesGcmKeyManager::static_key_type());
+  key_template.set_output_prefix_type(OutputPrefixType::TINK);
+  key_template.set_value(key_format.SerializeAsString());
+
+  auto new_result = KeysetManager::New(key_template);
+  EXPECT_TRUE(new_result.ok()) << new_result.status();
+  auto keyset_manager = std::move(new_result.ValueOrDie());
+  auto keyset =
+      TestKeysetHandle::GetKeyset(*(keyset_manager->GetKeysetHandle()));
+  auto primary_key_id = keyset.primary_key_id();
+
+  // Add many keys at once.
+  int count = 2000;
+  auto add_result = keyset_manager->AddKeys(key_template, count);
+  EXPECT_TRUE(add_result.ok()) << add_result.status();
+  std::vector<uint32_t> key_ids = add_result.ValueOrDie();
+  EXPECT_EQ(count, key_ids.size());
+  EXPECT_EQ(count + 1, keyset_manager->KeyCount());
+  std::set<uint32_t> distinct_ids(key_ids.begin(), key_ids.end());
+  distinct_ids.insert(primary_key_id);
+  EXPECT_EQ(count + 1, distinct_ids.size());
+
+  keyset = TestKeysetHandle::GetKeyset(*(keyset_manager->GetKeysetHandle()));
+  EXPECT_EQ(primary_key_id, keyset.primary_key_id());
+  for (int i = 0; i < count; i++) {
+    EXPECT_EQ(key_ids[i], keyset.key(i + 1).key_id());
+    EXPECT_EQ(KeyStatusType::ENABLED, keyset.key(i + 1).status());
+    EXPECT_EQ(OutputPrefixType::TINK, keyset.key(i + 1).output_prefix_type());
+  }
+
+  // The added keys can be managed individually.
+  auto status = keyset_manager->Disable(key_ids[count - 1]);
+  EXPECT_TRUE(status.ok()) << status;
+  status = keyset_manager->SetPrimary(key_ids[count - 3]);
+  EXPECT_TRUE(status.ok()) << status;
+
+  // Delete every other added key; the others keep their order.
+  std::vector<uint32_t> deleted_ids;
+  for (int i = 0; i < count; i += 2) deleted_ids.push_back(key_ids[i]);
+  status = keyset_manager->DeleteKeys(deleted_ids);
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(count / 2 + 1, keyset_manager->KeyCount());
+  keyset = TestKeysetHandle::GetKeyset(*(keyset_manager->GetKeysetHandle()));
+  EXPECT_EQ(primary_key_id, keyset.key(0).key_id());
+  for (int i = 1; i < count; i += 2) {
+    EXPECT_EQ(key_ids[i], keyset.key(i / 2 + 1).key_id());
+  }
+  EXPECT_EQ(KeyStatusType::DISABLED, keyset.key(count / 2).status());
+
+  // The index is kept up to date by the deletions.
+  status = keyset_manager->Enable(key_ids[count - 1]);
+  EXPECT_TRUE(status.ok()) << status;
+  status = keyset_manager->Enable(key_ids[0]);
+  EXPECT_EQ(util::error::NOT_FOUND, status.error_code());
+
+  // Invalid deletions leave the keyset unchanged.
+  status = keyset_manager->DeleteKeys({key_ids[1], key_ids[0]});
+  EXPECT_EQ(util::error::NOT_FOUND, status.error_code());
+  status = keyset_manager->DeleteKeys({key_ids[1], key_ids[count - 3]});
+  EXPECT_EQ(util::error::INVALID_ARGUMENT, status.error_code());
+  EXPECT_PRED_FORMAT2(testing::IsSubstring, "Cannot delete primary",
+                      status.error_message());
+  EXPECT_EQ(count / 2 + 1, keyset_manager->KeyCount());
+
+  // Adding keys with an invalid template adds no keys.
+  KeyTemplate invalid_template;
+  invalid_template.set_type_url("some.unknown.key.type");
+  add_result = keyset_manager->AddKeys(invalid_template, 10);
+  EXPECT_FALSE(add_result.ok());
+  EXPECT_EQ(count / 2 + 1, keyset_manager->KeyCount());
+}
+
 }  // namespace tink
 }  // namespace crypto
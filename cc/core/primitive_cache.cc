@@ -0,0 +1,163 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/primitive_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/evp.h"
+#include "openssl/mem.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using google::crypto::tink::KeyData;
+
+namespace {
+
+// The estimated memory usage of a cached primitive, in addition to
+// the size of its serialized key.
+const int64_t kEntryOverheadBytes = 1024;
+
+// The cache installed via PrimitiveCache::SetGlobal().
+struct GlobalCache {
+  absl::Mutex mutex;
+  std::shared_ptr<PrimitiveCache> cache GUARDED_BY(mutex);
+};
+
+GlobalCache& GetGlobalCache() {
+  static GlobalCache* global_cache = new GlobalCache();
+  return *global_cache;
+}
+
+}  // anonymous namespace
+
+PrimitiveCache::PrimitiveCache(const Options& options)
+    : options_(options),
+      cached_bytes_(0),
+      hit_count_(0),
+      miss_count_(0),
+      eviction_count_(0) {}
+
+PrimitiveCache::~PrimitiveCache() {
+  absl::MutexLock lock(&mutex_);
+  while (!lru_.empty()) Evict();
+}
+
+// static
+util::StatusOr<std::string> PrimitiveCache::Fingerprint(
+    const KeyData& key_data, const char* primitive_name) {
+  std::string input = absl::StrCat(
+      key_data.type_url().size(), ":", key_data.type_url(), ":",
+      primitive_name, ":", key_data.key_material_type(), ":",
+      key_data.value());
+  auto hash_result = subtle::boringssl::ComputeHash(input, *EVP_sha256());
+  OPENSSL_cleanse(&input[0], input.size());
+  if (!hash_result.ok()) return hash_result.status();
+  const std::vector<uint8_t>& hash = hash_result.ValueOrDie();
+  return std::string(hash.begin(), hash.end());
+}
+
+std::shared_ptr<void> PrimitiveCache::Find(const std::string& fingerprint) {
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(fingerprint);
+  if (it == index_.end()) {
+    miss_count_++;
+    return nullptr;
+  }
+  hit_count_++;
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->primitive;
+}
+
+std::shared_ptr<void> PrimitiveCache::Insert(const std::string& fingerprint,
+                                             std::shared_ptr<void> primitive,
+                                             int64_t cost) {
+  cost += kEntryOverheadBytes;
+  absl::MutexLock lock(&mutex_);
+  auto it = index_.find(fingerprint);
+  if (it != index_.end()) {
+    // Created concurrently by another thread.
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->primitive;
+  }
+  if (cost > options_.max_cached_bytes) return primitive;
+  while (cached_bytes_ + cost > options_.max_cached_bytes) Evict();
+  lru_.push_front({fingerprint, primitive, cost});
+  index_[fingerprint] = lru_.begin();
+  cached_bytes_ += cost;
+  return primitive;
+}
+
+void PrimitiveCache::Evict() {
+  CacheEntry& entry = lru_.back();
+  index_.erase(entry.fingerprint);
+  cached_bytes_ -= entry.cost;
+  eviction_count_++;
+  OPENSSL_cleanse(&entry.fingerprint[0], entry.fingerprint.size());
+  // Users of the primitive hold their own references.
+  lru_.pop_back();
+}
+
+int64_t PrimitiveCache::hit_count() const {
+  absl::MutexLock lock(&mutex_);
+  return hit_count_;
+}
+
+int64_t PrimitiveCache::miss_count() const {
+  absl::MutexLock lock(&mutex_);
+  return miss_count_;
+}
+
+int64_t PrimitiveCache::eviction_count() const {
+  absl::MutexLock lock(&mutex_);
+  return eviction_count_;
+}
+
+int64_t PrimitiveCache::cached_bytes() const {
+  absl::MutexLock lock(&mutex_);
+  return cached_bytes_;
+}
+
+int PrimitiveCache::size() const {
+  absl::MutexLock lock(&mutex_);
+  return lru_.size();
+}
+
+// static
+std::shared_ptr<PrimitiveCache> PrimitiveCache::GetGlobal() {
+  GlobalCache& global_cache = GetGlobalCache();
+  absl::MutexLock lock(&global_cache.mutex);
+  return global_cache.cache;
+}
+
+// static
+void PrimitiveCache::SetGlobal(std::shared_ptr<PrimitiveCache> cache) {
+  GlobalCache& global_cache = GetGlobalCache();
+  absl::MutexLock lock(&global_cache.mutex);
+  global_cache.cache = std::move(cache);
+}
+
+}  // namespace tink
+}  // namespace crypto
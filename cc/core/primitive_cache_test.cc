@@ -0,0 +1,254 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/primitive_cache.h"
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/key_manager.h"
+#include "tink/keyset_handle.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AddTinkKey;
+using crypto::tink::test::DummyAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+using google::crypto::tink::KeyData;
+using google::crypto::tink::Keyset;
+using google::crypto::tink::KeyStatusType;
+
+const char kKeyType[] = "type.googleapis.com/test.PrimitiveCacheTestKey";
+
+std::atomic<int> primitives_created(0);
+
+class DummyKeyFactory : public KeyFactory {
+ public:
+  util::StatusOr<std::unique_ptr<portable_proto::MessageLite>> NewKey(
+      const portable_proto::MessageLite& key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  util::StatusOr<std::unique_ptr<portable_proto::MessageLite>> NewKey(
+      absl::string_view serialized_key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  util::StatusOr<std::unique_ptr<KeyData>> NewKeyData(
+      absl::string_view serialized_key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+};
+
+// Creates DummyAeads named after the key value, and counts them.
+class CountingAeadKeyManager : public KeyManager<Aead> {
+ public:
+  util::StatusOr<std::unique_ptr<Aead>> GetPrimitive(
+      const KeyData& key_data) const override {
+    if (key_data.value() == "invalid") {
+      return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+    }
+    primitives_created++;
+    return {absl::make_unique<DummyAead>(key_data.value())};
+  }
+
+  util::StatusOr<std::unique_ptr<Aead>> GetPrimitive(
+      const portable_proto::MessageLite& key) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  uint32_t get_version() const override { return 0; }
+
+  const std::string& get_key_type() const override { return key_type_; }
+
+  const KeyFactory& get_key_factory() const override { return key_factory_; }
+
+ private:
+  const std::string key_type_ = kKeyType;
+  DummyKeyFactory key_factory_;
+};
+
+KeyData GetKeyData(const std::string& value) {
+  KeyData key_data;
+  key_data.set_type_url(kKeyType);
+  key_data.set_value(value);
+  key_data.set_key_material_type(KeyData::SYMMETRIC);
+  return key_data;
+}
+
+class PrimitiveCacheTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    ASSERT_THAT(Registry::RegisterKeyManager(
+                    absl::make_unique<CountingAeadKeyManager>(), true),
+                IsOk());
+    ASSERT_THAT(
+        Registry::RegisterPrimitiveWrapper(absl::make_unique<AeadWrapper>()),
+        IsOk());
+  }
+
+  void SetUp() override { primitives_created = 0; }
+};
+
+TEST_F(PrimitiveCacheTest, SharesPrimitives) {
+  PrimitiveCache cache{PrimitiveCache::Options()};
+  auto result1 = cache.GetPrimitive<Aead>(GetKeyData("key 1"));
+  ASSERT_THAT(result1.status(), IsOk());
+  auto result2 = cache.GetPrimitive<Aead>(GetKeyData("key 1"));
+  ASSERT_THAT(result2.status(), IsOk());
+  auto result3 = cache.GetPrimitive<Aead>(GetKeyData("key 2"));
+  ASSERT_THAT(result3.status(), IsOk());
+
+  EXPECT_EQ(result1.ValueOrDie(), result2.ValueOrDie());
+  EXPECT_NE(result1.ValueOrDie(), result3.ValueOrDie());
+  EXPECT_EQ(2, primitives_created);
+  EXPECT_EQ(1, cache.hit_count());
+  EXPECT_EQ(2, cache.miss_count());
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(0, cache.eviction_count());
+
+  // The primitives are the ones for the respective keys.
+  std::string ciphertext =
+      result3.ValueOrDie()->Encrypt("plaintext", "ad").ValueOrDie();
+  EXPECT_EQ(ciphertext,
+            DummyAead("key 2").Encrypt("plaintext", "ad").ValueOrDie());
+}
+
+TEST_F(PrimitiveCacheTest, KeyMaterialTypeIsPartOfTheKey) {
+  PrimitiveCache cache{PrimitiveCache::Options()};
+  KeyData key_data = GetKeyData("key");
+  ASSERT_THAT(cache.GetPrimitive<Aead>(key_data).status(), IsOk());
+  key_data.set_key_material_type(KeyData::REMOTE);
+  ASSERT_THAT(cache.GetPrimitive<Aead>(key_data).status(), IsOk());
+  EXPECT_EQ(2, primitives_created);
+}
+
+TEST_F(PrimitiveCacheTest, ErrorsAreNotCached) {
+  PrimitiveCache cache{PrimitiveCache::Options()};
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(cache.GetPrimitive<Aead>(GetKeyData("invalid")).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  KeyData key_data = GetKeyData("key");
+  key_data.set_type_url("type.googleapis.com/test.UnknownKey");
+  EXPECT_THAT(cache.GetPrimitive<Aead>(key_data).status(),
+              StatusIs(util::error::NOT_FOUND));
+  EXPECT_EQ(0, cache.size());
+  EXPECT_EQ(0, cache.cached_bytes());
+}
+
+TEST_F(PrimitiveCacheTest, EvictsLeastRecentlyUsed) {
+  PrimitiveCache::Options options;
+  // Room for two entries.
+  options.max_cached_bytes = 2 * 1100;
+  PrimitiveCache cache(options);
+  auto primitive1 = cache.GetPrimitive<Aead>(GetKeyData("key 1")).ValueOrDie();
+  ASSERT_THAT(cache.GetPrimitive<Aead>(GetKeyData("key 2")).status(), IsOk());
+  ASSERT_THAT(cache.GetPrimitive<Aead>(GetKeyData("key 1")).status(), IsOk());
+  // Evicts key 2.
+  ASSERT_THAT(cache.GetPrimitive<Aead>(GetKeyData("key 3")).status(), IsOk());
+  EXPECT_EQ(1, cache.eviction_count());
+  EXPECT_EQ(2, cache.size());
+  EXPECT_GE(options.max_cached_bytes, cache.cached_bytes());
+
+  EXPECT_EQ(primitive1,
+            cache.GetPrimitive<Aead>(GetKeyData("key 1")).ValueOrDie());
+  EXPECT_EQ(3, primitives_created);
+  ASSERT_THAT(cache.GetPrimitive<Aead>(GetKeyData("key 2")).status(), IsOk());
+  EXPECT_EQ(4, primitives_created);
+
+  // An evicted primitive remains usable by its users.
+  PrimitiveCache::Options tiny_options;
+  tiny_options.max_cached_bytes = 10;
+  PrimitiveCache tiny_cache(tiny_options);
+  auto primitive = tiny_cache.GetPrimitive<Aead>(GetKeyData("key"));
+  ASSERT_THAT(primitive.status(), IsOk());
+  EXPECT_EQ(0, tiny_cache.size());
+  EXPECT_THAT(primitive.ValueOrDie()->Encrypt("plaintext", "ad").status(),
+              IsOk());
+}
+
+TEST_F(PrimitiveCacheTest, ConcurrentLookups) {
+  PrimitiveCache cache{PrimitiveCache::Options()};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&cache]() {
+      for (int i = 0; i < 100; i++) {
+        auto result =
+            cache.GetPrimitive<Aead>(GetKeyData(absl::StrCat("key ", i % 10)));
+        EXPECT_THAT(result.status(), IsOk());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(10, cache.size());
+  EXPECT_EQ(800, cache.hit_count() + cache.miss_count());
+}
+
+TEST_F(PrimitiveCacheTest, KeysetHandleUsesGlobalCache) {
+  Keyset keyset;
+  AddTinkKey(kKeyType, 42, GetKeyData("key 1"), KeyStatusType::ENABLED,
+             KeyData::SYMMETRIC, &keyset);
+  AddTinkKey(kKeyType, 43, GetKeyData("key 2"), KeyStatusType::ENABLED,
+             KeyData::SYMMETRIC, &keyset);
+  keyset.set_primary_key_id(42);
+  auto handle = TestKeysetHandle::GetKeysetHandle(keyset);
+
+  // Without a cache, each GetPrimitive() creates the primitives anew.
+  ASSERT_EQ(nullptr, PrimitiveCache::GetGlobal());
+  ASSERT_THAT(handle->GetPrimitive<Aead>().status(), IsOk());
+  ASSERT_THAT(handle->GetPrimitive<Aead>().status(), IsOk());
+  EXPECT_EQ(4, primitives_created);
+
+  auto cache = std::make_shared<PrimitiveCache>(PrimitiveCache::Options());
+  PrimitiveCache::SetGlobal(cache);
+  primitives_created = 0;
+  auto aead1 = handle->GetPrimitive<Aead>();
+  ASSERT_THAT(aead1.status(), IsOk());
+  auto aead2 = handle->GetPrimitive<Aead>();
+  ASSERT_THAT(aead2.status(), IsOk());
+  EXPECT_EQ(2, primitives_created);
+  EXPECT_EQ(2, cache->hit_count());
+  std::string ciphertext =
+      aead1.ValueOrDie()->Encrypt("plaintext", "ad").ValueOrDie();
+  EXPECT_EQ("plaintext",
+            aead2.ValueOrDie()->Decrypt(ciphertext, "ad").ValueOrDie());
+
+  PrimitiveCache::SetGlobal(nullptr);
+  ASSERT_THAT(handle->GetPrimitive<Aead>().status(), IsOk());
+  EXPECT_EQ(4, primitives_created);
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
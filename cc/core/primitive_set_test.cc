@@ -14,16 +14,23 @@
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <atomic>
 #include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "tink/primitive_set.h"
+#include "absl/memory/memory.h"
 #include "tink/crypto_format.h"
 #include "tink/mac.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
 #include "gtest/gtest.h"
 #include "proto/tink.pb.h"
 
 using crypto::tink::test::DummyMac;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
 using google::crypto::tink::Keyset;
 using google::crypto::tink::KeyStatusType;
 using google::crypto::tink::OutputPrefixType;
@@ -360,6 +367,183 @@ TEST_F(PrimitiveSetTest, DisabledKey) {
   EXPECT_FALSE(add_primitive_result.ok());
 }
 
+TEST_F(PrimitiveSetTest, GetAll) {
+  PrimitiveSet<Mac> primitive_set;
+  EXPECT_TRUE(primitive_set.get_all().empty());
+  add_primitives(&primitive_set, 100, 3);
+  Keyset::Key raw_key;
+  raw_key.set_output_prefix_type(OutputPrefixType::RAW);
+  raw_key.set_key_id(42);
+  raw_key.set_status(KeyStatusType::ENABLED);
+  ASSERT_THAT(primitive_set
+                  .AddPrimitive(absl::make_unique<DummyMac>("raw"), raw_key)
+                  .status(),
+              IsOk());
+
+  std::vector<uint32_t> key_ids;
+  for (const auto* entry : primitive_set.get_all()) {
+    key_ids.push_back(entry->get_key_id());
+  }
+  std::sort(key_ids.begin(), key_ids.end());
+  EXPECT_EQ(std::vector<uint32_t>({42, 100, 101, 102}), key_ids);
+}
+
+Keyset::Key GetTinkKey(uint32_t key_id) {
+  Keyset::Key key;
+  key.set_output_prefix_type(OutputPrefixType::TINK);
+  key.set_key_id(key_id);
+  key.set_status(KeyStatusType::ENABLED);
+  return key;
+}
+
+// Returns a factory of DummyMacs named 'mac_name', counting its calls
+// in 'num_created'.
+PrimitiveSet<Mac>::Entry<Mac>::Factory CountingFactory(
+    const std::string& mac_name, std::atomic<int>* num_created) {
+  return [mac_name, num_created]() {
+    (*num_created)++;
+    return util::StatusOr<std::shared_ptr<Mac>>(
+        std::make_shared<DummyMac>(mac_name));
+  };
+}
+
+TEST_F(PrimitiveSetTest, LazyEntries) {
+  std::atomic<int> num_created(0);
+  PrimitiveSet<Mac> primitive_set;
+  auto entry_result = primitive_set.AddLazyPrimitive(
+      CountingFactory("lazy MAC", &num_created), GetTinkKey(42));
+  ASSERT_THAT(entry_result.status(), IsOk());
+  auto entry = entry_result.ValueOrDie();
+  EXPECT_TRUE(entry->is_lazy());
+  EXPECT_EQ(KeyStatusType::ENABLED, entry->get_status());
+  EXPECT_EQ(OutputPrefixType::TINK, entry->get_output_prefix_type());
+  EXPECT_EQ(CryptoFormat::get_output_prefix(GetTinkKey(42)).ValueOrDie(),
+            entry->get_identifier());
+  EXPECT_EQ(0, num_created);
+
+  // Concurrent first uses create the primitive once.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([entry]() {
+      auto mac_result = entry->get_shared_primitive();
+      ASSERT_THAT(mac_result.status(), IsOk());
+      EXPECT_EQ(DummyMac("lazy MAC").ComputeMac("data").ValueOrDie(),
+                mac_result.ValueOrDie()->ComputeMac("data").ValueOrDie());
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(1, num_created);
+  EXPECT_EQ(entry->get_shared_primitive().ValueOrDie().get(),
+            &entry->get_primitive());
+  EXPECT_EQ(1, num_created);
+
+  // Invalid arguments.
+  Keyset::Key disabled_key = GetTinkKey(43);
+  disabled_key.set_status(KeyStatusType::DISABLED);
+  EXPECT_THAT(primitive_set.AddLazyPrimitive(
+                  CountingFactory("lazy MAC", &num_created), disabled_key)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(primitive_set.AddLazyPrimitive(nullptr, GetTinkKey(44)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(PrimitiveSetTest, LazyEntryErrors) {
+  PrimitiveSet<Mac> primitive_set;
+  int num_calls = 0;
+  auto entry_result = primitive_set.AddLazyPrimitive(
+      [&num_calls]() -> util::StatusOr<std::shared_ptr<Mac>> {
+        num_calls++;
+        return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+      },
+      GetTinkKey(42));
+  ASSERT_THAT(entry_result.status(), IsOk());
+  auto entry = entry_result.ValueOrDie();
+
+  // Errors are not cached, and a failing entry cannot become the primary.
+  EXPECT_THAT(entry->get_shared_primitive().status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(entry->get_shared_primitive().status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_EQ(2, num_calls);
+  EXPECT_THAT(primitive_set.set_primary(entry),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_EQ(nullptr, primitive_set.get_primary());
+}
+
+TEST_F(PrimitiveSetTest, EvictsIdleLazyPrimitives) {
+  std::atomic<int> num_created(0);
+  PrimitiveSet<Mac> primitive_set(std::chrono::milliseconds(1));
+  auto primary = primitive_set.AddLazyPrimitive(
+      CountingFactory("primary MAC", &num_created), GetTinkKey(1))
+      .ValueOrDie();
+  auto lazy = primitive_set.AddLazyPrimitive(
+      CountingFactory("lazy MAC", &num_created), GetTinkKey(2))
+      .ValueOrDie();
+  auto eager = primitive_set.AddPrimitive(
+      absl::make_unique<DummyMac>("eager MAC"), GetTinkKey(3)).ValueOrDie();
+  ASSERT_THAT(primitive_set.set_primary(primary), IsOk());
+  EXPECT_EQ(1, num_created);
+
+  std::shared_ptr<Mac> mac = lazy->get_shared_primitive().ValueOrDie();
+  EXPECT_EQ(2, num_created);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  // Only the idle lazy primitive is dropped, but not the primary one.
+  EXPECT_EQ(1, primitive_set.EvictIdlePrimitives());
+  EXPECT_EQ(0, primitive_set.EvictIdlePrimitives());
+  // The dropped primitive remains usable by its users.
+  EXPECT_THAT(mac->ComputeMac("data").status(), IsOk());
+  EXPECT_NE(mac, lazy->get_shared_primitive().ValueOrDie());
+  EXPECT_EQ(3, num_created);
+  EXPECT_THAT(eager->get_shared_primitive().status(), IsOk());
+
+  // Lookups drop idle primitives as well.
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_THAT(primitive_set.get_primitives(lazy->get_identifier()).status(),
+              IsOk());
+  EXPECT_EQ(0, primitive_set.EvictIdlePrimitives());
+  lazy->get_shared_primitive();
+  EXPECT_EQ(4, num_created);
+
+  // Primitives referenced via get_primitive() are not dropped.
+  lazy->get_primitive();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(0, primitive_set.EvictIdlePrimitives());
+  lazy->get_shared_primitive();
+  EXPECT_EQ(4, num_created);
+}
+
+TEST_F(PrimitiveSetTest, PinLazyPrimitives) {
+  std::atomic<int> num_created(0);
+  PrimitiveSet<Mac> primitive_set(std::chrono::milliseconds(1));
+  auto lazy = primitive_set.AddLazyPrimitive(
+      CountingFactory("lazy MAC", &num_created), GetTinkKey(1))
+      .ValueOrDie();
+  ASSERT_THAT(primitive_set.AddPrimitive(
+                  absl::make_unique<DummyMac>("eager MAC"), GetTinkKey(2))
+                  .status(),
+              IsOk());
+  ASSERT_THAT(primitive_set.PinLazyPrimitives(), IsOk());
+  EXPECT_EQ(1, num_created);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(0, primitive_set.EvictIdlePrimitives());
+  EXPECT_EQ(DummyMac("lazy MAC").ComputeMac("data").ValueOrDie(),
+            lazy->get_primitive().ComputeMac("data").ValueOrDie());
+  EXPECT_EQ(1, num_created);
+
+  // The error of a failing factory is returned.
+  ASSERT_THAT(primitive_set.AddLazyPrimitive(
+                  []() -> util::StatusOr<std::shared_ptr<Mac>> {
+                    return util::Status(util::error::INVALID_ARGUMENT,
+                                        "invalid key");
+                  },
+                  GetTinkKey(3))
+                  .status(),
+              IsOk());
+  EXPECT_THAT(primitive_set.PinLazyPrimitives(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
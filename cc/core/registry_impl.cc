@@ -15,6 +15,7 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "tink/core/registry_impl.h"
 
+#include "absl/memory/memory.h"
 #include "tink/util/errors.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
@@ -26,35 +27,56 @@ using google::crypto::tink::KeyTemplate;
 namespace crypto {
 namespace tink {
 
+RegistryImpl::RegistryImpl() : snapshot_(new Snapshot()) {}
+
+RegistryImpl::~RegistryImpl() {
+  delete snapshot_.load(std::memory_order_acquire);
+}
+
+void RegistryImpl::Publish(std::unique_ptr<const Snapshot> new_snapshot) {
+  std::unique_ptr<const Snapshot> replaced_snapshot(snapshot_.exchange(
+      new_snapshot.release(), std::memory_order_acq_rel));
+  // Lookups that started before the exchange may still read the replaced
+  // snapshot; the ones that start later read the new one.
+  reclaimer_.Synchronize();
+}
+
+std::shared_ptr<const RegistryImpl::KeyTypeInfo>
+RegistryImpl::FindKeyTypeInfo(const std::string& type_url) const {
+  ReadSection section(*this);
+  const Snapshot& current = section.snapshot();
+  auto it = current.type_url_to_info.find(type_url);
+  if (it == current.type_url_to_info.end()) return nullptr;
+  return it->second;
+}
+
 StatusOr<std::unique_ptr<KeyData>> RegistryImpl::NewKeyData(
     const KeyTemplate& key_template) const {
-  absl::MutexLock lock(&maps_mutex_);
   const std::string& type_url = key_template.type_url();
-  auto it = type_url_to_info_.find(type_url);
-  if (it == type_url_to_info_.end()) {
+  std::shared_ptr<const KeyTypeInfo> info = FindKeyTypeInfo(type_url);
+  if (info == nullptr) {
     return ToStatusF(util::error::NOT_FOUND,
                      "No manager for type '%s' has been registered.",
                      type_url.c_str());
   }
-  if (!it->second.new_key_allowed()) {
+  if (!info->new_key_allowed()) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "KeyManager for type '%s' does not allow "
                      "for creation of new keys.",
                      type_url.c_str());
   }
-  return it->second.key_factory().NewKeyData(key_template.value());
+  return info->key_factory().NewKeyData(key_template.value());
 }
 
 StatusOr<std::unique_ptr<KeyData>> RegistryImpl::GetPublicKeyData(
     const std::string& type_url, const std::string& serialized_private_key) const {
-  absl::MutexLock lock(&maps_mutex_);
-  auto it = type_url_to_info_.find(type_url);
-  if (it == type_url_to_info_.end()) {
+  std::shared_ptr<const KeyTypeInfo> info = FindKeyTypeInfo(type_url);
+  if (info == nullptr) {
     return ToStatusF(util::error::INTERNAL, "No Key type '%s' registered.",
                      type_url.c_str());
   }
   auto factory =
-      dynamic_cast<const PrivateKeyFactory*>(&it->second.key_factory());
+      dynamic_cast<const PrivateKeyFactory*>(&info->key_factory());
   if (factory == nullptr) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "KeyManager for type '%s' does not have "
@@ -64,20 +86,21 @@ StatusOr<std::unique_ptr<KeyData>> RegistryImpl::GetPublicKeyData(
   return result;
 }
 
+// static
 crypto::tink::util::Status RegistryImpl::CheckInsertable(
-    const std::string& type_url, const std::type_index& key_manager_type_index,
-    bool new_key_allowed) const {
-  auto it = type_url_to_info_.find(type_url);
+    const Snapshot& snapshot, const std::string& type_url,
+    const std::type_index& key_manager_type_index, bool new_key_allowed) {
+  auto it = snapshot.type_url_to_info.find(type_url);
 
-  if (it == type_url_to_info_.end()) {
+  if (it == snapshot.type_url_to_info.end()) {
     return crypto::tink::util::Status::OK;
   }
-  if (it->second.key_manager_type_index() != key_manager_type_index) {
+  if (it->second->key_manager_type_index() != key_manager_type_index) {
     return ToStatusF(crypto::tink::util::error::ALREADY_EXISTS,
                      "A manager for type '%s' has been already registered.",
                      type_url.c_str());
   }
-  if (!it->second.new_key_allowed() && new_key_allowed) {
+  if (!it->second->new_key_allowed() && new_key_allowed) {
     return ToStatusF(crypto::tink::util::error::ALREADY_EXISTS,
                      "A manager for type '%s' has been already registered "
                      "with forbidden new key operation.",
@@ -86,11 +109,39 @@ crypto::tink::util::Status RegistryImpl::CheckInsertable(
   return crypto::tink::util::Status::OK;
 }
 
+// static
+void RegistryImpl::SetNewKeyAllowed(const std::string& type_url,
+                                    bool new_key_allowed, Snapshot* snapshot) {
+  auto& info = snapshot->type_url_to_info[type_url];
+  auto modified_info = std::make_shared<KeyTypeInfo>(*info);
+  modified_info->set_new_key_allowed(new_key_allowed);
+  info = std::move(modified_info);
+}
+
+crypto::tink::util::Status RegistryImpl::RegisterBatch(Batch batch) {
+  return Update([&batch](Snapshot* snapshot, bool* changed) {
+    snapshot->type_url_to_info.reserve(snapshot->type_url_to_info.size() +
+                                       batch.size());
+    for (auto& operation : batch.operations_) {
+      auto status = operation->Apply(snapshot, changed);
+      if (!status.ok()) return status;
+    }
+    return util::OkStatus();
+  });
+}
+
+util::Status RegistryImpl::RegisterMonitoringClientFactory(
+    std::shared_ptr<MonitoringClientFactory> factory) {
+  return Update([&](Snapshot* snapshot, bool* changed) {
+    *changed = snapshot->monitoring_factory != factory;
+    snapshot->monitoring_factory = std::move(factory);
+    return util::Status::OK;
+  });
+}
+
 void RegistryImpl::Reset() {
   absl::MutexLock lock(&maps_mutex_);
-  type_url_to_info_.clear();
-  name_to_catalogue_map_.clear();
-  primitive_to_wrapper_.clear();
+  Publish(absl::make_unique<Snapshot>());
 }
 
 }  // namespace tink
@@ -17,11 +17,15 @@
 #define TINK_CORE_REGISTRY_IMPL_H_
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "absl/synchronization/mutex.h"
@@ -31,8 +35,10 @@
 #include "tink/core/key_manager_impl.h"
 #include "tink/core/private_key_manager_impl.h"
 #include "tink/key_manager.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
+#include "tink/util/epoch_reclaimer.h"
 #include "tink/util/errors.h"
 #include "tink/util/protobuf_helper.h"
 #include "tink/util/status.h"
@@ -42,6 +48,15 @@
 namespace crypto {
 namespace tink {
 
+// The registered key managers, wrappers and catalogues are kept in
+// an immutable snapshot.  Lookups (GetPrimitive(), get_key_manager(),
+// Wrap() etc.) read the current snapshot without taking any lock, in
+// a read-side section of an EpochReclaimer.  Registration is serialized
+// by a mutex; it copies the current snapshot, modifies the copy and then
+// publishes it atomically, and frees the replaced snapshot once no lookup
+// uses it any more.  Snapshots share the (reference-counted) entries, so
+// pointers returned by get_key_manager() and get_catalogue() remain valid
+// until Reset().
 class RegistryImpl {
  public:
   static RegistryImpl& GlobalInstance() {
@@ -51,7 +66,7 @@ class RegistryImpl {
 
   template <class P>
   crypto::tink::util::StatusOr<const Catalogue<P>*> get_catalogue(
-      const std::string& catalogue_name) const LOCKS_EXCLUDED(maps_mutex_);
+      const std::string& catalogue_name) const;
 
   template <class P>
   crypto::tink::util::Status AddCatalogue(const std::string& catalogue_name,
@@ -91,7 +106,7 @@ class RegistryImpl {
 
   template <class P>
   crypto::tink::util::StatusOr<const KeyManager<P>*> get_key_manager(
-      const std::string& type_url) const LOCKS_EXCLUDED(maps_mutex_);
+      const std::string& type_url) const;
 
 
   // Takes ownership of 'wrapper', which must be non-nullptr.
@@ -101,31 +116,42 @@ class RegistryImpl {
 
   template <class P>
   crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
-      const google::crypto::tink::KeyData& key_data)
-      const LOCKS_EXCLUDED(maps_mutex_);
+      const google::crypto::tink::KeyData& key_data) const;
 
   template <class P>
   crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
-      const std::string& type_url, const portable_proto::MessageLite& key)
-      const LOCKS_EXCLUDED(maps_mutex_);
+      const std::string& type_url,
+      const portable_proto::MessageLite& key) const;
 
   crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::KeyData>>
-  NewKeyData(const google::crypto::tink::KeyTemplate& key_template)
-      const LOCKS_EXCLUDED(maps_mutex_);
+  NewKeyData(const google::crypto::tink::KeyTemplate& key_template) const;
 
   crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::KeyData>>
   GetPublicKeyData(const std::string& type_url, const std::string& serialized_private_key)
-      const LOCKS_EXCLUDED(maps_mutex_);
+      const;
 
   template <class P>
   crypto::tink::util::StatusOr<std::unique_ptr<P>> Wrap(
-      std::unique_ptr<PrimitiveSet<P>> primitive_set) const
+      std::unique_ptr<PrimitiveSet<P>> primitive_set) const;
+
+  // Makes Wrap() monitor the primitives it returns with clients created
+  // by 'factory'.  A null 'factory' disables monitoring.
+  crypto::tink::util::Status RegisterMonitoringClientFactory(
+      std::shared_ptr<MonitoringClientFactory> factory)
       LOCKS_EXCLUDED(maps_mutex_);
 
   void Reset() LOCKS_EXCLUDED(maps_mutex_);
 
+  // A list of registrations, see below.
+  class Batch;
+
+  // Applies all the registrations in 'batch' in a single update of the
+  // registry.  If any of them fails, none of them takes effect.
+  crypto::tink::util::Status RegisterBatch(Batch batch)
+      LOCKS_EXCLUDED(maps_mutex_);
+
  private:
-  // All information for a given type url.
+  // All information for a given type url.  Copies share the key managers.
   class KeyTypeInfo {
    public:
     // Information for each primitive which is available for a key type.
@@ -262,7 +288,7 @@ class RegistryImpl {
     // A factory constructed from an internal key manager. Owned version of
     // key_factory if constructed with an InternalKeyManager. This is nullptr if
     // constructed with a KeyManager.
-    std::unique_ptr<const KeyFactory> internal_key_factory_;
+    std::shared_ptr<const KeyFactory> internal_key_factory_;
     // Unowned copy of internal_key_factory, always different from
     // nullptr.
     const KeyFactory* key_factory_;
@@ -287,31 +313,243 @@ class RegistryImpl {
     const std::string type_id_name;
   };
 
-  RegistryImpl() = default;
+  // The registered key managers, wrappers and catalogues.  Immutable once
+  // published; the entries are shared by subsequent snapshots.
+  struct Snapshot {
+    std::unordered_map<std::string, std::shared_ptr<const KeyTypeInfo>>
+        type_url_to_info;
+    // A map from the type_id to the corresponding wrapper. We use a
+    // shared_ptr because shared_ptr<void> is valid (as opposed to
+    // unique_ptr<void>).
+    std::unordered_map<std::type_index, std::shared_ptr<void>>
+        primitive_to_wrapper;
+    std::unordered_map<std::string, std::shared_ptr<const LabelInfo>>
+        name_to_catalogue_map;
+    // Creates the monitoring clients of wrapped primitives, if not null.
+    std::shared_ptr<MonitoringClientFactory> monitoring_factory;
+  };
+
+  RegistryImpl();
+  ~RegistryImpl();
   RegistryImpl(const RegistryImpl&) = delete;
   RegistryImpl& operator=(const RegistryImpl&) = delete;
 
   template <class P>
   crypto::tink::util::StatusOr<const PrimitiveWrapper<P>*> get_wrapper()
-      const LOCKS_EXCLUDED(maps_mutex_);
+      const;
 
-  // Returns OK if the key manager with the given type index can be inserted
-  // for type url type_url and parameter new_key_allowed. Otherwise returns
-  // an error to be returned to the user.
-  crypto::tink::util::Status CheckInsertable(
-      const std::string& type_url, const std::type_index& key_manager_type_index,
-      bool new_key_allowed) const SHARED_LOCKS_REQUIRED(maps_mutex_);
+  // A read-side section, in which the snapshot that was current when
+  // the section was entered stays valid.  Sections must not register
+  // anything, and should not call into key managers or wrappers.
+  class ReadSection {
+   public:
+    explicit ReadSection(const RegistryImpl& registry)
+        : reclaimer_(registry.reclaimer_),
+          token_(reclaimer_.EnterRead()),
+          snapshot_(*registry.snapshot_.load(std::memory_order_acquire)) {}
+    ~ReadSection() { reclaimer_.ExitRead(token_); }
+
+    const Snapshot& snapshot() const { return snapshot_; }
+
+   private:
+    ReadSection(const ReadSection&) = delete;
+    ReadSection& operator=(const ReadSection&) = delete;
+
+    crypto::tink::util::EpochReclaimer& reclaimer_;
+    const int token_;
+    const Snapshot& snapshot_;
+  };
+
+  // Returns the current snapshot, which is valid as long as 'maps_mutex_'
+  // is held.
+  const Snapshot& snapshot() const EXCLUSIVE_LOCKS_REQUIRED(maps_mutex_) {
+    return *snapshot_.load(std::memory_order_acquire);
+  }
+
+  // Makes 'new_snapshot' the current snapshot, and frees the replaced one
+  // once the read-side sections that may use it have been exited.
+  void Publish(std::unique_ptr<const Snapshot> new_snapshot)
+      EXCLUSIVE_LOCKS_REQUIRED(maps_mutex_);
+
+  // Applies 'modify' to a copy of the current snapshot, and publishes
+  // the copy if 'modify' succeeds and reports that it changed the copy.
+  template <class F>
+  crypto::tink::util::Status Update(F modify) LOCKS_EXCLUDED(maps_mutex_);
+
+  // The following methods take ownership of the given key managers
+  // (or wrapper), and insert them into 'snapshot' unless they are registered
+  // there already.  They set '*changed' if 'snapshot' was modified.
+  template <class P>
+  static crypto::tink::util::Status InsertKeyManager(
+      std::unique_ptr<KeyManager<P>> owned_manager, bool new_key_allowed,
+      Snapshot* snapshot, bool* changed);
+
+  template <class KeyProto, class KeyFormatProto, class... P>
+  static crypto::tink::util::Status InsertInternalKeyManager(
+      std::unique_ptr<InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>>
+          owned_manager,
+      bool new_key_allowed, Snapshot* snapshot, bool* changed);
 
+  template <class PrivateKeyProto, class KeyFormatProto, class PublicKeyProto,
+            class PrivatePrimitivesList, class PublicPrimitivesList>
+  static crypto::tink::util::Status InsertAsymmetricKeyManagers(
+      std::unique_ptr<InternalPrivateKeyManager<PrivateKeyProto,
+                                                KeyFormatProto, PublicKeyProto,
+                                                PrivatePrimitivesList>>
+          owned_private_key_manager,
+      std::unique_ptr<
+          InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>>
+          owned_public_key_manager,
+      bool new_key_allowed, Snapshot* snapshot, bool* changed);
+
+  template <class P>
+  static crypto::tink::util::Status InsertPrimitiveWrapper(
+      std::unique_ptr<PrimitiveWrapper<P>> owned_wrapper, Snapshot* snapshot,
+      bool* changed);
+
+  // Returns OK if the key manager with the given type index can be inserted
+  // for type url type_url and parameter new_key_allowed into 'snapshot'.
+  // Otherwise returns an error to be returned to the user.
+  static crypto::tink::util::Status CheckInsertable(
+      const Snapshot& snapshot, const std::string& type_url,
+      const std::type_index& key_manager_type_index, bool new_key_allowed);
+
+  // Sets new_key_allowed of the (registered) key type 'type_url'
+  // in 'snapshot' to 'new_key_allowed'.  The KeyTypeInfo is replaced
+  // by a modified copy, as it is shared with the published snapshots.
+  static void SetNewKeyAllowed(const std::string& type_url,
+                               bool new_key_allowed, Snapshot* snapshot);
+
+  // Returns the KeyTypeInfo of 'type_url' in the current snapshot,
+  // or null if 'type_url' is not registered.
+  std::shared_ptr<const KeyTypeInfo> FindKeyTypeInfo(
+      const std::string& type_url) const;
+
+  // Serializes the modifications of the registry.
   mutable absl::Mutex maps_mutex_;
-  std::unordered_map<std::string, KeyTypeInfo> type_url_to_info_
-      GUARDED_BY(maps_mutex_);
-  // A map from the type_id to the corresponding wrapper. We use a shared_ptr
-  // because shared_ptr<void> is valid (as opposed to unique_ptr<void>).
-  std::unordered_map<std::type_index, std::shared_ptr<void>>
-      primitive_to_wrapper_ GUARDED_BY(maps_mutex_);
-
-  std::unordered_map<std::string, LabelInfo> name_to_catalogue_map_
-      GUARDED_BY(maps_mutex_);
+  // The current snapshot, owned by the registry.
+  std::atomic<const Snapshot*> snapshot_;
+  // Tracks the lookups that may use replaced snapshots.
+  mutable crypto::tink::util::EpochReclaimer reclaimer_;
+};
+
+// Key managers and wrappers to be registered by RegistryImpl::RegisterBatch().
+// Registering them together copies the registry's snapshot only once,
+// instead of once per key manager.
+class RegistryImpl::Batch {
+ public:
+  Batch() {}
+  Batch(Batch&& other) = default;
+  Batch& operator=(Batch&& other) = default;
+
+  // The following methods take ownership of their arguments, and are
+  // otherwise like the corresponding Register-methods of RegistryImpl.
+  template <class P>
+  void AddKeyManager(KeyManager<P>* manager, bool new_key_allowed);
+
+  template <class KeyProto, class KeyFormatProto, class... P>
+  void AddInternalKeyManager(
+      InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>* manager,
+      bool new_key_allowed);
+
+  template <class PrivateKeyProto, class KeyFormatProto, class PublicKeyProto,
+            class PrivatePrimitivesList, class PublicPrimitivesList>
+  void AddAsymmetricKeyManagers(
+      InternalPrivateKeyManager<PrivateKeyProto, KeyFormatProto, PublicKeyProto,
+                                PrivatePrimitivesList>* private_key_manager,
+      InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>*
+          public_key_manager,
+      bool new_key_allowed);
+
+  template <class P>
+  void AddPrimitiveWrapper(PrimitiveWrapper<P>* wrapper);
+
+  int size() const { return operations_.size(); }
+
+ private:
+  friend class RegistryImpl;
+
+  // A registration, which is applied to a snapshot like the Insert-methods
+  // of RegistryImpl.
+  class Operation {
+   public:
+    virtual ~Operation() {}
+    virtual crypto::tink::util::Status Apply(Snapshot* snapshot,
+                                             bool* changed) = 0;
+  };
+
+  template <class F>
+  class OperationImpl : public Operation {
+   public:
+    explicit OperationImpl(F apply) : apply_(std::move(apply)) {}
+    crypto::tink::util::Status Apply(Snapshot* snapshot,
+                                     bool* changed) override {
+      return apply_(snapshot, changed);
+    }
+
+   private:
+    F apply_;
+  };
+
+  template <class F>
+  void Add(F apply) {
+    operations_.push_back(
+        absl::make_unique<OperationImpl<F>>(std::move(apply)));
+  }
+
+  // Functors for Add(), which own the objects to be registered.
+  template <class P>
+  struct KeyManagerInsertion {
+    std::unique_ptr<KeyManager<P>> manager;
+    bool new_key_allowed;
+
+    crypto::tink::util::Status operator()(Snapshot* snapshot, bool* changed) {
+      return InsertKeyManager(std::move(manager), new_key_allowed, snapshot,
+                              changed);
+    }
+  };
+
+  template <class KeyProto, class KeyFormatProto, class... P>
+  struct InternalKeyManagerInsertion {
+    std::unique_ptr<InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>>
+        manager;
+    bool new_key_allowed;
+
+    crypto::tink::util::Status operator()(Snapshot* snapshot, bool* changed) {
+      return InsertInternalKeyManager(std::move(manager), new_key_allowed,
+                                      snapshot, changed);
+    }
+  };
+
+  template <class PrivateKeyProto, class KeyFormatProto, class PublicKeyProto,
+            class PrivatePrimitivesList, class PublicPrimitivesList>
+  struct AsymmetricKeyManagersInsertion {
+    std::unique_ptr<InternalPrivateKeyManager<PrivateKeyProto, KeyFormatProto,
+                                              PublicKeyProto,
+                                              PrivatePrimitivesList>>
+        private_key_manager;
+    std::unique_ptr<
+        InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>>
+        public_key_manager;
+    bool new_key_allowed;
+
+    crypto::tink::util::Status operator()(Snapshot* snapshot, bool* changed) {
+      return InsertAsymmetricKeyManagers(std::move(private_key_manager),
+                                         std::move(public_key_manager),
+                                         new_key_allowed, snapshot, changed);
+    }
+  };
+
+  template <class P>
+  struct PrimitiveWrapperInsertion {
+    std::unique_ptr<PrimitiveWrapper<P>> wrapper;
+
+    crypto::tink::util::Status operator()(Snapshot* snapshot, bool* changed) {
+      return InsertPrimitiveWrapper(std::move(wrapper), snapshot, changed);
+    }
+  };
+
+  std::vector<std::unique_ptr<Operation>> operations_;
 };
 
 template <class P>
@@ -324,10 +562,11 @@ crypto::tink::util::Status RegistryImpl::AddCatalogue(
   }
   std::shared_ptr<void> entry(catalogue);
   absl::MutexLock lock(&maps_mutex_);
-  auto curr_catalogue = name_to_catalogue_map_.find(catalogue_name);
-  if (curr_catalogue != name_to_catalogue_map_.end()) {
+  const Snapshot& current = snapshot();
+  auto curr_catalogue = current.name_to_catalogue_map.find(catalogue_name);
+  if (curr_catalogue != current.name_to_catalogue_map.end()) {
     auto existing =
-        static_cast<Catalogue<P>*>(curr_catalogue->second.catalogue.get());
+        static_cast<Catalogue<P>*>(curr_catalogue->second->catalogue.get());
     if (std::type_index(typeid(*existing)) !=
         std::type_index(typeid(*catalogue))) {
       return ToStatusF(crypto::tink::util::error::ALREADY_EXISTS,
@@ -335,10 +574,13 @@ crypto::tink::util::Status RegistryImpl::AddCatalogue(
                        catalogue_name.c_str());
     }
   } else {
-    name_to_catalogue_map_.emplace(
-        std::piecewise_construct, std::forward_as_tuple(catalogue_name),
-        std::forward_as_tuple(std::move(entry), std::type_index(typeid(P)),
-                              typeid(P).name()));
+    auto updated = absl::make_unique<Snapshot>(current);
+    updated->name_to_catalogue_map.emplace(
+        catalogue_name,
+        std::make_shared<const LabelInfo>(std::move(entry),
+                                          std::type_index(typeid(P)),
+                                          typeid(P).name()));
+    Publish(std::move(updated));
   }
   return crypto::tink::util::Status::OK;
 }
@@ -346,99 +588,172 @@ crypto::tink::util::Status RegistryImpl::AddCatalogue(
 template <class P>
 crypto::tink::util::StatusOr<const Catalogue<P>*> RegistryImpl::get_catalogue(
     const std::string& catalogue_name) const {
-  absl::MutexLock lock(&maps_mutex_);
-  auto catalogue_entry = name_to_catalogue_map_.find(catalogue_name);
-  if (catalogue_entry == name_to_catalogue_map_.end()) {
+  ReadSection section(*this);
+  const Snapshot& current = section.snapshot();
+  auto catalogue_entry = current.name_to_catalogue_map.find(catalogue_name);
+  if (catalogue_entry == current.name_to_catalogue_map.end()) {
     return ToStatusF(crypto::tink::util::error::NOT_FOUND,
                      "No catalogue named '%s' has been added.",
                      catalogue_name.c_str());
   }
-  if (catalogue_entry->second.type_id_name != typeid(P).name()) {
+  if (catalogue_entry->second->type_id_name != typeid(P).name()) {
     return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
                      "Wrong Primitive type for catalogue named '%s': "
                      "got '%s', expected '%s'",
                      catalogue_name.c_str(), typeid(P).name(),
-                     catalogue_entry->second.type_id_name.c_str());
+                     catalogue_entry->second->type_id_name.c_str());
   }
-  return static_cast<Catalogue<P>*>(catalogue_entry->second.catalogue.get());
+  return static_cast<Catalogue<P>*>(catalogue_entry->second->catalogue.get());
+}
+
+template <class F>
+crypto::tink::util::Status RegistryImpl::Update(F modify) {
+  absl::MutexLock lock(&maps_mutex_);
+  auto updated = absl::make_unique<Snapshot>(snapshot());
+  bool changed = false;
+  crypto::tink::util::Status status = modify(updated.get(), &changed);
+  if (!status.ok()) return status;
+  if (changed) Publish(std::move(updated));
+  return crypto::tink::util::Status::OK;
 }
 
 template <class P>
 crypto::tink::util::Status RegistryImpl::RegisterKeyManager(
     KeyManager<P>* manager, bool new_key_allowed) {
   auto owned_manager = absl::WrapUnique(manager);
+  return Update([&](Snapshot* snapshot, bool* changed) {
+    return InsertKeyManager(std::move(owned_manager), new_key_allowed,
+                            snapshot, changed);
+  });
+}
+
+template <class KeyProto, class KeyFormatProto, class... P>
+crypto::tink::util::Status RegistryImpl::RegisterInternalKeyManager(
+    InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>* manager,
+    bool new_key_allowed) {
+  auto owned_manager = absl::WrapUnique(manager);
+  return Update([&](Snapshot* snapshot, bool* changed) {
+    return InsertInternalKeyManager(std::move(owned_manager), new_key_allowed,
+                                    snapshot, changed);
+  });
+}
+
+template <class PrivateKeyProto, class KeyFormatProto, class PublicKeyProto,
+          class PrivatePrimitivesList, class PublicPrimitivesList>
+crypto::tink::util::Status RegistryImpl::RegisterAsymmetricKeyManagers(
+    InternalPrivateKeyManager<PrivateKeyProto, KeyFormatProto, PublicKeyProto,
+                              PrivatePrimitivesList>* private_key_manager,
+    InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>*
+        public_key_manager,
+    bool new_key_allowed) LOCKS_EXCLUDED(maps_mutex_) {
+  auto owned_private_key_manager = absl::WrapUnique(private_key_manager);
+  auto owned_public_key_manager = absl::WrapUnique(public_key_manager);
+  return Update([&](Snapshot* snapshot, bool* changed) {
+    return InsertAsymmetricKeyManagers(std::move(owned_private_key_manager),
+                                       std::move(owned_public_key_manager),
+                                       new_key_allowed, snapshot, changed);
+  });
+}
+
+template <class P>
+crypto::tink::util::Status RegistryImpl::RegisterPrimitiveWrapper(
+    PrimitiveWrapper<P>* wrapper) {
+  auto owned_wrapper = absl::WrapUnique(wrapper);
+  return Update([&](Snapshot* snapshot, bool* changed) {
+    return InsertPrimitiveWrapper(std::move(owned_wrapper), snapshot, changed);
+  });
+}
+
+// static
+template <class P>
+crypto::tink::util::Status RegistryImpl::InsertKeyManager(
+    std::unique_ptr<KeyManager<P>> owned_manager, bool new_key_allowed,
+    Snapshot* snapshot, bool* changed) {
   if (owned_manager == nullptr) {
     return crypto::tink::util::Status(
         crypto::tink::util::error::INVALID_ARGUMENT,
         "Parameter 'manager' must be non-null.");
   }
   std::string type_url = owned_manager->get_key_type();
-  if (!manager->DoesSupport(type_url)) {
+  if (!owned_manager->DoesSupport(type_url)) {
     return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
                      "The manager does not support type '%s'.",
                      type_url.c_str());
   }
-  absl::MutexLock lock(&maps_mutex_);
-  crypto::tink::util::Status status = CheckInsertable(
-      type_url, std::type_index(typeid(*owned_manager)), new_key_allowed);
+  crypto::tink::util::Status status =
+      CheckInsertable(*snapshot, type_url,
+                      std::type_index(typeid(*owned_manager)), new_key_allowed);
   if (!status.ok()) return status;
 
-  auto it = type_url_to_info_.find(type_url);
-  if (it != type_url_to_info_.end()) {
-    it->second.set_new_key_allowed(new_key_allowed);
+  auto it = snapshot->type_url_to_info.find(type_url);
+  if (it != snapshot->type_url_to_info.end() &&
+      it->second->new_key_allowed() == new_key_allowed) {
+    return crypto::tink::util::Status::OK;
+  }
+  if (it != snapshot->type_url_to_info.end()) {
+    SetNewKeyAllowed(type_url, new_key_allowed, snapshot);
   } else {
-    type_url_to_info_.emplace(
-        std::piecewise_construct, std::forward_as_tuple(type_url),
-        std::forward_as_tuple(owned_manager.release(), new_key_allowed));
+    snapshot->type_url_to_info.emplace(
+        type_url, std::make_shared<const KeyTypeInfo>(owned_manager.release(),
+                                                      new_key_allowed));
   }
+  *changed = true;
   return crypto::tink::util::Status::OK;
 }
 
+// static
 template <class KeyProto, class KeyFormatProto, class... P>
-crypto::tink::util::Status RegistryImpl::RegisterInternalKeyManager(
-    InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>* manager,
-    bool new_key_allowed) {
-  std::unique_ptr<InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>>
-      owned_manager = absl::WrapUnique(manager);
-
-  if (manager == nullptr) {
+crypto::tink::util::Status RegistryImpl::InsertInternalKeyManager(
+    std::unique_ptr<InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>>
+        owned_manager,
+    bool new_key_allowed, Snapshot* snapshot, bool* changed) {
+  if (owned_manager == nullptr) {
     return crypto::tink::util::Status(
         crypto::tink::util::error::INVALID_ARGUMENT,
         "Parameter 'manager' must be non-null.");
   }
   std::string type_url = owned_manager->get_key_type();
-  absl::MutexLock lock(&maps_mutex_);
-  crypto::tink::util::Status status = CheckInsertable(
-      type_url, std::type_index(typeid(*owned_manager)), new_key_allowed);
+  crypto::tink::util::Status status =
+      CheckInsertable(*snapshot, type_url,
+                      std::type_index(typeid(*owned_manager)), new_key_allowed);
   if (!status.ok()) return status;
 
-  auto it = type_url_to_info_.find(type_url);
-  if (it != type_url_to_info_.end()) {
-    it->second.set_new_key_allowed(new_key_allowed);
+  auto it = snapshot->type_url_to_info.find(type_url);
+  if (it != snapshot->type_url_to_info.end() &&
+      it->second->new_key_allowed() == new_key_allowed) {
+    return crypto::tink::util::Status::OK;
+  }
+  if (it != snapshot->type_url_to_info.end()) {
+    SetNewKeyAllowed(type_url, new_key_allowed, snapshot);
   } else {
-    type_url_to_info_.emplace(
-        std::piecewise_construct, std::forward_as_tuple(type_url),
-        std::forward_as_tuple(owned_manager.release(), new_key_allowed));
+    snapshot->type_url_to_info.emplace(
+        type_url, std::make_shared<const KeyTypeInfo>(owned_manager.release(),
+                                                      new_key_allowed));
   }
+  *changed = true;
   return crypto::tink::util::Status::OK;
 }
 
+// static
 template <class PrivateKeyProto, class KeyFormatProto, class PublicKeyProto,
           class PrivatePrimitivesList, class PublicPrimitivesList>
-crypto::tink::util::Status RegistryImpl::RegisterAsymmetricKeyManagers(
-    InternalPrivateKeyManager<PrivateKeyProto, KeyFormatProto, PublicKeyProto,
-                              PrivatePrimitivesList>* private_key_manager,
-    InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>*
-        public_key_manager,
-    bool new_key_allowed) LOCKS_EXCLUDED(maps_mutex_) {
-  auto owned_private_key_manager = absl::WrapUnique(private_key_manager);
-  auto owned_public_key_manager = absl::WrapUnique(public_key_manager);
+crypto::tink::util::Status RegistryImpl::InsertAsymmetricKeyManagers(
+    std::unique_ptr<InternalPrivateKeyManager<PrivateKeyProto, KeyFormatProto,
+                                              PublicKeyProto,
+                                              PrivatePrimitivesList>>
+        owned_private_key_manager,
+    std::unique_ptr<
+        InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>>
+        owned_public_key_manager,
+    bool new_key_allowed, Snapshot* snapshot, bool* changed) {
+  auto private_key_manager = owned_private_key_manager.get();
+  auto public_key_manager = owned_public_key_manager.get();
   if (private_key_manager == nullptr) {
     return crypto::tink::util::Status(
         crypto::tink::util::error::INVALID_ARGUMENT,
         "Parameter 'private_key_manager' must be non-null.");
   }
-  if (owned_public_key_manager == nullptr) {
+  if (public_key_manager == nullptr) {
     return crypto::tink::util::Status(
         crypto::tink::util::error::INVALID_ARGUMENT,
         "Parameter 'public_key_manager' must be non-null.");
@@ -446,12 +761,11 @@ crypto::tink::util::Status RegistryImpl::RegisterAsymmetricKeyManagers(
   std::string private_type_url = private_key_manager->get_key_type();
   std::string public_type_url = public_key_manager->get_key_type();
 
-  absl::MutexLock lock(&maps_mutex_);
   crypto::tink::util::Status status = CheckInsertable(
-      private_type_url, std::type_index(typeid(*private_key_manager)),
-      new_key_allowed);
+      *snapshot, private_type_url,
+      std::type_index(typeid(*private_key_manager)), new_key_allowed);
   if (!status.ok()) return status;
-  status = CheckInsertable(public_type_url,
+  status = CheckInsertable(*snapshot, public_type_url,
                            std::type_index(typeid(*public_key_manager)),
                            new_key_allowed);
   if (!status.ok()) return status;
@@ -462,58 +776,59 @@ crypto::tink::util::Status RegistryImpl::RegisterAsymmetricKeyManagers(
         "Passed in key managers must have different get_key_type() results.");
   }
 
-  auto it = type_url_to_info_.find(private_type_url);
-  if (it != type_url_to_info_.end()) {
-    if (it->second.public_key_manager_type_index().has_value()) {
-      if (*it->second.public_key_manager_type_index() !=
+  auto it = snapshot->type_url_to_info.find(private_type_url);
+  if (it != snapshot->type_url_to_info.end()) {
+    if (it->second->public_key_manager_type_index().has_value()) {
+      if (*it->second->public_key_manager_type_index() !=
           std::type_index(typeid(*public_key_manager))) {
         return crypto::tink::util::Status(
             crypto::tink::util::error::INVALID_ARGUMENT,
             absl::StrCat("public key manager corresponding to ",
                          std::type_index(typeid(*private_key_manager)).name(),
                          " is already registered with ",
-                         it->second.public_key_manager_type_index()->name(),
+                         it->second->public_key_manager_type_index()->name(),
                          ", cannot be re-registered with ",
                          std::type_index(typeid(*private_key_manager)).name()));
       }
     }
   }
 
-  it = type_url_to_info_.find(private_type_url);
-  if (it == type_url_to_info_.end() ||
-      !it->second.public_key_manager_type_index().has_value()) {
-    type_url_to_info_.emplace(
-        std::piecewise_construct, std::forward_as_tuple(private_type_url),
-        std::forward_as_tuple(owned_private_key_manager.release(),
-                              owned_public_key_manager.get(), new_key_allowed));
+  if (it == snapshot->type_url_to_info.end() ||
+      !it->second->public_key_manager_type_index().has_value()) {
+    // Like emplace(), does not replace an existing entry.
+    snapshot->type_url_to_info.emplace(
+        private_type_url,
+        std::make_shared<const KeyTypeInfo>(owned_private_key_manager.release(),
+                                            public_key_manager,
+                                            new_key_allowed));
   } else {
-    it->second.set_new_key_allowed(new_key_allowed);
+    SetNewKeyAllowed(private_type_url, new_key_allowed, snapshot);
   }
 
-  it = type_url_to_info_.find(public_type_url);
-  if (it == type_url_to_info_.end()) {
-    type_url_to_info_.emplace(
-        std::piecewise_construct, std::forward_as_tuple(public_type_url),
-        std::forward_as_tuple(owned_public_key_manager.release(),
-                              new_key_allowed));
+  if (snapshot->type_url_to_info.count(public_type_url) == 0) {
+    snapshot->type_url_to_info.emplace(
+        public_type_url,
+        std::make_shared<const KeyTypeInfo>(owned_public_key_manager.release(),
+                                            new_key_allowed));
   }
-
+  *changed = true;
   return util::OkStatus();
 }
 
+// static
 template <class P>
-crypto::tink::util::Status RegistryImpl::RegisterPrimitiveWrapper(
-    PrimitiveWrapper<P>* wrapper) {
-  if (wrapper == nullptr) {
+crypto::tink::util::Status RegistryImpl::InsertPrimitiveWrapper(
+    std::unique_ptr<PrimitiveWrapper<P>> owned_wrapper, Snapshot* snapshot,
+    bool* changed) {
+  if (owned_wrapper == nullptr) {
     return crypto::tink::util::Status(
         crypto::tink::util::error::INVALID_ARGUMENT,
         "Parameter 'wrapper' must be non-null.");
   }
-  std::shared_ptr<void> entry(wrapper);
+  std::shared_ptr<void> entry(std::move(owned_wrapper));
 
-  absl::MutexLock lock(&maps_mutex_);
-  auto it = primitive_to_wrapper_.find(std::type_index(typeid(P)));
-  if (it != primitive_to_wrapper_.end()) {
+  auto it = snapshot->primitive_to_wrapper.find(std::type_index(typeid(P)));
+  if (it != snapshot->primitive_to_wrapper.end()) {
     if (std::type_index(
             typeid(*static_cast<PrimitiveWrapper<P>*>(it->second.get()))) !=
         std::type_index(
@@ -524,22 +839,58 @@ crypto::tink::util::Status RegistryImpl::RegisterPrimitiveWrapper(
     }
     return crypto::tink::util::Status::OK;
   }
-  primitive_to_wrapper_.insert(
+  snapshot->primitive_to_wrapper.insert(
       std::make_pair(std::type_index(typeid(P)), std::move(entry)));
+  *changed = true;
   return crypto::tink::util::Status::OK;
 }
 
+template <class P>
+void RegistryImpl::Batch::AddKeyManager(KeyManager<P>* manager,
+                                        bool new_key_allowed) {
+  Add(KeyManagerInsertion<P>{absl::WrapUnique(manager), new_key_allowed});
+}
+
+template <class KeyProto, class KeyFormatProto, class... P>
+void RegistryImpl::Batch::AddInternalKeyManager(
+    InternalKeyManager<KeyProto, KeyFormatProto, List<P...>>* manager,
+    bool new_key_allowed) {
+  Add(InternalKeyManagerInsertion<KeyProto, KeyFormatProto, P...>{
+      absl::WrapUnique(manager), new_key_allowed});
+}
+
+template <class PrivateKeyProto, class KeyFormatProto, class PublicKeyProto,
+          class PrivatePrimitivesList, class PublicPrimitivesList>
+void RegistryImpl::Batch::AddAsymmetricKeyManagers(
+    InternalPrivateKeyManager<PrivateKeyProto, KeyFormatProto, PublicKeyProto,
+                              PrivatePrimitivesList>* private_key_manager,
+    InternalKeyManager<PublicKeyProto, void, PublicPrimitivesList>*
+        public_key_manager,
+    bool new_key_allowed) {
+  Add(AsymmetricKeyManagersInsertion<PrivateKeyProto, KeyFormatProto,
+                                     PublicKeyProto, PrivatePrimitivesList,
+                                     PublicPrimitivesList>{
+      absl::WrapUnique(private_key_manager),
+      absl::WrapUnique(public_key_manager), new_key_allowed});
+}
+
+template <class P>
+void RegistryImpl::Batch::AddPrimitiveWrapper(PrimitiveWrapper<P>* wrapper) {
+  Add(PrimitiveWrapperInsertion<P>{absl::WrapUnique(wrapper)});
+}
+
 template <class P>
 crypto::tink::util::StatusOr<const KeyManager<P>*>
 RegistryImpl::get_key_manager(const std::string& type_url) const {
-  absl::MutexLock lock(&maps_mutex_);
-  auto it = type_url_to_info_.find(type_url);
-  if (it == type_url_to_info_.end()) {
+  ReadSection section(*this);
+  const Snapshot& current = section.snapshot();
+  auto it = current.type_url_to_info.find(type_url);
+  if (it == current.type_url_to_info.end()) {
     return ToStatusF(crypto::tink::util::error::NOT_FOUND,
                      "No manager for type '%s' has been registered.",
                      type_url.c_str());
   }
-  return it->second.get_key_manager<P>(type_url);
+  return it->second->get_key_manager<P>(type_url);
 }
 
 template <class P>
@@ -565,9 +916,10 @@ crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::GetPrimitive(
 template <class P>
 crypto::tink::util::StatusOr<const PrimitiveWrapper<P>*>
 RegistryImpl::get_wrapper() const {
-  absl::MutexLock lock(&maps_mutex_);
-  auto it = primitive_to_wrapper_.find(std::type_index(typeid(P)));
-  if (it == primitive_to_wrapper_.end()) {
+  ReadSection section(*this);
+  const Snapshot& current = section.snapshot();
+  auto it = current.primitive_to_wrapper.find(std::type_index(typeid(P)));
+  if (it == current.primitive_to_wrapper.end()) {
     return util::Status(
         util::error::INVALID_ARGUMENT,
         absl::StrCat("No wrapper registered for type ", typeid(P).name()));
@@ -587,6 +939,17 @@ crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::Wrap(
   if (!wrapper_result.ok()) {
     return wrapper_result.status();
   }
+  if (!wrapper_result.ValueOrDie()->SupportsLazyPrimitives()) {
+    crypto::tink::util::Status status = primitive_set->PinLazyPrimitives();
+    if (!status.ok()) return status;
+  }
+  // Holds the factory while wrapping, even if it is replaced meanwhile.
+  std::shared_ptr<MonitoringClientFactory> monitoring_factory =
+      ReadSection(*this).snapshot().monitoring_factory;
+  if (monitoring_factory != nullptr) {
+    return wrapper_result.ValueOrDie()->WrapWithMonitoring(
+        std::move(primitive_set), monitoring_factory.get());
+  }
   crypto::tink::util::StatusOr<std::unique_ptr<P>> primitive_result =
       wrapper_result.ValueOrDie()->Wrap(std::move(primitive_set));
   return std::move(primitive_result);
@@ -16,6 +16,7 @@
 
 #include "tink/registry.h"
 
+#include <atomic>
 #include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
@@ -23,6 +24,7 @@
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
 #include "tink/aead.h"
 #include "tink/aead/aead_catalogue.h"
 #include "tink/aead/aead_wrapper.h"
@@ -35,6 +37,7 @@
 #include "tink/keyset_manager.h"
 #include "tink/subtle/aes_gcm_boringssl.h"
 #include "tink/subtle/random.h"
+#include "tink/util/monitoring_counters.h"
 #include "tink/util/protobuf_helper.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -289,6 +292,121 @@ TEST_F(RegistryTest, testConcurrentRegistration) {
   EXPECT_EQ(util::error::NOT_FOUND, manager_result.status().error_code());
 }
 
+TEST_F(RegistryTest, testLookupsDuringRegistration) {
+  std::string key_type_prefix_a = "key_type_a_";
+  std::string key_type_prefix_b = "key_type_b_";
+  int count_a = 10;
+  int count_b = 100;
+  register_test_managers(key_type_prefix_a, count_a);
+
+  // Look up the managers registered so far while registering more.
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        verify_test_managers(key_type_prefix_a, count_a);
+      }
+    });
+  }
+  register_test_managers(key_type_prefix_b, count_b);
+  done = true;
+  for (auto& reader : readers) reader.join();
+
+  verify_test_managers(key_type_prefix_a, count_a);
+  verify_test_managers(key_type_prefix_b, count_b);
+}
+
+// A key factory whose NewKeyData() reports its start in 'started' and then
+// waits for 'release'.
+class BlockingKeyFactory : public TestKeyFactory {
+ public:
+  BlockingKeyFactory(const std::string& key_type, absl::Notification* started,
+                     absl::Notification* release)
+      : TestKeyFactory(key_type), started_(started), release_(release) {}
+
+  util::StatusOr<std::unique_ptr<KeyData>> NewKeyData(
+      absl::string_view serialized_key_format) const override {
+    started_->Notify();
+    release_->WaitForNotification();
+    return TestKeyFactory::NewKeyData(serialized_key_format);
+  }
+
+ private:
+  absl::Notification* started_;
+  absl::Notification* release_;
+};
+
+// A key manager which counts its destructions in 'destructions', and whose
+// key factory is a BlockingKeyFactory.
+class DestructionCountingKeyManager : public TestAeadKeyManager {
+ public:
+  DestructionCountingKeyManager(const std::string& key_type,
+                                int* destructions, absl::Notification* started,
+                                absl::Notification* release)
+      : TestAeadKeyManager(key_type),
+        destructions_(destructions),
+        key_factory_(key_type, started, release) {}
+
+  ~DestructionCountingKeyManager() override { (*destructions_)++; }
+
+  const KeyFactory& get_key_factory() const override {
+    return key_factory_;
+  }
+
+ private:
+  int* destructions_;
+  BlockingKeyFactory key_factory_;
+};
+
+TEST_F(RegistryTest, testResetDestroysKeyManagers) {
+  int destructions = 0;
+  absl::Notification started, release;
+  EXPECT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<DestructionCountingKeyManager>(
+                      "some_key_type", &destructions, &started, &release),
+                  true),
+              IsOk());
+  // The replaced snapshots are freed, but the manager is shared
+  // with the current one.
+  register_test_managers("other_key_type_", 5);
+  EXPECT_EQ(0, destructions);
+  EXPECT_THAT(Registry::get_key_manager<Aead>("some_key_type").status(),
+              IsOk());
+
+  Registry::Reset();
+  EXPECT_EQ(1, destructions);
+}
+
+TEST_F(RegistryTest, testResetKeepsKeyManagersOfPendingLookups) {
+  int destructions = 0;
+  absl::Notification started, release;
+  EXPECT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<DestructionCountingKeyManager>(
+                      "some_key_type", &destructions, &started, &release),
+                  true),
+              IsOk());
+  KeyTemplate key_template;
+  key_template.set_type_url("some_key_type");
+  util::Status new_key_status;
+  std::thread lookup([&key_template, &new_key_status]() {
+    new_key_status = Registry::NewKeyData(key_template).status();
+  });
+  started.WaitForNotification();
+
+  // Reset() returns once no lookup reads the replaced snapshot, but
+  // the lookup in progress still uses the manager.
+  Registry::Reset();
+  EXPECT_EQ(0, destructions);
+  EXPECT_THAT(Registry::get_key_manager<Aead>("some_key_type").status(),
+              StatusIs(util::error::NOT_FOUND));
+
+  release.Notify();
+  lookup.join();
+  EXPECT_THAT(new_key_status, IsOk());
+  EXPECT_EQ(1, destructions);
+}
+
 TEST_F(RegistryTest, testBasic) {
   std::string key_type_1 = "google.crypto.tink.AesCtrHmacAeadKey";
   std::string key_type_2 = "google.crypto.tink.AesGcmKey";
@@ -628,6 +746,42 @@ TEST_F(RegistryTest, WrapperFails) {
                       result.status().error_message());
 }
 
+// Tests that the primitives of lazy entries are created before wrapping,
+// unless the wrapper supports lazy primitives.
+TEST_F(RegistryTest, WrapPinsLazyPrimitives) {
+  Keyset::Key key;
+  key.set_output_prefix_type(OutputPrefixType::TINK);
+  key.set_key_id(1234543);
+  key.set_status(KeyStatusType::ENABLED);
+  Keyset::Key lazy_key = key;
+  lazy_key.set_key_id(726329);
+  auto get_primitive_set = [&key, &lazy_key]() {
+    auto primitive_set = absl::make_unique<PrimitiveSet<Aead>>();
+    auto entry_result = primitive_set->AddPrimitive(
+        absl::make_unique<DummyAead>("primary_aead"), key);
+    primitive_set->set_primary(entry_result.ValueOrDie());
+    primitive_set->AddLazyPrimitive(
+        []() -> util::StatusOr<std::shared_ptr<Aead>> {
+          return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+        },
+        lazy_key);
+    return primitive_set;
+  };
+
+  ASSERT_THAT(Registry::RegisterPrimitiveWrapper(
+                  absl::make_unique<TestWrapper<Aead>>()),
+              IsOk());
+  EXPECT_THAT(
+      Registry::Wrap<Aead>(get_primitive_set()).status(),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("invalid key")));
+
+  Registry::Reset();
+  ASSERT_THAT(
+      Registry::RegisterPrimitiveWrapper(absl::make_unique<AeadWrapper>()),
+      IsOk());
+  EXPECT_THAT(Registry::Wrap<Aead>(get_primitive_set()).status(), IsOk());
+}
+
 // Tests that wrapping works as expected in the usual case.
 TEST_F(RegistryTest, UsualWrappingTest) {
   Keyset keyset;
@@ -685,6 +839,44 @@ TEST_F(RegistryTest, UsualWrappingTest) {
                       decrypt_result.status().error_message());
 }
 
+// Tests that the primitives wrapped while a MonitoringClientFactory is
+// registered report their calls to it.
+TEST_F(RegistryTest, MonitoringClientFactory) {
+  Keyset::Key key;
+  key.set_output_prefix_type(OutputPrefixType::TINK);
+  key.set_key_id(1234543);
+  key.set_status(KeyStatusType::ENABLED);
+  auto get_primitive_set = [&key]() {
+    auto primitive_set = absl::make_unique<PrimitiveSet<Aead>>();
+    auto entry_result = primitive_set->AddPrimitive(
+        absl::make_unique<DummyAead>("aead"), key);
+    EXPECT_TRUE(entry_result.ok());
+    EXPECT_TRUE(primitive_set->set_primary(entry_result.ValueOrDie()).ok());
+    return primitive_set;
+  };
+  ASSERT_TRUE(
+      Registry::RegisterPrimitiveWrapper(absl::make_unique<AeadWrapper>())
+          .ok());
+  auto counters = std::make_shared<util::MonitoringCounters>();
+  ASSERT_TRUE(Registry::RegisterMonitoringClientFactory(counters).ok());
+
+  auto aead_result = Registry::Wrap<Aead>(get_primitive_set());
+  ASSERT_TRUE(aead_result.ok()) << aead_result.status();
+  ASSERT_TRUE(aead_result.ValueOrDie()->Encrypt("plaintext", "aad").ok());
+
+  // Primitives wrapped after monitoring is disabled are not monitored.
+  ASSERT_TRUE(Registry::RegisterMonitoringClientFactory(nullptr).ok());
+  auto unmonitored_result = Registry::Wrap<Aead>(get_primitive_set());
+  ASSERT_TRUE(unmonitored_result.ok()) << unmonitored_result.status();
+  ASSERT_TRUE(
+      unmonitored_result.ValueOrDie()->Encrypt("plaintext", "aad").ok());
+  ASSERT_TRUE(aead_result.ValueOrDie()->Encrypt("plaintext", "aad").ok());
+
+  auto counts = counters->GetCounts();
+  EXPECT_EQ(2, (counts[{"aead", "encrypt"}].keys.at(1234543).calls));
+  EXPECT_EQ(18, (counts[{"aead", "encrypt"}].keys.at(1234543).bytes));
+}
+
 // Tests that the error message in GetKeyManager contains the type_id.name() of
 // the primitive for which the key manager was actually registered.
 TEST_F(RegistryTest, GetKeyManagerErrorMessage) {
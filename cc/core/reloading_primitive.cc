@@ -0,0 +1,89 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/reloading_primitive.h"
+
+#include <sys/stat.h>
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+// The properties of a keyset file that are checked for changes.
+struct FileVersion {
+  time_t modification_time;
+  off_t size;
+  ino_t inode;
+
+  bool operator==(const FileVersion& other) const {
+    return modification_time == other.modification_time &&
+           size == other.size && inode == other.inode;
+  }
+};
+
+struct FileSourceState {
+  absl::Mutex mutex;
+  bool has_been_read GUARDED_BY(mutex) = false;
+  FileVersion version GUARDED_BY(mutex);
+};
+
+}  // namespace
+
+KeysetSource KeysetFileSource(
+    const std::string& filename,
+    std::function<util::StatusOr<std::unique_ptr<KeysetHandle>>(
+        std::unique_ptr<std::istream> keyset_stream)> read_keyset) {
+  auto state = std::make_shared<FileSourceState>();
+  return [filename, read_keyset, state]()
+             -> util::StatusOr<std::unique_ptr<KeysetHandle>> {
+    struct stat file_stat;
+    if (stat(filename.c_str(), &file_stat) != 0) {
+      return ToStatusF(util::error::NOT_FOUND,
+                       "Cannot stat keyset file '%s': %s", filename.c_str(),
+                       std::strerror(errno));
+    }
+    FileVersion version = {file_stat.st_mtime, file_stat.st_size,
+                           file_stat.st_ino};
+    absl::MutexLock lock(&state->mutex);
+    if (state->has_been_read && state->version == version) {
+      return std::unique_ptr<KeysetHandle>(nullptr);
+    }
+    auto keyset_stream = absl::make_unique<std::ifstream>(
+        filename, std::ios_base::in | std::ios_base::binary);
+    if (!keyset_stream->is_open()) {
+      return ToStatusF(util::error::NOT_FOUND,
+                       "Cannot open keyset file '%s'", filename.c_str());
+    }
+    auto keyset_handle_result = read_keyset(std::move(keyset_stream));
+    if (!keyset_handle_result.ok()) return keyset_handle_result.status();
+    state->has_been_read = true;
+    state->version = version;
+    return std::move(keyset_handle_result.ValueOrDie());
+  };
+}
+
+}  // namespace tink
+}  // namespace crypto
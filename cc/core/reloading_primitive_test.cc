@@ -0,0 +1,349 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/reloading_primitive.h"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/binary_keyset_reader.h"
+#include "tink/cleartext_keyset_handle.h"
+#include "tink/key_manager.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AddKeyData;
+using crypto::tink::test::DummyAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+using google::crypto::tink::KeyData;
+using google::crypto::tink::Keyset;
+using google::crypto::tink::KeyStatusType;
+using google::crypto::tink::OutputPrefixType;
+
+const char kKeyType[] = "type.googleapis.com/test.ReloadingPrimitiveTestKey";
+
+class DummyKeyFactory : public KeyFactory {
+ public:
+  util::StatusOr<std::unique_ptr<portable_proto::MessageLite>> NewKey(
+      const portable_proto::MessageLite& key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  util::StatusOr<std::unique_ptr<portable_proto::MessageLite>> NewKey(
+      absl::string_view serialized_key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  util::StatusOr<std::unique_ptr<KeyData>> NewKeyData(
+      absl::string_view serialized_key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+};
+
+// Creates DummyAeads named after the key value.
+class DummyAeadKeyManager : public KeyManager<Aead> {
+ public:
+  util::StatusOr<std::unique_ptr<Aead>> GetPrimitive(
+      const KeyData& key_data) const override {
+    if (key_data.value() == "invalid") {
+      return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+    }
+    return {absl::make_unique<DummyAead>(key_data.value())};
+  }
+
+  util::StatusOr<std::unique_ptr<Aead>> GetPrimitive(
+      const portable_proto::MessageLite& key) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  uint32_t get_version() const override { return 0; }
+
+  const std::string& get_key_type() const override { return key_type_; }
+
+  const KeyFactory& get_key_factory() const override { return key_factory_; }
+
+ private:
+  const std::string key_type_ = kKeyType;
+  DummyKeyFactory key_factory_;
+};
+
+// Returns a keyset with a single raw key with the given value, whose
+// primitive is a DummyAead named 'key_value'.
+Keyset GetKeyset(const std::string& key_value) {
+  KeyData key_data;
+  key_data.set_type_url(kKeyType);
+  key_data.set_value(key_value);
+  key_data.set_key_material_type(KeyData::SYMMETRIC);
+  Keyset keyset;
+  AddKeyData(key_data, 1, OutputPrefixType::RAW, KeyStatusType::ENABLED,
+             &keyset);
+  keyset.set_primary_key_id(1);
+  return keyset;
+}
+
+// Returns the name of the DummyAead 'aead'.
+std::string GetName(const Aead& aead) {
+  auto encrypt_result = aead.Encrypt("", "");
+  EXPECT_THAT(encrypt_result.status(), IsOk());
+  std::string ciphertext = encrypt_result.ValueOrDie();
+  return ciphertext.substr(ciphertext.find(':', 2) + 1);
+}
+
+// A KeysetSource whose keyset and errors are controlled by the test.
+class TestSource {
+ public:
+  KeysetSource source() {
+    return [this]() { return Next(); };
+  }
+
+  void SetKey(const std::string& key_value) {
+    absl::MutexLock lock(&mutex_);
+    key_value_ = key_value;
+    changed_ = true;
+  }
+
+  void SetStatus(const util::Status& status) {
+    absl::MutexLock lock(&mutex_);
+    status_ = status;
+  }
+
+ private:
+  util::StatusOr<std::unique_ptr<KeysetHandle>> Next() {
+    absl::MutexLock lock(&mutex_);
+    if (!status_.ok()) return status_;
+    if (!changed_) return std::unique_ptr<KeysetHandle>(nullptr);
+    changed_ = false;
+    return TestKeysetHandle::GetKeysetHandle(GetKeyset(key_value_));
+  }
+
+  absl::Mutex mutex_;
+  std::string key_value_ GUARDED_BY(mutex_);
+  bool changed_ GUARDED_BY(mutex_) = false;
+  util::Status status_ GUARDED_BY(mutex_);
+};
+
+class ReloadingPrimitiveTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    ASSERT_THAT(Registry::RegisterKeyManager(
+                    absl::make_unique<DummyAeadKeyManager>(), true),
+                IsOk());
+    ASSERT_THAT(
+        Registry::RegisterPrimitiveWrapper(absl::make_unique<AeadWrapper>()),
+        IsOk());
+  }
+
+  TestSource test_source_;
+};
+
+const std::chrono::steady_clock::duration kNoReloads =
+    std::chrono::steady_clock::duration::zero();
+
+TEST_F(ReloadingPrimitiveTest, Reload) {
+  test_source_.SetKey("key 1");
+  auto result =
+      ReloadingPrimitive<Aead>::New(test_source_.source(), kNoReloads);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& aead = *result.ValueOrDie();
+  EXPECT_EQ("key 1", GetName(*aead.Get()));
+
+  // The keyset has not changed.
+  EXPECT_THAT(aead.Reload(), IsOk());
+  EXPECT_EQ("key 1", GetName(*aead.Get()));
+  EXPECT_EQ(0, aead.reload_count());
+
+  test_source_.SetKey("key 2");
+  EXPECT_THAT(aead.Reload(), IsOk());
+  EXPECT_EQ("key 2", GetName(*aead.Get()));
+  EXPECT_EQ(1, aead.reload_count());
+}
+
+TEST_F(ReloadingPrimitiveTest, ErrorsKeepTheCurrentPrimitive) {
+  test_source_.SetKey("key 1");
+  auto result =
+      ReloadingPrimitive<Aead>::New(test_source_.source(), kNoReloads);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& aead = *result.ValueOrDie();
+
+  test_source_.SetStatus(util::Status(util::error::UNAVAILABLE, "down"));
+  EXPECT_THAT(aead.Reload(), StatusIs(util::error::UNAVAILABLE));
+  EXPECT_THAT(aead.last_reload_status(), StatusIs(util::error::UNAVAILABLE));
+  EXPECT_EQ("key 1", GetName(*aead.Get()));
+
+  test_source_.SetStatus(util::Status::OK);
+  test_source_.SetKey("invalid");
+  EXPECT_THAT(aead.Reload(), StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_EQ("key 1", GetName(*aead.Get()));
+  EXPECT_EQ(0, aead.reload_count());
+
+  test_source_.SetKey("key 2");
+  EXPECT_THAT(aead.Reload(), IsOk());
+  EXPECT_THAT(aead.last_reload_status(), IsOk());
+  EXPECT_EQ("key 2", GetName(*aead.Get()));
+}
+
+TEST_F(ReloadingPrimitiveTest, InitialLoadMustSucceed) {
+  test_source_.SetKey("invalid");
+  EXPECT_THAT(
+      ReloadingPrimitive<Aead>::New(test_source_.source(), kNoReloads)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  TestSource empty_source;
+  EXPECT_THAT(
+      ReloadingPrimitive<Aead>::New(empty_source.source(), kNoReloads)
+          .status(),
+      StatusIs(util::error::FAILED_PRECONDITION));
+
+  EXPECT_THAT(ReloadingPrimitive<Aead>::New(nullptr, kNoReloads).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(ReloadingPrimitiveTest, RefsKeepReplacedPrimitivesAlive) {
+  test_source_.SetKey("key 1");
+  auto result =
+      ReloadingPrimitive<Aead>::New(test_source_.source(), kNoReloads);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& aead = *result.ValueOrDie();
+
+  auto ref = absl::make_unique<ReloadingPrimitive<Aead>::Ref>(aead.Get());
+  test_source_.SetKey("key 2");
+  absl::Notification reloaded;
+  std::thread reload_thread([&aead, &reloaded]() {
+    EXPECT_THAT(aead.Reload(), IsOk());
+    reloaded.Notify();
+  });
+
+  // The new primitive is published right away, but the reload waits
+  // until the reference to the previous primitive is gone.
+  while (GetName(*aead.Get()) != "key 2") absl::SleepFor(absl::Milliseconds(1));
+  EXPECT_FALSE(reloaded.WaitForNotificationWithTimeout(absl::Milliseconds(50)));
+  EXPECT_EQ("key 1", GetName(**ref));
+  // The status of the waiting reload is available meanwhile.
+  EXPECT_THAT(aead.last_reload_status(), IsOk());
+  EXPECT_EQ(1, aead.reload_count());
+  ref.reset();
+  reload_thread.join();
+  EXPECT_TRUE(reloaded.HasBeenNotified());
+}
+
+TEST_F(ReloadingPrimitiveTest, ReloadsInTheBackground) {
+  test_source_.SetKey("key 1");
+  auto result = ReloadingPrimitive<Aead>::New(test_source_.source(),
+                                              std::chrono::milliseconds(1));
+  ASSERT_THAT(result.status(), IsOk());
+  auto& aead = *result.ValueOrDie();
+
+  test_source_.SetKey("key 2");
+  while (aead.reload_count() == 0) absl::SleepFor(absl::Milliseconds(1));
+  EXPECT_EQ("key 2", GetName(*aead.Get()));
+}
+
+TEST_F(ReloadingPrimitiveTest, ConcurrentUseDuringReloads) {
+  test_source_.SetKey("key 0");
+  auto result =
+      ReloadingPrimitive<Aead>::New(test_source_.source(), kNoReloads);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& aead = *result.ValueOrDie();
+
+  std::atomic<bool> done(false);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&aead, &done]() {
+      while (!done) {
+        auto ref = aead.Get();
+        std::string name = GetName(*ref);
+        auto ciphertext = ref->Encrypt("plaintext", "");
+        ASSERT_THAT(ciphertext.status(), IsOk());
+        // The primitive does not change during an operation.
+        EXPECT_EQ(name, GetName(*ref));
+        EXPECT_THAT(ref->Decrypt(ciphertext.ValueOrDie(), "").status(),
+                    IsOk());
+      }
+    });
+  }
+  for (int i = 1; i <= 100; i++) {
+    test_source_.SetKey(absl::StrCat("key ", i));
+    EXPECT_THAT(aead.Reload(), IsOk());
+  }
+  done = true;
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(100, aead.reload_count());
+  EXPECT_EQ("key 100", GetName(*aead.Get()));
+}
+
+TEST_F(ReloadingPrimitiveTest, KeysetFileSource) {
+  std::string filename = absl::StrCat(
+      crypto::tink::test::TmpDir(), "/reloading_primitive_test_keyset");
+  auto write_keyset = [&filename](const std::string& key_value) {
+    std::ofstream file(filename, std::ios_base::out | std::ios_base::binary |
+                                     std::ios_base::trunc);
+    file << GetKeyset(key_value).SerializeAsString();
+  };
+  auto read_keyset = [](std::unique_ptr<std::istream> keyset_stream)
+      -> util::StatusOr<std::unique_ptr<KeysetHandle>> {
+    auto reader_result = BinaryKeysetReader::New(std::move(keyset_stream));
+    if (!reader_result.ok()) return reader_result.status();
+    return CleartextKeysetHandle::Read(std::move(reader_result.ValueOrDie()));
+  };
+  KeysetSource source = KeysetFileSource(filename, read_keyset);
+
+  write_keyset("key 1");
+  auto result = ReloadingPrimitive<Aead>::New(source, kNoReloads);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& aead = *result.ValueOrDie();
+  EXPECT_EQ("key 1", GetName(*aead.Get()));
+
+  // The file has not changed.
+  auto source_result = source();
+  ASSERT_THAT(source_result.status(), IsOk());
+  EXPECT_EQ(nullptr, source_result.ValueOrDie());
+
+  // A keyset of another size.
+  write_keyset("key 22");
+  EXPECT_THAT(aead.Reload(), IsOk());
+  EXPECT_EQ("key 22", GetName(*aead.Get()));
+
+  std::remove(filename.c_str());
+  EXPECT_THAT(aead.Reload(), StatusIs(util::error::NOT_FOUND));
+  EXPECT_EQ("key 22", GetName(*aead.Get()));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,179 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/static_config.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/key_manager.h"
+#include "tink/primitive_set.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::DummyAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+using google::crypto::tink::KeyData;
+using google::crypto::tink::KeyTemplate;
+
+class DummyKeyFactory : public KeyFactory {
+ public:
+  util::StatusOr<std::unique_ptr<portable_proto::MessageLite>> NewKey(
+      const portable_proto::MessageLite& key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  util::StatusOr<std::unique_ptr<portable_proto::MessageLite>> NewKey(
+      absl::string_view serialized_key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  util::StatusOr<std::unique_ptr<KeyData>> NewKeyData(
+      absl::string_view serialized_key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+};
+
+// A key manager for the key type "test.StaticConfigKey<n>", which creates
+// DummyAeads named after the key type.
+template <int n>
+class DummyAeadKeyManager : public KeyManager<Aead> {
+ public:
+  util::StatusOr<std::unique_ptr<Aead>> GetPrimitive(
+      const KeyData& key_data) const override {
+    return {absl::make_unique<DummyAead>(key_type_)};
+  }
+
+  util::StatusOr<std::unique_ptr<Aead>> GetPrimitive(
+      const portable_proto::MessageLite& key) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not implemented");
+  }
+
+  uint32_t get_version() const override { return 0; }
+
+  const std::string& get_key_type() const override { return key_type_; }
+
+  const KeyFactory& get_key_factory() const override { return key_factory_; }
+
+ private:
+  const std::string key_type_ =
+      absl::StrCat("type.googleapis.com/test.StaticConfigKey", n);
+  DummyKeyFactory key_factory_;
+};
+
+// Another key manager for the same key type as DummyAeadKeyManager<n>.
+template <int n>
+class OtherAeadKeyManager : public DummyAeadKeyManager<n> {};
+
+std::string KeyType(int n) {
+  return absl::StrCat("type.googleapis.com/test.StaticConfigKey", n);
+}
+
+class StaticConfigTest : public ::testing::Test {
+ protected:
+  void SetUp() override { Registry::Reset(); }
+  void TearDown() override { Registry::Reset(); }
+};
+
+TEST_F(StaticConfigTest, RegistersAllEntries) {
+  using Config = StaticConfig<KeyManagerEntry<DummyAeadKeyManager<1>>,
+                              KeyManagerEntry<DummyAeadKeyManager<2>, false>,
+                              PrimitiveWrapperEntry<AeadWrapper>>;
+  EXPECT_THAT(Config::Register(), IsOk());
+
+  for (int n : {1, 2}) {
+    auto manager_result = Registry::get_key_manager<Aead>(KeyType(n));
+    ASSERT_THAT(manager_result.status(), IsOk());
+    EXPECT_EQ(KeyType(n), manager_result.ValueOrDie()->get_key_type());
+  }
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(3)).status(),
+              StatusIs(util::error::NOT_FOUND));
+
+  // The key type registered with new_key_allowed = false.
+  KeyTemplate key_template;
+  key_template.set_type_url(KeyType(2));
+  EXPECT_THAT(Registry::NewKeyData(key_template).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  // The wrapper.
+  auto primitive_set = absl::make_unique<PrimitiveSet<Aead>>();
+  google::crypto::tink::Keyset::Key key;
+  key.set_key_id(1);
+  key.set_status(google::crypto::tink::KeyStatusType::ENABLED);
+  key.set_output_prefix_type(google::crypto::tink::OutputPrefixType::RAW);
+  auto entry_result =
+      primitive_set->AddPrimitive(absl::make_unique<DummyAead>("aead"), key);
+  ASSERT_THAT(entry_result.status(), IsOk());
+  primitive_set->set_primary(entry_result.ValueOrDie());
+  EXPECT_THAT(Registry::Wrap(std::move(primitive_set)).status(), IsOk());
+}
+
+TEST_F(StaticConfigTest, RegisterIsIdempotent) {
+  using Config = StaticConfig<KeyManagerEntry<DummyAeadKeyManager<1>>,
+                              PrimitiveWrapperEntry<AeadWrapper>>;
+  EXPECT_THAT(Config::Register(), IsOk());
+  EXPECT_THAT(Config::Register(), IsOk());
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(1)).status(), IsOk());
+}
+
+TEST_F(StaticConfigTest, NestedConfigs) {
+  using Inner = StaticConfig<KeyManagerEntry<DummyAeadKeyManager<1>>>;
+  using Config =
+      StaticConfig<Inner, KeyManagerEntry<DummyAeadKeyManager<2>>>;
+  EXPECT_THAT(Config::Register(), IsOk());
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(1)).status(), IsOk());
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(2)).status(), IsOk());
+}
+
+TEST_F(StaticConfigTest, FailedRegistrationRegistersNothing) {
+  EXPECT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<DummyAeadKeyManager<2>>(), true),
+              IsOk());
+  using Config = StaticConfig<KeyManagerEntry<DummyAeadKeyManager<1>>,
+                              KeyManagerEntry<OtherAeadKeyManager<2>>,
+                              KeyManagerEntry<DummyAeadKeyManager<3>>>;
+  EXPECT_THAT(Config::Register(), StatusIs(util::error::ALREADY_EXISTS));
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(1)).status(),
+              StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(3)).status(),
+              StatusIs(util::error::NOT_FOUND));
+
+  // The entries within a configuration must be consistent, too.
+  Registry::Reset();
+  using InconsistentConfig =
+      StaticConfig<KeyManagerEntry<DummyAeadKeyManager<1>>,
+                   KeyManagerEntry<OtherAeadKeyManager<1>>>;
+  EXPECT_THAT(InconsistentConfig::Register(),
+              StatusIs(util::error::ALREADY_EXISTS));
+  EXPECT_THAT(Registry::get_key_manager<Aead>(KeyType(1)).status(),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
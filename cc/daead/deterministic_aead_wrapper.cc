@@ -16,8 +16,10 @@
 
 #include "tink/daead/deterministic_aead_wrapper.h"
 
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
 #include "tink/deterministic_aead.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -28,6 +30,8 @@ namespace tink {
 
 namespace {
 
+using crypto::tink::internal::FunctionMonitor;
+
 util::Status Validate(PrimitiveSet<DeterministicAead>* daead_set) {
   if (daead_set == nullptr) {
     return util::Status(util::error::INTERNAL, "daead_set must be non-NULL");
@@ -41,9 +45,12 @@ util::Status Validate(PrimitiveSet<DeterministicAead>* daead_set) {
 
 class  DeterministicAeadSetWrapper : public DeterministicAead {
  public:
-  explicit DeterministicAeadSetWrapper(
-      std::unique_ptr<PrimitiveSet<DeterministicAead>> daead_set)
-      : daead_set_(std::move(daead_set)) {}
+  DeterministicAeadSetWrapper(
+      std::unique_ptr<PrimitiveSet<DeterministicAead>> daead_set,
+      FunctionMonitor encrypt_monitor, FunctionMonitor decrypt_monitor)
+      : daead_set_(std::move(daead_set)),
+        encrypt_monitor_(std::move(encrypt_monitor)),
+        decrypt_monitor_(std::move(decrypt_monitor)) {}
 
   crypto::tink::util::StatusOr<std::string> EncryptDeterministically(
       absl::string_view plaintext,
@@ -57,6 +64,8 @@ class  DeterministicAeadSetWrapper : public DeterministicAead {
 
  private:
   std::unique_ptr<PrimitiveSet<DeterministicAead>> daead_set_;
+  const FunctionMonitor encrypt_monitor_;
+  const FunctionMonitor decrypt_monitor_;
 };
 
 util::StatusOr<std::string> DeterministicAeadSetWrapper::EncryptDeterministically(
@@ -66,11 +75,16 @@ util::StatusOr<std::string> DeterministicAeadSetWrapper::EncryptDeterministicall
   plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
 
-  auto encrypt_result =
-      daead_set_->get_primary()->get_primitive().EncryptDeterministically(
-          plaintext, associated_data);
-  if (!encrypt_result.ok()) return encrypt_result.status();
-  const std::string& key_id = daead_set_->get_primary()->get_identifier();
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+  const auto* primary = daead_set_->get_primary();
+  auto encrypt_result = primary->get_primitive().EncryptDeterministically(
+      plaintext, associated_data);
+  if (!encrypt_result.ok()) {
+    call.LogFailure();
+    return encrypt_result.status();
+  }
+  call.Log(primary->get_key_id(), plaintext.size());
+  const std::string& key_id = primary->get_identifier();
   return key_id + encrypt_result.ValueOrDie();
 }
 
@@ -80,6 +94,7 @@ util::StatusOr<std::string> DeterministicAeadSetWrapper::DecryptDeterministicall
   // regardless of whether the size is 0.
   associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
 
+  FunctionMonitor::Call call = decrypt_monitor_.StartCall();
   if (ciphertext.length() > CryptoFormat::kNonRawPrefixSize) {
     const std::string& key_id = std::string(
         ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize));
@@ -88,13 +103,16 @@ util::StatusOr<std::string> DeterministicAeadSetWrapper::DecryptDeterministicall
       absl::string_view raw_ciphertext =
           ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& daead_entry : *(primitives_result.ValueOrDie())) {
-        DeterministicAead& daead = daead_entry->get_primitive();
+        auto daead_result = daead_entry->get_shared_primitive();
+        if (!daead_result.ok()) continue;
+        DeterministicAead& daead = *daead_result.ValueOrDie();
         auto decrypt_result =
             daead.DecryptDeterministically(raw_ciphertext, associated_data);
         if (decrypt_result.ok()) {
+          call.Log(daead_entry->get_key_id(), ciphertext.size());
           return std::move(decrypt_result.ValueOrDie());
         } else {
-          // LOG that a matching key didn't decrypt the ciphertext.
+          call.LogKeyFailure(daead_entry->get_key_id());
         }
       }
     }
@@ -104,14 +122,19 @@ util::StatusOr<std::string> DeterministicAeadSetWrapper::DecryptDeterministicall
   auto raw_primitives_result = daead_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& daead_entry : *(raw_primitives_result.ValueOrDie())) {
-      DeterministicAead& daead = daead_entry->get_primitive();
+      auto daead_result = daead_entry->get_shared_primitive();
+      if (!daead_result.ok()) continue;
+      DeterministicAead& daead = *daead_result.ValueOrDie();
       auto decrypt_result =
           daead.DecryptDeterministically(ciphertext, associated_data);
       if (decrypt_result.ok()) {
+        call.Log(daead_entry->get_key_id(), ciphertext.size());
         return std::move(decrypt_result.ValueOrDie());
       }
+      call.LogKeyFailure(daead_entry->get_key_id());
     }
   }
+  call.LogFailure();
   return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
 }
 
@@ -120,10 +143,24 @@ util::StatusOr<std::string> DeterministicAeadSetWrapper::DecryptDeterministicall
 util::StatusOr<std::unique_ptr<DeterministicAead>>
 DeterministicAeadWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<DeterministicAead>> primitive_set) const {
+  return WrapWithMonitoring(std::move(primitive_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<DeterministicAead>>
+DeterministicAeadWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<DeterministicAead>> primitive_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<DeterministicAead> daead(
-      new DeterministicAeadSetWrapper(std::move(primitive_set)));
+  auto encrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, primitive_set.get(), "daead", "encrypt");
+  if (!encrypt_monitor_result.ok()) return encrypt_monitor_result.status();
+  auto decrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, primitive_set.get(), "daead", "decrypt");
+  if (!decrypt_monitor_result.ok()) return decrypt_monitor_result.status();
+  std::unique_ptr<DeterministicAead> daead(new DeterministicAeadSetWrapper(
+      std::move(primitive_set), std::move(encrypt_monitor_result.ValueOrDie()),
+      std::move(decrypt_monitor_result.ValueOrDie())));
   return std::move(daead);
 }
 
@@ -19,6 +19,7 @@
 
 #include "absl/strings/string_view.h"
 #include "tink/deterministic_aead.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/util/statusor.h"
@@ -41,6 +42,13 @@ class DeterministicAeadWrapper : public PrimitiveWrapper<DeterministicAead> {
   crypto::tink::util::StatusOr<std::unique_ptr<DeterministicAead>> Wrap(
       std::unique_ptr<PrimitiveSet<DeterministicAead>> primitive_set)
       const override;
+
+  crypto::tink::util::StatusOr<std::unique_ptr<DeterministicAead>>
+  WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<DeterministicAead>> primitive_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
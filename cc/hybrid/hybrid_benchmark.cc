@@ -0,0 +1,122 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of hybrid encryption and decryption with
+// ECIES-P256-HKDF-HMAC-SHA256-AES128-GCM keysets.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/hybrid/hybrid_config.h"
+#include "tink/hybrid/hybrid_key_templates.h"
+#include "tink/hybrid_decrypt.h"
+#include "tink/hybrid_encrypt.h"
+#include "tink/keyset_handle.h"
+#include "tink/subtle/random.h"
+#include "tink/util/allocation_counter.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AllocationCounter;
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::GetShared;
+using crypto::tink::test::NewKeysetHandle;
+using crypto::tink::test::SetAllocationCounters;
+using crypto::tink::test::SetThroughput;
+using crypto::tink::test::ThreadCounts;
+using google::crypto::tink::OutputPrefixType;
+
+struct HybridPrimitives {
+  std::unique_ptr<HybridEncrypt> encrypt;
+  std::unique_ptr<HybridDecrypt> decrypt;
+};
+
+// Returns the primitives of a fresh key pair, shared by all the threads.
+util::StatusOr<HybridPrimitives*> GetHybridPrimitives() {
+  return GetShared<HybridPrimitives>(
+      "", []() -> util::StatusOr<std::unique_ptr<HybridPrimitives>> {
+        auto status = HybridConfig::Register();
+        if (!status.ok()) return status;
+        auto private_handle_result = NewKeysetHandle(
+            HybridKeyTemplates::EciesP256HkdfHmacSha256Aes128Gcm(), 1,
+            OutputPrefixType::TINK);
+        if (!private_handle_result.ok()) return private_handle_result.status();
+        auto& private_handle = *private_handle_result.ValueOrDie();
+        auto public_handle_result = private_handle.GetPublicKeysetHandle();
+        if (!public_handle_result.ok()) return public_handle_result.status();
+        auto encrypt_result =
+            public_handle_result.ValueOrDie()->GetPrimitive<HybridEncrypt>();
+        if (!encrypt_result.ok()) return encrypt_result.status();
+        auto decrypt_result = private_handle.GetPrimitive<HybridDecrypt>();
+        if (!decrypt_result.ok()) return decrypt_result.status();
+        auto primitives = absl::make_unique<HybridPrimitives>();
+        primitives->encrypt = std::move(encrypt_result.ValueOrDie());
+        primitives->decrypt = std::move(decrypt_result.ValueOrDie());
+        return std::move(primitives);
+      });
+}
+
+void BM_HybridEncrypt(benchmark::State& state) {
+  auto primitives_result = GetHybridPrimitives();
+  if (!CheckOk(primitives_result.status(), &state)) return;
+  const HybridEncrypt& encrypt = *primitives_result.ValueOrDie()->encrypt;
+  std::string plaintext = subtle::Random::GetRandomBytes(state.range(0));
+  std::string context_info = subtle::Random::GetRandomBytes(16);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto encrypt_result = encrypt.Encrypt(plaintext, context_info);
+    if (!CheckOk(encrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(encrypt_result.ValueOrDie().data());
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(state.range(0), &state);
+}
+
+void BM_HybridDecrypt(benchmark::State& state) {
+  auto primitives_result = GetHybridPrimitives();
+  if (!CheckOk(primitives_result.status(), &state)) return;
+  const HybridPrimitives& primitives = *primitives_result.ValueOrDie();
+  std::string context_info = subtle::Random::GetRandomBytes(16);
+  auto encrypt_result = primitives.encrypt->Encrypt(
+      subtle::Random::GetRandomBytes(state.range(0)), context_info);
+  if (!CheckOk(encrypt_result.status(), &state)) return;
+  const std::string& ciphertext = encrypt_result.ValueOrDie();
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto decrypt_result = primitives.decrypt->Decrypt(ciphertext, context_info);
+    if (!CheckOk(decrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(decrypt_result.ValueOrDie().data());
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(state.range(0), &state);
+}
+
+BENCHMARK(BM_HybridEncrypt)->Arg(64)->Arg(16 << 10);
+BENCHMARK(BM_HybridDecrypt)->Arg(64)->Arg(16 << 10);
+BENCHMARK(BM_HybridEncrypt)->Arg(64)->Apply(ThreadCounts);
+BENCHMARK(BM_HybridDecrypt)->Arg(64)->Apply(ThreadCounts);
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -16,8 +16,10 @@
 
 #include "tink/hybrid/hybrid_decrypt_wrapper.h"
 
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
 #include "tink/hybrid_decrypt.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -28,11 +30,15 @@ namespace tink {
 
 namespace {
 
+using crypto::tink::internal::FunctionMonitor;
+
 class HybridDecryptSetWrapper : public HybridDecrypt {
  public:
-  explicit HybridDecryptSetWrapper(
-      std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set)
-      : hybrid_decrypt_set_(std::move(hybrid_decrypt_set)) {}
+  HybridDecryptSetWrapper(
+      std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set,
+      FunctionMonitor decrypt_monitor)
+      : hybrid_decrypt_set_(std::move(hybrid_decrypt_set)),
+        decrypt_monitor_(std::move(decrypt_monitor)) {}
 
   crypto::tink::util::StatusOr<std::string> Decrypt(
       absl::string_view ciphertext,
@@ -42,6 +48,7 @@ class HybridDecryptSetWrapper : public HybridDecrypt {
 
  private:
   std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set_;
+  const FunctionMonitor decrypt_monitor_;
 };
 
 util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
@@ -51,6 +58,7 @@ util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
   // regardless of whether the size is 0.
   context_info = subtle::SubtleUtilBoringSSL::EnsureNonNull(context_info);
 
+  FunctionMonitor::Call call = decrypt_monitor_.StartCall();
   if (ciphertext.length() > CryptoFormat::kNonRawPrefixSize) {
     const std::string& key_id = std::string(ciphertext.substr(0,
         CryptoFormat::kNonRawPrefixSize));
@@ -59,13 +67,17 @@ util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
       absl::string_view raw_ciphertext =
           ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& hybrid_decrypt_entry : *(primitives_result.ValueOrDie())) {
-        HybridDecrypt& hybrid_decrypt = hybrid_decrypt_entry->get_primitive();
+        auto hybrid_decrypt_result =
+            hybrid_decrypt_entry->get_shared_primitive();
+        if (!hybrid_decrypt_result.ok()) continue;
+        HybridDecrypt& hybrid_decrypt = *hybrid_decrypt_result.ValueOrDie();
         auto decrypt_result =
             hybrid_decrypt.Decrypt(raw_ciphertext, context_info);
         if (decrypt_result.ok()) {
+          call.Log(hybrid_decrypt_entry->get_key_id(), ciphertext.size());
           return std::move(decrypt_result.ValueOrDie());
         } else {
-          // LOG that a matching key didn't decrypt the ciphertext.
+          call.LogKeyFailure(hybrid_decrypt_entry->get_key_id());
         }
       }
     }
@@ -75,13 +87,19 @@ util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
   auto raw_primitives_result = hybrid_decrypt_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& hybrid_decrypt_entry : *(raw_primitives_result.ValueOrDie())) {
-        HybridDecrypt& hybrid_decrypt = hybrid_decrypt_entry->get_primitive();
+      auto hybrid_decrypt_result =
+          hybrid_decrypt_entry->get_shared_primitive();
+      if (!hybrid_decrypt_result.ok()) continue;
+      HybridDecrypt& hybrid_decrypt = *hybrid_decrypt_result.ValueOrDie();
       auto decrypt_result = hybrid_decrypt.Decrypt(ciphertext, context_info);
       if (decrypt_result.ok()) {
+        call.Log(hybrid_decrypt_entry->get_key_id(), ciphertext.size());
         return std::move(decrypt_result.ValueOrDie());
       }
+      call.LogKeyFailure(hybrid_decrypt_entry->get_key_id());
     }
   }
+  call.LogFailure();
   return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
 }
 
@@ -103,10 +121,21 @@ util::Status Validate(PrimitiveSet<HybridDecrypt>* hybrid_decrypt_set) {
 util::StatusOr<std::unique_ptr<HybridDecrypt>>
 HybridDecryptWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<HybridDecrypt>> primitive_set) const {
+  return WrapWithMonitoring(std::move(primitive_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<HybridDecrypt>>
+HybridDecryptWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<HybridDecrypt>> primitive_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<HybridDecrypt> hybrid_decrypt(
-      new HybridDecryptSetWrapper(std::move(primitive_set)));
+  auto decrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, primitive_set.get(), "hybrid_decrypt", "decrypt");
+  if (!decrypt_monitor_result.ok()) return decrypt_monitor_result.status();
+  std::unique_ptr<HybridDecrypt> hybrid_decrypt(new HybridDecryptSetWrapper(
+      std::move(primitive_set),
+      std::move(decrypt_monitor_result.ValueOrDie())));
   return std::move(hybrid_decrypt);
 }
 
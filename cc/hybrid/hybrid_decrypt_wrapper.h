@@ -19,6 +19,7 @@
 
 #include "absl/strings/string_view.h"
 #include "tink/hybrid_decrypt.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/util/statusor.h"
@@ -35,6 +36,12 @@ class HybridDecryptWrapper : public PrimitiveWrapper<HybridDecrypt> {
   util::StatusOr<std::unique_ptr<HybridDecrypt>> Wrap(
       std::unique_ptr<PrimitiveSet<HybridDecrypt>> primitive_set)
       const override;
+
+  util::StatusOr<std::unique_ptr<HybridDecrypt>> WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<HybridDecrypt>> primitive_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
@@ -16,8 +16,10 @@
 
 #include "tink/hybrid/hybrid_encrypt_wrapper.h"
 
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
 #include "tink/hybrid_encrypt.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -28,6 +30,8 @@ namespace tink {
 
 namespace {
 
+using crypto::tink::internal::FunctionMonitor;
+
 util::Status Validate(PrimitiveSet<HybridEncrypt>* hybrid_encrypt_set) {
   if (hybrid_encrypt_set == nullptr) {
     return util::Status(util::error::INTERNAL,
@@ -46,9 +50,11 @@ util::Status Validate(PrimitiveSet<HybridEncrypt>* hybrid_encrypt_set) {
 // which must be non-NULL (and must contain a primary instance).
 class HybridEncryptSetWrapper : public HybridEncrypt {
  public:
-  explicit HybridEncryptSetWrapper(
-      std::unique_ptr<PrimitiveSet<HybridEncrypt>> hybrid_encrypt_set)
-      : hybrid_encrypt_set_(std::move(hybrid_encrypt_set)) {}
+  HybridEncryptSetWrapper(
+      std::unique_ptr<PrimitiveSet<HybridEncrypt>> hybrid_encrypt_set,
+      FunctionMonitor encrypt_monitor)
+      : hybrid_encrypt_set_(std::move(hybrid_encrypt_set)),
+        encrypt_monitor_(std::move(encrypt_monitor)) {}
 
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
@@ -58,6 +64,7 @@ class HybridEncryptSetWrapper : public HybridEncrypt {
 
  private:
   std::unique_ptr<PrimitiveSet<HybridEncrypt>> hybrid_encrypt_set_;
+  const FunctionMonitor encrypt_monitor_;
 };
 
 util::StatusOr<std::string> HybridEncryptSetWrapper::Encrypt(
@@ -68,10 +75,15 @@ util::StatusOr<std::string> HybridEncryptSetWrapper::Encrypt(
   plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   context_info = subtle::SubtleUtilBoringSSL::EnsureNonNull(context_info);
 
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
   auto primary = hybrid_encrypt_set_->get_primary();
   auto encrypt_result =
       primary->get_primitive().Encrypt(plaintext, context_info);
-  if (!encrypt_result.ok()) return encrypt_result.status();
+  if (!encrypt_result.ok()) {
+    call.LogFailure();
+    return encrypt_result.status();
+  }
+  call.Log(primary->get_key_id(), plaintext.size());
   const std::string& key_id = primary->get_identifier();
   return key_id + encrypt_result.ValueOrDie();
 }
@@ -80,10 +92,21 @@ util::StatusOr<std::string> HybridEncryptSetWrapper::Encrypt(
 
 util::StatusOr<std::unique_ptr<HybridEncrypt>> HybridEncryptWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<HybridEncrypt>> primitive_set) const {
+  return WrapWithMonitoring(std::move(primitive_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<HybridEncrypt>>
+HybridEncryptWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<HybridEncrypt>> primitive_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<HybridEncrypt> hybrid_encrypt(
-      new HybridEncryptSetWrapper(std::move(primitive_set)));
+  auto encrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, primitive_set.get(), "hybrid_encrypt", "encrypt");
+  if (!encrypt_monitor_result.ok()) return encrypt_monitor_result.status();
+  std::unique_ptr<HybridEncrypt> hybrid_encrypt(new HybridEncryptSetWrapper(
+      std::move(primitive_set),
+      std::move(encrypt_monitor_result.ValueOrDie())));
   return std::move(hybrid_encrypt);
 }
 
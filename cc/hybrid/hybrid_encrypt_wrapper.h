@@ -19,6 +19,7 @@
 
 #include "absl/strings/string_view.h"
 #include "tink/hybrid_encrypt.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/util/statusor.h"
@@ -35,6 +36,12 @@ class HybridEncryptWrapper : public PrimitiveWrapper<HybridEncrypt> {
   util::StatusOr<std::unique_ptr<HybridEncrypt>> Wrap(
       std::unique_ptr<PrimitiveSet<HybridEncrypt>> primitive_set)
       const override;
+
+  util::StatusOr<std::unique_ptr<HybridEncrypt>> WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<HybridEncrypt>> primitive_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
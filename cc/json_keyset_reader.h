@@ -40,11 +40,17 @@ class JsonKeysetReader : public KeysetReader {
   crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::Keyset>>
   Read() override;
 
+  crypto::tink::util::StatusOr<google::crypto::tink::Keyset*> ReadIntoArena(
+      google::protobuf::Arena* arena) override;
+
   crypto::tink::util::StatusOr<
     std::unique_ptr<google::crypto::tink::EncryptedKeyset>>
   ReadEncrypted() override;
 
  private:
+  // Reads the keyset from the underlying source into 'keyset'.
+  crypto::tink::util::Status ReadInto(google::crypto::tink::Keyset* keyset);
+
   explicit JsonKeysetReader(std::unique_ptr<std::istream> keyset_stream)
       : serialized_keyset_(""), keyset_stream_(std::move(keyset_stream)) {}
   explicit JsonKeysetReader(absl::string_view serialized_keyset)
@@ -17,12 +17,19 @@
 #ifndef TINK_KEYSET_HANDLE_H_
 #define TINK_KEYSET_HANDLE_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "tink/aead.h"
 #include "tink/key_manager.h"
 #include "tink/keyset_reader.h"
 #include "tink/keyset_writer.h"
+#include "tink/primitive_cache.h"
 #include "tink/primitive_set.h"
 #include "tink/registry.h"
+#include "tink/util/thread_pool.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
@@ -71,6 +78,8 @@ class KeysetHandle {
   // a non-ok status. Uses the KeyManager and PrimitiveWrapper objects in the
   // global registry to create the primitive. This function is the most common
   // way of creating a primitive.
+  // If a PrimitiveCache has been installed (PrimitiveCache::SetGlobal()),
+  // the primitives of the individual keys are shared via that cache.
   template <class P>
   crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive() const;
 
@@ -82,6 +91,28 @@ class KeysetHandle {
   crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
       const KeyManager<P>* custom_manager) const;
 
+  // Same as GetPrimitive(), but creates the primitives of the individual
+  // keys in parallel on 'thread_pool', or, if 'thread_pool' is null,
+  // on a temporary pool with ThreadPool::DefaultNumThreads() threads.
+  // This speeds up the creation for large keysets, e.g. with many RSA keys.
+  // The result (including the error, if any) is the same as the result
+  // of GetPrimitive().  Must not be called from a thread of 'thread_pool'.
+  template <class P>
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitiveInParallel(
+      crypto::tink::util::ThreadPool* thread_pool) const;
+
+  // Same as GetPrimitive(), but creates only the primitive of the primary
+  // key upfront.  The primitives of the other keys are created when they
+  // are first needed (e.g. to decrypt a ciphertext of an old key), and are
+  // dropped again once unused for longer than 'max_idle_time'.  This saves
+  // time and memory for keysets with many keys of which only few are used.
+  // Note that errors in non-primary keys are thus not reported here;
+  // such keys just fail to decrypt or verify anything.
+  template <class P>
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetLazyPrimitive(
+      std::chrono::steady_clock::duration max_idle_time =
+          std::chrono::steady_clock::duration::max()) const;
+
  private:
   // The classes below need access to get_keyset();
   friend class CleartextKeysetHandle;
@@ -95,6 +126,10 @@ class KeysetHandle {
   explicit KeysetHandle(google::crypto::tink::Keyset keyset);
   // Creates a handle that contains the given keyset.
   explicit KeysetHandle(std::unique_ptr<google::crypto::tink::Keyset> keyset);
+  // Creates a handle that shares the given keyset, which may be owned
+  // by an arena (see util::SecretArena::MakeShared()).
+  explicit KeysetHandle(
+      std::shared_ptr<const google::crypto::tink::Keyset> keyset);
 
   // Helper function which generates a key from a template, then adds it
   // to the keyset. TODO(tholenst): Change this to a proper member operating
@@ -109,46 +144,135 @@ class KeysetHandle {
   // Creates a set of primitives corresponding to the keys with
   // (status == ENABLED) in the keyset given in 'keyset_handle',
   // assuming all the corresponding key managers are present (keys
-  // with (status != ENABLED) are skipped).
+  // with (status != ENABLED) are skipped).  Primitives not created
+  // by 'custom_manager' come from the global PrimitiveCache, if any.
   //
   // The returned set is usually later "wrapped" into a class that
   // implements the corresponding Primitive-interface.
+  //
+  // If 'thread_pool' is non-null, the primitives are created in parallel
+  // on its threads; the keys are still added to the set in their order
+  // in the keyset, and the error returned is the one of the first key
+  // (in that order) that fails.
   template <class P>
   crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>> GetPrimitives(
-      const KeyManager<P>* custom_manager) const;
+      const KeyManager<P>* custom_manager,
+      crypto::tink::util::ThreadPool* thread_pool = nullptr) const;
 
-  google::crypto::tink::Keyset keyset_;
+  // Like GetPrimitives(nullptr), but only the entry of the primary key is
+  // eager; see GetLazyPrimitive().
+  template <class P>
+  crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>>
+  GetLazyPrimitives(std::chrono::steady_clock::duration max_idle_time) const;
+
+  // Returns the primitive for 'key', created by 'custom_manager' if it
+  // supports the key, and otherwise by 'cache' or (if 'cache' is null)
+  // by the global registry.
+  template <class P>
+  static crypto::tink::util::StatusOr<std::shared_ptr<P>> CreatePrimitive(
+      const google::crypto::tink::Keyset::Key& key,
+      const KeyManager<P>* custom_manager, PrimitiveCache* cache);
+
+  // The keyset is never modified, hence copies of a handle share it.
+  std::shared_ptr<const google::crypto::tink::Keyset> keyset_;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 // Implementation details of templated methods.
 
+template <class P>
+crypto::tink::util::StatusOr<std::shared_ptr<P>> KeysetHandle::CreatePrimitive(
+    const google::crypto::tink::Keyset::Key& key,
+    const KeyManager<P>* custom_manager, PrimitiveCache* cache) {
+  if (custom_manager != nullptr &&
+      custom_manager->DoesSupport(key.key_data().type_url())) {
+    auto primitive_result = custom_manager->GetPrimitive(key.key_data());
+    if (!primitive_result.ok()) return primitive_result.status();
+    return std::shared_ptr<P>(std::move(primitive_result.ValueOrDie()));
+  }
+  if (cache != nullptr) return cache->GetPrimitive<P>(key.key_data());
+  auto primitive_result = Registry::GetPrimitive<P>(key.key_data());
+  if (!primitive_result.ok()) return primitive_result.status();
+  return std::shared_ptr<P>(std::move(primitive_result.ValueOrDie()));
+}
+
 template <class P>
 crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>>
-KeysetHandle::GetPrimitives(const KeyManager<P>* custom_manager) const {
+KeysetHandle::GetPrimitives(const KeyManager<P>* custom_manager,
+                            crypto::tink::util::ThreadPool* thread_pool) const {
   crypto::tink::util::Status status = ValidateKeyset(get_keyset());
   if (!status.ok()) return status;
-  std::unique_ptr<PrimitiveSet<P>> primitives(new PrimitiveSet<P>());
+  std::shared_ptr<PrimitiveCache> cache = PrimitiveCache::GetGlobal();
+  std::vector<const google::crypto::tink::Keyset::Key*> keys;
   for (const google::crypto::tink::Keyset::Key& key : get_keyset().key()) {
     if (key.status() == google::crypto::tink::KeyStatusType::ENABLED) {
-      std::unique_ptr<P> primitive;
-      if (custom_manager != nullptr &&
-          custom_manager->DoesSupport(key.key_data().type_url())) {
-        auto primitive_result = custom_manager->GetPrimitive(key.key_data());
-        if (!primitive_result.ok()) return primitive_result.status();
-        primitive = std::move(primitive_result.ValueOrDie());
-      } else {
-        auto primitive_result = Registry::GetPrimitive<P>(key.key_data());
-        if (!primitive_result.ok()) return primitive_result.status();
-        primitive = std::move(primitive_result.ValueOrDie());
-      }
-      auto entry_result = primitives->AddPrimitive(std::move(primitive), key);
+      keys.push_back(&key);
+    }
+  }
+
+  // If requested, create the primitives in parallel upfront.
+  std::vector<crypto::tink::util::StatusOr<std::shared_ptr<P>>> results;
+  if (thread_pool != nullptr && keys.size() > 1) {
+    results.resize(keys.size());
+    absl::BlockingCounter done(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+      thread_pool->Schedule([&keys, &results, &done, &cache, custom_manager,
+                             i]() {
+        results[i] = CreatePrimitive<P>(*keys[i], custom_manager, cache.get());
+        done.DecrementCount();
+      });
+    }
+    done.Wait();
+  }
+
+  std::unique_ptr<PrimitiveSet<P>> primitives(new PrimitiveSet<P>());
+  for (size_t i = 0; i < keys.size(); i++) {
+    auto primitive_result =
+        results.empty()
+            ? CreatePrimitive<P>(*keys[i], custom_manager, cache.get())
+            : std::move(results[i]);
+    if (!primitive_result.ok()) return primitive_result.status();
+    auto entry_result = primitives->AddPrimitive(
+        std::move(primitive_result.ValueOrDie()), *keys[i]);
+    if (!entry_result.ok()) return entry_result.status();
+    if (keys[i]->key_id() == get_keyset().primary_key_id()) {
+      auto primary_result =
+          primitives->set_primary(entry_result.ValueOrDie());
+      if (!primary_result.ok()) return primary_result;
+    }
+  }
+  return std::move(primitives);
+}
+
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>>
+KeysetHandle::GetLazyPrimitives(
+    std::chrono::steady_clock::duration max_idle_time) const {
+  crypto::tink::util::Status status = ValidateKeyset(get_keyset());
+  if (!status.ok()) return status;
+  std::shared_ptr<PrimitiveCache> cache = PrimitiveCache::GetGlobal();
+  std::unique_ptr<PrimitiveSet<P>> primitives(
+      new PrimitiveSet<P>(max_idle_time));
+  for (const google::crypto::tink::Keyset::Key& key : get_keyset().key()) {
+    if (key.status() != google::crypto::tink::KeyStatusType::ENABLED) {
+      continue;
+    }
+    if (key.key_id() == get_keyset().primary_key_id()) {
+      auto primitive_result = CreatePrimitive<P>(key, nullptr, cache.get());
+      if (!primitive_result.ok()) return primitive_result.status();
+      auto entry_result = primitives->AddPrimitive(
+          std::move(primitive_result.ValueOrDie()), key);
+      if (!entry_result.ok()) return entry_result.status();
+      auto primary_result = primitives->set_primary(entry_result.ValueOrDie());
+      if (!primary_result.ok()) return primary_result;
+    } else {
+      // The entry keeps its own copy of the key.
+      auto entry_result = primitives->AddLazyPrimitive(
+          [key, cache]() {
+            return CreatePrimitive<P>(key, nullptr, cache.get());
+          },
+          key);
       if (!entry_result.ok()) return entry_result.status();
-      if (key.key_id() == get_keyset().primary_key_id()) {
-        auto primary_result =
-            primitives->set_primary(entry_result.ValueOrDie());
-        if (!primary_result.ok()) return primary_result;
-      }
     }
   }
   return std::move(primitives);
@@ -178,6 +302,33 @@ crypto::tink::util::StatusOr<std::unique_ptr<P>> KeysetHandle::GetPrimitive(
   return Registry::Wrap<P>(std::move(primitives_result.ValueOrDie()));
 }
 
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>>
+KeysetHandle::GetPrimitiveInParallel(
+    crypto::tink::util::ThreadPool* thread_pool) const {
+  std::unique_ptr<crypto::tink::util::ThreadPool> own_thread_pool;
+  if (thread_pool == nullptr) {
+    own_thread_pool = absl::make_unique<crypto::tink::util::ThreadPool>(
+        crypto::tink::util::ThreadPool::DefaultNumThreads());
+    thread_pool = own_thread_pool.get();
+  }
+  auto primitives_result = this->GetPrimitives<P>(nullptr, thread_pool);
+  if (!primitives_result.ok()) {
+    return primitives_result.status();
+  }
+  return Registry::Wrap<P>(std::move(primitives_result.ValueOrDie()));
+}
+
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>> KeysetHandle::GetLazyPrimitive(
+    std::chrono::steady_clock::duration max_idle_time) const {
+  auto primitives_result = this->GetLazyPrimitives<P>(max_idle_time);
+  if (!primitives_result.ok()) {
+    return primitives_result.status();
+  }
+  return Registry::Wrap<P>(std::move(primitives_result.ValueOrDie()));
+}
+
 }  // namespace tink
 }  // namespace crypto
 
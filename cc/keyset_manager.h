@@ -16,6 +16,9 @@
 #ifndef TINK_KEYSET_MANAGER_H_
 #define TINK_KEYSET_MANAGER_H_
 
+#include <unordered_map>
+#include <vector>
+
 #include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "tink/util/status.h"
@@ -31,6 +34,10 @@ class KeysetHandle;
 // rotating, disabling, enabling, or destroying keys.
 // An instance of this class takes care of a single Keyset, that can be
 // accessed via GetKeysetHandle()-method.
+//
+// The keys are indexed by key_id, so that operations on a single key
+// take constant time (except for Delete(), which preserves the order
+// of the remaining keys), also for keysets with many keys.
 class KeysetManager {
  public:
   // Constructs a KeysetManager with an empty Keyset.
@@ -61,6 +68,14 @@ class KeysetManager {
       const google::crypto::tink::KeyTemplate& key_template)
       LOCKS_EXCLUDED(keyset_mutex_);
 
+  // Adds to the managed keyset 'count' fresh keys generated according to
+  // 'key_template', and returns their key_ids.  The added keys have status
+  // 'ENABLED'.  All the keys are generated before the keyset is modified,
+  // so either all of them or none are added.
+  crypto::tink::util::StatusOr<std::vector<uint32_t>> AddKeys(
+      const google::crypto::tink::KeyTemplate& key_template, int count)
+      LOCKS_EXCLUDED(keyset_mutex_);
+
   // Sets the status of the specified key to 'ENABLED'.
   // Succeeds only if before the call the specified key
   // has status 'DISABLED' or 'ENABLED'.
@@ -87,6 +102,12 @@ class KeysetManager {
   crypto::tink::util::Status Delete(uint32_t key_id)
       LOCKS_EXCLUDED(keyset_mutex_);
 
+  // Removes the specified keys from the managed keyset, in a single pass
+  // over the keyset.  Succeeds only if all the specified keys exist and
+  // none of them is primary; otherwise the keyset is not modified.
+  crypto::tink::util::Status DeleteKeys(const std::vector<uint32_t>& key_ids)
+      LOCKS_EXCLUDED(keyset_mutex_);
+
   // Sets the specified key as the primary.
   // Succeeds only if the specified key is 'ENABLED'.
   crypto::tink::util::Status SetPrimary(uint32_t key_id)
@@ -103,8 +124,26 @@ class KeysetManager {
       const google::crypto::tink::KeyTemplate& key_template, bool as_primary)
       LOCKS_EXCLUDED(keyset_mutex_);
 
+  // Returns the key with the given 'key_id', or null if there is none.
+  google::crypto::tink::Keyset::Key* FindKey(uint32_t key_id)
+      EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
+  // Returns 'count' distinct random key_ids which are not used in the keyset.
+  std::vector<uint32_t> NewKeyIds(int count)
+      EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
+  // Appends an 'ENABLED' key with the given properties to the keyset.
+  void AppendKey(uint32_t key_id, google::crypto::tink::KeyData* key_data,
+                 google::crypto::tink::OutputPrefixType output_prefix_type)
+      EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
+  // Recomputes key_index_ from keyset_.
+  void RebuildIndex() EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
   mutable absl::Mutex keyset_mutex_;
   google::crypto::tink::Keyset keyset_ GUARDED_BY(keyset_mutex_);
+  // The position of the (first) key with each key_id in keyset_.
+  std::unordered_map<uint32_t, int> key_index_ GUARDED_BY(keyset_mutex_);
 };
 
 }  // namespace tink
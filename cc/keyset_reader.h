@@ -17,6 +17,7 @@
 #ifndef TINK_KEYSET_READER_H_
 #define TINK_KEYSET_READER_H_
 
+#include "google/protobuf/arena.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
 
@@ -32,6 +33,20 @@ class KeysetReader {
    std::unique_ptr<google::crypto::tink::Keyset>>
   Read() = 0;
 
+  // Reads a (cleartext) Keyset object from the underlying source, and
+  // returns it as a message owned by 'arena'.  Readers should override
+  // this to build the Keyset on 'arena' in the first place; by default,
+  // the Keyset returned by Read() is handed over to 'arena'.
+  virtual crypto::tink::util::StatusOr<google::crypto::tink::Keyset*>
+  ReadIntoArena(google::protobuf::Arena* arena) {
+    auto keyset_result = Read();
+    if (!keyset_result.ok()) return keyset_result.status();
+    google::crypto::tink::Keyset* keyset =
+        keyset_result.ValueOrDie().release();
+    arena->Own(keyset);
+    return keyset;
+  }
+
   // Reads and returns an EncryptedKeyset object from the underlying source.
   virtual crypto::tink::util::StatusOr<
     std::unique_ptr<google::crypto::tink::EncryptedKeyset>>
@@ -16,8 +16,13 @@
 
 #include "tink/mac/mac_wrapper.h"
 
+#include <string.h>
+
+#include "absl/strings/match.h"
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
 #include "tink/mac.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -27,14 +32,19 @@
 namespace crypto {
 namespace tink {
 
+using crypto::tink::internal::FunctionMonitor;
 using google::crypto::tink::OutputPrefixType;
 
 namespace {
 
 class MacSetWrapper : public Mac {
  public:
-  explicit MacSetWrapper(std::unique_ptr<PrimitiveSet<Mac>> mac_set)
-      : mac_set_(std::move(mac_set)) {}
+  MacSetWrapper(std::unique_ptr<PrimitiveSet<Mac>> mac_set,
+                FunctionMonitor compute_monitor,
+                FunctionMonitor verify_monitor)
+      : mac_set_(std::move(mac_set)),
+        compute_monitor_(std::move(compute_monitor)),
+        verify_monitor_(std::move(verify_monitor)) {}
 
   crypto::tink::util::StatusOr<std::string> ComputeMac(
       absl::string_view data) const override;
@@ -46,6 +56,8 @@ class MacSetWrapper : public Mac {
 
  private:
   std::unique_ptr<PrimitiveSet<Mac>> mac_set_;
+  const FunctionMonitor compute_monitor_;
+  const FunctionMonitor verify_monitor_;
 };
 
 util::Status Validate(PrimitiveSet<Mac>* mac_set) {
@@ -65,7 +77,9 @@ util::StatusOr<std::string> MacSetWrapper::ComputeMac(
   // regardless of whether the size is 0.
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
 
+  FunctionMonitor::Call call = compute_monitor_.StartCall();
   auto primary = mac_set_->get_primary();
+  const size_t data_size = data.size();
   std::string local_data;
   if (primary->get_output_prefix_type() == OutputPrefixType::LEGACY) {
     local_data = std::string(data);
@@ -74,7 +88,11 @@ util::StatusOr<std::string> MacSetWrapper::ComputeMac(
     data = local_data;
   }
   auto compute_mac_result = primary->get_primitive().ComputeMac(data);
-  if (!compute_mac_result.ok()) return compute_mac_result.status();
+  if (!compute_mac_result.ok()) {
+    call.LogFailure();
+    return compute_mac_result.status();
+  }
+  call.Log(primary->get_key_id(), data_size);
   const std::string& key_id = primary->get_identifier();
   return key_id + compute_mac_result.ValueOrDie();
 }
@@ -85,6 +103,8 @@ util::Status MacSetWrapper::VerifyMac(
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
   mac_value = subtle::SubtleUtilBoringSSL::EnsureNonNull(mac_value);
 
+  FunctionMonitor::Call call = verify_monitor_.StartCall();
+  const size_t data_size = data.size();
   if (mac_value.length() > CryptoFormat::kNonRawPrefixSize) {
     const std::string& key_id = std::string(mac_value.substr(0,
         CryptoFormat::kNonRawPrefixSize));
@@ -99,12 +119,15 @@ util::Status MacSetWrapper::VerifyMac(
           local_data.append(1, CryptoFormat::kLegacyStartByte);
           data = local_data;
         }
-        Mac& mac = mac_entry->get_primitive();
+        auto mac_result = mac_entry->get_shared_primitive();
+        if (!mac_result.ok()) continue;
+        Mac& mac = *mac_result.ValueOrDie();
         util::Status status = mac.VerifyMac(raw_mac_value, data);
         if (status.ok()) {
+          call.Log(mac_entry->get_key_id(), data_size);
           return status;
         } else {
-          // TODO(przydatek): LOG that a matching key didn't verify the MAC.
+          call.LogKeyFailure(mac_entry->get_key_id());
         }
       }
     }
@@ -114,23 +137,156 @@ util::Status MacSetWrapper::VerifyMac(
   auto raw_primitives_result = mac_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& mac_entry : *(raw_primitives_result.ValueOrDie())) {
-        Mac& mac = mac_entry->get_primitive();
-        util::Status status = mac.VerifyMac(mac_value, data);
+      auto mac_result = mac_entry->get_shared_primitive();
+      if (!mac_result.ok()) continue;
+      Mac& mac = *mac_result.ValueOrDie();
+      util::Status status = mac.VerifyMac(mac_value, data);
       if (status.ok()) {
+        call.Log(mac_entry->get_key_id(), data_size);
         return status;
       }
+      call.LogKeyFailure(mac_entry->get_key_id());
     }
   }
+  call.LogFailure();
   return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
 }
 
+// A Mac for a set whose only key is the primary.  It holds the primitive
+// and the prefix of the key directly, so that its operations neither look up
+// the set nor copy the identifier of the key, and behave otherwise like
+// those of MacSetWrapper.
+class SingleKeyMac : public Mac {
+ public:
+  SingleKeyMac(std::shared_ptr<Mac> mac, absl::string_view prefix,
+               OutputPrefixType output_prefix_type, uint32_t key_id,
+               FunctionMonitor compute_monitor, FunctionMonitor verify_monitor)
+      : mac_(std::move(mac)),
+        prefix_size_(prefix.size()),
+        is_legacy_(output_prefix_type == OutputPrefixType::LEGACY),
+        key_id_(key_id),
+        compute_monitor_(std::move(compute_monitor)),
+        verify_monitor_(std::move(verify_monitor)) {
+    memcpy(prefix_, prefix.data(), prefix_size_);
+  }
+
+  crypto::tink::util::StatusOr<std::string> ComputeMac(
+      absl::string_view data) const override;
+
+  crypto::tink::util::Status VerifyMac(absl::string_view mac_value,
+                                       absl::string_view data) const override;
+
+  ~SingleKeyMac() override {}
+
+ private:
+  const std::shared_ptr<Mac> mac_;
+  char prefix_[CryptoFormat::kNonRawPrefixSize];
+  const size_t prefix_size_;  // 0 for RAW keys.
+  // LEGACY keys authenticate the data followed by kLegacyStartByte.
+  const bool is_legacy_;
+  const uint32_t key_id_;
+  const FunctionMonitor compute_monitor_;
+  const FunctionMonitor verify_monitor_;
+};
+
+util::StatusOr<std::string> SingleKeyMac::ComputeMac(
+    absl::string_view data) const {
+  data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
+
+  FunctionMonitor::Call call = compute_monitor_.StartCall();
+  const size_t data_size = data.size();
+  std::string local_data;
+  if (is_legacy_) {
+    local_data.reserve(data.size() + 1);
+    local_data.append(data.data(), data.size());
+    local_data.append(1, CryptoFormat::kLegacyStartByte);
+    data = local_data;
+  }
+  auto compute_mac_result = mac_->ComputeMac(data);
+  if (!compute_mac_result.ok()) {
+    call.LogFailure();
+    return compute_mac_result;
+  }
+  call.Log(key_id_, data_size);
+  if (prefix_size_ == 0) return compute_mac_result;
+  const std::string& raw_mac_value = compute_mac_result.ValueOrDie();
+  std::string mac_value;
+  mac_value.reserve(prefix_size_ + raw_mac_value.size());
+  mac_value.append(prefix_, prefix_size_);
+  mac_value.append(raw_mac_value);
+  return std::move(mac_value);
+}
+
+util::Status SingleKeyMac::VerifyMac(absl::string_view mac_value,
+                                     absl::string_view data) const {
+  data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
+  mac_value = subtle::SubtleUtilBoringSSL::EnsureNonNull(mac_value);
+
+  FunctionMonitor::Call call = verify_monitor_.StartCall();
+  const size_t data_size = data.size();
+  if (prefix_size_ > 0) {
+    if (mac_value.length() <= prefix_size_ ||
+        !absl::StartsWith(mac_value,
+                          absl::string_view(prefix_, prefix_size_))) {
+      call.LogFailure();
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "verification failed");
+    }
+    mac_value.remove_prefix(prefix_size_);
+  }
+  std::string local_data;
+  if (is_legacy_) {
+    local_data.reserve(data.size() + 1);
+    local_data.append(data.data(), data.size());
+    local_data.append(1, CryptoFormat::kLegacyStartByte);
+    data = local_data;
+  }
+  if (!mac_->VerifyMac(mac_value, data).ok()) {
+    call.LogKeyFailure(key_id_);
+    call.LogFailure();
+    return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
+  }
+  call.Log(key_id_, data_size);
+  return util::Status::OK;
+}
+
 }  // namespace
 
 util::StatusOr<std::unique_ptr<Mac>> MacWrapper::Wrap(
       std::unique_ptr<PrimitiveSet<Mac>> mac_set) const {
+  return WrapWithMonitoring(std::move(mac_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<Mac>> MacWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<Mac>> mac_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(mac_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<Mac> mac(new MacSetWrapper(std::move(mac_set)));
+  auto compute_monitor_result = FunctionMonitor::New(
+      monitoring_factory, mac_set.get(), "mac", "compute");
+  if (!compute_monitor_result.ok()) return compute_monitor_result.status();
+  auto verify_monitor_result = FunctionMonitor::New(
+      monitoring_factory, mac_set.get(), "mac", "verify");
+  if (!verify_monitor_result.ok()) return verify_monitor_result.status();
+  if (mac_set->size() == 1) {
+    // Single-key sets, which are the most common ones, get a wrapper
+    // without per-operation lookups.
+    const auto* primary = mac_set->get_primary();
+    auto primary_result = primary->get_shared_primitive();
+    if (primary_result.ok() &&
+        primary->get_identifier().size() <= CryptoFormat::kNonRawPrefixSize) {
+      std::unique_ptr<Mac> mac(new SingleKeyMac(
+          std::move(primary_result.ValueOrDie()), primary->get_identifier(),
+          primary->get_output_prefix_type(), primary->get_key_id(),
+          std::move(compute_monitor_result.ValueOrDie()),
+          std::move(verify_monitor_result.ValueOrDie())));
+      return std::move(mac);
+    }
+  }
+  std::unique_ptr<Mac> mac(
+      new MacSetWrapper(std::move(mac_set),
+                        std::move(compute_monitor_result.ValueOrDie()),
+                        std::move(verify_monitor_result.ValueOrDie())));
   return std::move(mac);
 }
 
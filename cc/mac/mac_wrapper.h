@@ -19,6 +19,7 @@
 
 #include "absl/strings/string_view.h"
 #include "tink/mac.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/util/status.h"
@@ -37,6 +38,12 @@ class MacWrapper : public PrimitiveWrapper<Mac> {
  public:
   util::StatusOr<std::unique_ptr<Mac>> Wrap(
       std::unique_ptr<PrimitiveSet<Mac>> mac_set) const override;
+
+  util::StatusOr<std::unique_ptr<Mac>> WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<Mac>> mac_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
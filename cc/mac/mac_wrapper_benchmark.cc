@@ -0,0 +1,120 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of MACs obtained from keysets, i.e. of the primitive set
+// wrapper on top of HMAC, with keysets of 1 to 256 keys with TINK or RAW
+// output prefixes.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/str_cat.h"
+#include "tink/keyset_handle.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_config.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/subtle/random.h"
+#include "tink/util/allocation_counter.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AllocationCounter;
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::GetShared;
+using crypto::tink::test::NewKeysetHandle;
+using crypto::tink::test::SetAllocationCounters;
+using crypto::tink::test::SetThroughput;
+using crypto::tink::test::ThreadCounts;
+using google::crypto::tink::OutputPrefixType;
+
+// Returns the HMAC-SHA256 Mac for a keyset of 'num_keys' keys
+// with 'output_prefix_type', shared by all the threads.
+util::StatusOr<Mac*> GetMac(int num_keys, OutputPrefixType output_prefix_type) {
+  return GetShared<Mac>(
+      absl::StrCat(num_keys, "/", output_prefix_type),
+      [=]() -> util::StatusOr<std::unique_ptr<Mac>> {
+        auto status = MacConfig::Register();
+        if (!status.ok()) return status;
+        auto handle_result = NewKeysetHandle(MacKeyTemplates::HmacSha256(),
+                                             num_keys, output_prefix_type);
+        if (!handle_result.ok()) return handle_result.status();
+        return handle_result.ValueOrDie()->GetPrimitive<Mac>();
+      });
+}
+
+// Arguments: the number of keys, the output prefix type,
+// and the message size.
+void WrapperArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int num_keys : {1, 16, 256}) {
+    for (int prefix : {OutputPrefixType::TINK, OutputPrefixType::RAW}) {
+      for (int message_size : {64, 16 << 10}) {
+        benchmark->Args({num_keys, prefix, message_size});
+      }
+    }
+  }
+}
+
+void BM_WrappedMacCompute(benchmark::State& state) {
+  auto mac_result =
+      GetMac(state.range(0), static_cast<OutputPrefixType>(state.range(1)));
+  if (!CheckOk(mac_result.status(), &state)) return;
+  const Mac& mac = *mac_result.ValueOrDie();
+  std::string data = subtle::Random::GetRandomBytes(state.range(2));
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto compute_result = mac.ComputeMac(data);
+    if (!CheckOk(compute_result.status(), &state)) break;
+    benchmark::DoNotOptimize(compute_result.ValueOrDie().data());
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(state.range(2), &state);
+}
+
+void BM_WrappedMacVerify(benchmark::State& state) {
+  auto mac_result =
+      GetMac(state.range(0), static_cast<OutputPrefixType>(state.range(1)));
+  if (!CheckOk(mac_result.status(), &state)) return;
+  const Mac& mac = *mac_result.ValueOrDie();
+  std::string data = subtle::Random::GetRandomBytes(state.range(2));
+  auto compute_result = mac.ComputeMac(data);
+  if (!CheckOk(compute_result.status(), &state)) return;
+  const std::string& tag = compute_result.ValueOrDie();
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    if (!CheckOk(mac.VerifyMac(tag, data), &state)) break;
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(state.range(2), &state);
+}
+
+BENCHMARK(BM_WrappedMacCompute)->Apply(WrapperArgs);
+BENCHMARK(BM_WrappedMacVerify)->Apply(WrapperArgs);
+BENCHMARK(BM_WrappedMacCompute)
+    ->Args({1, OutputPrefixType::TINK, 1 << 10})
+    ->Apply(ThreadCounts);
+BENCHMARK(BM_WrappedMacVerify)
+    ->Args({1, OutputPrefixType::TINK, 1 << 10})
+    ->Apply(ThreadCounts);
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -18,10 +18,14 @@
 #include "tink/crypto_format.h"
 #include "tink/mac.h"
 #include "tink/primitive_set.h"
+#include "tink/util/allocation_matchers.h"
 #include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
+using crypto::tink::test::AllocatesAtMostMoreThan;
 using crypto::tink::test::DummyMac;
 using google::crypto::tink::Keyset;
 using google::crypto::tink::KeyStatusType;
@@ -31,6 +35,32 @@ namespace crypto {
 namespace tink {
 namespace {
 
+// Returns a set with a DummyMac named 'mac_name' for a key with the given
+// 'output_prefix_type' as the primary and, if 'add_other_key' is true,
+// another key.
+std::unique_ptr<PrimitiveSet<Mac>> GetMacSet(
+    const std::string& mac_name, OutputPrefixType output_prefix_type,
+    bool add_other_key) {
+  auto mac_set = absl::make_unique<PrimitiveSet<Mac>>();
+  Keyset::Key key;
+  key.set_status(KeyStatusType::ENABLED);
+  if (add_other_key) {
+    key.set_output_prefix_type(OutputPrefixType::TINK);
+    key.set_key_id(42);
+    auto entry_result =
+        mac_set->AddPrimitive(absl::make_unique<DummyMac>("other"), key);
+    EXPECT_TRUE(entry_result.ok()) << entry_result.status();
+  }
+  key.set_output_prefix_type(output_prefix_type);
+  key.set_key_id(1234543);
+  auto entry_result =
+      mac_set->AddPrimitive(absl::make_unique<DummyMac>(mac_name), key);
+  EXPECT_TRUE(entry_result.ok()) << entry_result.status();
+  auto status = mac_set->set_primary(entry_result.ValueOrDie());
+  EXPECT_TRUE(status.ok()) << status;
+  return mac_set;
+}
+
 TEST(MacWrapperTest, WrapNullptr) {
   auto mac_result = MacWrapper().Wrap(nullptr);
   EXPECT_FALSE(mac_result.ok());
@@ -150,6 +180,74 @@ TEST(MacWrapperTest, testLegacyAuthentication) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST(MacWrapperTest, SingleKeySets) {
+  std::string data = "some_data_for_mac";
+  for (OutputPrefixType output_prefix_type :
+       {OutputPrefixType::TINK, OutputPrefixType::LEGACY,
+        OutputPrefixType::CRUNCHY, OutputPrefixType::RAW}) {
+    SCOPED_TRACE(OutputPrefixType_Name(output_prefix_type));
+    auto single_result =
+        MacWrapper().Wrap(GetMacSet("mac", output_prefix_type, false));
+    ASSERT_TRUE(single_result.ok()) << single_result.status();
+    auto single_mac = std::move(single_result.ValueOrDie());
+    auto multi_result =
+        MacWrapper().Wrap(GetMacSet("mac", output_prefix_type, true));
+    ASSERT_TRUE(multi_result.ok()) << multi_result.status();
+    auto multi_mac = std::move(multi_result.ValueOrDie());
+
+    // The MACs of a single-key set are the same as those of a set with
+    // more keys, and each of them can verify those of the other.
+    auto compute_mac_result = single_mac->ComputeMac(data);
+    ASSERT_TRUE(compute_mac_result.ok()) << compute_mac_result.status();
+    std::string mac_value = compute_mac_result.ValueOrDie();
+    compute_mac_result = multi_mac->ComputeMac(data);
+    ASSERT_TRUE(compute_mac_result.ok()) << compute_mac_result.status();
+    EXPECT_EQ(mac_value, compute_mac_result.ValueOrDie());
+    for (Mac* mac : {single_mac.get(), multi_mac.get()}) {
+      auto status = mac->VerifyMac(mac_value, data);
+      EXPECT_TRUE(status.ok()) << status;
+    }
+
+    // MACs with a wrong prefix or of a wrong size are rejected.
+    std::string wrong_prefix = mac_value;
+    wrong_prefix[0] ^= 1;
+    for (const std::string& bad_mac_value :
+         {wrong_prefix, mac_value.substr(0, CryptoFormat::kNonRawPrefixSize),
+          std::string("")}) {
+      auto status = single_mac->VerifyMac(bad_mac_value, data);
+      EXPECT_EQ(util::error::INVALID_ARGUMENT, status.error_code());
+      EXPECT_PRED_FORMAT2(testing::IsSubstring, "verification failed",
+                          status.error_message());
+    }
+  }
+}
+
+TEST(MacWrapperTest, Allocations) {
+  std::string data = "some_data_for_mac";
+  DummyMac raw_mac("mac");
+  std::string raw_mac_value = raw_mac.ComputeMac(data).ValueOrDie();
+
+  for (bool add_other_key : {false, true}) {
+    SCOPED_TRACE(add_other_key ? "two keys" : "one key");
+    auto mac_result =
+        MacWrapper().Wrap(GetMacSet("mac", OutputPrefixType::TINK,
+                                    add_other_key));
+    ASSERT_TRUE(mac_result.ok()) << mac_result.status();
+    auto mac = std::move(mac_result.ValueOrDie());
+    std::string mac_value = mac->ComputeMac(data).ValueOrDie();
+
+    // Wrapping adds at most the allocation of the prefixed MAC when
+    // computing, and of the key identifier when verifying.
+    EXPECT_THAT([&]() { mac->ComputeMac(data); },
+                AllocatesAtMostMoreThan(
+                    [&]() { raw_mac.ComputeMac(data); }, 1));
+    EXPECT_THAT([&]() { mac->VerifyMac(mac_value, data); },
+                AllocatesAtMostMoreThan(
+                    [&]() { raw_mac.VerifyMac(raw_mac_value, data); },
+                    add_other_key ? 1 : 0));
+  }
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -0,0 +1,94 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_MONITORING_H_
+#define TINK_MONITORING_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// Monitoring of the primitives obtained from keysets.
+//
+// When a MonitoringClientFactory is registered with
+// Registry::RegisterMonitoringClientFactory(), the primitive wrappers
+// create a MonitoringClient for each function of a wrapped primitive
+// (e.g. one for Aead::Encrypt() and one for Aead::Decrypt()), and report
+// every call of the function to it.  Without a factory, the wrapped
+// primitives do no monitoring at all.
+//
+// The clients are called on every operation, possibly concurrently,
+// so their methods must be thread-safe and cheap.
+// util/monitoring_counters.h provides an implementation based on sharded
+// counters.
+
+// Describes the function of a wrapped primitive that a client monitors.
+struct MonitoringContext {
+  // The primitive, e.g. "aead", and its function, e.g. "encrypt".
+  std::string primitive;
+  std::string api_function;
+  // The IDs of the keys in the keyset of the primitive.
+  std::vector<uint32_t> key_ids;
+  uint32_t primary_key_id;
+};
+
+// Receives the reports about the calls of one function of a primitive.
+class MonitoringClient {
+ public:
+  // Logs a successful call, which used the key with 'key_id' to process
+  // an input of 'num_bytes' bytes.
+  virtual void Log(uint32_t key_id, int64_t num_bytes) = 0;
+
+  // Logs a failed call.  For decrypting or verifying functions this is
+  // a call for which none of the keys succeeded.
+  virtual void LogFailure() = 0;
+
+  // Logs that the key with 'key_id' was tried, and failed, by a decrypting
+  // or verifying call (which may still succeed with another key).
+  virtual void LogKeyFailure(uint32_t key_id) {}
+
+  // Returns true if the client wants the latency of the calls.  This is
+  // queried once, when the primitive is wrapped; the clock is read only
+  // for clients that return true.
+  virtual bool records_latency() const { return false; }
+
+  // Logs the duration of a call, successful or not, in nanoseconds.
+  virtual void LogLatency(int64_t nanoseconds) {}
+
+  virtual ~MonitoringClient() {}
+};
+
+// Creates the MonitoringClients of wrapped primitives.
+class MonitoringClientFactory {
+ public:
+  // Returns a new client for the function described by 'context'.
+  // If this fails, the primitive cannot be wrapped.
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<MonitoringClient>>
+  New(const MonitoringContext& context) = 0;
+
+  virtual ~MonitoringClientFactory() {}
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_MONITORING_H_
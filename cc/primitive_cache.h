@@ -0,0 +1,164 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_PRIMITIVE_CACHE_H_
+#define TINK_PRIMITIVE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// A cache of primitives, which lets all the users of a key share
+// a single primitive for it.
+//
+// Creating a primitive parses and validates the key, and runs the setup
+// of the underlying cipher (key expansion, import of RSA or EC keys, etc.).
+// Services that create primitives on demand for many keysets can avoid
+// repeating this work by enabling a PrimitiveCache: primitives are then
+// looked up by a fingerprint (SHA-256) of the type URL, the serialized key
+// and the primitive type, and shared by all the KeysetHandles which contain
+// the key.  Primitives are immutable and thread-safe, hence can be shared.
+//
+// The cache keeps the most recently used primitives within a memory budget.
+// As the actual memory usage of a primitive is not known, each primitive
+// is accounted for with the size of its serialized key plus a fixed
+// overhead.  The cache does not keep copies of the key material, only
+// its fingerprints, which are wiped when the primitive is evicted.
+//
+// The cache is opt-in: KeysetHandle::GetPrimitive() uses it only once it
+// has been installed with PrimitiveCache::SetGlobal().  Primitives created
+// via a custom KeyManager are not cached.
+//
+// PrimitiveCache is thread safe.
+class PrimitiveCache {
+ public:
+  struct Options {
+    Options() : max_cached_bytes(16 * 1024 * 1024) {}  // 16 MB
+
+    // The memory budget of the cache (see above for how it is accounted).
+    int64_t max_cached_bytes;
+  };
+
+  explicit PrimitiveCache(const Options& options);
+  ~PrimitiveCache();
+
+  // Returns the primitive for 'key_data', from the cache or created
+  // via the Registry (and then added to the cache).
+  template <class P>
+  crypto::tink::util::StatusOr<std::shared_ptr<P>> GetPrimitive(
+      const google::crypto::tink::KeyData& key_data) LOCKS_EXCLUDED(mutex_);
+
+  // The number of GetPrimitive()-calls served from the cache.
+  int64_t hit_count() const LOCKS_EXCLUDED(mutex_);
+
+  // The number of GetPrimitive()-calls that created a primitive.
+  int64_t miss_count() const LOCKS_EXCLUDED(mutex_);
+
+  // The number of primitives evicted from the cache.
+  int64_t eviction_count() const LOCKS_EXCLUDED(mutex_);
+
+  // The memory currently accounted for the cached primitives.
+  int64_t cached_bytes() const LOCKS_EXCLUDED(mutex_);
+
+  // The number of cached primitives.
+  int size() const LOCKS_EXCLUDED(mutex_);
+
+  // Returns the cache used by KeysetHandle::GetPrimitive(),
+  // or null if none has been installed.
+  static std::shared_ptr<PrimitiveCache> GetGlobal();
+
+  // Installs 'cache' (which may be null, to disable caching)
+  // as the cache used by KeysetHandle::GetPrimitive().
+  static void SetGlobal(std::shared_ptr<PrimitiveCache> cache);
+
+ private:
+  PrimitiveCache(const PrimitiveCache&) = delete;
+  PrimitiveCache& operator=(const PrimitiveCache&) = delete;
+
+  struct CacheEntry {
+    std::string fingerprint;
+    std::shared_ptr<void> primitive;
+    int64_t cost;
+  };
+
+  typedef std::list<CacheEntry> LruList;
+
+  // Returns the fingerprint of 'key_data' for primitives of the type
+  // with the name 'primitive_name'.
+  static crypto::tink::util::StatusOr<std::string> Fingerprint(
+      const google::crypto::tink::KeyData& key_data,
+      const char* primitive_name);
+
+  // Returns the cached primitive with the given fingerprint, or null.
+  std::shared_ptr<void> Find(const std::string& fingerprint)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Adds 'primitive' to the cache, unless a primitive with the same
+  // fingerprint has been added concurrently, and returns the cached one.
+  std::shared_ptr<void> Insert(const std::string& fingerprint,
+                               std::shared_ptr<void> primitive, int64_t cost)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Removes the least recently used entry.
+  void Evict() EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const Options options_;
+  mutable absl::Mutex mutex_;
+  // The cached primitives, the most recently used first.
+  LruList lru_ GUARDED_BY(mutex_);
+  std::unordered_map<std::string, LruList::iterator> index_
+      GUARDED_BY(mutex_);
+  int64_t cached_bytes_ GUARDED_BY(mutex_);
+  int64_t hit_count_ GUARDED_BY(mutex_);
+  int64_t miss_count_ GUARDED_BY(mutex_);
+  int64_t eviction_count_ GUARDED_BY(mutex_);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Implementation details of templated methods.
+
+template <class P>
+crypto::tink::util::StatusOr<std::shared_ptr<P>> PrimitiveCache::GetPrimitive(
+    const google::crypto::tink::KeyData& key_data) {
+  auto fingerprint_result = Fingerprint(key_data, typeid(P).name());
+  if (!fingerprint_result.ok()) return fingerprint_result.status();
+  const std::string& fingerprint = fingerprint_result.ValueOrDie();
+  std::shared_ptr<void> cached = Find(fingerprint);
+  if (cached != nullptr) return std::static_pointer_cast<P>(cached);
+
+  auto primitive_result = Registry::GetPrimitive<P>(key_data);
+  if (!primitive_result.ok()) return primitive_result.status();
+  std::shared_ptr<P> primitive = std::move(primitive_result.ValueOrDie());
+  int64_t cost = key_data.type_url().size() + key_data.value().size();
+  return std::static_pointer_cast<P>(Insert(fingerprint, primitive, cost));
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PRIMITIVE_CACHE_H_
@@ -17,6 +17,11 @@
 #ifndef TINK_PRIMITIVE_SET_H_
 #define TINK_PRIMITIVE_SET_H_
 
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
@@ -46,24 +51,84 @@ namespace tink {
 // the set is used, and upon decryption the ciphertext's prefix
 // determines the identifier of the primitive from the set.
 //
+// An entry of a set is either eager, i.e. it holds its primitive from
+// the start, or lazy, i.e. it creates its primitive on first use (see
+// AddLazyPrimitive()).  The primitives of lazy entries that remain unused
+// for longer than the idle time of the set are dropped, and are created
+// again when needed.
+//
 // PrimitiveSet is a public class to allow its use in implementations
 // of custom primitives.
 template <class P>
 class PrimitiveSet {
  public:
+  typedef std::chrono::steady_clock Clock;
+
   // Entry-objects hold individual instances of primitives in the set.
+  // A primitive may be shared with other sets (see PrimitiveCache).
   template <class P2>
   class Entry {
    public:
-    Entry(std::unique_ptr<P2> primitive, const std::string& identifier,
+    // Creates the primitive of a lazy entry.
+    typedef std::function<
+        crypto::tink::util::StatusOr<std::shared_ptr<P2>>()> Factory;
+
+    // Constructs an eager entry.
+    Entry(std::shared_ptr<P2> primitive, const std::string& identifier,
           google::crypto::tink::KeyStatusType status,
-          google::crypto::tink::OutputPrefixType output_prefix_type)
+          google::crypto::tink::OutputPrefixType output_prefix_type,
+          uint32_t key_id)
         : primitive_(std::move(primitive)),
           identifier_(identifier),
           status_(status),
-          output_prefix_type_(output_prefix_type) {}
+          output_prefix_type_(output_prefix_type),
+          key_id_(key_id),
+          pinned_(true) {}
+
+    // Constructs a lazy entry, whose primitive is created by 'factory'.
+    Entry(Factory factory, const std::string& identifier,
+          google::crypto::tink::KeyStatusType status,
+          google::crypto::tink::OutputPrefixType output_prefix_type,
+          uint32_t key_id)
+        : factory_(std::move(factory)),
+          identifier_(identifier),
+          status_(status),
+          output_prefix_type_(output_prefix_type),
+          key_id_(key_id),
+          pinned_(false) {}
 
-    P2& get_primitive() const { return *primitive_; }
+    // Returns the primitive of this entry.  As callers may hold on to the
+    // returned reference, a lazy entry keeps its primitive from then on.
+    // This must be called on a lazy entry only once its primitive has
+    // been pinned (by set_primary() or PinLazyPrimitives()), as there is
+    // no way to report an error of its factory here.  Sets with unpinned
+    // lazy entries are given only to wrappers which do not call this on
+    // them (see PrimitiveWrapper::SupportsLazyPrimitives()).
+    P2& get_primitive() const {
+      if (!is_lazy()) return *primitive_;
+      absl::MutexLock lock(&mutex_);
+      pinned_ = true;
+      if (!MaterializeLocked().ok()) {
+        // There is no primitive to return a reference to.
+        std::abort();
+      }
+      return *lazy_primitive_;
+    }
+
+    // Returns the primitive of this entry, creating it first if this
+    // is a lazy entry whose primitive does not exist (anymore).
+    // Concurrent calls create the primitive only once.
+    crypto::tink::util::StatusOr<std::shared_ptr<P2>> get_shared_primitive()
+        const {
+      if (!is_lazy()) return primitive_;
+      absl::MutexLock lock(&mutex_);
+      auto status = MaterializeLocked();
+      if (!status.ok()) return status;
+      return lazy_primitive_;
+    }
+
+    // Returns true iff this entry creates its primitive on first use.
+    bool is_lazy() const { return factory_ != nullptr; }
 
     const std::string& get_identifier() const { return identifier_; }
 
@@ -73,21 +138,75 @@ class PrimitiveSet {
       return output_prefix_type_;
     }
 
+    uint32_t get_key_id() const { return key_id_; }
+
    private:
-    std::unique_ptr<P> primitive_;
+    friend class PrimitiveSet;
+
+    crypto::tink::util::Status MaterializeLocked() const
+        EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+      last_use_ = Clock::now();
+      if (lazy_primitive_ != nullptr) return crypto::tink::util::Status::OK;
+      auto primitive_result = factory_();
+      if (!primitive_result.ok()) return primitive_result.status();
+      if (primitive_result.ValueOrDie() == nullptr) {
+        return ToStatusF(crypto::tink::util::error::INTERNAL,
+                         "The factory returned a null primitive.");
+      }
+      lazy_primitive_ = std::move(primitive_result.ValueOrDie());
+      return crypto::tink::util::Status::OK;
+    }
+
+    // Drops the primitive of a lazy entry that has not been used since
+    // 'cutoff', unless it is pinned.  Returns true iff it was dropped.
+    bool EvictIfUnusedSince(Clock::time_point cutoff) const {
+      if (!is_lazy()) return false;
+      absl::MutexLock lock(&mutex_);
+      if (pinned_ || lazy_primitive_ == nullptr || last_use_ >= cutoff) {
+        return false;
+      }
+      lazy_primitive_.reset();
+      return true;
+    }
+
+    // Pins the primitive of a lazy entry, which is created if needed.
+    crypto::tink::util::Status Pin() const {
+      if (!is_lazy()) return crypto::tink::util::Status::OK;
+      absl::MutexLock lock(&mutex_);
+      auto status = MaterializeLocked();
+      if (status.ok()) pinned_ = true;
+      return status;
+    }
+
+    const std::shared_ptr<P2> primitive_;  // Only for eager entries.
+    const Factory factory_;  // Only for lazy entries.
     std::string identifier_;
     google::crypto::tink::KeyStatusType status_;
     google::crypto::tink::OutputPrefixType output_prefix_type_;
+    uint32_t key_id_;
+    mutable absl::Mutex mutex_;
+    mutable std::shared_ptr<P2> lazy_primitive_ GUARDED_BY(mutex_);
+    mutable Clock::time_point last_use_ GUARDED_BY(mutex_);
+    // True iff the primitive must not be dropped.
+    mutable bool pinned_ GUARDED_BY(mutex_);
   };
 
   typedef std::vector<std::unique_ptr<Entry<P>>> Primitives;
 
   // Constructs an empty PrimitiveSet.
-  PrimitiveSet<P>() : primary_(nullptr) {}
+  PrimitiveSet<P>() : PrimitiveSet<P>(Clock::duration::max()) {}
+
+  // Constructs an empty PrimitiveSet, in which the primitives of lazy
+  // entries are dropped once they are unused for longer than
+  // 'max_idle_time'.
+  explicit PrimitiveSet<P>(Clock::duration max_idle_time)
+      : primary_(nullptr),
+        max_idle_time_(max_idle_time),
+        next_eviction_(Clock::time_point::max()) {}
 
   // Adds 'primitive' to this set for the specified 'key'.
   crypto::tink::util::StatusOr<Entry<P>*> AddPrimitive(
-      std::unique_ptr<P> primitive, google::crypto::tink::Keyset::Key key) {
+      std::shared_ptr<P> primitive, google::crypto::tink::Keyset::Key key) {
     if (key.status() != google::crypto::tink::KeyStatusType::ENABLED) {
       return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
                        "The key must be ENABLED.");
@@ -102,14 +221,71 @@ class PrimitiveSet {
     absl::MutexLock lock(&primitives_mutex_);
     primitives_[identifier].push_back(
         absl::make_unique<Entry<P>>(std::move(primitive), identifier,
-                                    key.status(), key.output_prefix_type()));
+                                    key.status(), key.output_prefix_type(),
+                                    key.key_id()));
+    return primitives_[identifier].back().get();
+  }
+
+  // Adds a lazy entry for the specified 'key' to this set, whose primitive
+  // is created by 'factory' when it is first used.  'factory' may be
+  // called several times if the primitive is dropped when idle.
+  crypto::tink::util::StatusOr<Entry<P>*> AddLazyPrimitive(
+      typename Entry<P>::Factory factory,
+      google::crypto::tink::Keyset::Key key) {
+    if (key.status() != google::crypto::tink::KeyStatusType::ENABLED) {
+      return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
+                       "The key must be ENABLED.");
+    }
+    auto identifier_result = CryptoFormat::get_output_prefix(key);
+    if (!identifier_result.ok()) return identifier_result.status();
+    if (factory == nullptr) {
+      return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
+                       "The factory must be non-null.");
+    }
+    std::string identifier = identifier_result.ValueOrDie();
+    absl::MutexLock lock(&primitives_mutex_);
+    primitives_[identifier].push_back(
+        absl::make_unique<Entry<P>>(std::move(factory), identifier,
+                                    key.status(), key.output_prefix_type(),
+                                    key.key_id()));
+    if (max_idle_time_ != Clock::duration::max() &&
+        next_eviction_ == Clock::time_point::max()) {
+      next_eviction_ = Clock::now() + max_idle_time_;
+    }
     return primitives_[identifier].back().get();
   }
 
+  // Creates the primitives of all lazy entries, and keeps them from then
+  // on, so that get_primitive() can be called on every entry.  Returns
+  // the first error of a factory, if any.
+  crypto::tink::util::Status PinLazyPrimitives() {
+    absl::MutexLock lock(&primitives_mutex_);
+    for (const auto& identifier_and_entries : primitives_) {
+      for (const auto& entry : identifier_and_entries.second) {
+        auto status = entry->Pin();
+        if (!status.ok()) return status;
+      }
+    }
+    return crypto::tink::util::Status::OK;
+  }
+
+  // Drops the primitives of the lazy entries that have been unused for
+  // longer than the idle time of this set.  This happens automatically
+  // on lookups, at most once per idle time.  Returns the number of
+  // primitives dropped.
+  int EvictIdlePrimitives() {
+    absl::MutexLock lock(&primitives_mutex_);
+    return EvictIdlePrimitivesLocked(Clock::now());
+  }
+
   // Returns the entries with primitives identifed by 'identifier'.
   crypto::tink::util::StatusOr<const Primitives*> get_primitives(
       const std::string& identifier) {
     absl::MutexLock lock(&primitives_mutex_);
+    if (next_eviction_ != Clock::time_point::max()) {
+      Clock::time_point now = Clock::now();
+      if (now >= next_eviction_) EvictIdlePrimitivesLocked(now);
+    }
     typename CiphertextPrefixToPrimitivesMap::iterator found =
         primitives_.find(identifier);
     if (found == primitives_.end()) {
@@ -120,12 +296,35 @@ class PrimitiveSet {
     return &(found->second);
   }
 
+  // Returns the number of entries in this set.
+  int size() {
+    absl::MutexLock lock(&primitives_mutex_);
+    int size = 0;
+    for (const auto& identifier_and_entries : primitives_) {
+      size += identifier_and_entries.second.size();
+    }
+    return size;
+  }
+
+  // Returns all the entries of this set.
+  std::vector<Entry<P>*> get_all() {
+    absl::MutexLock lock(&primitives_mutex_);
+    std::vector<Entry<P>*> entries;
+    for (const auto& identifier_and_entries : primitives_) {
+      for (const auto& entry : identifier_and_entries.second) {
+        entries.push_back(entry.get());
+      }
+    }
+    return entries;
+  }
+
   // Returns all primitives that use RAW prefix.
   crypto::tink::util::StatusOr<const Primitives*> get_raw_primitives() {
     return get_primitives(CryptoFormat::kRawPrefix);
   }
 
   // Sets the given 'primary' as the primary primitive of this set.
+  // The primitive of a lazy 'primary' is created, and kept from then on.
   crypto::tink::util::Status set_primary(Entry<P>* primary) {
     if (!primary) {
       return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
@@ -141,6 +340,8 @@ class PrimitiveSet {
                        "Primary cannot be set to an entry which is "
                        "not held by this primitive set.");
     }
+    auto status = primary->Pin();
+    if (!status.ok()) return status;
 
     primary_ = primary;
     return crypto::tink::util::Status::OK;
@@ -152,9 +353,26 @@ class PrimitiveSet {
  private:
   typedef std::unordered_map<std::string, Primitives>
       CiphertextPrefixToPrimitivesMap;
+
+  int EvictIdlePrimitivesLocked(Clock::time_point now)
+      EXCLUSIVE_LOCKS_REQUIRED(primitives_mutex_) {
+    if (max_idle_time_ == Clock::duration::max()) return 0;
+    int num_evicted = 0;
+    for (const auto& identifier_and_entries : primitives_) {
+      for (const auto& entry : identifier_and_entries.second) {
+        if (entry->EvictIfUnusedSince(now - max_idle_time_)) num_evicted++;
+      }
+    }
+    next_eviction_ = now + max_idle_time_;
+    return num_evicted;
+  }
+
   Entry<P>* primary_;  // the Entry<P> object is owned by primitives_
+  const Clock::duration max_idle_time_;
   absl::Mutex primitives_mutex_;
   CiphertextPrefixToPrimitivesMap primitives_ GUARDED_BY(primitives_mutex_);
+  // When lookups should next drop idle primitives; max() if never.
+  Clock::time_point next_eviction_ GUARDED_BY(primitives_mutex_);
 };
 
 }  // namespace tink
@@ -19,6 +19,7 @@
 
 #include <memory>
 
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/util/statusor.h"
 
@@ -37,6 +38,23 @@ class PrimitiveWrapper {
   virtual ~PrimitiveWrapper() {}
   virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>> Wrap(
       std::unique_ptr<PrimitiveSet<Primitive>> primitive_set) const = 0;
+
+  // Like Wrap(), but the returned primitive reports its operations to
+  // MonitoringClients created by 'monitoring_factory', which is used only
+  // during the call.  Wrappers that support monitoring override this;
+  // the default ignores 'monitoring_factory'.
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>>
+  WrapWithMonitoring(std::unique_ptr<PrimitiveSet<Primitive>> primitive_set,
+                     MonitoringClientFactory* monitoring_factory) const {
+    return Wrap(std::move(primitive_set));
+  }
+
+  // Returns true iff the primitives returned by Wrap() use only
+  // get_shared_primitive() on the entries of the set, except on the
+  // primary.  Only such wrappers are given sets with lazy entries (see
+  // KeysetHandle::GetLazyPrimitive()) as they are; for other wrappers,
+  // the primitives of all entries are created before wrapping.
+  virtual bool SupportsLazyPrimitives() const { return false; }
 };
 
 }  // namespace tink
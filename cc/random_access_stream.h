@@ -17,6 +17,8 @@
 #ifndef TINK_RANDOM_ACCESS_STREAM_H_
 #define TINK_RANDOM_ACCESS_STREAM_H_
 
+#include <vector>
+
 #include "tink/util/buffer.h"
 #include "tink/util/status.h"
 
@@ -52,6 +54,41 @@ class RandomAccessStream {
       int count,
       crypto::tink::util::Buffer* dest_buffer) = 0;
 
+  // A range of a stream to be read by PReadRanges().
+  struct ReadRange {
+    int64_t position;
+    int count;
+    crypto::tink::util::Buffer* dest_buffer;
+    // Set by PReadRanges() to the status of reading this range,
+    // which has the same meaning as the status returned by PRead().
+    crypto::tink::util::Status status;
+  };
+
+  // Reads each of the 'ranges', as if PRead() was called for each of them,
+  // and sets the status of every range accordingly.  The ranges may be
+  // read in any order, and they must not share destination buffers.
+  //
+  // Implementations can serve several ranges at once (e.g. with a single
+  // syscall, or by decrypting a segment once for all the ranges within it),
+  // hence reading many small ranges with a single call can be much cheaper
+  // than issuing a PRead()-call per range.  The default implementation
+  // simply calls PRead() for each range.
+  //
+  // Returns a non-OK status only if 'ranges' is NULL, the statuses
+  // of the individual ranges are reported in the ranges.
+  virtual crypto::tink::util::Status PReadRanges(
+      std::vector<ReadRange>* ranges) {
+    if (ranges == nullptr) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::INVALID_ARGUMENT,
+          "ranges must be non-null");
+    }
+    for (ReadRange& range : *ranges) {
+      range.status = PRead(range.position, range.count, range.dest_buffer);
+    }
+    return crypto::tink::util::OkStatus();
+  }
+
   // Returns the size of this stream in bytes, if available.
   // It is the "logical" size of a stream (i.e. of a sequence of bytes),
   // stating how many bytes are there in the sequence.
@@ -21,6 +21,7 @@
 #include <string>
 
 #include "tink/core/registry_impl.h"
+#include "tink/monitoring.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -195,6 +196,16 @@ class Registry {
     return RegistryImpl::GlobalInstance().Wrap<P>(std::move(primitive_set));
   }
 
+  // Makes the primitives wrapped from now on report their operations
+  // to MonitoringClients created by 'factory' (see monitoring.h).
+  // Primitives wrapped before are not affected.  A null 'factory'
+  // disables monitoring, which is the default.
+  static crypto::tink::util::Status RegisterMonitoringClientFactory(
+      std::shared_ptr<MonitoringClientFactory> factory) {
+    return RegistryImpl::GlobalInstance().RegisterMonitoringClientFactory(
+        std::move(factory));
+  }
+
   // Resets the registry.
   // After reset the registry is empty, i.e. it contains neither catalogues
   // nor key managers. This method is intended for testing only.
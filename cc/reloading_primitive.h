@@ -0,0 +1,267 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_RELOADING_PRIMITIVE_H_
+#define TINK_RELOADING_PRIMITIVE_H_
+
+#include <atomic>
+#include <chrono>  // NOLINT(build/c++11)
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/epoch_reclaimer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// A source of keysets for ReloadingPrimitive: returns the current keyset,
+// or a null handle if the keyset has not changed since the previous call.
+typedef std::function<
+    crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>>()>
+    KeysetSource;
+
+// Returns a KeysetSource that reads the keyset from the file 'filename'
+// via 'read_keyset' (e.g. a JsonKeysetReader and KeysetHandle::Read()),
+// whenever the modification time, the size or the inode of the file has
+// changed since the previous successful read.  Keyset files should be
+// replaced atomically (i.e. by renaming a new file), so that the source
+// never sees a partially written keyset.
+KeysetSource KeysetFileSource(
+    const std::string& filename,
+    std::function<crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>>(
+        std::unique_ptr<std::istream> keyset_stream)> read_keyset);
+
+// A primitive of type P for a keyset that is rotated while it is in use.
+//
+// ReloadingPrimitive polls a KeysetSource on a background thread, and
+// whenever the source returns a new keyset, creates the primitive for it
+// and publishes it with an atomic pointer swap.  Get() returns a reference
+// to the current primitive without taking any lock, and operations that
+// are in flight during a swap complete with the previous primitive, which
+// is deleted once all the references to it are gone (the background thread
+// waits for this via an EpochReclaimer).  Hence neither the creation of
+// the new primitive nor the reclamation of the previous one adds latency
+// to the callers of Get().
+//
+// If the source or the creation of the primitive fails, the current
+// primitive stays in use, and the error is reported by
+// last_reload_status().
+//
+// ReloadingPrimitive is thread safe.
+template <class P>
+class ReloadingPrimitive {
+ public:
+  // A reference to the primitive that was current when Get() was called,
+  // which keeps the primitive alive until the reference is destroyed.
+  // As it also delays the reclamation of replaced primitives, a Ref
+  // should be held only for the duration of an operation.
+  class Ref {
+   public:
+    Ref(Ref&& other)
+        : reclaimer_(other.reclaimer_), token_(other.token_),
+          primitive_(other.primitive_) {
+      other.reclaimer_ = nullptr;
+    }
+
+    ~Ref() {
+      if (reclaimer_ != nullptr) reclaimer_->ExitRead(token_);
+    }
+
+    P* operator->() const { return primitive_; }
+    P& operator*() const { return *primitive_; }
+
+   private:
+    friend class ReloadingPrimitive;
+
+    Ref(util::EpochReclaimer* reclaimer, int token, P* primitive)
+        : reclaimer_(reclaimer), token_(token), primitive_(primitive) {}
+    Ref(const Ref&) = delete;
+    Ref& operator=(const Ref&) = delete;
+
+    util::EpochReclaimer* reclaimer_;
+    int token_;
+    P* primitive_;
+  };
+
+  // Creates the primitive for the keyset returned by 'source', failing
+  // if that fails, and then checks 'source' for a new keyset every
+  // 'reload_interval'.  If 'reload_interval' is not positive, no
+  // background thread is started, and the keyset is reloaded only
+  // via Reload().
+  static crypto::tink::util::StatusOr<std::unique_ptr<ReloadingPrimitive<P>>>
+  New(KeysetSource source, std::chrono::steady_clock::duration reload_interval);
+
+  // Stops the background thread, and deletes the current primitive.
+  // All the Refs must have been destroyed before.
+  ~ReloadingPrimitive();
+
+  // Returns a reference to the current primitive.
+  Ref Get() const {
+    int token = reclaimer_.EnterRead();
+    return Ref(&reclaimer_, token, primitive_.load(std::memory_order_seq_cst));
+  }
+
+  // Checks the source for a new keyset now, and if there is one, replaces
+  // the primitive.  Returns after the previous primitive has been deleted,
+  // i.e. after all the Refs to it have been destroyed.  Hence this must
+  // not be called by a thread that holds a Ref, as it would wait forever.
+  // Concurrent calls are serialized.
+  crypto::tink::util::Status Reload()
+      LOCKS_EXCLUDED(reload_mutex_, status_mutex_);
+
+  // Returns the status of the most recent reload.  Does not wait for
+  // a reload that waits for Refs to the previous primitive.
+  crypto::tink::util::Status last_reload_status() const
+      LOCKS_EXCLUDED(status_mutex_) {
+    absl::MutexLock lock(&status_mutex_);
+    return last_reload_status_;
+  }
+
+  // Returns the number of times the primitive has been replaced.
+  int64_t reload_count() const LOCKS_EXCLUDED(status_mutex_) {
+    absl::MutexLock lock(&status_mutex_);
+    return reload_count_;
+  }
+
+ private:
+  explicit ReloadingPrimitive(KeysetSource source)
+      : source_(std::move(source)), primitive_(nullptr), reload_count_(0),
+        stopping_(false) {}
+  ReloadingPrimitive(const ReloadingPrimitive&) = delete;
+  ReloadingPrimitive& operator=(const ReloadingPrimitive&) = delete;
+
+  // Returns the primitive for the keyset returned by the source, or null
+  // if the keyset has not changed.
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> NewPrimitive()
+      EXCLUSIVE_LOCKS_REQUIRED(reload_mutex_);
+
+  // The body of the background thread.
+  void ReloadLoop(std::chrono::steady_clock::duration reload_interval)
+      LOCKS_EXCLUDED(stop_mutex_);
+
+  const KeysetSource source_;
+  mutable util::EpochReclaimer reclaimer_;
+  std::atomic<P*> primitive_;
+
+  // Serializes the reloads.  Held while waiting for the Refs to the
+  // previous primitive, unlike status_mutex_.
+  absl::Mutex reload_mutex_;
+  mutable absl::Mutex status_mutex_;
+  crypto::tink::util::Status last_reload_status_ GUARDED_BY(status_mutex_);
+  int64_t reload_count_ GUARDED_BY(status_mutex_);
+
+  absl::Mutex stop_mutex_;
+  bool stopping_ GUARDED_BY(stop_mutex_);
+  std::thread reload_thread_;
+};
+
+// static
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<ReloadingPrimitive<P>>>
+ReloadingPrimitive<P>::New(
+    KeysetSource source, std::chrono::steady_clock::duration reload_interval) {
+  if (!source) {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::INVALID_ARGUMENT,
+        "source must be non-null");
+  }
+  std::unique_ptr<ReloadingPrimitive<P>> reloading_primitive(
+      new ReloadingPrimitive<P>(std::move(source)));
+  auto status = reloading_primitive->Reload();
+  if (!status.ok()) return status;
+  if (reloading_primitive->primitive_.load() == nullptr) {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::FAILED_PRECONDITION,
+        "source returned no keyset");
+  }
+  if (reload_interval > std::chrono::steady_clock::duration::zero()) {
+    ReloadingPrimitive<P>* self = reloading_primitive.get();
+    reloading_primitive->reload_thread_ = std::thread(
+        [self, reload_interval]() { self->ReloadLoop(reload_interval); });
+  }
+  return std::move(reloading_primitive);
+}
+
+template <class P>
+ReloadingPrimitive<P>::~ReloadingPrimitive() {
+  {
+    absl::MutexLock lock(&stop_mutex_);
+    stopping_ = true;
+  }
+  if (reload_thread_.joinable()) reload_thread_.join();
+  delete primitive_.load();
+}
+
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>>
+ReloadingPrimitive<P>::NewPrimitive() {
+  auto keyset_handle_result = source_();
+  if (!keyset_handle_result.ok()) return keyset_handle_result.status();
+  auto keyset_handle = std::move(keyset_handle_result.ValueOrDie());
+  if (keyset_handle == nullptr) return std::unique_ptr<P>(nullptr);
+  return keyset_handle->template GetPrimitive<P>();
+}
+
+template <class P>
+crypto::tink::util::Status ReloadingPrimitive<P>::Reload() {
+  absl::MutexLock lock(&reload_mutex_);
+  auto primitive_result = NewPrimitive();
+  P* previous = nullptr;
+  if (primitive_result.ok() && primitive_result.ValueOrDie() != nullptr) {
+    previous = primitive_.exchange(primitive_result.ValueOrDie().release(),
+                                   std::memory_order_seq_cst);
+  }
+  {
+    absl::MutexLock status_lock(&status_mutex_);
+    last_reload_status_ = primitive_result.status();
+    if (previous != nullptr) reload_count_++;
+  }
+  if (previous != nullptr) {
+    reclaimer_.Synchronize();
+    delete previous;
+  }
+  return primitive_result.status();
+}
+
+template <class P>
+void ReloadingPrimitive<P>::ReloadLoop(
+    std::chrono::steady_clock::duration reload_interval) {
+  while (true) {
+    {
+      absl::MutexLock lock(&stop_mutex_);
+      if (stop_mutex_.AwaitWithTimeout(absl::Condition(&stopping_),
+                                       absl::FromChrono(reload_interval))) {
+        return;
+      }
+    }
+    // Errors are reported via last_reload_status().
+    Reload().IgnoreError();
+  }
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_RELOADING_PRIMITIVE_H_
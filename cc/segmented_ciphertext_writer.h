@@ -0,0 +1,88 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SEGMENTED_CIPHERTEXT_WRITER_H_
+#define TINK_SEGMENTED_CIPHERTEXT_WRITER_H_
+
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+
+// A SegmentedCiphertextWriter writes a StreamingAead-ciphertext segment
+// by segment, at explicit positions of the ciphertext destination.
+// In contrast to an encrypting OutputStream, the segments can be written
+// in any order, and concurrently from multiple threads: once the header
+// of the ciphertext is fixed, each segment depends only on its plaintext
+// and its segment number.
+//
+// The plaintext is split into segments as follows: segment 0 covers
+// the plaintext bytes [0, GetPlaintextSegmentSize(0)), segment 1 starts
+// at GetPlaintextSegmentOffset(1) = GetPlaintextSegmentSize(0), and so on.
+// Each segment except for the last one must be written with exactly
+// GetPlaintextSegmentSize() bytes of plaintext via WriteSegment(),
+// and the last segment must be written via Finalize().  The ciphertext
+// is complete once all the segments have been written successfully.
+class SegmentedCiphertextWriter {
+ public:
+  // Returns the number of plaintext bytes of segment 'segment_number',
+  // unless it is the last segment, which can be shorter.
+  virtual int GetPlaintextSegmentSize(int64_t segment_number) const = 0;
+
+  // Returns the offset of segment 'segment_number' within the plaintext.
+  virtual int64_t GetPlaintextSegmentOffset(int64_t segment_number) const = 0;
+
+  // Returns the position of segment 'segment_number' within the ciphertext
+  // destination.
+  virtual int64_t GetCiphertextSegmentPosition(
+      int64_t segment_number) const = 0;
+
+  // Returns the number of segments of a ciphertext of a plaintext
+  // of 'plaintext_size' bytes.  This is always at least 1, since even
+  // an empty plaintext is encrypted as a (last) segment.
+  virtual int64_t GetNumberOfSegments(int64_t plaintext_size) const = 0;
+
+  // Encrypts 'plaintext' as segment 'segment_number' (which must not be
+  // the last segment), and writes the resulting ciphertext segment to its
+  // position in the ciphertext destination.  'plaintext' must be exactly
+  // GetPlaintextSegmentSize(segment_number) bytes long.  Each segment
+  // can be written only once, even if the write fails: rewriting it would
+  // reuse its nonce, so further attempts fail with FAILED_PRECONDITION.
+  // Thread safe.
+  virtual crypto::tink::util::Status WriteSegment(
+      int64_t segment_number, absl::string_view plaintext) = 0;
+
+  // Encrypts 'plaintext' as the last segment of the ciphertext, and writes
+  // it to its position in the ciphertext destination.  'plaintext' must not
+  // be longer than GetPlaintextSegmentSize(segment_number), and must not be
+  // empty unless 'segment_number' is 0.  Afterwards no segments with numbers
+  // larger or equal to 'segment_number' can be written.
+  // Thread safe; can be called concurrently with WriteSegment() for
+  // the preceding segments, but only once per writer.
+  virtual crypto::tink::util::Status Finalize(
+      int64_t segment_number, absl::string_view plaintext) = 0;
+
+  virtual ~SegmentedCiphertextWriter() {}
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SEGMENTED_CIPHERTEXT_WRITER_H_
@@ -16,7 +16,9 @@
 
 #include "tink/signature/public_key_sign_wrapper.h"
 
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/public_key_sign.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -26,6 +28,7 @@
 namespace crypto {
 namespace tink {
 
+using crypto::tink::internal::FunctionMonitor;
 using google::crypto::tink::OutputPrefixType;
 
 namespace {
@@ -44,9 +47,11 @@ util::Status Validate(PrimitiveSet<PublicKeySign>* public_key_sign_set) {
 
 class PublicKeySignSetWrapper : public PublicKeySign {
  public:
-  explicit PublicKeySignSetWrapper(
-      std::unique_ptr<PrimitiveSet<PublicKeySign>> public_key_sign_set)
-      : public_key_sign_set_(std::move(public_key_sign_set)) {}
+  PublicKeySignSetWrapper(
+      std::unique_ptr<PrimitiveSet<PublicKeySign>> public_key_sign_set,
+      FunctionMonitor sign_monitor)
+      : public_key_sign_set_(std::move(public_key_sign_set)),
+        sign_monitor_(std::move(sign_monitor)) {}
 
   crypto::tink::util::StatusOr<std::string> Sign(
       absl::string_view data) const override;
@@ -55,6 +60,7 @@ class PublicKeySignSetWrapper : public PublicKeySign {
 
  private:
   std::unique_ptr<PrimitiveSet<PublicKeySign>> public_key_sign_set_;
+  const FunctionMonitor sign_monitor_;
 };
 
 util::StatusOr<std::string> PublicKeySignSetWrapper::Sign(
@@ -63,7 +69,9 @@ util::StatusOr<std::string> PublicKeySignSetWrapper::Sign(
   // regardless of whether the size is 0.
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
 
+  FunctionMonitor::Call call = sign_monitor_.StartCall();
   auto primary = public_key_sign_set_->get_primary();
+  const size_t data_size = data.size();
   std::string local_data;
   if (primary->get_output_prefix_type() == OutputPrefixType::LEGACY) {
     local_data = std::string(data);
@@ -71,7 +79,11 @@ util::StatusOr<std::string> PublicKeySignSetWrapper::Sign(
     data = local_data;
   }
   auto sign_result = primary->get_primitive().Sign(data);
-  if (!sign_result.ok()) return sign_result.status();
+  if (!sign_result.ok()) {
+    call.LogFailure();
+    return sign_result.status();
+  }
+  call.Log(primary->get_key_id(), data_size);
   const std::string& key_id = primary->get_identifier();
   return key_id + sign_result.ValueOrDie();
 }
@@ -80,10 +92,20 @@ util::StatusOr<std::string> PublicKeySignSetWrapper::Sign(
 
 util::StatusOr<std::unique_ptr<PublicKeySign>> PublicKeySignWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<PublicKeySign>> primitive_set) const {
+  return WrapWithMonitoring(std::move(primitive_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<PublicKeySign>>
+PublicKeySignWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<PublicKeySign>> primitive_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<PublicKeySign> public_key_sign(
-      new PublicKeySignSetWrapper(std::move(primitive_set)));
+  auto sign_monitor_result = FunctionMonitor::New(
+      monitoring_factory, primitive_set.get(), "public_key_sign", "sign");
+  if (!sign_monitor_result.ok()) return sign_monitor_result.status();
+  std::unique_ptr<PublicKeySign> public_key_sign(new PublicKeySignSetWrapper(
+      std::move(primitive_set), std::move(sign_monitor_result.ValueOrDie())));
   return std::move(public_key_sign);
 }
 
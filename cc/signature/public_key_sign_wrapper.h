@@ -18,6 +18,7 @@
 #define TINK_SIGNATURE_PUBLIC_KEY_SIGN_WRAPPER_H_
 
 #include "absl/strings/string_view.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/public_key_sign.h"
@@ -39,6 +40,13 @@ class PublicKeySignWrapper : public PrimitiveWrapper<PublicKeySign> {
   crypto::tink::util::StatusOr<std::unique_ptr<PublicKeySign>> Wrap(
       std::unique_ptr<PrimitiveSet<PublicKeySign>> primitive_set)
       const override;
+
+  crypto::tink::util::StatusOr<std::unique_ptr<PublicKeySign>>
+  WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<PublicKeySign>> primitive_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
@@ -16,7 +16,9 @@
 
 #include "tink/signature/public_key_verify_wrapper.h"
 
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/public_key_verify.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -27,6 +29,7 @@
 namespace crypto {
 namespace tink {
 
+using crypto::tink::internal::FunctionMonitor;
 using google::crypto::tink::OutputPrefixType;
 
 namespace {
@@ -45,9 +48,11 @@ util::Status Validate(PrimitiveSet<PublicKeyVerify>* public_key_verify_set) {
 
 class PublicKeyVerifySetWrapper : public PublicKeyVerify {
  public:
-  explicit PublicKeyVerifySetWrapper(
-      std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set)
-      : public_key_verify_set_(std::move(public_key_verify_set)) {}
+  PublicKeyVerifySetWrapper(
+      std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set,
+      FunctionMonitor verify_monitor)
+      : public_key_verify_set_(std::move(public_key_verify_set)),
+        verify_monitor_(std::move(verify_monitor)) {}
 
   crypto::tink::util::Status Verify(absl::string_view signature,
                                     absl::string_view data) const override;
@@ -56,6 +61,7 @@ class PublicKeyVerifySetWrapper : public PublicKeyVerify {
 
  private:
   std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set_;
+  const FunctionMonitor verify_monitor_;
 };
 
 util::Status PublicKeyVerifySetWrapper::Verify(
@@ -66,9 +72,12 @@ util::Status PublicKeyVerifySetWrapper::Verify(
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
   signature = subtle::SubtleUtilBoringSSL::EnsureNonNull(signature);
 
+  FunctionMonitor::Call call = verify_monitor_.StartCall();
+  const size_t data_size = data.size();
   if (signature.length() <= CryptoFormat::kNonRawPrefixSize) {
     // This also rejects raw signatures with size of 4 bytes or fewer.
     // We're not aware of any schemes that output signatures that small.
+    call.LogFailure();
     return util::Status(util::error::INVALID_ARGUMENT, "Signature too short.");
   }
   const std::string& key_id = std::string(
@@ -84,13 +93,16 @@ util::Status PublicKeyVerifySetWrapper::Verify(
         local_data.append(1, CryptoFormat::kLegacyStartByte);
         data = local_data;
       }
-      auto& public_key_verify = entry->get_primitive();
+      auto public_key_verify_result = entry->get_shared_primitive();
+      if (!public_key_verify_result.ok()) continue;
+      auto& public_key_verify = *public_key_verify_result.ValueOrDie();
       auto verify_result =
           public_key_verify.Verify(raw_signature, data);
       if (verify_result.ok()) {
+        call.Log(entry->get_key_id(), data_size);
         return util::Status::OK;
       } else {
-        // LOG that a matching key didn't verify the signature.
+        call.LogKeyFailure(entry->get_key_id());
       }
     }
   }
@@ -100,13 +112,19 @@ util::Status PublicKeyVerifySetWrapper::Verify(
   if (raw_primitives_result.ok()) {
     for (auto& public_key_verify_entry :
              *(raw_primitives_result.ValueOrDie())) {
-      auto& public_key_verify = public_key_verify_entry->get_primitive();
+      auto public_key_verify_result =
+          public_key_verify_entry->get_shared_primitive();
+      if (!public_key_verify_result.ok()) continue;
+      auto& public_key_verify = *public_key_verify_result.ValueOrDie();
       auto verify_result = public_key_verify.Verify(signature, data);
       if (verify_result.ok()) {
+        call.Log(public_key_verify_entry->get_key_id(), data_size);
         return util::Status::OK;
       }
+      call.LogKeyFailure(public_key_verify_entry->get_key_id());
     }
   }
+  call.LogFailure();
   return util::Status(util::error::INVALID_ARGUMENT, "Invalid signature.");
 }
 
@@ -115,10 +133,23 @@ util::Status PublicKeyVerifySetWrapper::Verify(
 util::StatusOr<std::unique_ptr<PublicKeyVerify>> PublicKeyVerifyWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set)
     const {
+  return WrapWithMonitoring(std::move(public_key_verify_set), nullptr);
+}
+
+util::StatusOr<std::unique_ptr<PublicKeyVerify>>
+PublicKeyVerifyWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set,
+    MonitoringClientFactory* monitoring_factory) const {
   util::Status status = Validate(public_key_verify_set.get());
   if (!status.ok()) return status;
+  auto verify_monitor_result =
+      FunctionMonitor::New(monitoring_factory, public_key_verify_set.get(),
+                           "public_key_verify", "verify");
+  if (!verify_monitor_result.ok()) return verify_monitor_result.status();
   std::unique_ptr<PublicKeyVerify> public_key_verify(
-      new PublicKeyVerifySetWrapper(std::move(public_key_verify_set)));
+      new PublicKeyVerifySetWrapper(
+          std::move(public_key_verify_set),
+          std::move(verify_monitor_result.ValueOrDie())));
   return std::move(public_key_verify);
 }
 
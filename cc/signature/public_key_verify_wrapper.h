@@ -18,6 +18,7 @@
 #define TINK_SIGNATURE_PUBLIC_KEY_VERIFY_WRAPPER_H_
 
 #include "absl/strings/string_view.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/public_key_verify.h"
@@ -40,6 +41,13 @@ class PublicKeyVerifyWrapper : public PrimitiveWrapper<PublicKeyVerify> {
   crypto::tink::util::StatusOr<std::unique_ptr<PublicKeyVerify>> Wrap(
       std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set)
       const override;
+
+  crypto::tink::util::StatusOr<std::unique_ptr<PublicKeyVerify>>
+  WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
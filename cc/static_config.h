@@ -0,0 +1,103 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STATIC_CONFIG_H_
+#define TINK_STATIC_CONFIG_H_
+
+#include "tink/core/registry_impl.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+
+// A configuration, i.e. a set of key managers and primitive wrappers,
+// which is fixed at compile time.  Example:
+//
+//   using MyConfig = StaticConfig<
+//       KeyManagerEntry<AesGcmKeyManager>,
+//       KeyManagerEntry<HmacKeyManager>,
+//       PrimitiveWrapperEntry<AeadWrapper>,
+//       PrimitiveWrapperEntry<MacWrapper>>;
+//
+//   auto status = MyConfig::Register();
+//
+// Unlike the Config-classes (e.g. AeadConfig) and TinkConfig, a StaticConfig
+// uses neither catalogues nor RegistryConfig-protos: it constructs only
+// the listed key managers and wrappers, and registers all of them in
+// a single update of the registry.  Moreover only the listed classes are
+// referenced, so that the code of the other key types can be dropped
+// by the linker.
+//
+// The entries can be KeyManagerEntry, InternalKeyManagerEntry,
+// AsymmetricKeyManagersEntry, PrimitiveWrapperEntry, or other
+// StaticConfigs, whose entries are then included.
+template <class... Entries>
+class StaticConfig {
+ public:
+  // Registers all the entries, or none of them if any registration fails
+  // (e.g. because a different key manager is registered for a key type).
+  static crypto::tink::util::Status Register() {
+    RegistryImpl::Batch batch;
+    AddTo(&batch);
+    return RegistryImpl::GlobalInstance().RegisterBatch(std::move(batch));
+  }
+
+  static void AddTo(RegistryImpl::Batch* batch) {
+    // Expands to one AddTo()-call per entry, in order.
+    int unused[] = {0, (Entries::AddTo(batch), 0)...};
+    (void)unused;
+  }
+};
+
+// A KeyManager<P>, which must be default-constructible.
+template <class ConcreteKeyManager, bool new_key_allowed = true>
+struct KeyManagerEntry {
+  static void AddTo(RegistryImpl::Batch* batch) {
+    batch->AddKeyManager(new ConcreteKeyManager(), new_key_allowed);
+  }
+};
+
+// An InternalKeyManager, which must be default-constructible.
+template <class ConcreteKeyManager, bool new_key_allowed = true>
+struct InternalKeyManagerEntry {
+  static void AddTo(RegistryImpl::Batch* batch) {
+    batch->AddInternalKeyManager(new ConcreteKeyManager(), new_key_allowed);
+  }
+};
+
+// A pair of InternalPrivateKeyManager and InternalKeyManager for the
+// corresponding public keys, which must be default-constructible.
+template <class PrivateKeyManager, class PublicKeyManager,
+          bool new_key_allowed = true>
+struct AsymmetricKeyManagersEntry {
+  static void AddTo(RegistryImpl::Batch* batch) {
+    batch->AddAsymmetricKeyManagers(new PrivateKeyManager(),
+                                    new PublicKeyManager(), new_key_allowed);
+  }
+};
+
+// A PrimitiveWrapper<P>, which must be default-constructible.
+template <class ConcretePrimitiveWrapper>
+struct PrimitiveWrapperEntry {
+  static void AddTo(RegistryImpl::Batch* batch) {
+    batch->AddPrimitiveWrapper(new ConcretePrimitiveWrapper());
+  }
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STATIC_CONFIG_H_
@@ -23,6 +23,8 @@
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/random_access_stream.h"
+#include "tink/segmented_ciphertext_writer.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -39,6 +41,25 @@ namespace tink {
 // of the ciphertext.
 class StreamingAead {
  public:
+  // The outcome of a verify-only pass over a ciphertext stream,
+  // cf. VerifyStream() and VerifyRandomAccessStream() below.
+  struct VerificationResult {
+    // The number of leading ciphertext segments that were found to be
+    // authentic, i.e. the number of all segments if the entire ciphertext
+    // is authentic.
+    int64_t verified_segments = 0;
+    // The index of the first ciphertext segment that failed authentication,
+    // or -1 if the entire ciphertext is authentic.  A malformed or truncated
+    // header, or a ciphertext that does not match any of the keys,
+    // is reported as a failure of segment 0.
+    int64_t first_invalid_segment = -1;
+    // The position of the first invalid segment within the ciphertext
+    // source, or -1 if the entire ciphertext is authentic.
+    int64_t first_invalid_segment_offset = -1;
+
+    bool is_authentic() const { return first_invalid_segment < 0; }
+  };
+
   // Returns a wrapper around 'ciphertext_destination', such that any bytes
   // written via the wrapper are AEAD-encrypted using 'associated_data' as
   // associated authenticated data. The associated data is not included in the
@@ -73,6 +94,89 @@ class StreamingAead {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data) = 0;
 
+  // Authenticates the ciphertext read from 'ciphertext_source' without
+  // returning the resulting plaintext, using 'associated_data' as associated
+  // authenticated data.  The ciphertext segments are verified in parallel,
+  // and plaintext is written only to per-thread scratch buffers.
+  // Returns a non-OK status only if 'ciphertext_source' could not be read,
+  // or if verification is not supported by this primitive; authentication
+  // failures are reported via the returned VerificationResult.
+  virtual crypto::tink::util::StatusOr<VerificationResult>
+  VerifyStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "verification not supported");
+  }
+
+  // Like VerifyStream(), but reads the ciphertext from a RandomAccessStream,
+  // which allows the segments to be read in parallel as well.
+  // 'ciphertext_source' must have a known size(), and must support
+  // concurrent PRead()-calls.
+  virtual crypto::tink::util::StatusOr<VerificationResult>
+  VerifyRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "verification not supported");
+  }
+
+  // Returns the size of the ciphertext that EncryptBuffer() produces
+  // for a plaintext of 'plaintext_size' bytes.
+  virtual crypto::tink::util::StatusOr<int64_t> GetCiphertextSize(
+      int64_t plaintext_size) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "buffer encryption not supported");
+  }
+
+  // Encrypts 'plaintext' using 'associated_data' as associated authenticated
+  // data, and writes the ciphertext to the 'ciphertext_size' bytes starting
+  // at 'ciphertext', where 'ciphertext_size' must be equal to
+  // GetCiphertextSize(plaintext.size()).  The ciphertext is identical
+  // in format to the bytes that an encrypting stream returned by
+  // NewEncryptingStream() writes, so it can be decrypted with any
+  // of the decrypting streams.  The segments are encrypted in parallel.
+  virtual crypto::tink::util::Status EncryptBuffer(
+      absl::string_view plaintext,
+      absl::string_view associated_data,
+      char* ciphertext, int64_t ciphertext_size) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "buffer encryption not supported");
+  }
+
+  // Decrypts 'ciphertext' (as produced by EncryptBuffer() or by an encrypting
+  // stream) using 'associated_data' as associated authenticated data,
+  // and writes the plaintext to 'plaintext', which must have room for
+  // 'plaintext_capacity' bytes.  Returns the size of the plaintext.
+  // A capacity of ciphertext.size() bytes is always sufficient; if the
+  // plaintext does not fit, fails with RESOURCE_EXHAUSTED.
+  // The segments are decrypted in parallel.
+  virtual crypto::tink::util::StatusOr<int64_t> DecryptBuffer(
+      absl::string_view ciphertext,
+      absl::string_view associated_data,
+      char* plaintext, int64_t plaintext_capacity) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "buffer decryption not supported");
+  }
+
+  // Returns a writer that encrypts the plaintext segment by segment,
+  // using 'associated_data' as associated authenticated data, and writes
+  // the resulting ciphertext to the file 'ciphertext_fd' via pwrite().
+  // The writer allows the segments to be encrypted and written in any
+  // order and from multiple threads.  The ciphertext header is written
+  // at position 0 of 'ciphertext_fd' (or after the ciphertext offset,
+  // if the primitive uses one) before this method returns.
+  // The writer does not take ownership of 'ciphertext_fd', and does not
+  // truncate the file.
+  virtual crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::SegmentedCiphertextWriter>>
+  NewSegmentedCiphertextWriter(
+      int ciphertext_fd,
+      absl::string_view associated_data) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "segmented writing not supported");
+  }
+
   virtual ~StreamingAead() {}
 };
 
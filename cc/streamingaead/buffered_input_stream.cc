@@ -34,12 +34,18 @@ using util::Status;
 using util::StatusOr;
 
 BufferedInputStream::BufferedInputStream(
-    std::unique_ptr<crypto::tink::InputStream> input_stream) {
+    std::unique_ptr<crypto::tink::InputStream> input_stream)
+    : BufferedInputStream(std::move(input_stream), 4 * 1024) {  // 4 KB
+}
+
+BufferedInputStream::BufferedInputStream(
+    std::unique_ptr<crypto::tink::InputStream> input_stream,
+    int initial_buffer_size) {
   input_stream_ = std::move(input_stream);
   count_in_buffer_ = 0;
   count_backedup_ = 0;
   position_ = 0;
-  buffer_.resize(4 * 1024);  // 4 KB
+  buffer_.resize(std::max(initial_buffer_size, 1));
   buffer_offset_ = 0;
   after_rewind_ = false;
   rewinding_enabled_ = true;
@@ -39,6 +39,14 @@ class BufferedInputStream : public crypto::tink::InputStream {
   explicit BufferedInputStream(
       std::unique_ptr<crypto::tink::InputStream> input_stream);
 
+  // Like the constructor above, but allocates initially a buffer of
+  // 'initial_buffer_size' bytes, which avoids growing the buffer
+  // if the number of bytes read before DisableRewinding() is known
+  // in advance.
+  BufferedInputStream(
+      std::unique_ptr<crypto::tink::InputStream> input_stream,
+      int initial_buffer_size);
+
   ~BufferedInputStream() override;
 
   crypto::tink::util::StatusOr<int> Next(const void** data) override;
@@ -53,6 +61,9 @@ class BufferedInputStream : public crypto::tink::InputStream {
   // Disables rewinding.
   void DisableRewinding();
 
+  // Returns the number of bytes buffered so far.
+  int buffered_size() const { return count_in_buffer_; }
+
  private:
   std::unique_ptr<crypto::tink::InputStream> input_stream_;
   bool direct_access_;      // true iff we don't buffer any data any more
@@ -130,6 +130,25 @@ TEST(BufferedInputStreamTest, ReadingAndRewinding) {
   }
 }
 
+TEST(BufferedInputStreamTest, InitialBufferSize) {
+  for (auto initial_buffer_size : {0, 1, 100, 100000}) {
+    for (auto input_size : {0, 10, 1000, 10000}) {
+      SCOPED_TRACE(absl::StrCat("initial_buffer_size = ", initial_buffer_size,
+                                ", input_size = ", input_size));
+      std::string contents = subtle::Random::GetRandomBytes(input_size);
+      auto buf_stream = absl::make_unique<BufferedInputStream>(
+          GetInputStream(contents), initial_buffer_size);
+      std::string read;
+      EXPECT_THAT(ReadFromStream(buf_stream.get(), &read), IsOk());
+      EXPECT_EQ(contents, read);
+      EXPECT_EQ(input_size, buf_stream->buffered_size());
+      EXPECT_THAT(buf_stream->Rewind(), IsOk());
+      EXPECT_THAT(ReadFromStream(buf_stream.get(), &read), IsOk());
+      EXPECT_EQ(contents, read);
+    }
+  }
+}
+
 TEST(BufferedInputStreamTest, SingleBackup) {
   for (auto input_size : {0, 1, 10, 100, 1000, 10000, 100000}) {
     std::string contents = subtle::Random::GetRandomBytes(input_size);
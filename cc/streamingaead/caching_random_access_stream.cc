@@ -0,0 +1,304 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/caching_random_access_stream.h"
+
+#include <string.h>
+#include <algorithm>
+#include <iterator>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/thread_pool.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using util::Status;
+using util::StatusOr;
+
+namespace {
+
+// The number of reads in a row, each starting in the segment where
+// the previous one ended (or in the following segment), after which
+// the reads are considered sequential.
+const int kSequentialReadsThreshold = 2;
+
+}  // anonymous namespace
+
+// static
+StatusOr<std::unique_ptr<CachingRandomAccessStream>>
+CachingRandomAccessStream::New(std::unique_ptr<RandomAccessStream> source,
+                               const Options& options) {
+  if (source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT, "source must be non-null.");
+  }
+  if (options.segment_size <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_size must be positive.");
+  }
+  if (options.max_cached_segments <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_cached_segments must be positive.");
+  }
+  if (options.prefetch_segments < 0 ||
+      options.prefetch_segments >= options.max_cached_segments) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "prefetch_segments must be non-negative and smaller than "
+                  "max_cached_segments.");
+  }
+  return {absl::WrapUnique(
+      new CachingRandomAccessStream(std::move(source), options))};
+}
+
+CachingRandomAccessStream::CachingRandomAccessStream(
+    std::unique_ptr<RandomAccessStream> source, const Options& options)
+    : source_(std::move(source)),
+      options_(options),
+      last_segment_(-1),
+      last_read_segment_(-2),
+      sequential_reads_(0),
+      hit_count_(0),
+      miss_count_(0),
+      prefetch_count_(0) {
+  if (options_.prefetch_segments > 0) {
+    prefetch_pool_ = absl::make_unique<util::ThreadPool>(1);
+  }
+}
+
+CachingRandomAccessStream::~CachingRandomAccessStream() {
+  prefetch_pool_.reset();
+}
+
+StatusOr<std::shared_ptr<CachingRandomAccessStream::Segment>>
+CachingRandomAccessStream::ReadSegment(int64_t segment_index,
+                                       bool* is_complete) {
+  std::shared_ptr<Segment> segment;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!free_segments_.empty()) {
+      segment = std::move(free_segments_.back());
+      free_segments_.pop_back();
+    }
+  }
+  if (segment == nullptr) {
+    auto buffer_result =
+        util::Buffer::New(options_.segment_size, options_.buffer_pool);
+    if (!buffer_result.ok()) return buffer_result.status();
+    segment = std::make_shared<Segment>();
+    segment->data = std::move(buffer_result.ValueOrDie());
+  }
+  util::Buffer* buffer = segment->data.get();
+  int64_t position = segment_index * options_.segment_size;
+  auto status = source_->PRead(position, options_.segment_size, buffer);
+  if (!status.ok() && status.error_code() != util::error::OUT_OF_RANGE) {
+    return status;
+  }
+  // A short read is permanent only at the end of the stream.
+  segment->is_last = !status.ok() ||
+      (buffer->size() < options_.segment_size &&
+       source_->size() == position + buffer->size());
+  *is_complete = segment->is_last || buffer->size() == options_.segment_size;
+  return {std::move(segment)};
+}
+
+void CachingRandomAccessStream::FinishLoading(
+    int64_t segment_index, std::shared_ptr<Segment> segment) {
+  absl::MutexLock lock(&mutex_);
+  loading_.erase(std::find(loading_.begin(), loading_.end(), segment_index));
+  loading_finished_.SignalAll();
+  if (segment == nullptr) return;
+  if (segment->is_last &&
+      (last_segment_ < 0 || segment_index < last_segment_)) {
+    last_segment_ = segment_index;
+  }
+  if (cache_.count(segment_index) > 0) return;
+  if (lru_.size() >= static_cast<size_t>(options_.max_cached_segments)) {
+    // Evict the least recently used segment, and reuse its list node.
+    auto evicted = cache_.find(lru_.back());
+    // Readers still using the evicted segment hold their own reference,
+    // otherwise it can be recycled.
+    if (evicted->second.segment.use_count() == 1 &&
+        free_segments_.size() <
+            static_cast<size_t>(options_.prefetch_segments + 1)) {
+      free_segments_.push_back(std::move(evicted->second.segment));
+    }
+    cache_.erase(evicted);
+    lru_.splice(lru_.begin(), lru_, std::prev(lru_.end()));
+    lru_.front() = segment_index;
+  } else {
+    lru_.push_front(segment_index);
+  }
+  CacheEntry& entry = cache_[segment_index];
+  entry.segment = std::move(segment);
+  entry.lru_position = lru_.begin();
+}
+
+StatusOr<std::shared_ptr<const CachingRandomAccessStream::Segment>>
+CachingRandomAccessStream::GetSegment(int64_t segment_index) {
+  {
+    absl::MutexLock lock(&mutex_);
+    // Wait if the segment is being read by another thread (or prefetched).
+    while (cache_.count(segment_index) == 0 && IsLoading(segment_index)) {
+      loading_finished_.Wait(&mutex_);
+    }
+    auto it = cache_.find(segment_index);
+    if (it != cache_.end()) {
+      hit_count_++;
+      lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+      return {std::shared_ptr<const Segment>(it->second.segment)};
+    }
+    miss_count_++;
+    loading_.push_back(segment_index);
+  }
+  bool is_complete = false;
+  auto segment_result = ReadSegment(segment_index, &is_complete);
+  FinishLoading(segment_index,
+                segment_result.ok() && is_complete
+                    ? segment_result.ValueOrDie()
+                    : nullptr);
+  if (!segment_result.ok()) return segment_result.status();
+  return {std::shared_ptr<const Segment>(
+      std::move(segment_result.ValueOrDie()))};
+}
+
+bool CachingRandomAccessStream::IsLoading(int64_t segment_index) const {
+  return std::find(loading_.begin(), loading_.end(), segment_index) !=
+      loading_.end();
+}
+
+void CachingRandomAccessStream::Prefetch(int64_t segment_index) {
+  bool is_complete = false;
+  auto segment_result = ReadSegment(segment_index, &is_complete);
+  FinishLoading(segment_index,
+                segment_result.ok() && is_complete
+                    ? segment_result.ValueOrDie()
+                    : nullptr);
+}
+
+void CachingRandomAccessStream::MaybePrefetch(int64_t first_segment,
+                                              int64_t last_segment) {
+  if (prefetch_pool_ == nullptr) return;
+  // Do not prefetch beyond the end of the stream, if its size is known.
+  int64_t stream_size = source_->size();
+  absl::MutexLock lock(&mutex_);
+  if (stream_size >= 0 && last_segment_ < 0) {
+    last_segment_ = std::max<int64_t>(stream_size - 1, 0) /
+                    options_.segment_size;
+  }
+  if (first_segment == last_read_segment_ ||
+      first_segment == last_read_segment_ + 1) {
+    sequential_reads_++;
+  } else {
+    sequential_reads_ = 0;
+  }
+  last_read_segment_ = last_segment;
+  if (sequential_reads_ < kSequentialReadsThreshold) return;
+  for (int i = 1; i <= options_.prefetch_segments; i++) {
+    int64_t segment_index = last_segment + i;
+    if (last_segment_ >= 0 && segment_index > last_segment_) break;
+    if (cache_.count(segment_index) > 0 || IsLoading(segment_index)) {
+      continue;
+    }
+    loading_.push_back(segment_index);
+    prefetch_count_++;
+    prefetch_pool_->Schedule(
+        [this, segment_index]() { Prefetch(segment_index); });
+  }
+}
+
+Status CachingRandomAccessStream::PRead(int64_t position, int count,
+                                        util::Buffer* dest_buffer) {
+  if (dest_buffer == nullptr) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "dest_buffer must be non-null");
+  }
+  if (count < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "count cannot be negative");
+  }
+  if (count > dest_buffer->allocated_size()) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "buffer too small");
+  }
+  if (position < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "position cannot be negative");
+  }
+  dest_buffer->set_size(0);
+  if (count == 0) {
+    return Status::OK;
+  }
+  int64_t end = position + count;
+  int64_t current = position;
+  int64_t segment_index = position / options_.segment_size;
+  bool reached_end = false;
+  while (current < end) {
+    segment_index = current / options_.segment_size;
+    auto segment_result = GetSegment(segment_index);
+    if (!segment_result.ok()) return segment_result.status();
+    const Segment& segment = *segment_result.ValueOrDie();
+    int64_t offset = current - segment_index * options_.segment_size;
+    int64_t available = segment.data->size() - offset;
+    if (available > 0) {
+      int to_copy = std::min(available, end - current);
+      memcpy(dest_buffer->get_mem_block() + (current - position),
+             segment.data->get_mem_block() + offset, to_copy);
+      current += to_copy;
+      dest_buffer->set_size(current - position);
+    }
+    if (current < end && segment.data->size() < options_.segment_size) {
+      // A short segment: either the end of the stream, or data that is
+      // temporarily not available.
+      reached_end = segment.is_last;
+      break;
+    }
+  }
+  MaybePrefetch(position / options_.segment_size, segment_index);
+  if (reached_end) {
+    return Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  return Status::OK;
+}
+
+int64_t CachingRandomAccessStream::size() const {
+  return source_->size();
+}
+
+int64_t CachingRandomAccessStream::hit_count() const {
+  absl::MutexLock lock(&mutex_);
+  return hit_count_;
+}
+
+int64_t CachingRandomAccessStream::miss_count() const {
+  absl::MutexLock lock(&mutex_);
+  return miss_count_;
+}
+
+int64_t CachingRandomAccessStream::prefetch_count() const {
+  absl::MutexLock lock(&mutex_);
+  return prefetch_count_;
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
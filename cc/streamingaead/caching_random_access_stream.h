@@ -0,0 +1,187 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_CACHING_RANDOM_ACCESS_STREAM_H_
+#define TINK_STREAMINGAEAD_CACHING_RANDOM_ACCESS_STREAM_H_
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/buffer_pool.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/thread_pool.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// A RandomAccessStream that wraps another RandomAccessStream, typically
+// a decrypting one (like DecryptingRandomAccessStream), and keeps
+// a bounded LRU cache of segments of its contents.
+//
+// A PRead() on a decrypting stream reads and authenticates every ciphertext
+// segment that overlaps the requested range, so many small reads within
+// a segment would decrypt it over and over again.  With the cache only
+// the first read decrypts the segment, and subsequent ones just copy
+// from the cached plaintext.  For best results the segment size of the cache
+// should be the plaintext segment size of the underlying ciphertext.
+//
+// If reads that proceed sequentially through the stream are detected,
+// the following segments are prefetched asynchronously.
+//
+// The segments are read directly into Buffers, which are kept in the cache
+// without copying.  Evicted segments that are no longer in use are recycled
+// together with their Buffers, so that reading segments does no heap
+// allocation for their contents in a steady state.  If Options::buffer_pool
+// is set, the Buffers come from that pool.
+//
+// The wrapped stream must support concurrent PRead()-calls.
+// The cache can be shared by several threads, which read concurrently
+// from distinct segments; a segment is loaded only once even if
+// requested by several threads at the same time.
+class CachingRandomAccessStream : public crypto::tink::RandomAccessStream {
+ public:
+  struct Options {
+    Options()
+        : segment_size(0),
+          max_cached_segments(16),
+          prefetch_segments(0),
+          buffer_pool(nullptr) {}
+    // The size of the cached segments, must be positive.
+    int segment_size;
+    // The maximal number of segments kept in the cache, must be positive.
+    int max_cached_segments;
+    // The number of segments to be prefetched upon sequential reads,
+    // must be non-negative and smaller than max_cached_segments.
+    int prefetch_segments;
+    // The pool for the Buffers holding the cached segments, or null
+    // if the Buffers should be allocated individually.  If set, the pool
+    // must outlive the stream.
+    crypto::tink::util::BufferPool* buffer_pool;
+  };
+
+  // Constructs a RandomAccessStream that reads from 'source', and caches
+  // the read segments according to 'options'.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<CachingRandomAccessStream>>
+  New(std::unique_ptr<crypto::tink::RandomAccessStream> source,
+      const Options& options);
+
+  // Waits for the pending prefetches.
+  ~CachingRandomAccessStream() override;
+
+  crypto::tink::util::Status PRead(
+      int64_t position, int count,
+      crypto::tink::util::Buffer* dest_buffer) override;
+
+  int64_t size() const override;
+
+  // The number of segment lookups that were served from the cache.
+  int64_t hit_count() const LOCKS_EXCLUDED(mutex_);
+
+  // The number of segment lookups that required reading from the source.
+  int64_t miss_count() const LOCKS_EXCLUDED(mutex_);
+
+  // The number of segments that were read from the source by prefetching.
+  int64_t prefetch_count() const LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // The (plaintext) contents of a segment.
+  struct Segment {
+    std::unique_ptr<crypto::tink::util::Buffer> data;
+    // True iff the segment is the last one in the stream.
+    bool is_last;
+  };
+
+  // An entry of the cache.
+  struct CacheEntry {
+    std::shared_ptr<Segment> segment;
+    std::list<int64_t>::iterator lru_position;
+  };
+
+  CachingRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> source,
+      const Options& options);
+
+  // Returns the segment with index 'segment_index', from the cache
+  // or from the source.
+  crypto::tink::util::StatusOr<std::shared_ptr<const Segment>> GetSegment(
+      int64_t segment_index) LOCKS_EXCLUDED(mutex_);
+
+  // Reads the segment with index 'segment_index' from the source,
+  // into a recycled segment if available.
+  // Sets 'is_complete' to true iff the result can be cached, i.e. iff
+  // the segment has not been truncated by a non-permanent lack of data.
+  crypto::tink::util::StatusOr<std::shared_ptr<Segment>> ReadSegment(
+      int64_t segment_index, bool* is_complete) LOCKS_EXCLUDED(mutex_);
+
+  // Finishes loading of 'segment_index' from the source, adding
+  // 'segment' (if non-null) to the cache.
+  void FinishLoading(int64_t segment_index, std::shared_ptr<Segment> segment)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Updates the detection of sequential reads with a read of segments
+  // first_segment..last_segment, and schedules prefetching if needed.
+  void MaybePrefetch(int64_t first_segment, int64_t last_segment)
+      LOCKS_EXCLUDED(mutex_);
+
+  // Returns true iff the segment with index 'segment_index' is being read
+  // from the source.
+  bool IsLoading(int64_t segment_index) const
+      EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Loads the segment with index 'segment_index' in the background.
+  void Prefetch(int64_t segment_index) LOCKS_EXCLUDED(mutex_);
+
+  const std::unique_ptr<crypto::tink::RandomAccessStream> source_;
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  absl::CondVar loading_finished_;
+  std::unordered_map<int64_t, CacheEntry> cache_ GUARDED_BY(mutex_);
+  // Indices of the cached segments, the most recently used first.
+  std::list<int64_t> lru_ GUARDED_BY(mutex_);
+  // Indices of the segments that are being read from the source;
+  // only a few at a time, so a vector is cheaper than a set.
+  std::vector<int64_t> loading_ GUARDED_BY(mutex_);
+  // Evicted segments that can be reused by ReadSegment().
+  std::vector<std::shared_ptr<Segment>> free_segments_ GUARDED_BY(mutex_);
+  // The index of the last segment in the stream, if known, or -1.
+  int64_t last_segment_ GUARDED_BY(mutex_);
+  // The last segment of the most recent read, and the number of reads
+  // in a row that have continued the previous one.
+  int64_t last_read_segment_ GUARDED_BY(mutex_);
+  int sequential_reads_ GUARDED_BY(mutex_);
+  int64_t hit_count_ GUARDED_BY(mutex_);
+  int64_t miss_count_ GUARDED_BY(mutex_);
+  int64_t prefetch_count_ GUARDED_BY(mutex_);
+
+  // Runs the prefetching, if enabled.  Declared last, so that it is
+  // destroyed (which waits for the pending prefetches) first.
+  std::unique_ptr<crypto::tink::util::ThreadPool> prefetch_pool_;
+};
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_CACHING_RANDOM_ACCESS_STREAM_H_
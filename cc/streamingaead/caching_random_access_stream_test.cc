@@ -0,0 +1,257 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/caching_random_access_stream.h"
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/random.h"
+#include "tink/util/allocation_matchers.h"
+#include "tink/util/buffer.h"
+#include "tink/util/buffer_pool.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using crypto::tink::test::AllocatesAtMost;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+// A RandomAccessStream with the specified contents,
+// which counts the PRead()-calls.
+class CountingRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit CountingRandomAccessStream(absl::string_view contents)
+      : contents_(contents), read_count_(0) {}
+
+  util::Status PRead(int64_t position, int count,
+                     util::Buffer* dest_buffer) override {
+    read_count_++;
+    if (position >= contents_.size()) {
+      dest_buffer->set_size(0);
+      return util::Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    int read = std::min<int64_t>(count, contents_.size() - position);
+    memcpy(dest_buffer->get_mem_block(), contents_.data() + position, read);
+    dest_buffer->set_size(read);
+    return util::OkStatus();
+  }
+
+  int64_t size() const override { return contents_.size(); }
+
+  int read_count() const { return read_count_; }
+
+ private:
+  const std::string contents_;
+  std::atomic<int> read_count_;
+};
+
+struct TestStream {
+  CountingRandomAccessStream* source;
+  std::unique_ptr<CachingRandomAccessStream> stream;
+};
+
+TestStream GetTestStream(absl::string_view contents, int segment_size,
+                         int max_cached_segments, int prefetch_segments,
+                         util::BufferPool* buffer_pool = nullptr) {
+  auto source = absl::make_unique<CountingRandomAccessStream>(contents);
+  TestStream result;
+  result.source = source.get();
+  CachingRandomAccessStream::Options options;
+  options.segment_size = segment_size;
+  options.max_cached_segments = max_cached_segments;
+  options.prefetch_segments = prefetch_segments;
+  options.buffer_pool = buffer_pool;
+  auto stream_result =
+      CachingRandomAccessStream::New(std::move(source), options);
+  EXPECT_THAT(stream_result.status(), IsOk());
+  result.stream = std::move(stream_result.ValueOrDie());
+  return result;
+}
+
+// Reads 'count' bytes at 'position' from 'stream', and checks the result
+// against 'contents'.
+void ReadAndVerify(RandomAccessStream* stream, int64_t position, int count,
+                   absl::string_view contents) {
+  SCOPED_TRACE(absl::StrCat("position = ", position, ", count = ", count));
+  auto buffer = std::move(util::Buffer::New(count).ValueOrDie());
+  auto status = stream->PRead(position, count, buffer.get());
+  int64_t expected_size = std::max<int64_t>(
+      std::min<int64_t>(count, contents.size() - position), 0);
+  if (expected_size < count) {
+    EXPECT_THAT(status, StatusIs(util::error::OUT_OF_RANGE));
+  } else {
+    EXPECT_THAT(status, IsOk());
+  }
+  ASSERT_EQ(expected_size, buffer->size());
+  if (expected_size > 0) {
+    EXPECT_EQ(contents.substr(position, expected_size),
+              std::string(buffer->get_mem_block(), buffer->size()));
+  }
+}
+
+TEST(CachingRandomAccessStreamTest, ReadsMatchSource) {
+  for (int stream_size : {0, 1, 100, 1000, 10000}) {
+    for (int segment_size : {1, 64, 100, 4096}) {
+      SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size,
+                                ", segment_size = ", segment_size));
+      std::string contents = subtle::Random::GetRandomBytes(stream_size);
+      auto test_stream = GetTestStream(contents, segment_size, 4, 0);
+      for (int64_t position : {0, 1, 63, 64, 99, 500, 9990}) {
+        for (int count : {1, 10, 64, 333, 2000}) {
+          ReadAndVerify(test_stream.stream.get(), position, count, contents);
+        }
+      }
+      EXPECT_EQ(stream_size, test_stream.stream->size());
+    }
+  }
+}
+
+TEST(CachingRandomAccessStreamTest, RepeatedReadsHitCache) {
+  std::string contents = subtle::Random::GetRandomBytes(1000);
+  auto test_stream = GetTestStream(contents, 100, 4, 0);
+  for (int i = 0; i < 50; i++) {
+    ReadAndVerify(test_stream.stream.get(), 200 + i, 10, contents);
+  }
+  EXPECT_EQ(1, test_stream.source->read_count());
+  EXPECT_EQ(1, test_stream.stream->miss_count());
+  EXPECT_EQ(49, test_stream.stream->hit_count());
+
+  // A read spanning three segments, two of which are new.
+  ReadAndVerify(test_stream.stream.get(), 250, 200, contents);
+  EXPECT_EQ(3, test_stream.source->read_count());
+  EXPECT_EQ(3, test_stream.stream->miss_count());
+  EXPECT_EQ(50, test_stream.stream->hit_count());
+}
+
+TEST(CachingRandomAccessStreamTest, EvictsLeastRecentlyUsed) {
+  std::string contents = subtle::Random::GetRandomBytes(1000);
+  auto test_stream = GetTestStream(contents, 100, 2, 0);
+  ReadAndVerify(test_stream.stream.get(), 0, 10, contents);    // miss
+  ReadAndVerify(test_stream.stream.get(), 100, 10, contents);  // miss
+  ReadAndVerify(test_stream.stream.get(), 0, 10, contents);    // hit
+  ReadAndVerify(test_stream.stream.get(), 200, 10, contents);  // evicts 100
+  ReadAndVerify(test_stream.stream.get(), 0, 10, contents);    // hit
+  ReadAndVerify(test_stream.stream.get(), 100, 10, contents);  // miss
+  EXPECT_EQ(4, test_stream.stream->miss_count());
+  EXPECT_EQ(2, test_stream.stream->hit_count());
+  EXPECT_EQ(4, test_stream.source->read_count());
+}
+
+TEST(CachingRandomAccessStreamTest, PrefetchesSequentialReads) {
+  int segment_size = 100;
+  int segment_count = 50;
+  std::string contents =
+      subtle::Random::GetRandomBytes(segment_size * segment_count - 10);
+  auto test_stream = GetTestStream(contents, segment_size, 8, 3);
+  for (int64_t position = 0; position < contents.size(); position += 30) {
+    ReadAndVerify(test_stream.stream.get(), position, 30, contents);
+  }
+  // Each segment is read from the source exactly once,
+  // but most of them in the background.
+  EXPECT_EQ(segment_count, test_stream.source->read_count());
+  EXPECT_LT(0, test_stream.stream->prefetch_count());
+  EXPECT_EQ(segment_count, test_stream.stream->miss_count() +
+                               test_stream.stream->prefetch_count());
+}
+
+TEST(CachingRandomAccessStreamTest, ConcurrentReads) {
+  std::string contents = subtle::Random::GetRandomBytes(100000);
+  auto test_stream = GetTestStream(contents, 1000, 10, 2);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&test_stream, &contents, t]() {
+      for (int i = 0; i < 200; i++) {
+        ReadAndVerify(test_stream.stream.get(), (t * 7919 + i * 331) % 100000,
+                      1 + (i * 37) % 3000, contents);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_LT(0, test_stream.stream->hit_count());
+}
+
+TEST(CachingRandomAccessStreamTest, ReusesPooledBuffers) {
+  util::BufferPool pool;
+  std::string contents = subtle::Random::GetRandomBytes(10000);
+  auto test_stream = GetTestStream(contents, 1000, 2, 0, &pool);
+  for (int i = 0; i < 100; i++) {
+    ReadAndVerify(test_stream.stream.get(), (i * 7919) % 10000, 10, contents);
+  }
+  EXPECT_LT(50, test_stream.stream->miss_count());
+  // At most two cached segments, and one being read.
+  EXPECT_GE(3, pool.allocation_count());
+}
+
+TEST(CachingRandomAccessStreamTest, RecyclesEvictedSegments) {
+  std::string contents = subtle::Random::GetRandomBytes(10000);
+  auto test_stream = GetTestStream(contents, 1000, 2, 0);
+  auto buffer = std::move(util::Buffer::New(10).ValueOrDie());
+  int64_t position = 0;
+  util::Status status;
+  auto read_next_segment = [&]() {
+    status = test_stream.stream->PRead(position, 10, buffer.get());
+    position = (position + 1000) % 10000;
+  };
+  for (int i = 0; i < 5; i++) read_next_segment();
+  // Every read misses the cache; only the entry of the cache is allocated,
+  // while the segment and its Buffer are recycled.
+  EXPECT_THAT(read_next_segment, AllocatesAtMost(1));
+  EXPECT_THAT(status, IsOk());
+  EXPECT_EQ(7, test_stream.stream->miss_count());
+}
+
+TEST(CachingRandomAccessStreamTest, InvalidArguments) {
+  CachingRandomAccessStream::Options options;
+  EXPECT_THAT(CachingRandomAccessStream::New(nullptr, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  for (auto invalid :
+           {std::vector<int>{0, 4, 0}, std::vector<int>{10, 0, 0},
+            std::vector<int>{10, 4, -1}, std::vector<int>{10, 4, 4}}) {
+    options.segment_size = invalid[0];
+    options.max_cached_segments = invalid[1];
+    options.prefetch_segments = invalid[2];
+    EXPECT_THAT(CachingRandomAccessStream::New(
+                    absl::make_unique<CountingRandomAccessStream>("abc"),
+                    options).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  auto test_stream = GetTestStream("some contents", 4, 4, 0);
+  auto buffer = std::move(util::Buffer::New(10).ValueOrDie());
+  EXPECT_THAT(test_stream.stream->PRead(-1, 5, buffer.get()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(test_stream.stream->PRead(0, 11, buffer.get()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(test_stream.stream->PRead(0, 5, nullptr),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -43,12 +43,19 @@ using util::StatusOr;
 StatusOr<std::unique_ptr<InputStream>> DecryptingInputStream::New(
     std::shared_ptr<PrimitiveSet<StreamingAead>> primitives,
     std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
-    absl::string_view associated_data) {
+    absl::string_view associated_data,
+    std::shared_ptr<KeyAffinity> key_affinity) {
   std::unique_ptr<DecryptingInputStream> dec_stream(
       new DecryptingInputStream());
   dec_stream->primitives_ = primitives;
-  dec_stream->buffered_ct_source_ =
-      std::make_shared<BufferedInputStream>(std::move(ciphertext_source));
+  if (key_affinity != nullptr && key_affinity->probe_size() > 0) {
+    dec_stream->buffered_ct_source_ = std::make_shared<BufferedInputStream>(
+        std::move(ciphertext_source), key_affinity->probe_size());
+  } else {
+    dec_stream->buffered_ct_source_ =
+        std::make_shared<BufferedInputStream>(std::move(ciphertext_source));
+  }
+  dec_stream->key_affinity_ = key_affinity;
   dec_stream->associated_data_ = std::string(associated_data);
   dec_stream->attempted_matching_ = false;
   dec_stream->matching_stream_ = nullptr;
@@ -69,8 +76,23 @@ util::StatusOr<int> DecryptingInputStream::Next(const void** data) {
   if (!raw_primitives_result.ok()) {
     return Status(util::error::INTERNAL, "No RAW primitives found");
   }
-  for (auto& primitive : *(raw_primitives_result.ValueOrDie())) {
-    StreamingAead& streaming_aead = primitive->get_primitive();
+  auto& raw_primitives = *(raw_primitives_result.ValueOrDie());
+  int num_primitives = raw_primitives.size();
+
+  // Try the most recently matching primitive first, if known.
+  std::vector<int> order;
+  order.reserve(num_primitives);
+  int preferred = key_affinity_ == nullptr ? -1 :
+      key_affinity_->primitive_index();
+  if (preferred >= 0 && preferred < num_primitives) order.push_back(preferred);
+  for (int i = 0; i < num_primitives; i++) {
+    if (i != preferred) order.push_back(i);
+  }
+
+  for (int i : order) {
+    auto primitive_result = raw_primitives[i]->get_shared_primitive();
+    if (!primitive_result.ok()) continue;
+    StreamingAead& streaming_aead = *primitive_result.ValueOrDie();
     auto shared_ct = absl::make_unique<SharedInputStream>(
         buffered_ct_source_.get());
     auto decrypting_stream_result = streaming_aead.NewDecryptingStream(
@@ -79,7 +101,13 @@ util::StatusOr<int> DecryptingInputStream::Next(const void** data) {
       auto next_result = decrypting_stream_result.ValueOrDie()->Next(data);
       if (next_result.status().error_code() == util::error::OUT_OF_RANGE ||
           next_result.ok()) {  // Found a match.
+        if (key_affinity_ != nullptr) {
+          // Only the bytes read by the matching stream are needed
+          // to match it again, not those read by failed attempts.
+          key_affinity_->RecordMatch(i, buffered_ct_source_->Position());
+        }
         buffered_ct_source_->DisableRewinding();
+        matching_primitive_ = std::move(primitive_result.ValueOrDie());
         matching_stream_ = std::move(decrypting_stream_result.ValueOrDie());
         return next_result;
       }
@@ -25,6 +25,7 @@
 #include "tink/streaming_aead.h"
 #include "tink/util/statusor.h"
 #include "tink/streamingaead/buffered_input_stream.h"
+#include "tink/streamingaead/key_affinity.h"
 
 namespace crypto {
 namespace tink {
@@ -35,17 +36,23 @@ namespace streamingaead {
 // initial portion of the wrapped InputStream, to find a matching
 // primitive, i.e. the primitive that is able to decrypt the stream.
 // Once a match is found, all subsequent calls are forwarded to it.
+//
+// If a KeyAffinity is given, the primitive that matched most recently
+// is tried first, and the buffer for the probed portion of the stream
+// is pre-sized according to the most recent match.
 class DecryptingInputStream : public crypto::tink::InputStream {
  public:
   // Constructs an InputStream that wraps 'input_stream', and will use
   // (one of) provided 'primitives' to decrypt the contents of 'input_stream',
   // using 'associated_data' as authenticated associated data
-  // of the decryption process.
+  // of the decryption process.  'key_affinity' is optional, and if present
+  // it is updated upon a successful match.
   static util::StatusOr<std::unique_ptr<InputStream>> New(
       std::shared_ptr<
           crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives,
       std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
-      absl::string_view associated_data);
+      absl::string_view associated_data,
+      std::shared_ptr<KeyAffinity> key_affinity = nullptr);
 
   ~DecryptingInputStream() override {}
   util::StatusOr<int> Next(const void** data) override;
@@ -57,7 +64,11 @@ class DecryptingInputStream : public crypto::tink::InputStream {
   std::shared_ptr<
       crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives_;
   std::shared_ptr<BufferedInputStream> buffered_ct_source_;
+  std::shared_ptr<KeyAffinity> key_affinity_;
   std::string associated_data_;
+  // Keeps the primitive of matching_stream_ alive (it may be created
+  // lazily, and dropped by 'primitives_' when idle).
+  std::shared_ptr<crypto::tink::StreamingAead> matching_primitive_;
   std::unique_ptr<crypto::tink::InputStream> matching_stream_;
   bool attempted_matching_;
 };
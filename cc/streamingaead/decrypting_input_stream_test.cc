@@ -167,6 +167,53 @@ TEST(DecryptingInputStreamTest, BasicDecryption) {
   }
 }
 
+TEST(DecryptingInputStreamTest, KeyAffinity) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"},
+       {7213743, "streaming_aead2"}});
+  auto key_affinity = std::make_shared<KeyAffinity>();
+  EXPECT_EQ(-1, key_affinity->primitive_index());
+  EXPECT_EQ(0, key_affinity->probe_size());
+
+  std::string plaintext = subtle::Random::GetRandomBytes(10000);
+  std::string aad = "some aad";
+  auto& raw_primitives = *(saead_set->get_raw_primitives().ValueOrDie());
+  // Decrypt each ciphertext twice: first with a stale affinity,
+  // then with the affinity pointing at the matching primitive.
+  for (int i : {1, 1, 0, 2, 2, 0}) {
+    SCOPED_TRACE(absl::StrCat("primitive index = ", i));
+    auto ct = GetCiphertextSource(&(raw_primitives[i]->get_primitive()),
+                                  plaintext, aad);
+    auto dec_stream_result = DecryptingInputStream::New(
+        saead_set, std::move(ct), aad, key_affinity);
+    EXPECT_THAT(dec_stream_result.status(), IsOk());
+    std::string decrypted;
+    EXPECT_THAT(ReadFromStream(dec_stream_result.ValueOrDie().get(),
+                               &decrypted), IsOk());
+    EXPECT_EQ(plaintext, decrypted);
+    EXPECT_EQ(i, key_affinity->primitive_index());
+    EXPECT_LT(0, key_affinity->probe_size());
+  }
+
+  // A ciphertext without a match does not change the affinity.
+  auto dec_stream_result = DecryptingInputStream::New(
+      saead_set, GetInputStream(subtle::Random::GetRandomBytes(100)), aad,
+      key_affinity);
+  EXPECT_THAT(dec_stream_result.status(), IsOk());
+  std::string decrypted;
+  EXPECT_THAT(ReadFromStream(dec_stream_result.ValueOrDie().get(),
+                             &decrypted),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_EQ(0, key_affinity->primitive_index());
+
+  // The recorded probe size is bounded, whatever a stream has read.
+  int max_probe_size = KeyAffinity::kMaxProbeSize;
+  key_affinity->RecordMatch(1, int64_t{1} << 40);
+  EXPECT_EQ(max_probe_size, key_affinity->probe_size());
+  key_affinity->RecordMatch(1, 1000);
+  EXPECT_EQ(1000, key_affinity->probe_size());
+}
+
 TEST(DecryptingInputStreamTest, WrongAssociatedData) {
   uint32_t key_id_0 = 1234543;
   uint32_t key_id_1 = 726329;
@@ -99,7 +99,9 @@ util::Status DecryptingRandomAccessStream::PRead(
     return Status(util::error::INTERNAL, "No RAW primitives found");
   }
   for (auto& primitive : *(raw_primitives_result.ValueOrDie())) {
-    StreamingAead& streaming_aead = primitive->get_primitive();
+    auto primitive_result = primitive->get_shared_primitive();
+    if (!primitive_result.ok()) continue;
+    StreamingAead& streaming_aead = *primitive_result.ValueOrDie();
     auto shared_ct = absl::make_unique<SharedRandomAccessStream>(
         ciphertext_source_.get());
     auto decrypting_stream_result =
@@ -110,6 +112,7 @@ util::Status DecryptingRandomAccessStream::PRead(
           position, count, dest_buffer);
       if (status.ok() || status.error_code() == util::error::OUT_OF_RANGE) {
         // Found a match.
+        matching_primitive_ = std::move(primitive_result.ValueOrDie());
         matching_stream_ = std::move(decrypting_stream_result.ValueOrDie());
         return status;
       }
@@ -120,6 +123,23 @@ util::Status DecryptingRandomAccessStream::PRead(
                 "Could not find a decrypter matching the ciphertext stream.");
 }
 
+util::Status DecryptingRandomAccessStream::PReadRanges(
+    std::vector<ReadRange>* ranges) {
+  if (ranges == nullptr) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "ranges must be non-null");
+  }
+  {
+    absl::ReaderMutexLock lock(&matching_mutex_);
+    if (matching_stream_ != nullptr) {
+      return matching_stream_->PReadRanges(ranges);
+    }
+  }
+  // Matching has not been done yet, so read the ranges one by one:
+  // the first PRead()-call attempts the matching.
+  return RandomAccessStream::PReadRanges(ranges);
+}
+
 int64_t DecryptingRandomAccessStream::size() const {
   absl::ReaderMutexLock lock(&matching_mutex_);
   if (matching_stream_ != nullptr) {
@@ -36,6 +36,9 @@ namespace streamingaead {
 // to read the stream via the provided primitives to find a matching one,
 // i.e. the primitive that is able to decrypt the stream.
 // Once a match is found, all subsequent calls are forwarded to it.
+// Every PRead() decrypts all the segments it overlaps; for workloads with
+// many small or overlapping reads wrap the stream in
+// CachingRandomAccessStream, which caches the decrypted segments.
 class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
  public:
   // Constructs an RandomAccessStream that wraps 'random_access_stream',
@@ -51,6 +54,8 @@ class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
   ~DecryptingRandomAccessStream() override {}
   crypto::tink::util::Status PRead(int64_t position, int count,
       crypto::tink::util::Buffer* dest_buffer) override;
+  crypto::tink::util::Status PReadRanges(
+      std::vector<ReadRange>* ranges) override;
   int64_t size() const override;
 
  private:
@@ -70,6 +75,10 @@ class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
   std::string associated_data_;
   mutable absl::Mutex matching_mutex_;
   bool attempted_matching_ GUARDED_BY(matching_mutex_);
+  // Keeps the primitive of matching_stream_ alive (it may be created
+  // lazily, and dropped by 'primitives_' when idle).
+  std::shared_ptr<crypto::tink::StreamingAead> matching_primitive_
+      GUARDED_BY(matching_mutex_);
   std::unique_ptr<crypto::tink::RandomAccessStream> matching_stream_
       GUARDED_BY(matching_mutex_);
 };
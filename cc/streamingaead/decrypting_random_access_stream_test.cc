@@ -234,6 +234,39 @@ TEST(DecryptingRandomAccessStreamTest, SelectiveDecryption) {
   }
 }
 
+TEST(DecryptingRandomAccessStreamTest, ReadRanges) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"}});
+  std::string plaintext = subtle::Random::GetRandomBytes(1000);
+  std::string aad = "some_aad";
+  auto ct = GetCiphertextSource(
+      &((*saead_set->get_raw_primitives().ValueOrDie())[0]->get_primitive()),
+      plaintext, aad);
+  auto dec_stream_result =
+      DecryptingRandomAccessStream::New(saead_set, std::move(ct), aad);
+  EXPECT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+
+  // The first call finds the matching primitive, the second one
+  // is forwarded to it.
+  for (int i = 0; i < 2; i++) {
+    std::vector<std::unique_ptr<util::Buffer>> buffers;
+    std::vector<RandomAccessStream::ReadRange> ranges;
+    for (int64_t position : {500, 0, 990, 1000}) {
+      buffers.push_back(std::move(util::Buffer::New(20).ValueOrDie()));
+      ranges.push_back({position, 20, buffers.back().get()});
+    }
+    EXPECT_THAT(dec_stream->PReadRanges(&ranges), IsOk());
+    for (int j = 0; j < 3; j++) {
+      EXPECT_THAT(ranges[j].status, IsOk());
+      EXPECT_EQ(plaintext.substr(ranges[j].position, 20),
+                std::string(ranges[j].dest_buffer->get_mem_block(),
+                            ranges[j].dest_buffer->size()));
+    }
+    EXPECT_THAT(ranges[3].status, StatusIs(util::error::OUT_OF_RANGE));
+  }
+}
+
 TEST(DecryptingRandomAccessStreamTest, OutOfRangeDecryption) {
   uint32_t key_id_0 = 1234543;
   uint32_t key_id_1 = 726329;
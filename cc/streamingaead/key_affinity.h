@@ -0,0 +1,79 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_STREAMINGAEAD_KEY_AFFINITY_H_
+#define TINK_STREAMINGAEAD_KEY_AFFINITY_H_
+
+#include <stdint.h>
+
+#include <atomic>
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// Remembers which of the RAW primitives of a set of StreamingAead-primitives
+// matched the most recently opened ciphertext stream, and how many bytes
+// of ciphertext had to be buffered to find the match.  DecryptingInputStream
+// uses it to try the most recently matching primitive first (which during
+// key rotation usually avoids a failed first-segment decryption per stream),
+// and to pre-size its rewind buffer.
+//
+// An instance is shared by all the streams of one wrapper, and is thread safe.
+// The stored values are only hints: a stale value affects the performance,
+// but not the result of decryption.
+class KeyAffinity {
+ public:
+  KeyAffinity() : primitive_index_(-1), probe_size_(0) {}
+
+  // Returns the index of the most recently matching RAW primitive,
+  // or -1 if no match has been found yet.
+  int primitive_index() const {
+    return primitive_index_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the number of bytes buffered while finding the most recent
+  // match, or 0 if no match has been found yet.
+  int probe_size() const {
+    return probe_size_.load(std::memory_order_relaxed);
+  }
+
+  // Records a match of the RAW primitive with index 'primitive_index',
+  // which required buffering 'probe_size' bytes.  The recorded size
+  // is at most kMaxProbeSize, so that a single stream read far ahead
+  // does not make all the following streams allocate large buffers.
+  void RecordMatch(int primitive_index, int64_t probe_size) {
+    int recorded_size = kMaxProbeSize;
+    if (probe_size < recorded_size) recorded_size = probe_size;
+    primitive_index_.store(primitive_index, std::memory_order_relaxed);
+    probe_size_.store(recorded_size, std::memory_order_relaxed);
+  }
+
+  // The maximal recorded probe size, enough for the header and the first
+  // segment of streams with segments of up to 1 MB.
+  static constexpr int kMaxProbeSize = (1 << 20) + 1024;
+
+ private:
+  std::atomic<int> primitive_index_;
+  std::atomic<int> probe_size_;
+};
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_KEY_AFFINITY_H_
@@ -17,6 +17,8 @@
 #ifndef TINK_STREAMINGAEAD_SHARED_RANDOM_ACCESS_STREAM_H_
 #define TINK_STREAMINGAEAD_SHARED_RANDOM_ACCESS_STREAM_H_
 
+#include <vector>
+
 #include "tink/random_access_stream.h"
 #include "tink/util/buffer.h"
 #include "tink/util/status.h"
@@ -45,6 +47,11 @@ class SharedRandomAccessStream : public crypto::tink::RandomAccessStream {
     return random_access_stream_->PRead(position, count, dest_buffer);
   }
 
+  crypto::tink::util::Status PReadRanges(
+      std::vector<ReadRange>* ranges) override {
+    return random_access_stream_->PReadRanges(ranges);
+  }
+
   int64_t size() const override {
     return random_access_stream_->size();
   }
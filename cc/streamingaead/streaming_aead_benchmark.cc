@@ -0,0 +1,168 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of streaming encryption and decryption with AES-GCM-HKDF
+// keysets, over memory and file streams, with different segment sizes.
+
+#include <fcntl.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/input_stream.h"
+#include "tink/keyset_handle.h"
+#include "tink/output_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/streamingaead/streaming_aead_config.h"
+#include "tink/streamingaead/streaming_aead_key_templates.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/allocation_counter.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/file_output_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/statusor.h"
+#include "proto/aes_gcm_hkdf_streaming.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::AllocationCounter;
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::GetShared;
+using crypto::tink::test::NewKeysetHandle;
+using crypto::tink::test::SetAllocationCounters;
+using crypto::tink::test::SetThroughput;
+using crypto::tink::test::ThreadCounts;
+using google::crypto::tink::AesGcmHkdfStreamingKeyFormat;
+using google::crypto::tink::KeyTemplate;
+using google::crypto::tink::OutputPrefixType;
+
+constexpr int kPlaintextSize = 4 << 20;
+
+// Returns the AES128-GCM-HKDF StreamingAead with ciphertext segments
+// of 'segment_size' bytes, shared by all the threads.
+util::StatusOr<StreamingAead*> GetStreamingAead(int segment_size) {
+  return GetShared<StreamingAead>(
+      absl::StrCat(segment_size),
+      [=]() -> util::StatusOr<std::unique_ptr<StreamingAead>> {
+        auto status = StreamingAeadConfig::Register();
+        if (!status.ok()) return status;
+        KeyTemplate key_template =
+            StreamingAeadKeyTemplates::Aes128GcmHkdf4KB();
+        AesGcmHkdfStreamingKeyFormat key_format;
+        key_format.ParseFromString(key_template.value());
+        key_format.mutable_params()->set_ciphertext_segment_size(segment_size);
+        key_template.set_value(key_format.SerializeAsString());
+        auto handle_result =
+            NewKeysetHandle(key_template, 1, OutputPrefixType::RAW);
+        if (!handle_result.ok()) return handle_result.status();
+        return handle_result.ValueOrDie()->GetPrimitive<StreamingAead>();
+      });
+}
+
+// Encrypts kPlaintextSize bytes per iteration, to a new stream
+// created by 'new_destination'.
+template <class NewDestination>
+void EncryptToStream(benchmark::State& state, NewDestination new_destination) {
+  auto saead_result = GetStreamingAead(state.range(0));
+  if (!CheckOk(saead_result.status(), &state)) return;
+  StreamingAead& saead = *saead_result.ValueOrDie();
+  std::string plaintext = subtle::Random::GetRandomBytes(kPlaintextSize);
+  std::string associated_data = subtle::Random::GetRandomBytes(16);
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto enc_stream_result =
+        saead.NewEncryptingStream(new_destination(), associated_data);
+    if (!CheckOk(enc_stream_result.status(), &state)) break;
+    auto status = subtle::test::WriteToStream(
+        enc_stream_result.ValueOrDie().get(), plaintext);
+    if (!CheckOk(status, &state)) break;
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(kPlaintextSize, &state);
+}
+
+void BM_EncryptToMemory(benchmark::State& state) {
+  EncryptToStream(state, []() {
+    return absl::make_unique<util::OstreamOutputStream>(
+        absl::make_unique<std::stringstream>());
+  });
+}
+
+// Writes the ciphertext to /dev/null, to measure the overhead of
+// the file stream without the cost of the disk.
+void BM_EncryptToFile(benchmark::State& state) {
+  EncryptToStream(state, []() {
+    return absl::make_unique<util::FileOutputStream>(
+        open("/dev/null", O_WRONLY));
+  });
+}
+
+void BM_DecryptFromMemory(benchmark::State& state) {
+  auto saead_result = GetStreamingAead(state.range(0));
+  if (!CheckOk(saead_result.status(), &state)) return;
+  StreamingAead& saead = *saead_result.ValueOrDie();
+  std::string associated_data = subtle::Random::GetRandomBytes(16);
+  auto ciphertext_stream = absl::make_unique<std::stringstream>();
+  std::stringstream* ciphertext = ciphertext_stream.get();
+  auto enc_stream_result = saead.NewEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(
+          std::move(ciphertext_stream)),
+      associated_data);
+  if (!CheckOk(enc_stream_result.status(), &state)) return;
+  std::string plaintext = subtle::Random::GetRandomBytes(kPlaintextSize);
+  auto status = subtle::test::WriteToStream(
+      enc_stream_result.ValueOrDie().get(), plaintext);
+  if (!CheckOk(status, &state)) return;
+  std::string ciphertext_bytes = ciphertext->str();
+  AllocationCounter allocations;
+  for (auto _ : state) {
+    auto dec_stream_result = saead.NewDecryptingStream(
+        absl::make_unique<util::IstreamInputStream>(
+            absl::make_unique<std::stringstream>(ciphertext_bytes)),
+        associated_data);
+    if (!CheckOk(dec_stream_result.status(), &state)) break;
+    std::string decrypted;
+    status = subtle::test::ReadFromStream(
+        dec_stream_result.ValueOrDie().get(), &decrypted);
+    if (!CheckOk(status, &state)) break;
+  }
+  SetAllocationCounters(allocations, &state);
+  SetThroughput(kPlaintextSize, &state);
+}
+
+// Arguments: the ciphertext segment size.
+void SegmentSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(4 << 10)->Arg(64 << 10)->Arg(1 << 20);
+}
+
+BENCHMARK(BM_EncryptToMemory)->Apply(SegmentSizes);
+BENCHMARK(BM_EncryptToFile)->Apply(SegmentSizes);
+BENCHMARK(BM_DecryptFromMemory)->Apply(SegmentSizes);
+BENCHMARK(BM_EncryptToMemory)->Arg(64 << 10)->Apply(ThreadCounts);
+BENCHMARK(BM_DecryptFromMemory)->Arg(64 << 10)->Apply(ThreadCounts);
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
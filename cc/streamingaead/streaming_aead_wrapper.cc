@@ -16,20 +16,33 @@
 
 #include "tink/streamingaead/streaming_aead_wrapper.h"
 
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/streaming_aead.h"
+#include "tink/core/function_monitor.h"
 #include "tink/crypto_format.h"
 #include "tink/input_stream.h"
+#include "tink/monitoring.h"
 #include "tink/output_stream.h"
 #include "tink/primitive_set.h"
 #include "tink/random_access_stream.h"
+#include "tink/segmented_ciphertext_writer.h"
+#include "tink/streamingaead/buffered_input_stream.h"
 #include "tink/streamingaead/decrypting_input_stream.h"
 #include "tink/streamingaead/decrypting_random_access_stream.h"
+#include "tink/streamingaead/key_affinity.h"
+#include "tink/streamingaead/shared_input_stream.h"
+#include "tink/streamingaead/shared_random_access_stream.h"
+#include "tink/util/buffer.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
 namespace tink {
 
+using ::crypto::tink::internal::FunctionMonitor;
 using ::crypto::tink::util::Status;
 using ::crypto::tink::util::StatusOr;
 
@@ -52,11 +65,71 @@ Status Validate(PrimitiveSet<StreamingAead>* primitives) {
   return Status::OK;
 }
 
+// A SharedRandomAccessStream that records the first error of reading
+// the wrapped stream, i.e. an error other than OUT_OF_RANGE (end of stream)
+// or INVALID_ARGUMENT (invalid arguments of the read).
+class ErrorRecordingRandomAccessStream
+    : public streamingaead::SharedRandomAccessStream {
+ public:
+  explicit ErrorRecordingRandomAccessStream(
+      RandomAccessStream* random_access_stream)
+      : SharedRandomAccessStream(random_access_stream) {}
+
+  Status PRead(int64_t position, int count,
+               util::Buffer* dest_buffer) override {
+    auto status = SharedRandomAccessStream::PRead(position, count,
+                                                  dest_buffer);
+    Record(status);
+    return status;
+  }
+
+  Status PReadRanges(std::vector<ReadRange>* ranges) override {
+    auto status = SharedRandomAccessStream::PReadRanges(ranges);
+    if (status.ok()) {
+      for (const ReadRange& range : *ranges) Record(range.status);
+    }
+    return status;
+  }
+
+  // Returns the first read error, or OK if there was none.
+  Status read_error() const {
+    absl::MutexLock lock(&mutex_);
+    return read_error_;
+  }
+
+ private:
+  void Record(const Status& status) {
+    if (status.ok() ||
+        status.error_code() == util::error::OUT_OF_RANGE ||
+        status.error_code() == util::error::INVALID_ARGUMENT) {
+      return;
+    }
+    absl::MutexLock lock(&mutex_);
+    if (read_error_.ok()) read_error_ = status;
+  }
+
+  mutable absl::Mutex mutex_;
+  Status read_error_ GUARDED_BY(mutex_);
+};
+
+// Returns the result of a verification in which no key matched
+// the ciphertext, i.e. in which already the first segment is invalid.
+StreamingAead::VerificationResult NoMatchingKey(int64_t header_offset) {
+  StreamingAead::VerificationResult result;
+  result.first_invalid_segment = 0;
+  result.first_invalid_segment_offset = header_offset;
+  return result;
+}
+
 class StreamingAeadSetWrapper: public StreamingAead {
  public:
-  explicit StreamingAeadSetWrapper(
-      std::unique_ptr<PrimitiveSet<StreamingAead>> primitives)
-      : primitives_(std::move(primitives)) {}
+  StreamingAeadSetWrapper(
+      std::unique_ptr<PrimitiveSet<StreamingAead>> primitives,
+      FunctionMonitor encrypt_monitor, FunctionMonitor decrypt_monitor)
+      : primitives_(std::move(primitives)),
+        key_affinity_(std::make_shared<streamingaead::KeyAffinity>()),
+        encrypt_monitor_(std::move(encrypt_monitor)),
+        decrypt_monitor_(std::move(decrypt_monitor)) {}
 
   crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
   NewEncryptingStream(
@@ -74,6 +147,33 @@ class StreamingAeadSetWrapper: public StreamingAead {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data) override;
 
+  crypto::tink::util::StatusOr<VerificationResult> VerifyStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<VerificationResult> VerifyRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<int64_t> GetCiphertextSize(
+      int64_t plaintext_size) override;
+
+  crypto::tink::util::Status EncryptBuffer(
+      absl::string_view plaintext,
+      absl::string_view associated_data,
+      char* ciphertext, int64_t ciphertext_size) override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptBuffer(
+      absl::string_view ciphertext,
+      absl::string_view associated_data,
+      char* plaintext, int64_t plaintext_capacity) override;
+
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::SegmentedCiphertextWriter>>
+  NewSegmentedCiphertextWriter(
+      int ciphertext_fd,
+      absl::string_view associated_data) override;
+
   ~StreamingAeadSetWrapper() override {}
 
  private:
@@ -83,14 +183,126 @@ class StreamingAeadSetWrapper: public StreamingAead {
   // is destroyed, as we refer to primitives_ only when the user attempts
   // to read some data from the decrypting stream.
   std::shared_ptr<PrimitiveSet<StreamingAead>> primitives_;
+  // Shared by all the decrypting streams, to try the most recently
+  // matching primitive first.
+  std::shared_ptr<streamingaead::KeyAffinity> key_affinity_;
+  // The encrypting streams and writers are logged when they are created,
+  // with 0 bytes, and EncryptBuffer() and DecryptBuffer() with the size
+  // of their input.  Decrypting streams are not logged, as their key
+  // is known only once they are read.
+  const FunctionMonitor encrypt_monitor_;
+  const FunctionMonitor decrypt_monitor_;
 };  // class StreamingAeadSetWrapper
 
 StatusOr<std::unique_ptr<OutputStream>>
 StreamingAeadSetWrapper::NewEncryptingStream(
     std::unique_ptr<OutputStream> ciphertext_destination,
     absl::string_view associated_data) {
-  return primitives_->get_primary()->get_primitive().NewEncryptingStream(
-          std::move(ciphertext_destination), associated_data);
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+  const auto* primary = primitives_->get_primary();
+  auto stream_result = primary->get_primitive().NewEncryptingStream(
+      std::move(ciphertext_destination), associated_data);
+  if (!stream_result.ok()) {
+    call.LogFailure();
+  } else {
+    call.Log(primary->get_key_id(), 0);
+  }
+  return stream_result;
+}
+
+StatusOr<int64_t> StreamingAeadSetWrapper::GetCiphertextSize(
+    int64_t plaintext_size) {
+  return primitives_->get_primary()->get_primitive().GetCiphertextSize(
+      plaintext_size);
+}
+
+Status StreamingAeadSetWrapper::EncryptBuffer(
+    absl::string_view plaintext,
+    absl::string_view associated_data,
+    char* ciphertext, int64_t ciphertext_size) {
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+  const auto* primary = primitives_->get_primary();
+  Status status = primary->get_primitive().EncryptBuffer(
+      plaintext, associated_data, ciphertext, ciphertext_size);
+  if (!status.ok()) {
+    call.LogFailure();
+  } else {
+    call.Log(primary->get_key_id(), plaintext.size());
+  }
+  return status;
+}
+
+// Tries the RAW primitives, starting with the one that most recently
+// matched a decrypting stream.
+StatusOr<int64_t> StreamingAeadSetWrapper::DecryptBuffer(
+    absl::string_view ciphertext,
+    absl::string_view associated_data,
+    char* plaintext, int64_t plaintext_capacity) {
+  FunctionMonitor::Call call = decrypt_monitor_.StartCall();
+  auto raw_primitives_result = primitives_->get_raw_primitives();
+  if (!raw_primitives_result.ok()) {
+    call.LogFailure();
+    return Status(util::error::INTERNAL, "No RAW primitives found");
+  }
+  auto& raw_primitives = *(raw_primitives_result.ValueOrDie());
+  int num_primitives = raw_primitives.size();
+  int preferred = key_affinity_->primitive_index();
+  // A key reports a too small plaintext_capacity before decrypting;
+  // another key, with a different segment layout, may still match.
+  Status capacity_error;
+  if (preferred >= 0 && preferred < num_primitives) {
+    const auto& entry = raw_primitives[preferred];
+    auto primitive_result = entry->get_shared_primitive();
+    if (primitive_result.ok()) {
+      auto decrypt_result = primitive_result.ValueOrDie()->DecryptBuffer(
+          ciphertext, associated_data, plaintext, plaintext_capacity);
+      if (decrypt_result.ok()) {
+        call.Log(entry->get_key_id(), ciphertext.size());
+        return decrypt_result;
+      }
+      if (decrypt_result.status().error_code() ==
+          util::error::RESOURCE_EXHAUSTED) {
+        capacity_error = decrypt_result.status();
+      }
+      call.LogKeyFailure(entry->get_key_id());
+    }
+  }
+  for (int i = 0; i < num_primitives; i++) {
+    if (i == preferred) continue;
+    const auto& entry = raw_primitives[i];
+    auto primitive_result = entry->get_shared_primitive();
+    if (!primitive_result.ok()) continue;
+    auto decrypt_result = primitive_result.ValueOrDie()->DecryptBuffer(
+        ciphertext, associated_data, plaintext, plaintext_capacity);
+    if (decrypt_result.ok()) {
+      call.Log(entry->get_key_id(), ciphertext.size());
+      return decrypt_result;
+    }
+    if (decrypt_result.status().error_code() ==
+        util::error::RESOURCE_EXHAUSTED) {
+      capacity_error = decrypt_result.status();
+    }
+    call.LogKeyFailure(entry->get_key_id());
+  }
+  call.LogFailure();
+  if (!capacity_error.ok()) return capacity_error;
+  return Status(util::error::INVALID_ARGUMENT, "decryption failed");
+}
+
+StatusOr<std::unique_ptr<SegmentedCiphertextWriter>>
+StreamingAeadSetWrapper::NewSegmentedCiphertextWriter(
+    int ciphertext_fd,
+    absl::string_view associated_data) {
+  FunctionMonitor::Call call = encrypt_monitor_.StartCall();
+  const auto* primary = primitives_->get_primary();
+  auto writer_result = primary->get_primitive().NewSegmentedCiphertextWriter(
+      ciphertext_fd, associated_data);
+  if (!writer_result.ok()) {
+    call.LogFailure();
+  } else {
+    call.Log(primary->get_key_id(), 0);
+  }
+  return writer_result;
 }
 
 StatusOr<std::unique_ptr<InputStream>>
@@ -98,7 +310,8 @@ StreamingAeadSetWrapper::NewDecryptingStream(
     std::unique_ptr<InputStream> ciphertext_source,
     absl::string_view associated_data) {
   return {streamingaead::DecryptingInputStream::New(
-      primitives_, std::move(ciphertext_source), associated_data)};
+      primitives_, std::move(ciphertext_source), associated_data,
+      key_affinity_)};
 }
 
 StatusOr<std::unique_ptr<RandomAccessStream>>
@@ -109,15 +322,137 @@ StreamingAeadSetWrapper::NewDecryptingRandomAccessStream(
       primitives_, std::move(ciphertext_source), associated_data)};
 }
 
+// Finds the matching primitive by decrypting the first segment
+// (as DecryptingInputStream does), and then verifies the entire stream
+// with that primitive.  Only the first segment is buffered for rewinding.
+// A failure to read 'ciphertext_source' is returned as such, rather than
+// reported as a ciphertext that matches no key.
+StatusOr<StreamingAead::VerificationResult>
+StreamingAeadSetWrapper::VerifyStream(
+    std::unique_ptr<InputStream> ciphertext_source,
+    absl::string_view associated_data) {
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  auto raw_primitives_result = primitives_->get_raw_primitives();
+  if (!raw_primitives_result.ok()) {
+    return Status(util::error::INTERNAL, "No RAW primitives found");
+  }
+  auto buffered_ct_source =
+      absl::make_unique<streamingaead::BufferedInputStream>(
+          std::move(ciphertext_source));
+  for (auto& primitive : *(raw_primitives_result.ValueOrDie())) {
+    auto primitive_result = primitive->get_shared_primitive();
+    if (!primitive_result.ok()) continue;
+    StreamingAead& streaming_aead = *primitive_result.ValueOrDie();
+    bool is_match = false;
+    {
+      auto decrypting_stream_result = streaming_aead.NewDecryptingStream(
+          absl::make_unique<streamingaead::SharedInputStream>(
+              buffered_ct_source.get()),
+          associated_data);
+      if (decrypting_stream_result.ok()) {
+        const void* data;
+        auto next_result = decrypting_stream_result.ValueOrDie()->Next(&data);
+        is_match = next_result.ok() ||
+            next_result.status().error_code() == util::error::OUT_OF_RANGE;
+      }
+    }
+    // Rewind() keeps failing with the error of 'ciphertext_source', if any.
+    auto status = buffered_ct_source->Rewind();
+    if (!status.ok()) return status;
+    if (is_match) {
+      buffered_ct_source->DisableRewinding();
+      return streaming_aead.VerifyStream(
+          absl::make_unique<streamingaead::SharedInputStream>(
+              buffered_ct_source.get()),
+          associated_data);
+    }
+  }
+  return NoMatchingKey(0);
+}
+
+// Verifies the ciphertext with each of the primitives, until one
+// of them gets past the first segment.  A primitive that fails (e.g. as it
+// does not support verification) is skipped, unless it failed to read
+// 'ciphertext_source': such a read error is returned, as is a read error
+// that left all the keys without a match.
+StatusOr<StreamingAead::VerificationResult>
+StreamingAeadSetWrapper::VerifyRandomAccessStream(
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    absl::string_view associated_data) {
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  auto raw_primitives_result = primitives_->get_raw_primitives();
+  if (!raw_primitives_result.ok()) {
+    return Status(util::error::INTERNAL, "No RAW primitives found");
+  }
+  Status last_error(util::error::INVALID_ARGUMENT,
+                    "Could not find a decrypter matching the ciphertext.");
+  Status read_error;
+  bool any_verified = false;
+  VerificationResult no_match = NoMatchingKey(0);
+  for (auto& primitive : *(raw_primitives_result.ValueOrDie())) {
+    auto primitive_result = primitive->get_shared_primitive();
+    if (!primitive_result.ok()) {
+      last_error = primitive_result.status();
+      continue;
+    }
+    auto recording_source =
+        absl::make_unique<ErrorRecordingRandomAccessStream>(
+            ciphertext_source.get());
+    ErrorRecordingRandomAccessStream* recorder = recording_source.get();
+    auto verify_result =
+        primitive_result.ValueOrDie()->VerifyRandomAccessStream(
+            std::move(recording_source), associated_data);
+    if (!verify_result.ok()) {
+      if (!recorder->read_error().ok()) return recorder->read_error();
+      last_error = verify_result.status();
+      continue;
+    }
+    if (verify_result.ValueOrDie().first_invalid_segment != 0) {
+      return verify_result;  // Found a match.
+    }
+    if (read_error.ok()) read_error = recorder->read_error();
+    if (!any_verified) {
+      any_verified = true;
+      no_match = verify_result.ValueOrDie();
+    }
+  }
+  if (!read_error.ok()) return read_error;
+  if (!any_verified) return last_error;
+  return no_match;
+}
+
 }  // anonymous namespace
 
 StatusOr<std::unique_ptr<StreamingAead>> StreamingAeadWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<StreamingAead>> streaming_aead_set) const {
+  return WrapWithMonitoring(std::move(streaming_aead_set), nullptr);
+}
+
+StatusOr<std::unique_ptr<StreamingAead>>
+StreamingAeadWrapper::WrapWithMonitoring(
+    std::unique_ptr<PrimitiveSet<StreamingAead>> streaming_aead_set,
+    MonitoringClientFactory* monitoring_factory) const {
   auto status = Validate(streaming_aead_set.get());
   if (!status.ok()) return status;
+  auto encrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, streaming_aead_set.get(), "streaming_aead",
+      "encrypt");
+  if (!encrypt_monitor_result.ok()) return encrypt_monitor_result.status();
+  auto decrypt_monitor_result = FunctionMonitor::New(
+      monitoring_factory, streaming_aead_set.get(), "streaming_aead",
+      "decrypt");
+  if (!decrypt_monitor_result.ok()) return decrypt_monitor_result.status();
   std::unique_ptr<StreamingAead> streaming_aead =
       absl::make_unique<StreamingAeadSetWrapper>(
-          std::move(streaming_aead_set));
+          std::move(streaming_aead_set),
+          std::move(encrypt_monitor_result.ValueOrDie()),
+          std::move(decrypt_monitor_result.ValueOrDie()));
   return std::move(streaming_aead);
 }
 
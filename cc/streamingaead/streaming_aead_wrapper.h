@@ -19,6 +19,7 @@
 
 #include "absl/strings/string_view.h"
 #include "tink/streaming_aead.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
 #include "tink/util/statusor.h"
@@ -42,6 +43,14 @@ class StreamingAeadWrapper : public PrimitiveWrapper<StreamingAead> {
   util::StatusOr<std::unique_ptr<StreamingAead>> Wrap(
       std::unique_ptr<PrimitiveSet<StreamingAead>> streaming_aead_set)
       const override;
+
+  // Like Wrap(), with monitoring of the encrypting streams and writers
+  // (when they are created) and of EncryptBuffer() and DecryptBuffer().
+  util::StatusOr<std::unique_ptr<StreamingAead>> WrapWithMonitoring(
+      std::unique_ptr<PrimitiveSet<StreamingAead>> streaming_aead_set,
+      MonitoringClientFactory* monitoring_factory) const override;
+
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
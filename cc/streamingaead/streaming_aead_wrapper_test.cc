@@ -79,6 +79,45 @@ util::Status ReadAll(RandomAccessStream* ra_stream, std::string* contents) {
   return status;
 }
 
+// An InputStream whose reads fail with 'status'.
+class FailingInputStream : public InputStream {
+ public:
+  explicit FailingInputStream(util::Status status) : status_(status) {}
+  util::StatusOr<int> Next(const void** data) override { return status_; }
+  void BackUp(int count) override {}
+  int64_t Position() const override { return 0; }
+
+ private:
+  util::Status status_;
+};
+
+// A RandomAccessStream whose reads fail with 'status'.
+class FailingRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit FailingRandomAccessStream(util::Status status) : status_(status) {}
+  util::Status PRead(int64_t position, int count,
+                     util::Buffer* dest_buffer) override {
+    return status_;
+  }
+  int64_t size() const override { return 1000; }
+
+ private:
+  util::Status status_;
+};
+
+// A DummyStreamingAead that does not support verification.
+class UnverifiableStreamingAead : public DummyStreamingAead {
+ public:
+  explicit UnverifiableStreamingAead(absl::string_view streaming_aead_name)
+      : DummyStreamingAead(streaming_aead_name) {}
+
+  util::StatusOr<VerificationResult> VerifyRandomAccessStream(
+      std::unique_ptr<RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) override {
+    return util::Status(util::error::UNIMPLEMENTED, "not supported");
+  }
+};
+
 // A container for specification of instances of DummyStreamingAead
 // to be created for testing.
 struct StreamingAeadSpec {
@@ -299,6 +338,151 @@ TEST(StreamingAeadSetWrapperTest, DecryptionAfterWrapperIsDestroyed) {
   EXPECT_EQ(plaintext, decrypted);
 }
 
+TEST(StreamingAeadSetWrapperTest, Verification) {
+  uint32_t key_id_0 = 1234543;
+  uint32_t key_id_1 = 726329;
+  std::string saead_name_0 = "streaming_aead0";
+  std::string saead_name_1 = "streaming_aead1";
+  std::string aad = "some_aad";
+  std::string plaintext = subtle::Random::GetRandomBytes(1000);
+
+  // A ciphertext produced with a non-primary key.
+  std::string ciphertext = absl::StrCat(saead_name_0, aad, plaintext);
+
+  StreamingAeadWrapper wrapper;
+  auto wrap_result = wrapper.Wrap(GetTestStreamingAeadSet(
+      {{key_id_0, saead_name_0, OutputPrefixType::RAW},
+       {key_id_1, saead_name_1, OutputPrefixType::RAW}}));
+  EXPECT_TRUE(wrap_result.ok()) << wrap_result.status();
+  auto saead = std::move(wrap_result.ValueOrDie());
+
+  for (bool is_authentic : {true, false}) {
+    SCOPED_TRACE(absl::StrCat("is_authentic = ", is_authentic));
+    std::string verified_aad = is_authentic ? aad : "some other aad";
+    std::unique_ptr<InputStream> ct_source(
+        absl::make_unique<util::IstreamInputStream>(
+            absl::make_unique<std::stringstream>(ciphertext)));
+    auto result = saead->VerifyStream(std::move(ct_source), verified_aad);
+    ASSERT_THAT(result.status(), IsOk());
+    EXPECT_EQ(is_authentic, result.ValueOrDie().is_authentic());
+    EXPECT_EQ(is_authentic ? -1 : 0,
+              result.ValueOrDie().first_invalid_segment);
+
+    result = saead->VerifyRandomAccessStream(
+        GetRandomAccessStream(ciphertext), verified_aad);
+    ASSERT_THAT(result.status(), IsOk());
+    EXPECT_EQ(is_authentic, result.ValueOrDie().is_authentic());
+    EXPECT_EQ(is_authentic ? -1 : 0,
+              result.ValueOrDie().first_invalid_segment);
+  }
+}
+
+TEST(StreamingAeadSetWrapperTest, VerificationReportsReadErrors) {
+  StreamingAeadWrapper wrapper;
+  auto wrap_result = wrapper.Wrap(GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0", OutputPrefixType::RAW},
+       {726329, "streaming_aead1", OutputPrefixType::RAW}}));
+  EXPECT_TRUE(wrap_result.ok()) << wrap_result.status();
+  auto saead = std::move(wrap_result.ValueOrDie());
+
+  auto result = saead->VerifyStream(
+      absl::make_unique<FailingInputStream>(
+          util::Status(util::error::UNAVAILABLE, "read failed")),
+      "some_aad");
+  EXPECT_THAT(result.status(),
+              StatusIs(util::error::UNAVAILABLE, HasSubstr("read failed")));
+
+  result = saead->VerifyRandomAccessStream(
+      absl::make_unique<FailingRandomAccessStream>(
+          util::Status(util::error::UNAVAILABLE, "read failed")),
+      "some_aad");
+  EXPECT_THAT(result.status(),
+              StatusIs(util::error::UNAVAILABLE, HasSubstr("read failed")));
+}
+
+TEST(StreamingAeadSetWrapperTest, VerificationSkipsFailingKeys) {
+  std::string aad = "some_aad";
+  std::string ciphertext = absl::StrCat(
+      "streaming_aead1", aad, subtle::Random::GetRandomBytes(1000));
+
+  // A key that cannot verify, ahead of the matching key.
+  Keyset keyset;
+  auto saead_set = absl::make_unique<PrimitiveSet<StreamingAead>>();
+  Keyset::Key* key = keyset.add_key();
+  key->set_output_prefix_type(OutputPrefixType::RAW);
+  key->set_key_id(1234543);
+  key->set_status(KeyStatusType::ENABLED);
+  EXPECT_THAT(saead_set->AddPrimitive(
+      absl::make_unique<UnverifiableStreamingAead>("streaming_aead0"),
+      *key).status(), IsOk());
+  key = keyset.add_key();
+  key->set_output_prefix_type(OutputPrefixType::RAW);
+  key->set_key_id(726329);
+  key->set_status(KeyStatusType::ENABLED);
+  auto entry_result = saead_set->AddPrimitive(
+      absl::make_unique<DummyStreamingAead>("streaming_aead1"), *key);
+  ASSERT_THAT(entry_result.status(), IsOk());
+  saead_set->set_primary(entry_result.ValueOrDie());
+
+  StreamingAeadWrapper wrapper;
+  auto wrap_result = wrapper.Wrap(std::move(saead_set));
+  ASSERT_TRUE(wrap_result.ok()) << wrap_result.status();
+  auto saead = std::move(wrap_result.ValueOrDie());
+
+  auto result = saead->VerifyRandomAccessStream(
+      GetRandomAccessStream(ciphertext), aad);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_TRUE(result.ValueOrDie().is_authentic());
+
+  result = saead->VerifyRandomAccessStream(
+      GetRandomAccessStream(ciphertext), "other aad");
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_FALSE(result.ValueOrDie().is_authentic());
+}
+
+TEST(StreamingAeadSetWrapperTest, BufferEncryptionAndDecryption) {
+  uint32_t key_id_0 = 1234543;
+  uint32_t key_id_1 = 726329;
+  std::string saead_name_0 = "streaming_aead0";
+  std::string saead_name_1 = "streaming_aead1";
+  std::string aad = "some_aad";
+  std::string plaintext = subtle::Random::GetRandomBytes(1000);
+
+  StreamingAeadWrapper wrapper;
+  auto wrap_result = wrapper.Wrap(GetTestStreamingAeadSet(
+      {{key_id_0, saead_name_0, OutputPrefixType::RAW},
+       {key_id_1, saead_name_1, OutputPrefixType::RAW}}));
+  EXPECT_TRUE(wrap_result.ok()) << wrap_result.status();
+  auto saead = std::move(wrap_result.ValueOrDie());
+
+  // Encryption uses the primary primitive.
+  std::string ciphertext(
+      saead_name_1.size() + aad.size() + plaintext.size(), '\0');
+  EXPECT_THAT(saead->EncryptBuffer(plaintext, aad, &ciphertext[0],
+                                   ciphertext.size()), IsOk());
+  EXPECT_EQ(absl::StrCat(saead_name_1, aad, plaintext), ciphertext);
+
+  // Decryption works with any of the primitives.
+  for (const std::string& ct : {ciphertext, absl::StrCat(saead_name_0, aad,
+                                                         plaintext)}) {
+    std::string decrypted(ct.size(), '\0');
+    auto decrypt_result =
+        saead->DecryptBuffer(ct, aad, &decrypted[0], decrypted.size());
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    decrypted.resize(decrypt_result.ValueOrDie());
+    EXPECT_EQ(plaintext, decrypted);
+
+    EXPECT_THAT(saead->DecryptBuffer(ct, "other aad", &decrypted[0],
+                                     decrypted.size()).status(),
+                StatusIs(util::error::INVALID_ARGUMENT,
+                         HasSubstr("decryption failed")));
+    EXPECT_THAT(saead->DecryptBuffer(ct, aad, &decrypted[0],
+                                     plaintext.size() - 1).status(),
+                StatusIs(util::error::RESOURCE_EXHAUSTED,
+                         HasSubstr("plaintext_capacity too small")));
+  }
+}
+
 TEST(StreamingAeadSetWrapperTest, MissingRawPrimitives) {
   uint32_t key_id_0 = 1234543;
   uint32_t key_id_1 = 726329;
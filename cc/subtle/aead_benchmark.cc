@@ -0,0 +1,171 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the AEAD and deterministic AEAD primitives.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "tink/aead.h"
+#include "tink/deterministic_aead.h"
+#include "tink/subtle/aes_ctr_boringssl.h"
+#include "tink/subtle/aes_eax_boringssl.h"
+#include "tink/subtle/aes_gcm_boringssl.h"
+#include "tink/subtle/aes_gcm_siv_boringssl.h"
+#include "tink/subtle/aes_siv_boringssl.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/encrypt_then_authenticate.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/xchacha20_poly1305_boringssl.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::MessageSizes;
+using crypto::tink::test::SetThroughput;
+
+typedef util::StatusOr<std::unique_ptr<Aead>> (*AeadFactory)();
+typedef util::StatusOr<std::unique_ptr<DeterministicAead>> (*DaeadFactory)();
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesGcm128() {
+  return AesGcmBoringSsl::New(Random::GetRandomBytes(16));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesGcm256() {
+  return AesGcmBoringSsl::New(Random::GetRandomBytes(32));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesGcmSiv128() {
+  return AesGcmSivBoringSsl::New(Random::GetRandomBytes(16));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesGcmSiv256() {
+  return AesGcmSivBoringSsl::New(Random::GetRandomBytes(32));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesEax128() {
+  return AesEaxBoringSsl::New(Random::GetRandomBytes(16), 16);
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewXChaCha20Poly1305() {
+  return XChacha20Poly1305BoringSsl::New(Random::GetRandomBytes(32));
+}
+
+// AES128-CTR-HMAC-SHA256, with the parameters of the Tink key template.
+util::StatusOr<std::unique_ptr<Aead>> NewAesCtrHmac128() {
+  auto cipher_result = AesCtrBoringSsl::New(Random::GetRandomBytes(16), 16);
+  if (!cipher_result.ok()) return cipher_result.status();
+  auto mac_result =
+      HmacBoringSsl::New(HashType::SHA256, 16, Random::GetRandomBytes(32));
+  if (!mac_result.ok()) return mac_result.status();
+  return EncryptThenAuthenticate::New(std::move(cipher_result.ValueOrDie()),
+                                      std::move(mac_result.ValueOrDie()), 16);
+}
+
+util::StatusOr<std::unique_ptr<DeterministicAead>> NewAesSiv() {
+  return AesSivBoringSsl::New(Random::GetRandomBytes(64));
+}
+
+void BM_AeadEncrypt(benchmark::State& state, AeadFactory factory) {
+  auto aead_result = factory();
+  if (!CheckOk(aead_result.status(), &state)) return;
+  const Aead& aead = *aead_result.ValueOrDie();
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  std::string associated_data = Random::GetRandomBytes(16);
+  for (auto _ : state) {
+    auto encrypt_result = aead.Encrypt(plaintext, associated_data);
+    if (!CheckOk(encrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(encrypt_result.ValueOrDie().data());
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+void BM_AeadDecrypt(benchmark::State& state, AeadFactory factory) {
+  auto aead_result = factory();
+  if (!CheckOk(aead_result.status(), &state)) return;
+  const Aead& aead = *aead_result.ValueOrDie();
+  std::string associated_data = Random::GetRandomBytes(16);
+  auto encrypt_result =
+      aead.Encrypt(Random::GetRandomBytes(state.range(0)), associated_data);
+  if (!CheckOk(encrypt_result.status(), &state)) return;
+  const std::string& ciphertext = encrypt_result.ValueOrDie();
+  for (auto _ : state) {
+    auto decrypt_result = aead.Decrypt(ciphertext, associated_data);
+    if (!CheckOk(decrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(decrypt_result.ValueOrDie().data());
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+void BM_DaeadEncrypt(benchmark::State& state, DaeadFactory factory) {
+  auto daead_result = factory();
+  if (!CheckOk(daead_result.status(), &state)) return;
+  const DeterministicAead& daead = *daead_result.ValueOrDie();
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  std::string associated_data = Random::GetRandomBytes(16);
+  for (auto _ : state) {
+    auto encrypt_result =
+        daead.EncryptDeterministically(plaintext, associated_data);
+    if (!CheckOk(encrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(encrypt_result.ValueOrDie().data());
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+void BM_DaeadDecrypt(benchmark::State& state, DaeadFactory factory) {
+  auto daead_result = factory();
+  if (!CheckOk(daead_result.status(), &state)) return;
+  const DeterministicAead& daead = *daead_result.ValueOrDie();
+  std::string associated_data = Random::GetRandomBytes(16);
+  auto encrypt_result = daead.EncryptDeterministically(
+      Random::GetRandomBytes(state.range(0)), associated_data);
+  if (!CheckOk(encrypt_result.status(), &state)) return;
+  const std::string& ciphertext = encrypt_result.ValueOrDie();
+  for (auto _ : state) {
+    auto decrypt_result =
+        daead.DecryptDeterministically(ciphertext, associated_data);
+    if (!CheckOk(decrypt_result.status(), &state)) break;
+    benchmark::DoNotOptimize(decrypt_result.ValueOrDie().data());
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+#define TINK_AEAD_BENCHMARKS(name, factory)                               \
+  BENCHMARK_CAPTURE(BM_AeadEncrypt, name, factory)->Apply(MessageSizes); \
+  BENCHMARK_CAPTURE(BM_AeadDecrypt, name, factory)->Apply(MessageSizes)
+
+TINK_AEAD_BENCHMARKS(AesGcm128, NewAesGcm128);
+TINK_AEAD_BENCHMARKS(AesGcm256, NewAesGcm256);
+TINK_AEAD_BENCHMARKS(AesGcmSiv128, NewAesGcmSiv128);
+TINK_AEAD_BENCHMARKS(AesGcmSiv256, NewAesGcmSiv256);
+TINK_AEAD_BENCHMARKS(AesEax128, NewAesEax128);
+TINK_AEAD_BENCHMARKS(XChaCha20Poly1305, NewXChaCha20Poly1305);
+TINK_AEAD_BENCHMARKS(AesCtrHmac128, NewAesCtrHmac128);
+
+BENCHMARK_CAPTURE(BM_DaeadEncrypt, AesSiv, NewAesSiv)->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_DaeadDecrypt, AesSiv, NewAesSiv)->Apply(MessageSizes);
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -17,7 +17,6 @@
 #include "tink/subtle/aes_gcm_boringssl.h"
 
 #include <string>
-#include <vector>
 
 #include "tink/aead.h"
 #include "tink/subtle/random.h"
@@ -69,21 +68,23 @@ util::StatusOr<std::unique_ptr<Aead>> AesGcmBoringSsl::New(
 
 util::StatusOr<std::string> AesGcmBoringSsl::Encrypt(
     absl::string_view plaintext, absl::string_view additional_data) const {
-  const std::string iv = Random::GetRandomBytes(IV_SIZE_IN_BYTES);
-  // TODO(bleichen): Check if it is OK to work on a std::string.
-  //   This is unclear since some compiler may use copy-on-write.
-  std::vector<uint8_t> ct(iv.size() + plaintext.size() + TAG_SIZE_IN_BYTES);
-  memcpy(ct.data(), iv.data(), iv.size());
+  // The ciphertext is sealed directly into the result, after the IV,
+  // so that the only allocation is that of the result.  (C++11 strings
+  // are contiguous and not copy-on-write.)
+  std::string ct = Random::GetRandomBytes(IV_SIZE_IN_BYTES);
+  ct.resize(IV_SIZE_IN_BYTES + plaintext.size() + TAG_SIZE_IN_BYTES);
+  uint8_t* ct_data = reinterpret_cast<uint8_t*>(&ct[0]);
   size_t len;
   if (EVP_AEAD_CTX_seal(
-          ctx_.get(), ct.data() + iv.size(), &len, ct.size() - iv.size(),
-          reinterpret_cast<const uint8_t*>(iv.data()), iv.size(),
+          ctx_.get(), ct_data + IV_SIZE_IN_BYTES, &len,
+          ct.size() - IV_SIZE_IN_BYTES, ct_data, IV_SIZE_IN_BYTES,
           reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
           reinterpret_cast<const uint8_t*>(additional_data.data()),
           additional_data.size()) != 1) {
     return util::Status(util::error::INTERNAL, "Encryption failed");
   }
-  return std::string(reinterpret_cast<const char*>(ct.data()), iv.size() + len);
+  ct.resize(IV_SIZE_IN_BYTES + len);
+  return std::move(ct);
 }
 
 util::StatusOr<std::string> AesGcmBoringSsl::Decrypt(
@@ -92,11 +93,11 @@ util::StatusOr<std::string> AesGcmBoringSsl::Decrypt(
     return util::Status(util::error::INTERNAL, "Ciphertext too short");
   }
 
-  std::vector<uint8_t> pt(ciphertext.size() - IV_SIZE_IN_BYTES -
-                          TAG_SIZE_IN_BYTES);
+  std::string pt(ciphertext.size() - IV_SIZE_IN_BYTES - TAG_SIZE_IN_BYTES,
+                 '\0');
   size_t len;
   if (EVP_AEAD_CTX_open(
-          ctx_.get(), pt.data(), &len, pt.size(),
+          ctx_.get(), reinterpret_cast<uint8_t*>(&pt[0]), &len, pt.size(),
           // The nonce is the first |IV_SIZE_IN_BYTES| bytes of |ciphertext|.
           reinterpret_cast<const uint8_t*>(ciphertext.data()), IV_SIZE_IN_BYTES,
           // The input is the remainder.
@@ -107,7 +108,8 @@ util::StatusOr<std::string> AesGcmBoringSsl::Decrypt(
           additional_data.size()) != 1) {
     return util::Status(util::error::INTERNAL, "Authentication failed");
   }
-  return std::string(reinterpret_cast<const char*>(pt.data()), len);
+  pt.resize(len);
+  return std::move(pt);
 }
 
 }  // namespace subtle
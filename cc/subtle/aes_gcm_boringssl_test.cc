@@ -22,9 +22,12 @@
 #include "absl/strings/str_cat.h"
 #include "include/rapidjson/document.h"
 #include "tink/subtle/wycheproof_util.h"
+#include "tink/util/allocation_matchers.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "openssl/err.h"
 
@@ -34,6 +37,8 @@ namespace tink {
 namespace subtle {
 namespace {
 
+using crypto::tink::test::AllocatesAtMost;
+
 TEST(AesGcmBoringSslTest, testBasic) {
   std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   auto res = AesGcmBoringSsl::New(key);
@@ -49,6 +54,22 @@ TEST(AesGcmBoringSslTest, testBasic) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
+TEST(AesGcmBoringSslTest, Allocations) {
+  std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = AesGcmBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+  auto ct = cipher->Encrypt(message, aad);
+  ASSERT_TRUE(ct.ok()) << ct.status();
+  std::string ciphertext = ct.ValueOrDie();
+  // The result is the only allocation.
+  EXPECT_THAT([&]() { cipher->Encrypt(message, aad); }, AllocatesAtMost(1));
+  EXPECT_THAT([&]() { cipher->Decrypt(ciphertext, aad); },
+              AllocatesAtMost(1));
+}
+
 TEST(AesGcmBoringSslTest, testModification) {
   std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   auto cipher = std::move(AesGcmBoringSsl::New(key).ValueOrDie());
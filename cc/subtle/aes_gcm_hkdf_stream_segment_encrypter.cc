@@ -132,6 +132,21 @@ util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegment(
     const std::vector<uint8_t>& plaintext,
     bool is_last_segment,
     std::vector<uint8_t>* ciphertext_buffer) {
+  auto status = EncryptSegmentAt(
+      get_segment_number(),
+      absl::string_view(reinterpret_cast<const char*>(plaintext.data()),
+                        plaintext.size()),
+      is_last_segment, ciphertext_buffer);
+  if (!status.ok()) return status;
+  IncSegmentNumber();
+  return util::OkStatus();
+}
+
+util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegmentAt(
+    int64_t segment_number,
+    absl::string_view plaintext,
+    bool is_last_segment,
+    std::vector<uint8_t>* ciphertext_buffer) const {
   if (plaintext.size() > get_plaintext_segment_size()) {
     return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
   }
@@ -139,8 +154,9 @@ util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegment(
     return util::Status(util::error::INVALID_ARGUMENT,
                         "ciphertext_buffer must be non-null");
   }
-  if (get_segment_number() > std::numeric_limits<uint32_t>::max() ||
-      (get_segment_number() == std::numeric_limits<uint32_t>::max() &&
+  if (segment_number < 0 ||
+      segment_number > std::numeric_limits<uint32_t>::max() ||
+      (segment_number == std::numeric_limits<uint32_t>::max() &&
        !is_last_segment)) {
     return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
   }
@@ -152,24 +168,23 @@ util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegment(
   std::vector<uint8_t> iv(kNonceSizeInBytes);
   memcpy(iv.data(), nonce_prefix_.data(), kNoncePrefixSizeInBytes);
   BigEndianStore32(iv.data() + kNoncePrefixSizeInBytes,
-                   static_cast<uint32_t>(get_segment_number()));
+                   static_cast<uint32_t>(segment_number));
   iv.back() = is_last_segment ? 1 : 0;
   size_t out_len;
   if (!EVP_AEAD_CTX_seal(
           ctx_.get(), ciphertext_buffer->data(), &out_len,
           ciphertext_buffer->size(),
           iv.data(), iv.size(),
-          plaintext.data(), plaintext.size(),
+          reinterpret_cast<const uint8_t*>(plaintext.data()),
+          plaintext.size(),
           /* ad = */ nullptr, /* ad.length() = */ 0)) {
     return util::Status(util::error::INTERNAL,
                         absl::StrCat("Encryption failed: ",
                                      SubtleUtilBoringSSL::GetErrors()));
   }
-  IncSegmentNumber();
   return util::OkStatus();
 }
 
-
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
@@ -87,6 +87,12 @@ class AesGcmHkdfStreamSegmentEncrypter : public StreamSegmentEncrypter {
       bool is_last_segment,
       std::vector<uint8_t>* ciphertext_buffer) override;
 
+  util::Status EncryptSegmentAt(
+      int64_t segment_number,
+      absl::string_view plaintext,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override;
+
   const std::vector<uint8_t>& get_header() const override {
     return header_;
   }
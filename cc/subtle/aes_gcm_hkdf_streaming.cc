@@ -25,6 +25,7 @@
 #include "tink/subtle/random.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/subtle/streaming_aead_buffer_crypter.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -100,6 +101,22 @@ AesGcmHkdfStreaming::NewSegmentEncrypter(
   return AesGcmHkdfStreamSegmentEncrypter::New(params);
 }
 
+StatusOr<int64_t> AesGcmHkdfStreaming::GetCiphertextSize(
+    int64_t plaintext_size) {
+  if (plaintext_size < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "plaintext_size must be non-negative");
+  }
+  // The header consists of its size, the salt and the nonce prefix.
+  int header_size = 1 + derived_key_size_ +
+      AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes;
+  return StreamingAeadBufferCrypter::GetCiphertextSize(
+      header_size, ciphertext_offset_,
+      ciphertext_segment_size_ -
+          AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes,
+      ciphertext_segment_size_, plaintext_size);
+}
+
 StatusOr<std::unique_ptr<StreamSegmentDecrypter>>
 AesGcmHkdfStreaming::NewSegmentDecrypter(
     absl::string_view associated_data) const {
@@ -43,6 +43,9 @@ class AesGcmHkdfStreaming : public NonceBasedStreamingAead {
 
   ~AesGcmHkdfStreaming() override {}
 
+  crypto::tink::util::StatusOr<int64_t> GetCiphertextSize(
+      int64_t plaintext_size) override;
+
  protected:
   crypto::tink::util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
   NewSegmentEncrypter(absl::string_view associated_data) const override;
@@ -91,6 +91,9 @@ TEST(AesGcmHkdfStreamingTest, testBasic) {
               EXPECT_EQ(pt_size, enc_stream->Position());
               std::string ct = ct_buf->str();
               EXPECT_NE(ct, pt);
+              auto ct_size_result = streaming_aead->GetCiphertextSize(pt_size);
+              EXPECT_TRUE(ct_size_result.ok()) << ct_size_result.status();
+              EXPECT_EQ(ct.size(), ct_size_result.ValueOrDie());
 
               // Use AesGcmHkdfStreaming to decrypt the resulting ciphertext.
               auto ct_bytes = absl::make_unique<std::stringstream>(std::string(ct));
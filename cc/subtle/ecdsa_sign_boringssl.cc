@@ -16,7 +16,7 @@
 
 #include "tink/subtle/ecdsa_sign_boringssl.h"
 
-#include <vector>
+#include <string>
 
 #include "absl/strings/str_cat.h"
 #include "tink/subtle/common_enums.h"
@@ -133,23 +133,25 @@ util::StatusOr<std::string> EcdsaSignBoringSsl::Sign(
   }
 
   // Compute the signature.
-  std::vector<uint8_t> buffer(ECDSA_size(key_.get()));
+  // The (DER-encoded) signature is written directly into the result.
+  std::string signature(ECDSA_size(key_.get()), '\0');
   unsigned int sig_length;
-  if (1 != ECDSA_sign(0 /* unused */, digest, digest_size, buffer.data(),
-                  &sig_length, key_.get())) {
+  if (1 != ECDSA_sign(0 /* unused */, digest, digest_size,
+                      reinterpret_cast<uint8_t*>(&signature[0]), &sig_length,
+                      key_.get())) {
     return util::Status(util::error::INTERNAL, "Signing failed.");
   }
+  signature.resize(sig_length);
 
   if (encoding_ == subtle::EcdsaSignatureEncoding::IEEE_P1363) {
-    auto status_or_sig = DerToIeee(
-        std::string(reinterpret_cast<char*>(buffer.data()), sig_length), key_.get());
+    auto status_or_sig = DerToIeee(signature, key_.get());
     if (!status_or_sig.ok()) {
       return status_or_sig.status();
     }
     return status_or_sig.ValueOrDie();
   }
 
-  return std::string(reinterpret_cast<char*>(buffer.data()), sig_length);
+  return std::move(signature);
 }
 
 }  // namespace subtle
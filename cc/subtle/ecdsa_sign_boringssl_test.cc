@@ -18,6 +18,7 @@
 
 #include <string>
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tink/public_key_sign.h"
 #include "tink/public_key_verify.h"
@@ -25,8 +26,10 @@
 #include "tink/subtle/ec_util.h"
 #include "tink/subtle/ecdsa_verify_boringssl.h"
 #include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/allocation_matchers.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
 
 namespace crypto {
@@ -34,6 +37,8 @@ namespace tink {
 namespace subtle {
 namespace {
 
+using crypto::tink::test::AllocatesAtMost;
+
 class EcdsaSignBoringSslTest : public ::testing::Test {
 };
 
@@ -74,6 +79,18 @@ TEST_F(EcdsaSignBoringSslTest, testBasicSigning) {
   }
 }
 
+TEST_F(EcdsaSignBoringSslTest, Allocations) {
+  auto ec_key = SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P256)
+                    .ValueOrDie();
+  auto signer_result = EcdsaSignBoringSsl::New(ec_key, HashType::SHA256,
+                                               EcdsaSignatureEncoding::DER);
+  ASSERT_TRUE(signer_result.ok()) << signer_result.status();
+  auto signer = std::move(signer_result.ValueOrDie());
+  std::string message = "some data to be signed";
+  // A DER signature is written directly into the returned string.
+  EXPECT_THAT([&]() { signer->Sign(message); }, AllocatesAtMost(1));
+}
+
 TEST_F(EcdsaSignBoringSslTest, testEncodingsMismatch) {
   subtle::EcdsaSignatureEncoding encodings[2] = {
       EcdsaSignatureEncoding::DER, EcdsaSignatureEncoding::IEEE_P1363};
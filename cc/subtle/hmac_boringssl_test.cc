@@ -20,9 +20,12 @@
 
 #include "tink/mac.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/util/allocation_matchers.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 
 namespace crypto {
@@ -30,6 +33,9 @@ namespace tink {
 namespace subtle {
 namespace {
 
+using crypto::tink::test::AllocatesAtMost;
+using crypto::tink::test::DoesNotAllocate;
+
 class HmacBoringSslTest : public ::testing::Test {
  public:
   // Utility to simplify testing with test vectors.
@@ -78,6 +84,20 @@ TEST_F(HmacBoringSslTest, testBasic) {
   }
 }
 
+TEST_F(HmacBoringSslTest, Allocations) {
+  std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto hmac_result = HmacBoringSsl::New(HashType::SHA256, 32, key);
+  ASSERT_TRUE(hmac_result.ok()) << hmac_result.status();
+  auto hmac = std::move(hmac_result.ValueOrDie());
+  std::string data = "Some data to test.";
+  auto res = hmac->ComputeMac(data);
+  ASSERT_TRUE(res.ok()) << res.status();
+  std::string tag = res.ValueOrDie();
+  // Computing allocates only the tag, and verifying nothing.
+  EXPECT_THAT([&]() { hmac->ComputeMac(data); }, AllocatesAtMost(1));
+  EXPECT_THAT([&]() { hmac->VerifyMac(tag, data); }, DoesNotAllocate());
+}
+
 TEST_F(HmacBoringSslTest, testModification) {
   std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   auto hmac_result = HmacBoringSsl::New(HashType::SHA1, 16, key);
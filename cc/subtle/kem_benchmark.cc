@@ -0,0 +1,93 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the ECIES-HKDF key encapsulation, i.e. of the public key
+// operations of ECIES-AEAD-HKDF hybrid encryption.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/ecies_hkdf_recipient_kem_boringssl.h"
+#include "tink/subtle/ecies_hkdf_sender_kem_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/benchmark_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::test::CheckOk;
+
+constexpr int kKeySize = 32;
+
+void BM_KemEncapsulate(benchmark::State& state, EllipticCurveType curve) {
+  auto key_result = SubtleUtilBoringSSL::GetNewEcKey(curve);
+  if (!CheckOk(key_result.status(), &state)) return;
+  const auto& key = key_result.ValueOrDie();
+  auto sender_result =
+      EciesHkdfSenderKemBoringSsl::New(curve, key.pub_x, key.pub_y);
+  if (!CheckOk(sender_result.status(), &state)) return;
+  const auto& sender = *sender_result.ValueOrDie();
+  std::string salt = Random::GetRandomBytes(16);
+  std::string info = Random::GetRandomBytes(16);
+  for (auto _ : state) {
+    auto kem_result = sender.GenerateKey(HashType::SHA256, salt, info,
+                                         kKeySize, EcPointFormat::UNCOMPRESSED);
+    if (!CheckOk(kem_result.status(), &state)) break;
+    benchmark::DoNotOptimize(kem_result.ValueOrDie().get());
+  }
+}
+
+void BM_KemDecapsulate(benchmark::State& state, EllipticCurveType curve) {
+  auto key_result = SubtleUtilBoringSSL::GetNewEcKey(curve);
+  if (!CheckOk(key_result.status(), &state)) return;
+  const auto& key = key_result.ValueOrDie();
+  auto sender_result =
+      EciesHkdfSenderKemBoringSsl::New(curve, key.pub_x, key.pub_y);
+  if (!CheckOk(sender_result.status(), &state)) return;
+  auto recipient_result = EciesHkdfRecipientKemBoringSsl::New(curve, key.priv);
+  if (!CheckOk(recipient_result.status(), &state)) return;
+  const auto& recipient = *recipient_result.ValueOrDie();
+  std::string salt = Random::GetRandomBytes(16);
+  std::string info = Random::GetRandomBytes(16);
+  auto kem_result = sender_result.ValueOrDie()->GenerateKey(
+      HashType::SHA256, salt, info, kKeySize, EcPointFormat::UNCOMPRESSED);
+  if (!CheckOk(kem_result.status(), &state)) return;
+  std::string kem_bytes = kem_result.ValueOrDie()->get_kem_bytes();
+  for (auto _ : state) {
+    auto decap_result =
+        recipient.GenerateKey(kem_bytes, HashType::SHA256, salt, info,
+                              kKeySize, EcPointFormat::UNCOMPRESSED);
+    if (!CheckOk(decap_result.status(), &state)) break;
+    benchmark::DoNotOptimize(decap_result.ValueOrDie().data());
+  }
+}
+
+BENCHMARK_CAPTURE(BM_KemEncapsulate, P256, EllipticCurveType::NIST_P256);
+BENCHMARK_CAPTURE(BM_KemEncapsulate, P384, EllipticCurveType::NIST_P384);
+BENCHMARK_CAPTURE(BM_KemEncapsulate, P521, EllipticCurveType::NIST_P521);
+BENCHMARK_CAPTURE(BM_KemDecapsulate, P256, EllipticCurveType::NIST_P256);
+BENCHMARK_CAPTURE(BM_KemDecapsulate, P384, EllipticCurveType::NIST_P384);
+BENCHMARK_CAPTURE(BM_KemDecapsulate, P521, EllipticCurveType::NIST_P521);
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
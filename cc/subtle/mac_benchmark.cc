@@ -0,0 +1,102 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of HMAC and HKDF.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "tink/mac.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/benchmark_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::test::CheckOk;
+using crypto::tink::test::MessageSizes;
+using crypto::tink::test::SetThroughput;
+
+// Returns an HMAC with a key and a tag as long as the output of 'hash'.
+util::StatusOr<std::unique_ptr<Mac>> NewHmac(HashType hash) {
+  int size = hash == HashType::SHA1 ? 20 : hash == HashType::SHA256 ? 32 : 64;
+  return HmacBoringSsl::New(hash, size, Random::GetRandomBytes(size));
+}
+
+void BM_HmacCompute(benchmark::State& state, HashType hash) {
+  auto mac_result = NewHmac(hash);
+  if (!CheckOk(mac_result.status(), &state)) return;
+  const Mac& mac = *mac_result.ValueOrDie();
+  std::string data = Random::GetRandomBytes(state.range(0));
+  for (auto _ : state) {
+    auto compute_result = mac.ComputeMac(data);
+    if (!CheckOk(compute_result.status(), &state)) break;
+    benchmark::DoNotOptimize(compute_result.ValueOrDie().data());
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+void BM_HmacVerify(benchmark::State& state, HashType hash) {
+  auto mac_result = NewHmac(hash);
+  if (!CheckOk(mac_result.status(), &state)) return;
+  const Mac& mac = *mac_result.ValueOrDie();
+  std::string data = Random::GetRandomBytes(state.range(0));
+  auto compute_result = mac.ComputeMac(data);
+  if (!CheckOk(compute_result.status(), &state)) return;
+  const std::string& tag = compute_result.ValueOrDie();
+  for (auto _ : state) {
+    if (!CheckOk(mac.VerifyMac(tag, data), &state)) break;
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+// Derives a 32-byte key from an input keying material of state.range(0)
+// bytes.
+void BM_Hkdf(benchmark::State& state, HashType hash) {
+  std::string ikm = Random::GetRandomBytes(state.range(0));
+  std::string salt = Random::GetRandomBytes(16);
+  std::string info = Random::GetRandomBytes(16);
+  for (auto _ : state) {
+    auto hkdf_result = Hkdf::ComputeHkdf(hash, ikm, salt, info, 32);
+    if (!CheckOk(hkdf_result.status(), &state)) break;
+    benchmark::DoNotOptimize(hkdf_result.ValueOrDie().data());
+  }
+  SetThroughput(state.range(0), &state);
+}
+
+BENCHMARK_CAPTURE(BM_HmacCompute, Sha1, HashType::SHA1)->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_HmacCompute, Sha256, HashType::SHA256)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_HmacCompute, Sha512, HashType::SHA512)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_HmacVerify, Sha1, HashType::SHA1)->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_HmacVerify, Sha256, HashType::SHA256)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_HmacVerify, Sha512, HashType::SHA512)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_Hkdf, Sha256, HashType::SHA256)->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_Hkdf, Sha512, HashType::SHA512)->Apply(MessageSizes);
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -20,12 +20,17 @@
 #include "tink/input_stream.h"
 #include "tink/random_access_stream.h"
 #include "tink/output_stream.h"
+#include "tink/segmented_ciphertext_writer.h"
 #include "tink/streaming_aead.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/subtle/streaming_aead_buffer_crypter.h"
 #include "tink/subtle/streaming_aead_decrypting_stream.h"
 #include "tink/subtle/streaming_aead_encrypting_stream.h"
+#include "tink/subtle/streaming_aead_segmented_writer.h"
+#include "tink/subtle/streaming_aead_verifier.h"
 #include "tink/util/statusor.h"
+#include "tink/util/thread_pool.h"
 
 namespace crypto {
 namespace tink {
@@ -60,6 +65,73 @@ crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::RandomAccessStream>>
   return util::Status(util::error::UNIMPLEMENTED, "not implemented yet");
 }
 
+crypto::tink::util::StatusOr<StreamingAead::VerificationResult>
+    NonceBasedStreamingAead::VerifyStream(
+        std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+        absl::string_view associated_data) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return StreamingAeadVerifier::VerifyStream(
+      std::move(segment_decrypter_result.ValueOrDie()),
+      std::move(ciphertext_source), util::ThreadPool::DefaultNumThreads());
+}
+
+crypto::tink::util::StatusOr<StreamingAead::VerificationResult>
+    NonceBasedStreamingAead::VerifyRandomAccessStream(
+        std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+        absl::string_view associated_data) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return StreamingAeadVerifier::VerifyRandomAccessStream(
+      std::move(segment_decrypter_result.ValueOrDie()),
+      std::move(ciphertext_source), util::ThreadPool::DefaultNumThreads());
+}
+
+crypto::tink::util::StatusOr<int64_t>
+    NonceBasedStreamingAead::GetCiphertextSize(int64_t plaintext_size) {
+  if (plaintext_size < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "plaintext_size must be non-negative");
+  }
+  auto segment_encrypter_result = NewSegmentEncrypter("");
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return StreamingAeadBufferCrypter::GetCiphertextSize(
+      *segment_encrypter_result.ValueOrDie(), plaintext_size);
+}
+
+crypto::tink::util::Status NonceBasedStreamingAead::EncryptBuffer(
+    absl::string_view plaintext,
+    absl::string_view associated_data,
+    char* ciphertext, int64_t ciphertext_size) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return StreamingAeadBufferCrypter::Encrypt(
+      std::move(segment_encrypter_result.ValueOrDie()), plaintext,
+      ciphertext, ciphertext_size, util::ThreadPool::DefaultNumThreads());
+}
+
+crypto::tink::util::StatusOr<int64_t> NonceBasedStreamingAead::DecryptBuffer(
+    absl::string_view ciphertext,
+    absl::string_view associated_data,
+    char* plaintext, int64_t plaintext_capacity) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return StreamingAeadBufferCrypter::Decrypt(
+      std::move(segment_decrypter_result.ValueOrDie()), ciphertext,
+      plaintext, plaintext_capacity, util::ThreadPool::DefaultNumThreads());
+}
+
+crypto::tink::util::StatusOr<
+    std::unique_ptr<crypto::tink::SegmentedCiphertextWriter>>
+    NonceBasedStreamingAead::NewSegmentedCiphertextWriter(
+        int ciphertext_fd,
+        absl::string_view associated_data) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return StreamingAeadSegmentedWriter::New(
+      std::move(segment_encrypter_result.ValueOrDie()), ciphertext_fd);
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
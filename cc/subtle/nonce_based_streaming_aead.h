@@ -21,6 +21,7 @@
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/random_access_stream.h"
+#include "tink/segmented_ciphertext_writer.h"
 #include "tink/streaming_aead.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
@@ -54,6 +55,44 @@ class NonceBasedStreamingAead : public StreamingAead {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data) override;
 
+  // Verifies the segments of the ciphertext in parallel, using as many
+  // threads as there are cores available.
+  crypto::tink::util::StatusOr<VerificationResult>
+  VerifyStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<VerificationResult>
+  VerifyRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  // Creates a segment encrypter to learn the sizes of the header and the
+  // segments; subclasses should override this to compute the size from
+  // their parameters instead.
+  crypto::tink::util::StatusOr<int64_t> GetCiphertextSize(
+      int64_t plaintext_size) override;
+
+  // Encrypts the segments in parallel, using as many threads
+  // as there are cores available.
+  crypto::tink::util::Status EncryptBuffer(
+      absl::string_view plaintext,
+      absl::string_view associated_data,
+      char* ciphertext, int64_t ciphertext_size) override;
+
+  // Decrypts the segments in parallel, using as many threads
+  // as there are cores available.
+  crypto::tink::util::StatusOr<int64_t> DecryptBuffer(
+      absl::string_view ciphertext,
+      absl::string_view associated_data,
+      char* plaintext, int64_t plaintext_capacity) override;
+
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::SegmentedCiphertextWriter>>
+  NewSegmentedCiphertextWriter(
+      int ciphertext_fd,
+      absl::string_view associated_data) override;
+
  protected:
   // -----------------------
   // Methods to be implemented by a subclass of this class.
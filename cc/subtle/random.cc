@@ -24,12 +24,14 @@ namespace subtle {
 
 // static
 std::string Random::GetRandomBytes(size_t length) {
-  std::unique_ptr<uint8_t[]> buf(new uint8_t[length]);
+  // The bytes are written directly into the result, so that short results
+  // (which fit into the string itself) need no allocation at all.
+  std::string bytes(length, '\0');
   // BoringSSL documentation says that it always returns 1; while
   // OpenSSL documentation says that it returns 1 on success, 0 otherwise. We
   // use BoringSSL, so we don't check the return value.
-  RAND_bytes(buf.get(), length);
-  return std::string(reinterpret_cast<const char *>(buf.get()), length);
+  RAND_bytes(reinterpret_cast<uint8_t *>(&bytes[0]), length);
+  return bytes;
 }
 
 }  // namespace subtle
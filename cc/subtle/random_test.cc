@@ -15,13 +15,19 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "tink/subtle/random.h"
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "tink/util/allocation_matchers.h"
+#include "tink/util/test_matchers.h"
 
 namespace crypto {
 namespace tink {
 namespace subtle {
 namespace {
 
+using crypto::tink::test::AllocatesAtMost;
+using crypto::tink::test::DoesNotAllocate;
+
 class RandomTest : public ::testing::Test {};
 
 TEST_F(RandomTest, testBasic) {
@@ -35,6 +41,13 @@ TEST_F(RandomTest, testBasic) {
   EXPECT_EQ(numTests, rand_strings.size());
 }
 
+TEST_F(RandomTest, Allocations) {
+  // The bytes are generated into the result, whose buffer is the only
+  // allocation; short results fit into the string itself.
+  EXPECT_THAT([]() { Random::GetRandomBytes(100); }, AllocatesAtMost(1));
+  EXPECT_THAT([]() { Random::GetRandomBytes(12); }, DoesNotAllocate());
+}
+
 }  // namespace
 }  // namespace subtle
 }  // namespace tink
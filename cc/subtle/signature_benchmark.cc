@@ -0,0 +1,175 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the signature primitives.  Signing and verifying hash
+// the message first, so these use a short message of fixed size.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/string_view.h"
+#include "openssl/base.h"
+#include "openssl/bn.h"
+#include "openssl/curve25519.h"
+#include "openssl/rsa.h"
+#include "tink/public_key_sign.h"
+#include "tink/public_key_verify.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/ecdsa_sign_boringssl.h"
+#include "tink/subtle/ecdsa_verify_boringssl.h"
+#include "tink/subtle/ed25519_sign_boringssl.h"
+#include "tink/subtle/ed25519_verify_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/rsa_ssa_pkcs1_sign_boringssl.h"
+#include "tink/subtle/rsa_ssa_pkcs1_verify_boringssl.h"
+#include "tink/subtle/rsa_ssa_pss_sign_boringssl.h"
+#include "tink/subtle/rsa_ssa_pss_verify_boringssl.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/benchmark_util.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::test::CheckOk;
+
+constexpr int kMessageSize = 64;
+
+// Creates a signer and a verifier for a freshly generated key pair.
+typedef util::Status (*SignatureFactory)(
+    std::unique_ptr<PublicKeySign>* signer,
+    std::unique_ptr<PublicKeyVerify>* verifier);
+
+template <EllipticCurveType curve, HashType hash>
+util::Status NewEcdsa(std::unique_ptr<PublicKeySign>* signer,
+                      std::unique_ptr<PublicKeyVerify>* verifier) {
+  auto key_result = SubtleUtilBoringSSL::GetNewEcKey(curve);
+  if (!key_result.ok()) return key_result.status();
+  const auto& key = key_result.ValueOrDie();
+  auto signer_result =
+      EcdsaSignBoringSsl::New(key, hash, EcdsaSignatureEncoding::DER);
+  if (!signer_result.ok()) return signer_result.status();
+  auto verifier_result =
+      EcdsaVerifyBoringSsl::New(key, hash, EcdsaSignatureEncoding::DER);
+  if (!verifier_result.ok()) return verifier_result.status();
+  *signer = std::move(signer_result.ValueOrDie());
+  *verifier = std::move(verifier_result.ValueOrDie());
+  return util::Status::OK;
+}
+
+util::Status NewEd25519(std::unique_ptr<PublicKeySign>* signer,
+                        std::unique_ptr<PublicKeyVerify>* verifier) {
+  uint8_t public_key[ED25519_PUBLIC_KEY_LEN];
+  uint8_t private_key[ED25519_PRIVATE_KEY_LEN];
+  ED25519_keypair(public_key, private_key);
+  auto signer_result = Ed25519SignBoringSsl::New(absl::string_view(
+      reinterpret_cast<const char*>(private_key), ED25519_PRIVATE_KEY_LEN));
+  if (!signer_result.ok()) return signer_result.status();
+  auto verifier_result = Ed25519VerifyBoringSsl::New(absl::string_view(
+      reinterpret_cast<const char*>(public_key), ED25519_PUBLIC_KEY_LEN));
+  if (!verifier_result.ok()) return verifier_result.status();
+  *signer = std::move(signer_result.ValueOrDie());
+  *verifier = std::move(verifier_result.ValueOrDie());
+  return util::Status::OK;
+}
+
+util::Status NewRsaKeyPair(SubtleUtilBoringSSL::RsaPrivateKey* private_key,
+                           SubtleUtilBoringSSL::RsaPublicKey* public_key) {
+  bssl::UniquePtr<BIGNUM> e(BN_new());
+  BN_set_u64(e.get(), RSA_F4);
+  return SubtleUtilBoringSSL::GetNewRsaKeyPair(3072, e.get(), private_key,
+                                               public_key);
+}
+
+util::Status NewRsaSsaPkcs1(std::unique_ptr<PublicKeySign>* signer,
+                            std::unique_ptr<PublicKeyVerify>* verifier) {
+  SubtleUtilBoringSSL::RsaPrivateKey private_key;
+  SubtleUtilBoringSSL::RsaPublicKey public_key;
+  auto status = NewRsaKeyPair(&private_key, &public_key);
+  if (!status.ok()) return status;
+  SubtleUtilBoringSSL::RsaSsaPkcs1Params params{HashType::SHA256};
+  auto signer_result = RsaSsaPkcs1SignBoringSsl::New(private_key, params);
+  if (!signer_result.ok()) return signer_result.status();
+  auto verifier_result = RsaSsaPkcs1VerifyBoringSsl::New(public_key, params);
+  if (!verifier_result.ok()) return verifier_result.status();
+  *signer = std::move(signer_result.ValueOrDie());
+  *verifier = std::move(verifier_result.ValueOrDie());
+  return util::Status::OK;
+}
+
+util::Status NewRsaSsaPss(std::unique_ptr<PublicKeySign>* signer,
+                          std::unique_ptr<PublicKeyVerify>* verifier) {
+  SubtleUtilBoringSSL::RsaPrivateKey private_key;
+  SubtleUtilBoringSSL::RsaPublicKey public_key;
+  auto status = NewRsaKeyPair(&private_key, &public_key);
+  if (!status.ok()) return status;
+  SubtleUtilBoringSSL::RsaSsaPssParams params{HashType::SHA256,
+                                              HashType::SHA256, 32};
+  auto signer_result = RsaSsaPssSignBoringSsl::New(private_key, params);
+  if (!signer_result.ok()) return signer_result.status();
+  auto verifier_result = RsaSsaPssVerifyBoringSsl::New(public_key, params);
+  if (!verifier_result.ok()) return verifier_result.status();
+  *signer = std::move(signer_result.ValueOrDie());
+  *verifier = std::move(verifier_result.ValueOrDie());
+  return util::Status::OK;
+}
+
+void BM_Sign(benchmark::State& state, SignatureFactory factory) {
+  std::unique_ptr<PublicKeySign> signer;
+  std::unique_ptr<PublicKeyVerify> verifier;
+  if (!CheckOk(factory(&signer, &verifier), &state)) return;
+  std::string data = Random::GetRandomBytes(kMessageSize);
+  for (auto _ : state) {
+    auto sign_result = signer->Sign(data);
+    if (!CheckOk(sign_result.status(), &state)) break;
+    benchmark::DoNotOptimize(sign_result.ValueOrDie().data());
+  }
+}
+
+void BM_Verify(benchmark::State& state, SignatureFactory factory) {
+  std::unique_ptr<PublicKeySign> signer;
+  std::unique_ptr<PublicKeyVerify> verifier;
+  if (!CheckOk(factory(&signer, &verifier), &state)) return;
+  std::string data = Random::GetRandomBytes(kMessageSize);
+  auto sign_result = signer->Sign(data);
+  if (!CheckOk(sign_result.status(), &state)) return;
+  const std::string& signature = sign_result.ValueOrDie();
+  for (auto _ : state) {
+    if (!CheckOk(verifier->Verify(signature, data), &state)) break;
+  }
+}
+
+#define TINK_SIGNATURE_BENCHMARKS(name, factory) \
+  BENCHMARK_CAPTURE(BM_Sign, name, factory);     \
+  BENCHMARK_CAPTURE(BM_Verify, name, factory)
+
+TINK_SIGNATURE_BENCHMARKS(
+    EcdsaP256, (NewEcdsa<EllipticCurveType::NIST_P256, HashType::SHA256>));
+TINK_SIGNATURE_BENCHMARKS(
+    EcdsaP384, (NewEcdsa<EllipticCurveType::NIST_P384, HashType::SHA512>));
+TINK_SIGNATURE_BENCHMARKS(
+    EcdsaP521, (NewEcdsa<EllipticCurveType::NIST_P521, HashType::SHA512>));
+TINK_SIGNATURE_BENCHMARKS(Ed25519, NewEd25519);
+TINK_SIGNATURE_BENCHMARKS(RsaSsaPkcs1_3072, NewRsaSsaPkcs1);
+TINK_SIGNATURE_BENCHMARKS(RsaSsaPss3072, NewRsaSsaPss);
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
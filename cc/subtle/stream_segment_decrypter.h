@@ -43,6 +43,9 @@ class StreamSegmentDecrypter {
   // Decryption uses the current value returned by get_segment_number()
   // as the segment number, and subsequently increments the current
   // segment number.
+  // Once the decrypter has been initialized, this method may be called
+  // concurrently from multiple threads, as long as the calls use distinct
+  // 'plaintext_buffer's.
   virtual util::Status DecryptSegment(
       const std::vector<uint8_t>& ciphertext,
       int64_t segment_number,
@@ -19,6 +19,7 @@
 
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "tink/util/status.h"
 
 namespace crypto {
@@ -75,6 +76,22 @@ class StreamSegmentEncrypter {
       bool is_last_segment,
       std::vector<uint8_t>* ciphertext_buffer) = 0;
 
+  // Encrypts 'plaintext' as the segment with number 'segment_number',
+  // and writes the resulting ciphertext to 'ciphertext_buffer', adjusting
+  // its size as needed.  In contrast to EncryptSegment(), this method
+  // neither uses nor changes the current segment number, and is safe
+  // to call concurrently (with distinct ciphertext buffers).
+  // The caller is responsible for encrypting each segment number only once,
+  // and for marking exactly one segment as the last one.
+  virtual util::Status EncryptSegmentAt(
+      int64_t segment_number,
+      absl::string_view plaintext,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const {
+    return util::Status(util::error::UNIMPLEMENTED,
+                        "positional encryption not supported");
+  }
+
   // Returns the header of the ciphertext stream.
   virtual const std::vector<uint8_t>& get_header() const = 0;
 
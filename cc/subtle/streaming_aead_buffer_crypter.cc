@@ -0,0 +1,274 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/streaming_aead_buffer_crypter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/thread_pool.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// The positions of the segments of a ciphertext within a buffer
+// that starts with the header (i.e. without the ciphertext offset).
+class SegmentLayout {
+ public:
+  SegmentLayout(int header_size, int ciphertext_offset,
+                int plaintext_segment_size, int ciphertext_segment_size)
+      : header_size_(header_size),
+        ciphertext_offset_(ciphertext_offset),
+        pt_segment_size_(plaintext_segment_size),
+        ct_segment_size_(ciphertext_segment_size) {}
+
+  int first_segment_size() const {
+    return pt_segment_size_ - ciphertext_offset_ - header_size_;
+  }
+  int segment_overhead() const { return ct_segment_size_ - pt_segment_size_; }
+
+  int64_t PlaintextOffset(int64_t segment_number) const {
+    if (segment_number == 0) return 0;
+    return first_segment_size() + (segment_number - 1) * pt_segment_size_;
+  }
+
+  int64_t CiphertextOffset(int64_t segment_number) const {
+    if (segment_number == 0) return header_size_;
+    return segment_number * ct_segment_size_ - ciphertext_offset_;
+  }
+
+  int64_t SegmentCountForPlaintext(int64_t plaintext_size) const {
+    if (plaintext_size <= first_segment_size()) return 1;
+    return 1 + (plaintext_size - first_segment_size() + pt_segment_size_ - 1) /
+        pt_segment_size_;
+  }
+
+  int64_t SegmentCountForCiphertext(int64_t ciphertext_size) const {
+    int64_t first_ct_segment_size = first_segment_size() + segment_overhead();
+    int64_t body_size = ciphertext_size - header_size_;
+    if (body_size <= first_ct_segment_size) return 1;
+    return 1 + (body_size - first_ct_segment_size + ct_segment_size_ - 1) /
+        ct_segment_size_;
+  }
+
+ private:
+  const int header_size_;
+  const int ciphertext_offset_;
+  const int pt_segment_size_;
+  const int ct_segment_size_;
+};
+
+// Calls 'process_segment' for each segment number in [0, segment_count),
+// on 'num_threads' threads.  Each thread passes the same pair of scratch
+// buffers to all its calls.  Stops at the first failure, and returns
+// the corresponding status.
+Status ProcessSegments(
+    int64_t segment_count, int num_threads,
+    const std::function<Status(int64_t, std::vector<uint8_t>*,
+                               std::vector<uint8_t>*)>& process_segment) {
+  absl::Mutex mutex;
+  Status status = Status::OK;
+  std::atomic<bool> failed(false);
+  std::atomic<int64_t> next_segment(0);
+  auto worker = [&]() {
+    std::vector<uint8_t> in_buffer;
+    std::vector<uint8_t> out_buffer;
+    while (!failed) {
+      int64_t number = next_segment++;
+      if (number >= segment_count) return;
+      Status segment_status =
+          process_segment(number, &in_buffer, &out_buffer);
+      if (!segment_status.ok()) {
+        absl::MutexLock lock(&mutex);
+        if (status.ok()) status = segment_status;
+        failed = true;
+        return;
+      }
+    }
+  };
+
+  if (num_threads > segment_count) num_threads = segment_count;
+  if (num_threads <= 1) {
+    worker();
+  } else {
+    util::ThreadPool pool(num_threads);
+    for (int i = 0; i < num_threads; i++) {
+      pool.Schedule(worker);
+    }
+  }  // The destructor of the pool waits for all the workers.
+  return status;
+}
+
+}  // anonymous namespace
+
+// static
+int64_t StreamingAeadBufferCrypter::GetCiphertextSize(
+    const StreamSegmentEncrypter& segment_encrypter, int64_t plaintext_size) {
+  return GetCiphertextSize(segment_encrypter.get_header().size(),
+                           segment_encrypter.get_ciphertext_offset(),
+                           segment_encrypter.get_plaintext_segment_size(),
+                           segment_encrypter.get_ciphertext_segment_size(),
+                           plaintext_size);
+}
+
+// static
+int64_t StreamingAeadBufferCrypter::GetCiphertextSize(
+    int header_size, int ciphertext_offset, int plaintext_segment_size,
+    int ciphertext_segment_size, int64_t plaintext_size) {
+  SegmentLayout layout(header_size, ciphertext_offset, plaintext_segment_size,
+                       ciphertext_segment_size);
+  return header_size + plaintext_size +
+      layout.SegmentCountForPlaintext(plaintext_size) *
+      layout.segment_overhead();
+}
+
+// static
+Status StreamingAeadBufferCrypter::Encrypt(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    absl::string_view plaintext, char* ciphertext, int64_t ciphertext_size,
+    int num_threads) {
+  if (segment_encrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_encrypter must be non-null");
+  }
+  if (ciphertext == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext must be non-null");
+  }
+  const std::vector<uint8_t>& header = segment_encrypter->get_header();
+  SegmentLayout layout(header.size(),
+                       segment_encrypter->get_ciphertext_offset(),
+                       segment_encrypter->get_plaintext_segment_size(),
+                       segment_encrypter->get_ciphertext_segment_size());
+  if (layout.first_segment_size() <= 0) {
+    return Status(util::error::INTERNAL,
+                  "Size of the first segment must be greater than 0.");
+  }
+  if (ciphertext_size !=
+      GetCiphertextSize(*segment_encrypter, plaintext.size())) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_size does not match the size of the plaintext");
+  }
+
+  memcpy(ciphertext, header.data(), header.size());
+  int64_t segment_count = layout.SegmentCountForPlaintext(plaintext.size());
+  const StreamSegmentEncrypter* encrypter = segment_encrypter.get();
+  return ProcessSegments(
+      segment_count, num_threads,
+      [&](int64_t number, std::vector<uint8_t>* unused,
+          std::vector<uint8_t>* ct_buffer) -> Status {
+        bool is_last = (number == segment_count - 1);
+        int64_t pt_start = layout.PlaintextOffset(number);
+        int64_t pt_end =
+            is_last ? plaintext.size() : layout.PlaintextOffset(number + 1);
+        Status status = encrypter->EncryptSegmentAt(
+            number, plaintext.substr(pt_start, pt_end - pt_start), is_last,
+            ct_buffer);
+        if (!status.ok()) return status;
+        memcpy(ciphertext + layout.CiphertextOffset(number), ct_buffer->data(),
+               ct_buffer->size());
+        return Status::OK;
+      });
+}
+
+// static
+StatusOr<int64_t> StreamingAeadBufferCrypter::Decrypt(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    absl::string_view ciphertext, char* plaintext,
+    int64_t plaintext_capacity, int num_threads) {
+  if (segment_decrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_decrypter must be non-null");
+  }
+  if (plaintext == nullptr && plaintext_capacity > 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "plaintext must be non-null");
+  }
+  int header_size = segment_decrypter->get_header_size();
+  SegmentLayout layout(header_size,
+                       segment_decrypter->get_ciphertext_offset(),
+                       segment_decrypter->get_plaintext_segment_size(),
+                       segment_decrypter->get_ciphertext_segment_size());
+  if (layout.first_segment_size() <= 0) {
+    return Status(util::error::INTERNAL,
+                  "Size of the first segment must be greater than 0.");
+  }
+  int64_t ciphertext_size = ciphertext.size();
+  if (ciphertext_size < header_size + layout.segment_overhead()) {
+    return Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  int64_t segment_count = layout.SegmentCountForCiphertext(ciphertext_size);
+  if (ciphertext_size - layout.CiphertextOffset(segment_count - 1) <
+      layout.segment_overhead()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "last ciphertext segment too short");
+  }
+  int64_t plaintext_size = ciphertext_size - header_size -
+      segment_count * layout.segment_overhead();
+  if (plaintext_size > plaintext_capacity) {
+    return Status(util::error::RESOURCE_EXHAUSTED,
+                  "plaintext_capacity too small");
+  }
+
+  std::vector<uint8_t> header(ciphertext.begin(),
+                              ciphertext.begin() + header_size);
+  auto status = segment_decrypter->Init(header);
+  if (!status.ok()) return status;
+
+  StreamSegmentDecrypter* decrypter = segment_decrypter.get();
+  status = ProcessSegments(
+      segment_count, num_threads,
+      [&](int64_t number, std::vector<uint8_t>* ct_buffer,
+          std::vector<uint8_t>* pt_buffer) -> Status {
+        bool is_last = (number == segment_count - 1);
+        int64_t ct_start = layout.CiphertextOffset(number);
+        int64_t ct_end =
+            is_last ? ciphertext_size : layout.CiphertextOffset(number + 1);
+        ct_buffer->assign(ciphertext.begin() + ct_start,
+                          ciphertext.begin() + ct_end);
+        Status status =
+            decrypter->DecryptSegment(*ct_buffer, number, is_last, pt_buffer);
+        if (!status.ok()) return status;
+        int64_t pt_start = layout.PlaintextOffset(number);
+        if (pt_start + pt_buffer->size() > plaintext_size) {
+          return Status(util::error::INTERNAL, "unexpected plaintext size");
+        }
+        memcpy(plaintext + pt_start, pt_buffer->data(), pt_buffer->size());
+        return Status::OK;
+      });
+  if (!status.ok()) return status;
+  return plaintext_size;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,86 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_STREAMING_AEAD_BUFFER_CRYPTER_H_
+#define TINK_SUBTLE_STREAMING_AEAD_BUFFER_CRYPTER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Encrypts and decrypts contiguous in-memory buffers using the ciphertext
+// format of StreamingAeadEncryptingStream, i.e. a ciphertext produced
+// by Encrypt() is identical in format to the bytes written by an encrypting
+// stream to an (initially empty) destination, and vice versa.
+//
+// The exact size of the output is computed upfront, and the segments
+// are processed in parallel on 'num_threads' threads, each of which
+// reuses a single scratch buffer for all the segments it processes.
+class StreamingAeadBufferCrypter {
+ public:
+  // Returns the size of the ciphertext of a plaintext of 'plaintext_size'
+  // bytes, when encrypted with segments as specified by 'segment_encrypter'.
+  static int64_t GetCiphertextSize(
+      const StreamSegmentEncrypter& segment_encrypter, int64_t plaintext_size);
+
+  // Same as above, for segments as specified by the given sizes (see
+  // StreamSegmentEncrypter), so that no encrypter has to be created.
+  static int64_t GetCiphertextSize(int header_size, int ciphertext_offset,
+                                   int plaintext_segment_size,
+                                   int ciphertext_segment_size,
+                                   int64_t plaintext_size);
+
+  // Encrypts 'plaintext' and writes the resulting ciphertext to the
+  // 'ciphertext_size' bytes at 'ciphertext', where 'ciphertext_size'
+  // must be equal to GetCiphertextSize(*segment_encrypter, plaintext.size()).
+  // 'segment_encrypter' must be a fresh encrypter which supports
+  // EncryptSegmentAt().
+  static crypto::tink::util::Status Encrypt(
+      std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+      absl::string_view plaintext, char* ciphertext, int64_t ciphertext_size,
+      int num_threads);
+
+  // Decrypts 'ciphertext' and writes the resulting plaintext to 'plaintext',
+  // which must have room for at least 'plaintext_capacity' bytes.
+  // Returns the size of the plaintext.  A capacity of ciphertext.size()
+  // bytes is always sufficient; a smaller one that cannot hold the plaintext
+  // fails with RESOURCE_EXHAUSTED, before anything is decrypted.
+  // If decryption fails, the contents
+  // of 'plaintext' are unspecified.
+  // 'segment_decrypter' must be a fresh (not initialized) decrypter,
+  // whose DecryptSegment() is safe to call concurrently (with distinct
+  // plaintext buffers) once it has been initialized.
+  static crypto::tink::util::StatusOr<int64_t> Decrypt(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      absl::string_view ciphertext, char* plaintext,
+      int64_t plaintext_capacity, int num_threads);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_STREAMING_AEAD_BUFFER_CRYPTER_H_
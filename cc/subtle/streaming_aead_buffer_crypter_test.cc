@@ -0,0 +1,132 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/streaming_aead_buffer_crypter.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::subtle::test::DummyStreamSegmentDecrypter;
+using crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+const int kHeaderSize = 10;
+
+TEST(StreamingAeadBufferCrypterTest, EncryptAndDecrypt) {
+  for (int pt_size : {0, 1, 10, 100, 1000, 10000, 100000}) {
+    for (int pt_segment_size : {64, 100, 1024}) {
+      for (int ct_offset : {0, 5, 15}) {
+        for (int num_threads : {1, 4}) {
+          SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                    ", pt_segment_size = ", pt_segment_size,
+                                    ", ct_offset = ", ct_offset,
+                                    ", num_threads = ", num_threads));
+          std::string pt = Random::GetRandomBytes(pt_size);
+          auto seg_enc = absl::make_unique<DummyStreamSegmentEncrypter>(
+              pt_segment_size, kHeaderSize, ct_offset);
+          int64_t ct_size =
+              StreamingAeadBufferCrypter::GetCiphertextSize(*seg_enc, pt_size);
+          std::string expected_ct = seg_enc->GenerateCiphertext(pt);
+          EXPECT_EQ(expected_ct.size(), ct_size);
+
+          std::string ct(ct_size, '\0');
+          EXPECT_THAT(StreamingAeadBufferCrypter::Encrypt(
+                          std::move(seg_enc), pt, &ct[0], ct_size,
+                          num_threads), IsOk());
+          EXPECT_EQ(expected_ct, ct);
+
+          std::string decrypted(ct.size(), '\0');
+          auto result = StreamingAeadBufferCrypter::Decrypt(
+              absl::make_unique<DummyStreamSegmentDecrypter>(
+                  pt_segment_size, kHeaderSize, ct_offset),
+              ct, &decrypted[0], decrypted.size(), num_threads);
+          ASSERT_THAT(result.status(), IsOk());
+          EXPECT_EQ(pt_size, result.ValueOrDie());
+          decrypted.resize(result.ValueOrDie());
+          EXPECT_EQ(pt, decrypted);
+        }
+      }
+    }
+  }
+}
+
+TEST(StreamingAeadBufferCrypterTest, InvalidCiphertexts) {
+  int pt_segment_size = 100;
+  int ct_offset = 5;
+  DummyStreamSegmentEncrypter seg_enc(pt_segment_size, kHeaderSize, ct_offset);
+  std::string pt = Random::GetRandomBytes(1000);
+  std::string ct = seg_enc.GenerateCiphertext(pt);
+  std::string corrupted_ct = ct;
+  corrupted_ct[ct.size() / 2] ^= 1;
+  corrupted_ct[ct.size() - 1] ^= 1;
+  std::string corrupted_header = ct;
+  corrupted_header[0] ^= 1;
+
+  for (const std::string& invalid_ct :
+           {std::string(""), ct.substr(0, kHeaderSize), ct.substr(1),
+            ct.substr(0, ct.size() - 1), absl::StrCat(ct, "x"), corrupted_ct,
+            corrupted_header}) {
+    SCOPED_TRACE(absl::StrCat("ct_size = ", invalid_ct.size()));
+    std::string decrypted(invalid_ct.size(), '\0');
+    auto result = StreamingAeadBufferCrypter::Decrypt(
+        absl::make_unique<DummyStreamSegmentDecrypter>(
+            pt_segment_size, kHeaderSize, ct_offset),
+        invalid_ct, &decrypted[0], decrypted.size(), 3);
+    EXPECT_FALSE(result.ok());
+  }
+
+  // Insufficient capacity for the plaintext.
+  std::string decrypted(pt.size() - 1, '\0');
+  EXPECT_THAT(StreamingAeadBufferCrypter::Decrypt(
+                  absl::make_unique<DummyStreamSegmentDecrypter>(
+                      pt_segment_size, kHeaderSize, ct_offset),
+                  ct, &decrypted[0], decrypted.size(), 3).status(),
+              StatusIs(util::error::RESOURCE_EXHAUSTED));
+}
+
+TEST(StreamingAeadBufferCrypterTest, InvalidArguments) {
+  std::string pt = "some plaintext";
+  std::string ct(1000, '\0');
+  EXPECT_THAT(StreamingAeadBufferCrypter::Encrypt(
+                  nullptr, pt, &ct[0], ct.size(), 1),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAeadBufferCrypter::Encrypt(
+                  absl::make_unique<DummyStreamSegmentEncrypter>(
+                      100, kHeaderSize, 0), pt, &ct[0], ct.size(), 1),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAeadBufferCrypter::Decrypt(
+                  nullptr, ct, &ct[0], ct.size(), 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
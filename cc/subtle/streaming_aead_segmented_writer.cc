@@ -0,0 +1,230 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/streaming_aead_segmented_writer.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/segmented_ciphertext_writer.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using crypto::tink::ToStatusF;
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// Writes 'count' bytes from 'data' at position 'position' of file
+// descriptor 'fd', while ignoring EINTR and short writes.
+Status PWriteFully(int fd, const uint8_t* data, size_t count,
+                   int64_t position) {
+  while (count > 0) {
+    ssize_t written = pwrite(fd, data, count, position);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return ToStatusF(util::error::INTERNAL,
+                       "I/O error upon write: %d", errno);
+    }
+    data += written;
+    count -= written;
+    position += written;
+  }
+  return Status::OK;
+}
+
+}  // anonymous namespace
+
+// static
+StatusOr<std::unique_ptr<SegmentedCiphertextWriter>>
+StreamingAeadSegmentedWriter::New(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    int ciphertext_fd) {
+  if (segment_encrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_encrypter must be non-null");
+  }
+  if (ciphertext_fd < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_fd must be a valid file descriptor");
+  }
+  int first_segment_size =
+      segment_encrypter->get_plaintext_segment_size() -
+      segment_encrypter->get_ciphertext_offset() -
+      segment_encrypter->get_header().size();
+  if (first_segment_size <= 0) {
+    return Status(util::error::INTERNAL,
+                  "Size of the first segment must be greater than 0.");
+  }
+  // Check upfront that positional encryption is supported.
+  std::vector<uint8_t> ct_buffer;
+  auto status = segment_encrypter->EncryptSegmentAt(
+      0, absl::string_view(), /* is_last_segment = */ false, &ct_buffer);
+  if (!status.ok()) return status;
+
+  const std::vector<uint8_t>& header = segment_encrypter->get_header();
+  status = PWriteFully(ciphertext_fd, header.data(), header.size(),
+                       segment_encrypter->get_ciphertext_offset());
+  if (!status.ok()) return status;
+  return {std::unique_ptr<SegmentedCiphertextWriter>(
+      new StreamingAeadSegmentedWriter(std::move(segment_encrypter),
+                                       ciphertext_fd))};
+}
+
+StreamingAeadSegmentedWriter::StreamingAeadSegmentedWriter(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    int ciphertext_fd)
+    : segment_encrypter_(std::move(segment_encrypter)),
+      ciphertext_fd_(ciphertext_fd),
+      first_segment_size_(segment_encrypter_->get_plaintext_segment_size() -
+                          segment_encrypter_->get_ciphertext_offset() -
+                          segment_encrypter_->get_header().size()),
+      max_segment_number_(-1),
+      last_segment_number_(-1) {}
+
+int StreamingAeadSegmentedWriter::GetPlaintextSegmentSize(
+    int64_t segment_number) const {
+  if (segment_number == 0) return first_segment_size_;
+  return segment_encrypter_->get_plaintext_segment_size();
+}
+
+int64_t StreamingAeadSegmentedWriter::GetPlaintextSegmentOffset(
+    int64_t segment_number) const {
+  if (segment_number == 0) return 0;
+  return first_segment_size_ + (segment_number - 1) *
+      segment_encrypter_->get_plaintext_segment_size();
+}
+
+int64_t StreamingAeadSegmentedWriter::GetCiphertextSegmentPosition(
+    int64_t segment_number) const {
+  if (segment_number == 0) {
+    return segment_encrypter_->get_ciphertext_offset() +
+        segment_encrypter_->get_header().size();
+  }
+  return segment_number * segment_encrypter_->get_ciphertext_segment_size();
+}
+
+int64_t StreamingAeadSegmentedWriter::GetNumberOfSegments(
+    int64_t plaintext_size) const {
+  if (plaintext_size <= first_segment_size_) return 1;
+  int64_t segment_size = segment_encrypter_->get_plaintext_segment_size();
+  return 1 + (plaintext_size - first_segment_size_ + segment_size - 1) /
+      segment_size;
+}
+
+Status StreamingAeadSegmentedWriter::WriteSegment(
+    int64_t segment_number, absl::string_view plaintext) {
+  if (segment_number < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_number must be non-negative");
+  }
+  if (plaintext.size() != GetPlaintextSegmentSize(segment_number)) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  absl::StrCat("segment ", segment_number, " must have ",
+                               GetPlaintextSegmentSize(segment_number),
+                               " bytes of plaintext, got ", plaintext.size()));
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    if (last_segment_number_ >= 0 && segment_number >= last_segment_number_) {
+      return Status(util::error::FAILED_PRECONDITION,
+                    absl::StrCat("segment ", segment_number,
+                                 " is not before the last segment ",
+                                 last_segment_number_));
+    }
+    int64_t written_size = written_segments_.size();
+    if (segment_number < written_size && written_segments_[segment_number]) {
+      return Status(util::error::FAILED_PRECONDITION,
+                    absl::StrCat("segment ", segment_number,
+                                 " has been written already"));
+    }
+    if (segment_number >= written_size) {
+      written_segments_.resize(
+          std::max(segment_number + 1, 2 * written_size));
+    }
+    // Marked before encrypting, so that even a failed write is not retried
+    // with a different plaintext under the same nonce.
+    written_segments_[segment_number] = true;
+    if (segment_number > max_segment_number_) {
+      max_segment_number_ = segment_number;
+    }
+  }
+  return EncryptAndWrite(segment_number, plaintext,
+                         /* is_last_segment = */ false);
+}
+
+Status StreamingAeadSegmentedWriter::Finalize(
+    int64_t segment_number, absl::string_view plaintext) {
+  if (segment_number < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_number must be non-negative");
+  }
+  if (plaintext.size() > GetPlaintextSegmentSize(segment_number)) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  absl::StrCat("segment ", segment_number,
+                               " can have at most ",
+                               GetPlaintextSegmentSize(segment_number),
+                               " bytes of plaintext"));
+  }
+  if (plaintext.empty() && segment_number != 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "only the first segment can be empty");
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    if (last_segment_number_ >= 0) {
+      return Status(util::error::FAILED_PRECONDITION,
+                    "the writer has been finalized already");
+    }
+    if (segment_number <= max_segment_number_) {
+      return Status(util::error::FAILED_PRECONDITION,
+                    absl::StrCat("segment ", max_segment_number_,
+                                 " has been written already"));
+    }
+    last_segment_number_ = segment_number;
+  }
+  return EncryptAndWrite(segment_number, plaintext,
+                         /* is_last_segment = */ true);
+}
+
+Status StreamingAeadSegmentedWriter::EncryptAndWrite(
+    int64_t segment_number, absl::string_view plaintext,
+    bool is_last_segment) const {
+  std::vector<uint8_t> ct_buffer;
+  auto status = segment_encrypter_->EncryptSegmentAt(
+      segment_number, plaintext, is_last_segment, &ct_buffer);
+  if (!status.ok()) return status;
+  return PWriteFully(ciphertext_fd_, ct_buffer.data(), ct_buffer.size(),
+                     GetCiphertextSegmentPosition(segment_number));
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,93 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_STREAMING_AEAD_SEGMENTED_WRITER_H_
+#define TINK_SUBTLE_STREAMING_AEAD_SEGMENTED_WRITER_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/segmented_ciphertext_writer.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// An implementation of SegmentedCiphertextWriter that encrypts segments
+// via StreamSegmentEncrypter::EncryptSegmentAt(), and writes them
+// to a file descriptor via pwrite().  The resulting ciphertext is identical
+// in format to the ciphertext produced by StreamingAeadEncryptingStream,
+// with the first get_ciphertext_offset() bytes of the file left untouched,
+// i.e. the header is written at position get_ciphertext_offset().
+class StreamingAeadSegmentedWriter : public SegmentedCiphertextWriter {
+ public:
+  // A factory that writes the header of the ciphertext to 'ciphertext_fd'.
+  // 'segment_encrypter' must support EncryptSegmentAt().
+  // The writer does not take the ownership of 'ciphertext_fd'.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<SegmentedCiphertextWriter>>
+  New(std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+      int ciphertext_fd);
+
+  // -----------------------
+  // Methods of SegmentedCiphertextWriter-interface implemented by this class.
+  int GetPlaintextSegmentSize(int64_t segment_number) const override;
+  int64_t GetPlaintextSegmentOffset(int64_t segment_number) const override;
+  int64_t GetCiphertextSegmentPosition(int64_t segment_number) const override;
+  int64_t GetNumberOfSegments(int64_t plaintext_size) const override;
+  crypto::tink::util::Status WriteSegment(
+      int64_t segment_number, absl::string_view plaintext) override;
+  crypto::tink::util::Status Finalize(
+      int64_t segment_number, absl::string_view plaintext) override;
+
+  ~StreamingAeadSegmentedWriter() override {}
+
+ private:
+  StreamingAeadSegmentedWriter(
+      std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+      int ciphertext_fd);
+
+  // Encrypts 'plaintext' as segment 'segment_number' and writes
+  // the resulting ciphertext segment to its position in the file.
+  crypto::tink::util::Status EncryptAndWrite(
+      int64_t segment_number, absl::string_view plaintext,
+      bool is_last_segment) const;
+
+  const std::unique_ptr<StreamSegmentEncrypter> segment_encrypter_;
+  const int ciphertext_fd_;
+  const int first_segment_size_;  // plaintext size of segment 0
+
+  absl::Mutex mutex_;
+  // The largest segment number passed to WriteSegment() so far, or -1.
+  int64_t max_segment_number_ GUARDED_BY(mutex_);
+  // The number of the last segment once Finalize() was called, or -1.
+  int64_t last_segment_number_ GUARDED_BY(mutex_);
+  // Whether WriteSegment() was called for a segment number.  A segment
+  // is written at most once, as its nonce depends only on its number.
+  std::vector<bool> written_segments_ GUARDED_BY(mutex_);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_STREAMING_AEAD_SEGMENTED_WRITER_H_
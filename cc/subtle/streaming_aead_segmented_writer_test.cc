@@ -0,0 +1,207 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/streaming_aead_segmented_writer.h"
+
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/segmented_ciphertext_writer.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "tink/util/thread_pool.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+const int kHeaderSize = 10;
+
+// Returns a writer that writes to a new test file 'filename', which
+// initially contains 'ct_offset' bytes of other data.
+std::unique_ptr<SegmentedCiphertextWriter> GetWriter(
+    absl::string_view filename, int pt_segment_size, int ct_offset,
+    int* fd) {
+  *fd = crypto::tink::test::GetTestFileDescriptor(filename);
+  std::string other(ct_offset, 'o');
+  EXPECT_EQ(ct_offset, write(*fd, other.data(), other.size()));
+  auto writer_result = StreamingAeadSegmentedWriter::New(
+      absl::make_unique<DummyStreamSegmentEncrypter>(
+          pt_segment_size, kHeaderSize, ct_offset), *fd);
+  EXPECT_THAT(writer_result.status(), IsOk());
+  return std::move(writer_result.ValueOrDie());
+}
+
+TEST(StreamingAeadSegmentedWriterTest, SegmentLayout) {
+  int pt_segment_size = 100;
+  int ct_offset = 7;
+  int fd;
+  auto writer = GetWriter("segmented_writer_layout.txt", pt_segment_size,
+                          ct_offset, &fd);
+  int first_segment_size = pt_segment_size - ct_offset - kHeaderSize;
+  int ct_segment_size =
+      pt_segment_size + DummyStreamSegmentEncrypter::kSegmentTagSize;
+  EXPECT_EQ(first_segment_size, writer->GetPlaintextSegmentSize(0));
+  EXPECT_EQ(pt_segment_size, writer->GetPlaintextSegmentSize(1));
+  EXPECT_EQ(0, writer->GetPlaintextSegmentOffset(0));
+  EXPECT_EQ(first_segment_size, writer->GetPlaintextSegmentOffset(1));
+  EXPECT_EQ(first_segment_size + 2 * pt_segment_size,
+            writer->GetPlaintextSegmentOffset(3));
+  EXPECT_EQ(ct_offset + kHeaderSize, writer->GetCiphertextSegmentPosition(0));
+  EXPECT_EQ(ct_segment_size, writer->GetCiphertextSegmentPosition(1));
+  EXPECT_EQ(3 * ct_segment_size, writer->GetCiphertextSegmentPosition(3));
+  EXPECT_EQ(1, writer->GetNumberOfSegments(0));
+  EXPECT_EQ(1, writer->GetNumberOfSegments(first_segment_size));
+  EXPECT_EQ(2, writer->GetNumberOfSegments(first_segment_size + 1));
+  EXPECT_EQ(2, writer->GetNumberOfSegments(
+      first_segment_size + pt_segment_size));
+  EXPECT_EQ(3, writer->GetNumberOfSegments(
+      first_segment_size + pt_segment_size + 1));
+  close(fd);
+}
+
+TEST(StreamingAeadSegmentedWriterTest, ConcurrentWritesMatchStreamEncryption) {
+  for (int pt_size : {0, 1, 10, 100, 1000, 10000}) {
+    for (int pt_segment_size : {64, 100, 1024}) {
+      for (int ct_offset : {0, 5, 15}) {
+        SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                  ", pt_segment_size = ", pt_segment_size,
+                                  ", ct_offset = ", ct_offset));
+        std::string filename = absl::StrCat(
+            "segmented_writer_", pt_size, "_", pt_segment_size, "_",
+            ct_offset, ".txt");
+        int fd;
+        auto writer = GetWriter(filename, pt_segment_size, ct_offset, &fd);
+        std::string pt = Random::GetRandomBytes(pt_size);
+        int64_t num_segments = writer->GetNumberOfSegments(pt_size);
+        {
+          // Write the segments in reverse order, from several threads.
+          util::ThreadPool pool(4);
+          for (int64_t i = num_segments - 1; i >= 0; i--) {
+            SegmentedCiphertextWriter* w = writer.get();
+            pool.Schedule([w, i, num_segments, &pt]() {
+              absl::string_view segment = absl::string_view(pt).substr(
+                  w->GetPlaintextSegmentOffset(i),
+                  w->GetPlaintextSegmentSize(i));
+              if (i == num_segments - 1) {
+                EXPECT_THAT(w->Finalize(i, segment), IsOk());
+              } else {
+                EXPECT_THAT(w->WriteSegment(i, segment), IsOk());
+              }
+            });
+          }
+        }
+        close(fd);
+        DummyStreamSegmentEncrypter seg_enc(pt_segment_size, kHeaderSize,
+                                            ct_offset);
+        std::string expected_ct = std::string(ct_offset, 'o') +
+                                  seg_enc.GenerateCiphertext(pt);
+        EXPECT_EQ(expected_ct, crypto::tink::test::ReadTestFile(filename));
+      }
+    }
+  }
+}
+
+TEST(StreamingAeadSegmentedWriterTest, InvalidWrites) {
+  int pt_segment_size = 100;
+  int ct_offset = 0;
+  int first_segment_size = pt_segment_size - ct_offset - kHeaderSize;
+  int fd;
+  auto writer = GetWriter("segmented_writer_invalid.txt", pt_segment_size,
+                          ct_offset, &fd);
+  std::string pt = Random::GetRandomBytes(pt_segment_size + 1);
+  absl::string_view pt_view(pt);
+
+  EXPECT_THAT(writer->WriteSegment(-1, pt_view.substr(0, pt_segment_size)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(writer->WriteSegment(0, pt_view.substr(0, pt_segment_size)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(writer->WriteSegment(1, pt_view.substr(0, first_segment_size)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(writer->Finalize(1, pt_view),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(writer->Finalize(1, ""),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  EXPECT_THAT(writer->WriteSegment(3, pt_view.substr(0, pt_segment_size)),
+              IsOk());
+  EXPECT_THAT(writer->Finalize(2, pt_view.substr(0, 10)),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->Finalize(4, pt_view.substr(0, 10)), IsOk());
+  EXPECT_THAT(writer->Finalize(5, pt_view.substr(0, 10)),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->WriteSegment(4, pt_view.substr(0, pt_segment_size)),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->WriteSegment(2, pt_view.substr(0, pt_segment_size)),
+              IsOk());
+  close(fd);
+}
+
+TEST(StreamingAeadSegmentedWriterTest, SegmentsAreWrittenOnlyOnce) {
+  int pt_segment_size = 100;
+  int ct_offset = 0;
+  int first_segment_size = pt_segment_size - ct_offset - kHeaderSize;
+  int fd;
+  auto writer = GetWriter("segmented_writer_rewrite.txt", pt_segment_size,
+                          ct_offset, &fd);
+  std::string pt1 = Random::GetRandomBytes(pt_segment_size);
+  std::string pt2 = Random::GetRandomBytes(pt_segment_size);
+
+  EXPECT_THAT(writer->WriteSegment(0, pt1.substr(0, first_segment_size)),
+              IsOk());
+  EXPECT_THAT(writer->WriteSegment(0, pt2.substr(0, first_segment_size)),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->WriteSegment(5, pt1), IsOk());
+  EXPECT_THAT(writer->WriteSegment(5, pt2),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->WriteSegment(5, pt1),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->WriteSegment(2, pt1), IsOk());
+  EXPECT_THAT(writer->Finalize(6, pt2.substr(0, 10)), IsOk());
+  EXPECT_THAT(writer->WriteSegment(2, pt2),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->WriteSegment(1, pt2), IsOk());
+  close(fd);
+}
+
+TEST(StreamingAeadSegmentedWriterTest, NullArguments) {
+  EXPECT_THAT(StreamingAeadSegmentedWriter::New(nullptr, 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAeadSegmentedWriter::New(
+                  absl::make_unique<DummyStreamSegmentEncrypter>(
+                      100, kHeaderSize, 0), -1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,405 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/streaming_aead_verifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/thread_pool.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+using VerificationResult = crypto::tink::StreamingAead::VerificationResult;
+
+namespace {
+
+// Reads at most 'count' bytes from the specified 'input_stream',
+// and puts them into 'output', where both 'input_stream' and 'output'
+// must be non-null.
+// Will try to read exactly 'count' bytes, unless the end of stream
+// is reached (then returns status OUT_OF_RANGE) or an error occurs
+// (an other non-OK status).
+// Before returning, resizes 'output' accordingly, to reflect
+// the actual number of bytes read.
+util::Status ReadFromStream(InputStream* input_stream, int count,
+                            std::vector<uint8_t>* output) {
+  const void* buffer;
+  int bytes_to_be_read = count;
+  int read_bytes = 0;    // bytes read in one Next()-call
+  int needed_bytes = 0;  // bytes actually needed
+  output->resize(count);
+  while (bytes_to_be_read > 0) {
+    auto next_result = input_stream->Next(&buffer);
+    if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      // End of stream.
+      output->resize(count - bytes_to_be_read);
+      return next_result.status();
+    }
+    if (!next_result.ok()) return next_result.status();
+    read_bytes = next_result.ValueOrDie();
+    needed_bytes = std::min(read_bytes, bytes_to_be_read);
+    memcpy(output->data() + (count - bytes_to_be_read), buffer, needed_bytes);
+    bytes_to_be_read -= needed_bytes;
+  }
+  if (read_bytes > needed_bytes) {
+    input_stream->BackUp(read_bytes - needed_bytes);
+  }
+  return Status::OK;
+}
+
+// Reads 'count' bytes starting at 'position' of 'ra_stream',
+// and puts them into 'output'.  Returns OUT_OF_RANGE if the end of stream
+// is reached before 'count' bytes could be read, in which case 'output'
+// contains the bytes read till the end of the stream.
+util::Status ReadFromStream(RandomAccessStream* ra_stream, int64_t position,
+                            int count, std::vector<uint8_t>* output) {
+  output->resize(count);
+  int read_bytes = 0;
+  while (read_bytes < count) {
+    auto buffer_result = util::Buffer::NewNonOwning(
+        reinterpret_cast<char*>(output->data()) + read_bytes,
+        count - read_bytes);
+    if (!buffer_result.ok()) return buffer_result.status();
+    auto buffer = std::move(buffer_result.ValueOrDie());
+    auto status =
+        ra_stream->PRead(position + read_bytes, count - read_bytes, buffer.get());
+    if (status.ok() || status.error_code() == util::error::OUT_OF_RANGE) {
+      read_bytes += buffer->size();
+    }
+    if (!status.ok()) {
+      output->resize(read_bytes);
+      return status;
+    }
+  }
+  return Status::OK;
+}
+
+// A ciphertext segment, and the scratch space for its decryption.
+struct Segment {
+  int64_t number;
+  int64_t offset;
+  bool is_last;
+  std::vector<uint8_t> ciphertext;
+  std::vector<uint8_t> plaintext;
+};
+
+// A fixed set of Segment-objects, which are handed out to the reader,
+// and returned once the verification of the segment is done.
+// Bounds the amount of ciphertext that is in flight.
+class SegmentSlots {
+ public:
+  explicit SegmentSlots(int count) {
+    for (int i = 0; i < count; i++) {
+      segments_.push_back(absl::make_unique<Segment>());
+      free_.push_back(segments_.back().get());
+    }
+  }
+
+  // Returns a free segment, waiting for one to become available if needed.
+  Segment* Acquire() {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &SegmentSlots::HasFree));
+    Segment* segment = free_.back();
+    free_.pop_back();
+    return segment;
+  }
+
+  void Release(Segment* segment) {
+    absl::MutexLock lock(&mutex_);
+    free_.push_back(segment);
+  }
+
+ private:
+  bool HasFree() const { return !free_.empty(); }
+
+  std::vector<std::unique_ptr<Segment>> segments_;
+  absl::Mutex mutex_;
+  std::vector<Segment*> free_ GUARDED_BY(mutex_);
+};
+
+// Collects the outcome of the verification of segments, which may be
+// verified out of order.
+class VerificationState {
+ public:
+  VerificationState()
+      : first_invalid_segment_(-1), first_invalid_segment_offset_(-1) {}
+
+  // Records that segment 'number', at position 'offset', is not authentic.
+  void RecordInvalidSegment(int64_t number, int64_t offset) {
+    absl::MutexLock lock(&mutex_);
+    if (first_invalid_segment_ < 0 || number < first_invalid_segment_) {
+      first_invalid_segment_ = number;
+      first_invalid_segment_offset_ = offset;
+    }
+  }
+
+  // Records an error that prevents the verification from completing.
+  void RecordError(const Status& status) {
+    absl::MutexLock lock(&mutex_);
+    if (status_.ok()) status_ = status;
+  }
+
+  // Returns true if the verification of segment 'number' is not needed
+  // any more, because an earlier segment failed, or an error occurred.
+  bool IsDone(int64_t number) {
+    absl::MutexLock lock(&mutex_);
+    return !status_.ok() ||
+        (first_invalid_segment_ >= 0 && number > first_invalid_segment_);
+  }
+
+  // Returns the result of a verification of 'segment_count' segments.
+  StatusOr<VerificationResult> GetResult(int64_t segment_count) {
+    absl::MutexLock lock(&mutex_);
+    if (!status_.ok()) return status_;
+    VerificationResult result;
+    result.first_invalid_segment = first_invalid_segment_;
+    result.first_invalid_segment_offset = first_invalid_segment_offset_;
+    result.verified_segments = first_invalid_segment_ < 0 ?
+        segment_count : first_invalid_segment_;
+    return result;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  Status status_ GUARDED_BY(mutex_);
+  int64_t first_invalid_segment_ GUARDED_BY(mutex_);
+  int64_t first_invalid_segment_offset_ GUARDED_BY(mutex_);
+};
+
+// Returns a result reporting that segment 0 at 'offset' is not authentic.
+VerificationResult InvalidFirstSegment(int64_t offset) {
+  VerificationResult result;
+  result.verified_segments = 0;
+  result.first_invalid_segment = 0;
+  result.first_invalid_segment_offset = offset;
+  return result;
+}
+
+// Verifies 'segment' using 'segment_decrypter', and records the outcome
+// in 'state'.
+void VerifySegment(StreamSegmentDecrypter* segment_decrypter,
+                   Segment* segment, VerificationState* state) {
+  if (state->IsDone(segment->number)) return;
+  auto status = segment_decrypter->DecryptSegment(
+      segment->ciphertext, segment->number, segment->is_last,
+      &segment->plaintext);
+  if (!status.ok()) {
+    state->RecordInvalidSegment(segment->number, segment->offset);
+  }
+}
+
+}  // namespace
+
+// static
+StatusOr<VerificationResult> StreamingAeadVerifier::VerifyStream(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<InputStream> ciphertext_source,
+    int num_threads) {
+  if (segment_decrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_decrypter must be non-null");
+  }
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  int header_size = segment_decrypter->get_header_size();
+  int first_segment_size =
+      segment_decrypter->get_ciphertext_segment_size() -
+      segment_decrypter->get_ciphertext_offset() - header_size;
+  if (first_segment_size <= 0) {
+    return Status(util::error::INTERNAL,
+                  "Size of the first segment must be greater than 0.");
+  }
+
+  // Read and process the header.
+  std::vector<uint8_t> header;
+  auto status = ReadFromStream(ciphertext_source.get(), header_size, &header);
+  if (status.error_code() == util::error::OUT_OF_RANGE) {
+    return InvalidFirstSegment(0);
+  }
+  if (!status.ok()) return status;
+  if (!segment_decrypter->Init(header).ok()) {
+    return InvalidFirstSegment(0);
+  }
+
+  // Read the segments sequentially and hand them over to the thread pool.
+  // A segment is dispatched only once the read of the subsequent segment
+  // has shown whether it is the last segment of the stream.
+  if (num_threads < 1) num_threads = 1;
+  VerificationState state;
+  SegmentSlots slots(2 * num_threads);
+  std::unique_ptr<util::ThreadPool> pool;
+  if (num_threads > 1) {
+    pool = absl::make_unique<util::ThreadPool>(num_threads);
+  }
+  StreamSegmentDecrypter* decrypter = segment_decrypter.get();
+  auto dispatch = [decrypter, &state, &slots, &pool](Segment* segment) {
+    if (pool == nullptr) {
+      VerifySegment(decrypter, segment, &state);
+      slots.Release(segment);
+      return;
+    }
+    pool->Schedule([decrypter, segment, &state, &slots]() {
+      VerifySegment(decrypter, segment, &state);
+      slots.Release(segment);
+    });
+  };
+
+  int64_t segment_number = 0;
+  int64_t offset = header_size;
+  Segment* previous = nullptr;  // read, but not dispatched yet
+  while (true) {
+    Segment* current = slots.Acquire();
+    int segment_size = segment_number == 0 ?
+        first_segment_size : segment_decrypter->get_ciphertext_segment_size();
+    status = ReadFromStream(ciphertext_source.get(), segment_size,
+                            &current->ciphertext);
+    bool reached_end = status.error_code() == util::error::OUT_OF_RANGE;
+    if (!status.ok() && !reached_end) {
+      state.RecordError(status);
+      slots.Release(current);
+      if (previous != nullptr) slots.Release(previous);
+      previous = nullptr;
+      break;
+    }
+    if (reached_end && current->ciphertext.empty() && previous != nullptr) {
+      // The previous segment was the last one.
+      slots.Release(current);
+      previous->is_last = true;
+      break;
+    }
+    current->number = segment_number;
+    current->offset = offset;
+    current->is_last = reached_end;
+    if (previous != nullptr) dispatch(previous);
+    previous = current;
+    segment_number++;
+    offset += current->ciphertext.size();
+    if (reached_end) break;
+    if (state.IsDone(current->number)) {
+      // An earlier segment is not authentic, no need to read further.
+      slots.Release(previous);
+      previous = nullptr;
+      break;
+    }
+  }
+  if (previous != nullptr) dispatch(previous);
+  pool.reset();  // Waits for the verification of all dispatched segments.
+  return state.GetResult(segment_number);
+}
+
+// static
+StatusOr<VerificationResult> StreamingAeadVerifier::VerifyRandomAccessStream(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    int num_threads) {
+  if (segment_decrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_decrypter must be non-null");
+  }
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  int64_t size = ciphertext_source->size();
+  if (size < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "size of ciphertext_source is not available");
+  }
+  int64_t header_offset = segment_decrypter->get_ciphertext_offset();
+  int header_size = segment_decrypter->get_header_size();
+  int64_t ct_segment_size = segment_decrypter->get_ciphertext_segment_size();
+  if (ct_segment_size - header_offset - header_size <= 0) {
+    return Status(util::error::INTERNAL,
+                  "Size of the first segment must be greater than 0.");
+  }
+
+  // Read and process the header.
+  std::vector<uint8_t> header;
+  auto status = ReadFromStream(ciphertext_source.get(), header_offset,
+                               header_size, &header);
+  if (status.error_code() == util::error::OUT_OF_RANGE) {
+    return InvalidFirstSegment(header_offset);
+  }
+  if (!status.ok()) return status;
+  if (!segment_decrypter->Init(header).ok()) {
+    return InvalidFirstSegment(header_offset);
+  }
+
+  // The ciphertext segments are aligned with multiples of ct_segment_size,
+  // except for the first one, which follows the header.
+  int64_t segment_count = size <= ct_segment_size ?
+      1 : (size + ct_segment_size - 1) / ct_segment_size;
+  int64_t first_segment_start = header_offset + header_size;
+  VerificationState state;
+  std::atomic<int64_t> next_segment(0);
+  StreamSegmentDecrypter* decrypter = segment_decrypter.get();
+  RandomAccessStream* source = ciphertext_source.get();
+  auto verify_segments = [&]() {
+    Segment segment;
+    while (true) {
+      int64_t number = next_segment++;
+      if (number >= segment_count || state.IsDone(number)) return;
+      int64_t start =
+          number == 0 ? first_segment_start : number * ct_segment_size;
+      int64_t end = std::min((number + 1) * ct_segment_size, size);
+      segment.number = number;
+      segment.offset = start;
+      segment.is_last = (number == segment_count - 1);
+      auto read_status = ReadFromStream(
+          source, start, std::max<int64_t>(end - start, 0),
+          &segment.ciphertext);
+      if (!read_status.ok() &&
+          read_status.error_code() != util::error::OUT_OF_RANGE) {
+        state.RecordError(read_status);
+        return;
+      }
+      VerifySegment(decrypter, &segment, &state);
+    }
+  };
+
+  if (num_threads > segment_count) num_threads = segment_count;
+  if (num_threads <= 1) {
+    verify_segments();
+  } else {
+    util::ThreadPool pool(num_threads);
+    for (int i = 0; i < num_threads; i++) {
+      pool.Schedule(verify_segments);
+    }
+  }  // The destructor of the pool waits for all the workers.
+  return state.GetResult(segment_count);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,75 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_STREAMING_AEAD_VERIFIER_H_
+#define TINK_SUBTLE_STREAMING_AEAD_VERIFIER_H_
+
+#include <memory>
+
+#include "tink/input_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Authenticates ciphertext streams produced by StreamingAeadEncryptingStream
+// without returning any plaintext.
+//
+// The segments of a ciphertext are independent of each other once
+// the header has been processed, so they are verified in parallel
+// on 'num_threads' threads, each of which decrypts to a scratch buffer
+// that is reused for subsequent segments.  The verification stops
+// at the first segment that fails authentication.
+//
+// 'segment_decrypter' must be a fresh (not initialized) decrypter,
+// whose DecryptSegment() is safe to call concurrently (with distinct
+// plaintext buffers) once it has been initialized.
+class StreamingAeadVerifier {
+ public:
+  // Verifies the ciphertext read from 'ciphertext_source', which must
+  // start with the header of the ciphertext stream, i.e. the first
+  // get_ciphertext_offset() bytes of the ciphertext must have been
+  // consumed already.  Ciphertext segments are read sequentially,
+  // and verified while the subsequent segments are being read.
+  // The offsets reported in the result are relative to the beginning
+  // of 'ciphertext_source'.
+  static crypto::tink::util::StatusOr<StreamingAead::VerificationResult>
+  VerifyStream(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      int num_threads);
+
+  // Verifies the ciphertext read from 'ciphertext_source', in which
+  // the header of the ciphertext stream starts at get_ciphertext_offset().
+  // The segments are read in parallel, so 'ciphertext_source' must support
+  // concurrent PRead()-calls, and must have a known size().
+  // The offsets reported in the result are positions in 'ciphertext_source'.
+  static crypto::tink::util::StatusOr<StreamingAead::VerificationResult>
+  VerifyRandomAccessStream(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      int num_threads);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_STREAMING_AEAD_VERIFIER_H_
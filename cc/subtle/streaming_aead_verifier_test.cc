@@ -0,0 +1,250 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/streaming_aead_verifier.h"
+
+#include <sstream>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/input_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/file_random_access_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using crypto::tink::subtle::test::DummyStreamSegmentDecrypter;
+using crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+const int kHeaderSize = 10;
+
+// Returns an InputStream with the specified contents.
+std::unique_ptr<InputStream> GetInputStream(absl::string_view contents) {
+  auto string_stream =
+      absl::make_unique<std::stringstream>(std::string(contents));
+  return {absl::make_unique<util::IstreamInputStream>(
+      std::move(string_stream))};
+}
+
+// Returns a RandomAccessStream with the specified contents.
+std::unique_ptr<RandomAccessStream> GetRandomAccessStream(
+    absl::string_view contents) {
+  static int index = 1;
+  std::string filename = absl::StrCat("verifier_data_file_", index, ".txt");
+  index++;
+  int input_fd = crypto::tink::test::GetTestFileDescriptor(filename, contents);
+  return {absl::make_unique<util::FileRandomAccessStream>(input_fd)};
+}
+
+// Verifies 'ciphertext' using a DummyStreamSegmentDecrypter, reading it
+// via an InputStream (if 'random_access' is false) or a RandomAccessStream.
+// In the latter case 'ct_offset' bytes are prepended to the ciphertext.
+util::StatusOr<StreamingAead::VerificationResult> Verify(
+    int pt_segment_size, int ct_offset, absl::string_view ciphertext,
+    bool random_access, int num_threads) {
+  auto seg_dec = absl::make_unique<DummyStreamSegmentDecrypter>(
+      pt_segment_size, kHeaderSize, ct_offset);
+  if (!random_access) {
+    return StreamingAeadVerifier::VerifyStream(
+        std::move(seg_dec), GetInputStream(ciphertext), num_threads);
+  }
+  std::string ct_with_offset = std::string(ct_offset, 'o');
+  ct_with_offset.append(ciphertext.data(), ciphertext.size());
+  return StreamingAeadVerifier::VerifyRandomAccessStream(
+      std::move(seg_dec), GetRandomAccessStream(ct_with_offset), num_threads);
+}
+
+// Returns the offsets (relative to the beginning of the header)
+// of all the segments of a ciphertext of size 'ct_size'.
+std::vector<int64_t> GetSegmentOffsets(int pt_segment_size, int ct_offset,
+                                       int64_t ct_size) {
+  int ct_segment_size =
+      pt_segment_size + DummyStreamSegmentEncrypter::kSegmentTagSize;
+  std::vector<int64_t> offsets;
+  int64_t offset = kHeaderSize;
+  int64_t segment_size = ct_segment_size - ct_offset - kHeaderSize;
+  do {
+    offsets.push_back(offset);
+    offset += segment_size;
+    segment_size = ct_segment_size;
+  } while (offset < ct_size);
+  return offsets;
+}
+
+class StreamingAeadVerifierTest : public ::testing::TestWithParam<bool> {
+};
+
+TEST_P(StreamingAeadVerifierTest, AuthenticCiphertexts) {
+  bool random_access = GetParam();
+  for (int pt_size : {0, 1, 10, 100, 1000, 10000, 100000}) {
+    for (int pt_segment_size : {64, 100, 1024}) {
+      for (int ct_offset : {0, 5, 15}) {
+        for (int num_threads : {1, 4}) {
+          SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                    ", pt_segment_size = ", pt_segment_size,
+                                    ", ct_offset = ", ct_offset,
+                                    ", num_threads = ", num_threads));
+          DummyStreamSegmentEncrypter seg_enc(pt_segment_size, kHeaderSize,
+                                              ct_offset);
+          std::string ct =
+              seg_enc.GenerateCiphertext(Random::GetRandomBytes(pt_size));
+          auto result = Verify(pt_segment_size, ct_offset, ct, random_access,
+                               num_threads);
+          ASSERT_THAT(result.status(), IsOk());
+          EXPECT_TRUE(result.ValueOrDie().is_authentic());
+          EXPECT_EQ(-1, result.ValueOrDie().first_invalid_segment);
+          EXPECT_EQ(-1, result.ValueOrDie().first_invalid_segment_offset);
+          EXPECT_EQ(
+              GetSegmentOffsets(pt_segment_size, ct_offset, ct.size()).size(),
+              result.ValueOrDie().verified_segments);
+        }
+      }
+    }
+  }
+}
+
+TEST_P(StreamingAeadVerifierTest, CorruptedSegments) {
+  bool random_access = GetParam();
+  int pt_segment_size = 100;
+  int pt_size = 2000;
+  for (int ct_offset : {0, 7}) {
+    for (int num_threads : {1, 3, 8}) {
+      DummyStreamSegmentEncrypter seg_enc(pt_segment_size, kHeaderSize,
+                                          ct_offset);
+      std::string ct =
+          seg_enc.GenerateCiphertext(Random::GetRandomBytes(pt_size));
+      auto offsets = GetSegmentOffsets(pt_segment_size, ct_offset, ct.size());
+      for (int64_t segment : {0, 1, 5, 12}) {
+        SCOPED_TRACE(absl::StrCat("ct_offset = ", ct_offset,
+                                  ", num_threads = ", num_threads,
+                                  ", segment = ", segment));
+        // Corrupt the segment number stored in the segment, as well as
+        // the subsequent segment.
+        int64_t segment_end = offsets[segment + 1];
+        std::string corrupted_ct = ct;
+        corrupted_ct[segment_end - 2] ^= 1;
+        corrupted_ct[offsets[segment + 2] - 2] ^= 1;
+        auto result = Verify(pt_segment_size, ct_offset, corrupted_ct,
+                             random_access, num_threads);
+        ASSERT_THAT(result.status(), IsOk());
+        EXPECT_FALSE(result.ValueOrDie().is_authentic());
+        EXPECT_EQ(segment, result.ValueOrDie().first_invalid_segment);
+        EXPECT_EQ(segment, result.ValueOrDie().verified_segments);
+        int64_t expected_offset =
+            offsets[segment] + (random_access ? ct_offset : 0);
+        EXPECT_EQ(expected_offset,
+                  result.ValueOrDie().first_invalid_segment_offset);
+      }
+    }
+  }
+}
+
+TEST_P(StreamingAeadVerifierTest, TruncatedCiphertext) {
+  bool random_access = GetParam();
+  int pt_segment_size = 100;
+  int ct_offset = 3;
+  DummyStreamSegmentEncrypter seg_enc(pt_segment_size, kHeaderSize, ct_offset);
+  std::string ct = seg_enc.GenerateCiphertext(Random::GetRandomBytes(1000));
+  auto offsets = GetSegmentOffsets(pt_segment_size, ct_offset, ct.size());
+  int64_t last_segment = offsets.size() - 1;
+
+  // Drop the last segment: the previous one is not marked as last.
+  auto result = Verify(pt_segment_size, ct_offset,
+                       ct.substr(0, offsets[last_segment]), random_access, 4);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(last_segment - 1, result.ValueOrDie().first_invalid_segment);
+
+  // Drop a part of the last segment.
+  result = Verify(pt_segment_size, ct_offset, ct.substr(0, ct.size() - 1),
+                  random_access, 4);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(last_segment, result.ValueOrDie().first_invalid_segment);
+
+  // Append garbage: the last segment is not the last one any more.
+  result = Verify(pt_segment_size, ct_offset, absl::StrCat(ct, "garbage"),
+                  random_access, 4);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(last_segment, result.ValueOrDie().first_invalid_segment);
+}
+
+TEST_P(StreamingAeadVerifierTest, InvalidHeader) {
+  bool random_access = GetParam();
+  int pt_segment_size = 100;
+  int ct_offset = 5;
+  DummyStreamSegmentEncrypter seg_enc(pt_segment_size, kHeaderSize, ct_offset);
+  std::string ct = seg_enc.GenerateCiphertext(Random::GetRandomBytes(1000));
+  int64_t header_offset = random_access ? ct_offset : 0;
+
+  std::string corrupted_ct = ct;
+  corrupted_ct[1] ^= 1;
+  for (const std::string& invalid_ct : {std::string(""),
+                                        ct.substr(0, kHeaderSize - 1),
+                                        corrupted_ct}) {
+    SCOPED_TRACE(absl::StrCat("ct_size = ", invalid_ct.size()));
+    auto result = Verify(pt_segment_size, ct_offset, invalid_ct,
+                         random_access, 2);
+    ASSERT_THAT(result.status(), IsOk());
+    EXPECT_EQ(0, result.ValueOrDie().first_invalid_segment);
+    EXPECT_EQ(header_offset,
+              result.ValueOrDie().first_invalid_segment_offset);
+    EXPECT_EQ(0, result.ValueOrDie().verified_segments);
+  }
+
+  // Only the header, without any segments.
+  auto result = Verify(pt_segment_size, ct_offset, ct.substr(0, kHeaderSize),
+                       random_access, 2);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(0, result.ValueOrDie().first_invalid_segment);
+  EXPECT_EQ(header_offset + kHeaderSize,
+            result.ValueOrDie().first_invalid_segment_offset);
+}
+
+INSTANTIATE_TEST_SUITE_P(StreamingAeadVerifierTests, StreamingAeadVerifierTest,
+                         testing::Bool());
+
+TEST(StreamingAeadVerifierNullTest, NullArguments) {
+  EXPECT_THAT(StreamingAeadVerifier::VerifyStream(
+                  nullptr, GetInputStream("ct"), 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAeadVerifier::VerifyStream(
+                  absl::make_unique<DummyStreamSegmentDecrypter>(
+                      100, kHeaderSize, 0), nullptr, 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StreamingAeadVerifier::VerifyRandomAccessStream(
+                  absl::make_unique<DummyStreamSegmentDecrypter>(
+                      100, kHeaderSize, 0), nullptr, 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
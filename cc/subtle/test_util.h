@@ -17,6 +17,7 @@
 #ifndef TINK_SUBTLE_TEST_UTIL_H_
 #define TINK_SUBTLE_TEST_UTIL_H_
 
+#include <atomic>
 #include <string>
 #include <vector>
 
@@ -114,6 +115,20 @@ class DummyStreamSegmentEncrypter : public StreamSegmentEncrypter {
     return util::Status::OK;
   }
 
+  util::Status EncryptSegmentAt(
+      int64_t segment_number,
+      absl::string_view plaintext,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override {
+    ciphertext_buffer->resize(plaintext.size() + kSegmentTagSize);
+    memcpy(ciphertext_buffer->data(), plaintext.data(), plaintext.size());
+    memcpy(ciphertext_buffer->data() + plaintext.size(),
+           &segment_number, sizeof(segment_number));
+    ciphertext_buffer->back() =
+        is_last_segment ? kLastSegment : kNotLastSegment;
+    return util::Status::OK;
+  }
+
   const std::vector<uint8_t>& get_header() const override {
     return header_;
   }
@@ -233,7 +248,7 @@ class DummyStreamSegmentDecrypter : public StreamSegmentDecrypter {
   std::vector<uint8_t> header_;
   int pt_segment_size_;
   int ct_offset_;
-  int64_t generated_output_size_;
+  std::atomic<int64_t> generated_output_size_;
 };   // class DummyStreamSegmentDecrypter
 
 }  // namespace test
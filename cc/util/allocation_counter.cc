@@ -0,0 +1,89 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Constant-initialized, so they can be used before main() and during
+// the construction of other thread-locals.
+thread_local int64_t thread_allocations = 0;
+thread_local int64_t thread_allocated_bytes = 0;
+
+void* CountedAllocate(std::size_t size) {
+  thread_allocations++;
+  thread_allocated_bytes += size;
+  // malloc(0) may return nullptr, but operator new must not.
+  return std::malloc(size == 0 ? 1 : size);
+}
+
+}  // namespace
+
+void* operator new(std::size_t size) {
+  void* ptr = CountedAllocate(size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new[](std::size_t size) {
+  void* ptr = CountedAllocate(size);
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+  return CountedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  std::free(ptr);
+}
+
+namespace crypto {
+namespace tink {
+namespace test {
+
+void AllocationCounter::Reset() {
+  start_allocations_ = thread_allocations;
+  start_bytes_ = thread_allocated_bytes;
+}
+
+int64_t AllocationCounter::allocations() const {
+  return thread_allocations - start_allocations_;
+}
+
+int64_t AllocationCounter::bytes() const {
+  return thread_allocated_bytes - start_bytes_;
+}
+
+}  // namespace test
+}  // namespace tink
+}  // namespace crypto
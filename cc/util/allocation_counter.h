@@ -0,0 +1,59 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_ALLOCATION_COUNTER_H_
+#define TINK_UTIL_ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+namespace crypto {
+namespace tink {
+namespace test {
+
+// Counts the heap allocations made by the current thread.
+//
+// Linking this library replaces the global operator new and operator
+// delete of the binary with versions that keep per-thread counts of the
+// allocations and of the allocated bytes, so it must be linked only into
+// tests and benchmarks.  Since the counts are per thread, allocations
+// made concurrently by other threads are not attributed to the current
+// one.
+class AllocationCounter {
+ public:
+  // Starts counting the allocations of the current thread.
+  AllocationCounter() { Reset(); }
+
+  // Restarts the counts at zero.
+  void Reset();
+
+  // Returns the number of allocations made by the current thread
+  // since the construction of this counter, or the last Reset().
+  int64_t allocations() const;
+
+  // Returns the number of bytes allocated by the current thread
+  // since the construction of this counter, or the last Reset().
+  int64_t bytes() const;
+
+ private:
+  int64_t start_allocations_;
+  int64_t start_bytes_;
+};
+
+}  // namespace test
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_ALLOCATION_COUNTER_H_
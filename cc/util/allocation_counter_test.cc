@@ -0,0 +1,114 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/allocation_counter.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace test {
+namespace {
+
+// Keeps the compiler from eliding the allocations of the tests.
+void* volatile sink;
+
+TEST(AllocationCounterTest, CountsAllocations) {
+  AllocationCounter counter;
+  EXPECT_EQ(0, counter.allocations());
+  EXPECT_EQ(0, counter.bytes());
+  std::unique_ptr<int> value(new int(42));
+  std::unique_ptr<char[]> buffer(new char[100]);
+  sink = value.get();
+  sink = buffer.get();
+  EXPECT_EQ(2, counter.allocations());
+  EXPECT_EQ(sizeof(int) + 100, counter.bytes());
+
+  // Deallocations do not change the counts.
+  value.reset();
+  buffer.reset();
+  EXPECT_EQ(2, counter.allocations());
+  EXPECT_EQ(sizeof(int) + 100, counter.bytes());
+}
+
+TEST(AllocationCounterTest, Reset) {
+  AllocationCounter counter;
+  std::unique_ptr<int> value(new int(42));
+  counter.Reset();
+  EXPECT_EQ(0, counter.allocations());
+  EXPECT_EQ(0, counter.bytes());
+  std::vector<char> buffer(50);
+  EXPECT_EQ(1, counter.allocations());
+  EXPECT_EQ(50, counter.bytes());
+}
+
+TEST(AllocationCounterTest, IgnoresOtherThreads) {
+  std::thread thread([]() {
+    AllocationCounter counter;
+    std::vector<char> buffer(1000);
+    EXPECT_EQ(1, counter.allocations());
+    EXPECT_EQ(1000, counter.bytes());
+  });
+  AllocationCounter counter;
+  thread.join();
+  EXPECT_EQ(0, counter.allocations());
+  EXPECT_EQ(0, counter.bytes());
+}
+
+TEST(AllocationMatchersTest, AllocatesAtMost) {
+  auto allocate_twice = []() {
+    std::vector<char> buffer(100);
+    std::unique_ptr<int> value(new int(42));
+    sink = buffer.data();
+    sink = value.get();
+  };
+  EXPECT_THAT(allocate_twice, AllocatesAtMost(2));
+  EXPECT_THAT(allocate_twice, AllocatesAtMost(3));
+  EXPECT_THAT(allocate_twice, testing::Not(AllocatesAtMost(1)));
+  EXPECT_THAT(allocate_twice, testing::Not(DoesNotAllocate()));
+
+  int value = 0;
+  EXPECT_THAT([&value]() { value++; }, DoesNotAllocate());
+  EXPECT_THAT([&value]() { value++; }, AllocatesAtMost(0));
+}
+
+TEST(AllocationMatchersTest, IgnoresTheFirstCall) {
+  std::unique_ptr<int> lazy_value;
+  auto get_lazy_value = [&lazy_value]() {
+    if (lazy_value == nullptr) lazy_value.reset(new int(42));
+  };
+  EXPECT_THAT(get_lazy_value, DoesNotAllocate());
+  EXPECT_NE(nullptr, lazy_value);
+}
+
+TEST(AllocationMatchersTest, Explanation) {
+  auto allocate = []() { std::vector<char> buffer(100); };
+  testing::StringMatchResultListener listener;
+  EXPECT_FALSE(testing::ExplainMatchResult(DoesNotAllocate(), allocate,
+                                           &listener));
+  EXPECT_EQ("allocates 1 times (100 bytes)", listener.str());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace tink
+}  // namespace crypto
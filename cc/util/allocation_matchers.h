@@ -0,0 +1,110 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_ALLOCATION_MATCHERS_H_
+#define TINK_UTIL_ALLOCATION_MATCHERS_H_
+
+#include <cstdint>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/util/allocation_counter.h"
+
+// Matchers for the number of heap allocations of a callable.
+//
+// They count the allocations via AllocationCounter, so a test using them
+// links the replacement operator new and operator delete of that library
+// (see allocation_counter.h); they are kept apart from test_matchers.h
+// for this reason.
+
+namespace crypto {
+namespace tink {
+namespace test {
+namespace internal {
+
+// Calls 'f' twice, and returns the number of heap allocations made
+// by the second call, so that one-time initializations do not count.
+// Sets 'bytes' to the number of bytes allocated by the second call.
+template <typename F>
+int64_t CountAllocations(const F& f, int64_t* bytes) {
+  f();
+  AllocationCounter counter;
+  f();
+  *bytes = counter.bytes();
+  return counter.allocations();
+}
+
+}  // namespace internal
+
+// Matches a callable, e.g. a lambda, that makes at most 'max_allocations'
+// heap allocations when it is called:
+//
+//   EXPECT_THAT([&]() { aead->Encrypt(plaintext, aad); },
+//               AllocatesAtMost(1));
+//
+// The callable is called twice, and only the allocations of the second
+// call are counted, so that one-time initializations do not count.
+// Only the allocations via operator new of the calling thread are counted.
+MATCHER_P(AllocatesAtMost, max_allocations,
+          std::string(negation ? "allocates more than "
+                               : "allocates at most ") +
+              ::testing::PrintToString(max_allocations) + " times") {
+  int64_t bytes;
+  int64_t allocations = internal::CountAllocations(arg, &bytes);
+  *result_listener << "allocates " << allocations << " times (" << bytes
+                   << " bytes)";
+  return allocations <= max_allocations;
+}
+
+// Matches a callable that makes no heap allocations when it is called,
+// like AllocatesAtMost(0).
+MATCHER(DoesNotAllocate, negation ? "allocates" : "does not allocate") {
+  int64_t bytes;
+  int64_t allocations = internal::CountAllocations(arg, &bytes);
+  *result_listener << "allocates " << allocations << " times (" << bytes
+                   << " bytes)";
+  return allocations == 0;
+}
+
+// Matches a callable that makes at most 'extra_allocations' heap
+// allocations more than the callable 'baseline', e.g. a wrapper
+// compared with the primitive it wraps:
+//
+//   EXPECT_THAT([&]() { wrapped->Encrypt(plaintext, aad); },
+//               AllocatesAtMostMoreThan(
+//                   [&]() { raw->Encrypt(plaintext, aad); }, 1));
+//
+// Both callables are counted as by AllocatesAtMost().
+MATCHER_P2(AllocatesAtMostMoreThan, baseline, extra_allocations,
+           std::string(negation ? "allocates more than "
+                                : "allocates at most ") +
+               ::testing::PrintToString(extra_allocations) +
+               " times more than the baseline") {
+  int64_t bytes;
+  int64_t baseline_allocations = internal::CountAllocations(baseline, &bytes);
+  int64_t allocations = internal::CountAllocations(arg, &bytes);
+  *result_listener << "allocates " << allocations << " times (" << bytes
+                   << " bytes), the baseline " << baseline_allocations
+                   << " times";
+  return allocations <= baseline_allocations + extra_allocations;
+}
+
+}  // namespace test
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_ALLOCATION_MATCHERS_H_
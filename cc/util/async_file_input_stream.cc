@@ -0,0 +1,170 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/async_file_input_stream.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Attempts to read 'count' bytes of data data from file descriptor fd
+// to 'buf' while ignoring EINTR.
+int read_ignoring_eintr(int fd, void *buf, size_t count) {
+  int result;
+  do {
+    result = read(fd, buf, count);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+}  // anonymous namespace
+
+AsyncFileInputStream::AsyncFileInputStream(int file_descriptor,
+                                           int buffer_size, int num_buffers)
+    : fd_(file_descriptor),
+      buffer_size_(buffer_size > 0 ? buffer_size : 128 * 1024),  // 128 KB
+      read_status_(Status::OK),
+      stopping_(false),
+      status_(Status::OK),
+      position_(0),
+      current_buffer_(-1),
+      count_in_buffer_(0),
+      count_backedup_(0),
+      buffer_offset_(0) {
+  // At least two buffers are needed to overlap reading with consuming.
+  if (num_buffers < 2) num_buffers = 3;
+  for (int i = 0; i < num_buffers; i++) {
+    buffers_.push_back(absl::make_unique<uint8_t[]>(buffer_size_));
+    free_buffers_.push_back(i);
+  }
+  counts_.resize(num_buffers, 0);
+  reader_ = std::thread(&AsyncFileInputStream::ReadLoop, this);
+}
+
+bool AsyncFileInputStream::HasDataOrEnded() const {
+  return !filled_buffers_.empty() || !read_status_.ok();
+}
+
+bool AsyncFileInputStream::HasFreeBufferOrStopping() const {
+  return !free_buffers_.empty() || stopping_;
+}
+
+void AsyncFileInputStream::ReadLoop() {
+  while (true) {
+    int index;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          this, &AsyncFileInputStream::HasFreeBufferOrStopping));
+      if (stopping_) return;
+      index = free_buffers_.front();
+      free_buffers_.pop_front();
+    }
+    // The buffer is owned by this thread until it is added to filled_buffers_.
+    int read_result =
+        read_ignoring_eintr(fd_, buffers_[index].get(), buffer_size_);
+    absl::MutexLock lock(&mutex_);
+    if (read_result <= 0) {  // EOF or an I/O error.
+      if (read_result == 0) {
+        read_status_ = Status(util::error::OUT_OF_RANGE, "EOF");
+      } else {
+        read_status_ =
+            ToStatusF(util::error::INTERNAL, "I/O error: %d", errno);
+      }
+      free_buffers_.push_back(index);
+      return;
+    }
+    counts_[index] = read_result;
+    filled_buffers_.push_back(index);
+  }
+}
+
+crypto::tink::util::StatusOr<int> AsyncFileInputStream::Next(
+    const void** data) {
+  if (!status_.ok()) return status_;
+  if (count_backedup_ > 0) {  // Return the backed-up bytes.
+    buffer_offset_ = buffer_offset_ + (count_in_buffer_ - count_backedup_);
+    count_in_buffer_ = count_backedup_;
+    count_backedup_ = 0;
+    *data = buffers_[current_buffer_].get() + buffer_offset_;
+    position_ = position_ + count_in_buffer_;
+    return count_in_buffer_;
+  }
+  absl::MutexLock lock(&mutex_);
+  if (current_buffer_ >= 0) {  // Hand the consumed buffer back for reading.
+    free_buffers_.push_back(current_buffer_);
+    current_buffer_ = -1;
+  }
+  mutex_.Await(absl::Condition(this, &AsyncFileInputStream::HasDataOrEnded));
+  if (filled_buffers_.empty()) {
+    status_ = read_status_;
+    return status_;
+  }
+  current_buffer_ = filled_buffers_.front();
+  filled_buffers_.pop_front();
+  buffer_offset_ = 0;
+  count_in_buffer_ = counts_[current_buffer_];
+  position_ = position_ + count_in_buffer_;
+  *data = buffers_[current_buffer_].get();
+  return count_in_buffer_;
+}
+
+void AsyncFileInputStream::BackUp(int count) {
+  if (!status_.ok() || count < 1 || count_backedup_ == count_in_buffer_) return;
+  int actual_count = std::min(count, count_in_buffer_ - count_backedup_);
+  count_backedup_ = count_backedup_ + actual_count;
+  position_ = position_ - actual_count;
+}
+
+AsyncFileInputStream::~AsyncFileInputStream() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  reader_.join();
+  close_ignoring_eintr(fd_);
+}
+
+int64_t AsyncFileInputStream::Position() const {
+  return position_;
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,92 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_ASYNC_FILE_INPUT_STREAM_H_
+#define TINK_UTIL_ASYNC_FILE_INPUT_STREAM_H_
+
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// An InputStream that reads from a file descriptor with read-ahead:
+// a background thread keeps reading into a ring of 'num_buffers' buffers,
+// so that the data returned by Next() is usually available already,
+// and the consumer (e.g. a decrypting stream) does not wait for the disk.
+// Meant for regular files: the destructor waits for a pending read().
+class AsyncFileInputStream : public crypto::tink::InputStream {
+ public:
+  // Constructs an InputStream that will read from the file specified
+  // via 'file_descriptor', using 'num_buffers' buffers of 'buffer_size'
+  // bytes each (if no legal values are given, reasonable defaults are used).
+  // Takes the ownership of the file, and will close it upon destruction.
+  explicit AsyncFileInputStream(int file_descriptor, int buffer_size = -1,
+                                int num_buffers = -1);
+
+  ~AsyncFileInputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(const void** data) override;
+
+  void BackUp(int count) override;
+
+  int64_t Position() const override;
+
+ private:
+  // Returns true iff a filled buffer is available or reading has ended.
+  bool HasDataOrEnded() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns true iff a free buffer is available or the stream is stopping.
+  bool HasFreeBufferOrStopping() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // The loop of the background thread, which fills free buffers.
+  void ReadLoop();
+
+  const int fd_;
+  const int buffer_size_;
+  std::vector<std::unique_ptr<uint8_t[]>> buffers_;
+  std::vector<int> counts_;  // # of bytes read into each of buffers_
+
+  absl::Mutex mutex_;
+  std::deque<int> free_buffers_ GUARDED_BY(mutex_);    // indices of buffers_
+  std::deque<int> filled_buffers_ GUARDED_BY(mutex_);  // indices of buffers_
+  // The status of the background thread, non-OK once it has stopped reading.
+  util::Status read_status_ GUARDED_BY(mutex_);
+  bool stopping_ GUARDED_BY(mutex_);
+  std::thread reader_;
+
+  // The state of the consumer, accessed only by Next() and BackUp().
+  util::Status status_;
+  int64_t position_;      // current position in the file (from the beginning)
+  int current_buffer_;    // index of the buffer returned by Next(), or -1
+  int count_in_buffer_;   // # of bytes available in the current buffer
+  int count_backedup_;    // # of bytes in the current buffer backed up
+  int buffer_offset_;     // offset at which the returned bytes start
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_ASYNC_FILE_INPUT_STREAM_H_
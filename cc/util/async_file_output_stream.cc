@@ -0,0 +1,209 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/async_file_output_stream.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/output_stream.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Attempts to write 'count' bytes of data data from 'buf'
+// to file descriptor fd, while ignoring EINTR.
+int write_ignoring_eintr(int fd, const void *buf, size_t count) {
+  int result;
+  do {
+    result = write(fd, buf, count);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Writes all the 'count' bytes from 'buf' to file descriptor fd.
+Status WriteFully(int fd, const uint8_t* buf, int count) {
+  int total_written = 0;
+  while (total_written < count) {
+    int write_result =
+        write_ignoring_eintr(fd, buf + total_written, count - total_written);
+    if (write_result < 0) {  // An I/O error occurred.
+      return ToStatusF(
+          util::error::INTERNAL, "I/O error upon write: %d", errno);
+    } else if (write_result == 0) {  // No progress, hence abort.
+      return ToStatusF(util::error::INTERNAL,
+                       "I/O error: failed to write %d bytes.",
+                       count - total_written);
+    }
+    total_written += write_result;
+  }
+  return Status::OK;
+}
+
+}  // anonymous namespace
+
+AsyncFileOutputStream::AsyncFileOutputStream(int file_descriptor,
+                                             int buffer_size, int num_buffers)
+    : fd_(file_descriptor),
+      buffer_size_(buffer_size > 0 ? buffer_size : 128 * 1024),  // 128 KB
+      write_status_(Status::OK),
+      stopping_(false),
+      status_(Status::OK),
+      position_(0),
+      current_buffer_(-1),
+      count_in_buffer_(0),
+      count_backedup_(0),
+      buffer_offset_(0) {
+  // At least two buffers are needed to overlap writing with producing.
+  if (num_buffers < 2) num_buffers = 3;
+  for (int i = 0; i < num_buffers; i++) {
+    buffers_.push_back(absl::make_unique<uint8_t[]>(buffer_size_));
+    free_buffers_.push_back(i);
+  }
+  counts_.resize(num_buffers, 0);
+  writer_ = std::thread(&AsyncFileOutputStream::WriteLoop, this);
+}
+
+bool AsyncFileOutputStream::HasFreeBufferOrFailed() const {
+  return !free_buffers_.empty() || !write_status_.ok();
+}
+
+bool AsyncFileOutputStream::HasPendingBufferOrStopping() const {
+  return !pending_buffers_.empty() || stopping_;
+}
+
+void AsyncFileOutputStream::WriteLoop() {
+  while (true) {
+    int index;
+    bool failed;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(
+          this, &AsyncFileOutputStream::HasPendingBufferOrStopping));
+      if (pending_buffers_.empty()) return;  // Stopping, and all written.
+      index = pending_buffers_.front();
+      pending_buffers_.pop_front();
+      failed = !write_status_.ok();
+    }
+    // After a failure the remaining data is dropped, as the file is corrupt.
+    Status status = failed ? Status::OK
+                           : WriteFully(fd_, buffers_[index].get(),
+                                        counts_[index]);
+    absl::MutexLock lock(&mutex_);
+    if (!status.ok()) write_status_ = status;
+    free_buffers_.push_back(index);
+  }
+}
+
+crypto::tink::util::StatusOr<int> AsyncFileOutputStream::Next(void** data) {
+  if (!status_.ok()) return status_;
+
+  // If some space was backed up, return it first.
+  if (count_backedup_ > 0) {
+    int backedup = count_backedup_;
+    buffer_offset_ = count_in_buffer_;
+    count_in_buffer_ = count_in_buffer_ + backedup;
+    count_backedup_ = 0;
+    position_ = position_ + backedup;
+    *data = buffers_[current_buffer_].get() + buffer_offset_;
+    return backedup;
+  }
+
+  absl::MutexLock lock(&mutex_);
+  if (current_buffer_ >= 0) {  // Hand the filled buffer over for writing.
+    counts_[current_buffer_] = count_in_buffer_;
+    pending_buffers_.push_back(current_buffer_);
+    current_buffer_ = -1;
+  }
+  mutex_.Await(
+      absl::Condition(this, &AsyncFileOutputStream::HasFreeBufferOrFailed));
+  if (!write_status_.ok()) {
+    status_ = write_status_;
+    return status_;
+  }
+  current_buffer_ = free_buffers_.front();
+  free_buffers_.pop_front();
+  count_in_buffer_ = buffer_size_;
+  count_backedup_ = 0;
+  buffer_offset_ = 0;
+  position_ = position_ + buffer_size_;
+  *data = buffers_[current_buffer_].get();
+  return buffer_size_;
+}
+
+void AsyncFileOutputStream::BackUp(int count) {
+  if (!status_.ok() || count < 1 || current_buffer_ < 0) return;
+  int actual_count = std::min(count, count_in_buffer_ - buffer_offset_);
+  count_backedup_ += actual_count;
+  count_in_buffer_ -= actual_count;
+  position_ -= actual_count;
+}
+
+AsyncFileOutputStream::~AsyncFileOutputStream() {
+  Close().IgnoreError();
+}
+
+Status AsyncFileOutputStream::Close() {
+  if (!writer_.joinable()) return status_;  // Already closed.
+  Status result = status_;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (result.ok() && current_buffer_ >= 0 && count_in_buffer_ > 0) {
+      counts_[current_buffer_] = count_in_buffer_;
+      pending_buffers_.push_back(current_buffer_);
+    }
+    current_buffer_ = -1;
+    stopping_ = true;
+  }
+  writer_.join();  // Waits until all the pending buffers are written.
+  if (result.ok()) {
+    absl::MutexLock lock(&mutex_);
+    result = write_status_;
+  }
+  if (close_ignoring_eintr(fd_) == -1 && result.ok()) {
+    result = ToStatusF(
+        util::error::INTERNAL, "I/O error upon close: %d", errno);
+  }
+  status_ = Status(util::error::FAILED_PRECONDITION, "Stream closed");
+  return result;
+}
+
+int64_t AsyncFileOutputStream::Position() const {
+  return position_;
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,96 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_ASYNC_FILE_OUTPUT_STREAM_H_
+#define TINK_UTIL_ASYNC_FILE_OUTPUT_STREAM_H_
+
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// An OutputStream that writes to a file descriptor with write-behind:
+// Next() hands the filled buffer to a background thread and returns
+// a fresh one from a ring of 'num_buffers' buffers, so that the producer
+// (e.g. an encrypting stream) does not wait while the data is flushed.
+// Errors of the background writes are reported by subsequent calls
+// to Next() or Close().
+class AsyncFileOutputStream : public crypto::tink::OutputStream {
+ public:
+  // Constructs an OutputStream that will write to the file specified
+  // via 'file_descriptor', using 'num_buffers' buffers of 'buffer_size'
+  // bytes each (if no legal values are given, reasonable defaults are used).
+  // Takes the ownership of the file, and will close it upon destruction.
+  explicit AsyncFileOutputStream(int file_descriptor, int buffer_size = -1,
+                                 int num_buffers = -1);
+
+  ~AsyncFileOutputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(void** data) override;
+
+  void BackUp(int count) override;
+
+  crypto::tink::util::Status Close() override;
+
+  int64_t Position() const override;
+
+ private:
+  // Returns true iff a free buffer is available or a write has failed.
+  bool HasFreeBufferOrFailed() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns true iff a buffer is pending to be written or the stream
+  // is stopping.
+  bool HasPendingBufferOrStopping() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // The loop of the background thread, which writes the pending buffers.
+  void WriteLoop();
+
+  const int fd_;
+  const int buffer_size_;
+  std::vector<std::unique_ptr<uint8_t[]>> buffers_;
+  std::vector<int> counts_;  // # of bytes to be written from each of buffers_
+
+  absl::Mutex mutex_;
+  std::deque<int> free_buffers_ GUARDED_BY(mutex_);     // indices of buffers_
+  std::deque<int> pending_buffers_ GUARDED_BY(mutex_);  // indices of buffers_
+  // The status of the background writes, non-OK after the first failure.
+  util::Status write_status_ GUARDED_BY(mutex_);
+  bool stopping_ GUARDED_BY(mutex_);
+  std::thread writer_;
+
+  // The state of the producer, accessed only by Next(), BackUp(), Close().
+  util::Status status_;
+  int64_t position_;     // current position in the file (from the beginning)
+  int current_buffer_;   // index of the buffer returned by Next(), or -1
+  int count_in_buffer_;  // # of bytes in the current buffer to be written
+  int count_backedup_;   // # of bytes in the current buffer backed up
+  int buffer_offset_;    // offset where the last returned *data starts
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_ASYNC_FILE_OUTPUT_STREAM_H_
@@ -0,0 +1,156 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/base64.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "absl/strings/escaping.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+const char kAlphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Set in the table entries of characters outside of the alphabet.
+// The entries of valid characters use only the low 24 bits.
+const uint32_t kInvalid = 0x01000000;
+
+// For each of the four positions in a group of encoded characters,
+// the 6-bit value of every character already shifted to its position
+// in the 24-bit decoded group, so that a group is decoded by OR-ing
+// four lookups, and all the validity checks of a string are folded
+// into a single test at the end.
+struct DecodingTables {
+  uint32_t shifted[4][256];
+
+  DecodingTables() {
+    for (int pos = 0; pos < 4; pos++) {
+      for (int c = 0; c < 256; c++) shifted[pos][c] = kInvalid;
+      for (int i = 0; i < 64; i++) {
+        uint8_t c = static_cast<uint8_t>(kAlphabet[i]);
+        shifted[pos][c] = static_cast<uint32_t>(i) << (18 - 6 * pos);
+      }
+    }
+  }
+};
+
+const DecodingTables& GetDecodingTables() {
+  static const DecodingTables* tables = new DecodingTables();
+  return *tables;
+}
+
+// Decodes 'encoded' if it is canonical base64, i.e. it consists only
+// of characters of the alphabet, optionally followed by padding,
+// and the unused bits of the last group are zero.  Returns false
+// otherwise, without deciding whether 'encoded' is valid.
+bool DecodeCanonical(absl::string_view encoded, std::string* decoded) {
+  size_t size = encoded.size();
+  if (size % 4 == 0 && size > 0 && encoded[size - 1] == '=') {
+    size--;
+    if (encoded[size - 1] == '=') size--;
+  }
+  size_t groups = size / 4;
+  size_t remainder = size % 4;
+  if (remainder == 1) return false;
+  decoded->resize(3 * groups + (remainder == 0 ? 0 : remainder - 1));
+
+  const uint32_t (&t)[4][256] = GetDecodingTables().shifted;
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(encoded.data());
+  char* out = &(*decoded)[0];
+  uint32_t all_bits = 0;
+  for (size_t i = 0; i < groups; i++) {
+    uint32_t group = t[0][in[0]] | t[1][in[1]] | t[2][in[2]] | t[3][in[3]];
+    all_bits |= group;
+    out[0] = static_cast<char>(group >> 16);
+    out[1] = static_cast<char>(group >> 8);
+    out[2] = static_cast<char>(group);
+    in += 4;
+    out += 3;
+  }
+  if (remainder == 2) {
+    uint32_t group = t[0][in[0]] | t[1][in[1]];
+    if ((group & 0xffff) != 0) return false;
+    all_bits |= group;
+    out[0] = static_cast<char>(group >> 16);
+  } else if (remainder == 3) {
+    uint32_t group = t[0][in[0]] | t[1][in[1]] | t[2][in[2]];
+    if ((group & 0xff) != 0) return false;
+    all_bits |= group;
+    out[0] = static_cast<char>(group >> 16);
+    out[1] = static_cast<char>(group >> 8);
+  }
+  return (all_bits & kInvalid) == 0;
+}
+
+// The pairs of characters that encode each 12-bit value, so that
+// a group of three bytes is encoded with two lookups.
+struct EncodingTable {
+  char pairs[4096][2];
+
+  EncodingTable() {
+    for (int i = 0; i < 4096; i++) {
+      pairs[i][0] = kAlphabet[i >> 6];
+      pairs[i][1] = kAlphabet[i & 0x3f];
+    }
+  }
+};
+
+const EncodingTable& GetEncodingTable() {
+  static const EncodingTable* table = new EncodingTable();
+  return *table;
+}
+
+}  // namespace
+
+void Base64Encode(absl::string_view data, std::string* encoded) {
+  size_t groups = data.size() / 3;
+  size_t remainder = data.size() % 3;
+  encoded->resize(4 * (groups + (remainder == 0 ? 0 : 1)));
+
+  const char (&pairs)[4096][2] = GetEncodingTable().pairs;
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+  char* out = &(*encoded)[0];
+  for (size_t i = 0; i < groups; i++) {
+    uint32_t group = (in[0] << 16) | (in[1] << 8) | in[2];
+    std::memcpy(out, pairs[group >> 12], 2);
+    std::memcpy(out + 2, pairs[group & 0xfff], 2);
+    in += 3;
+    out += 4;
+  }
+  if (remainder != 0) {
+    uint32_t group = (in[0] << 16) | (remainder == 2 ? in[1] << 8 : 0);
+    out[0] = kAlphabet[group >> 18];
+    out[1] = kAlphabet[(group >> 12) & 0x3f];
+    out[2] = remainder == 2 ? kAlphabet[(group >> 6) & 0x3f] : '=';
+    out[3] = '=';
+  }
+}
+
+bool Base64Decode(absl::string_view encoded, std::string* decoded) {
+  if (DecodeCanonical(encoded, decoded)) return true;
+  // Rare: leave the handling of non-canonical inputs to absl.
+  return absl::Base64Unescape(encoded, decoded);
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
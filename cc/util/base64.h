@@ -0,0 +1,49 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_BASE64_H_
+#define TINK_UTIL_BASE64_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// Base64 encoding with the standard alphabet (RFC 4648, Section 4),
+// as used by the JSON keyset format.
+//
+// Both functions write their output in place, without intermediate
+// copies, and process a group of four encoded characters per step
+// using lookup tables, without per-character branches.
+
+// Encodes 'data' into 'encoded' (replacing its contents), with padding.
+void Base64Encode(absl::string_view data, std::string* encoded);
+
+// Decodes 'encoded' into 'decoded' (replacing its contents).
+// Padding is optional.  Inputs that are not canonical (e.g. that contain
+// whitespace) are accepted iff absl::Base64Unescape() accepts them.
+// Returns false if 'encoded' is not valid base64, in which case
+// the contents of 'decoded' are unspecified.
+bool Base64Decode(absl::string_view encoded, std::string* decoded);
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_BASE64_H_
@@ -0,0 +1,93 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/base64.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/random.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+TEST(Base64Test, TestVectors) {
+  // From RFC 4648, Section 10.
+  struct {
+    std::string data;
+    std::string encoded;
+  } test_vectors[] = {
+      {"", ""},
+      {"f", "Zg=="},
+      {"fo", "Zm8="},
+      {"foo", "Zm9v"},
+      {"foob", "Zm9vYg=="},
+      {"fooba", "Zm9vYmE="},
+      {"foobar", "Zm9vYmFy"},
+  };
+  for (const auto& test_vector : test_vectors) {
+    std::string encoded = "previous contents";
+    Base64Encode(test_vector.data, &encoded);
+    EXPECT_EQ(test_vector.encoded, encoded);
+    std::string decoded = "previous contents";
+    EXPECT_TRUE(Base64Decode(test_vector.encoded, &decoded));
+    EXPECT_EQ(test_vector.data, decoded);
+  }
+}
+
+TEST(Base64Test, MatchesAbsl) {
+  for (int size = 0; size < 300; size++) {
+    SCOPED_TRACE(absl::StrCat("size = ", size));
+    std::string data = subtle::Random::GetRandomBytes(size);
+    std::string encoded;
+    Base64Encode(data, &encoded);
+    EXPECT_EQ(absl::Base64Escape(data), encoded);
+    std::string decoded;
+    EXPECT_TRUE(Base64Decode(encoded, &decoded));
+    EXPECT_EQ(data, decoded);
+  }
+}
+
+TEST(Base64Test, DecodesWithoutPadding) {
+  std::string decoded;
+  EXPECT_TRUE(Base64Decode("Zm9vYg", &decoded));
+  EXPECT_EQ("foob", decoded);
+  EXPECT_TRUE(Base64Decode("Zm9vYmE", &decoded));
+  EXPECT_EQ("fooba", decoded);
+}
+
+TEST(Base64Test, NonCanonicalInputsAreDecodedLikeAbsl) {
+  for (const std::string& encoded :
+       {"Zm9v\nYmFy", " Zm9vYmE=", "Zm9vYmE=\n", "Zm9vYmF=", "Zm9vYh==",
+        "Zm9vYmE", "Zm9vY", "Zm9vYmE==", "Zm9v=mFy", "Zm9v-_Fy", "Zm9v\xffmFy",
+        "=", "==", "===", "===="}) {
+    SCOPED_TRACE(absl::StrCat("encoded = '", absl::CEscape(encoded), "'"));
+    std::string expected;
+    bool expected_ok = absl::Base64Unescape(encoded, &expected);
+    std::string decoded;
+    ASSERT_EQ(expected_ok, Base64Decode(encoded, &decoded));
+    if (expected_ok) EXPECT_EQ(expected, decoded);
+  }
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,75 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/benchmark_util.h"
+
+#include "tink/keyset_manager.h"
+
+namespace crypto {
+namespace tink {
+namespace test {
+
+void MessageSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(0);
+  for (int64_t size = 16; size <= kMaxMessageSize; size *= 4) {
+    benchmark->Arg(size);
+  }
+}
+
+void ThreadCounts(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ThreadRange(1, kMaxThreads)->UseRealTime();
+}
+
+void SetThroughput(int64_t bytes_per_iteration, benchmark::State* state) {
+  state->SetBytesProcessed(state->iterations() * bytes_per_iteration);
+  state->SetItemsProcessed(state->iterations());
+}
+
+bool CheckOk(const crypto::tink::util::Status& status,
+             benchmark::State* state) {
+  if (status.ok()) return true;
+  state->SkipWithError(status.ToString().c_str());
+  return false;
+}
+
+void SetAllocationCounters(const AllocationCounter& counter,
+                           benchmark::State* state) {
+  state->counters["allocs"] = benchmark::Counter(
+      counter.allocations(), benchmark::Counter::kAvgIterations);
+  state->counters["alloc_bytes"] = benchmark::Counter(
+      counter.bytes(), benchmark::Counter::kAvgIterations);
+}
+
+util::StatusOr<std::unique_ptr<KeysetHandle>> NewKeysetHandle(
+    const google::crypto::tink::KeyTemplate& key_template, int num_keys,
+    google::crypto::tink::OutputPrefixType output_prefix_type) {
+  google::crypto::tink::KeyTemplate prefixed_template = key_template;
+  prefixed_template.set_output_prefix_type(output_prefix_type);
+  auto manager_result = KeysetManager::New(prefixed_template);
+  if (!manager_result.ok()) return manager_result.status();
+  auto& manager = *manager_result.ValueOrDie();
+  if (num_keys > 1) {
+    auto add_result = manager.AddKeys(prefixed_template, num_keys - 1);
+    if (!add_result.ok()) return add_result.status();
+    auto status = manager.SetPrimary(add_result.ValueOrDie().back());
+    if (!status.ok()) return status;
+  }
+  return manager.GetKeysetHandle();
+}
+
+}  // namespace test
+}  // namespace tink
+}  // namespace crypto
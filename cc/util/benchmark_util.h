@@ -0,0 +1,107 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_BENCHMARK_UTIL_H_
+#define TINK_UTIL_BENCHMARK_UTIL_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/allocation_counter.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace test {
+
+// Helpers for the benchmarks (*_benchmark.cc) based on Google Benchmark.
+// The benchmark binaries take the usual Google Benchmark flags, e.g.
+//   --benchmark_filter=AesGcm --benchmark_format=json
+//   --benchmark_out=results.json --benchmark_out_format=json
+// for machine-readable results.
+
+// The largest message size used by the benchmarks.
+constexpr int64_t kMaxMessageSize = 16 << 20;
+
+// The largest number of threads used by the multithreaded benchmarks.
+constexpr int kMaxThreads = 16;
+
+// Sets the arguments of 'benchmark' to the message sizes used by the
+// benchmarks: 0 bytes, and the powers of 4 from 16 bytes to 16 MiB.
+void MessageSizes(benchmark::internal::Benchmark* benchmark);
+
+// Runs 'benchmark' on 1, 2, 4, ..., kMaxThreads threads.  The time is
+// measured as wall-clock time, so the reported throughput is the total
+// throughput of all the threads.
+void ThreadCounts(benchmark::internal::Benchmark* benchmark);
+
+// Reports the throughput of the benchmark in 'state', each iteration
+// of which processed 'bytes_per_iteration' bytes, both in bytes and
+// in iterations ("items") per second.
+void SetThroughput(int64_t bytes_per_iteration, benchmark::State* state);
+
+// Returns true iff 'status' is OK; otherwise reports it as the error
+// of the benchmark in 'state', which then must return.
+bool CheckOk(const crypto::tink::util::Status& status,
+             benchmark::State* state);
+
+// Reports the allocations counted by 'counter' per iteration of the
+// benchmark in 'state', as the counters "allocs" and "alloc_bytes".
+// 'counter' must be created by the benchmark thread right before
+// the benchmark loop, so that it counts only the iterations.
+void SetAllocationCounters(const AllocationCounter& counter,
+                           benchmark::State* state);
+
+// Returns a handle of a fresh keyset with 'num_keys' keys generated
+// according to 'key_template', with 'output_prefix_type' instead of the
+// prefix type of the template.  The primary key is the last one, so that
+// decrypting with a RAW keyset tries all the keys.
+crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>> NewKeysetHandle(
+    const google::crypto::tink::KeyTemplate& key_template, int num_keys,
+    google::crypto::tink::OutputPrefixType output_prefix_type);
+
+// Returns the object created by 'factory' (a callable that returns
+// a StatusOr<std::unique_ptr<T>>) on the first call with 'key', and
+// the same object on all the subsequent calls with 'key'.  The threads of
+// multithreaded benchmarks use it to share the object under test, which
+// is never destroyed.  Errors of 'factory' are not cached.
+template <class T, class Factory>
+crypto::tink::util::StatusOr<T*> GetShared(const std::string& key,
+                                           Factory factory) {
+  static absl::Mutex* mutex = new absl::Mutex();
+  static auto* instances = new std::map<std::string, std::unique_ptr<T>>();
+  absl::MutexLock lock(mutex);
+  auto it = instances->find(key);
+  if (it != instances->end()) return it->second.get();
+  crypto::tink::util::StatusOr<std::unique_ptr<T>> result = factory();
+  if (!result.ok()) return result.status();
+  T* instance = result.ValueOrDie().get();
+  (*instances)[key] = std::move(result.ValueOrDie());
+  return instance;
+}
+
+}  // namespace test
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_BENCHMARK_UTIL_H_
@@ -17,6 +17,7 @@
 #include "tink/util/buffer.h"
 
 #include "absl/memory/memory.h"
+#include "tink/util/buffer_pool.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -109,6 +110,13 @@ StatusOr<std::unique_ptr<Buffer>> Buffer::New(int allocated_size) {
   return {absl::make_unique<OwningBuffer>(allocated_size)};
 }
 
+// static
+StatusOr<std::unique_ptr<Buffer>> Buffer::New(int allocated_size,
+                                              BufferPool* pool) {
+  if (pool == nullptr) return New(allocated_size);
+  return pool->NewBuffer(allocated_size);
+}
+
 // static
 StatusOr<std::unique_ptr<Buffer>> Buffer::NewNonOwning(
     char* mem_block, int allocated_size) {
@@ -25,6 +25,8 @@ namespace crypto {
 namespace tink {
 namespace util {
 
+class BufferPool;
+
 class Buffer {
  public:
   // Creates a new Buffer which allocates a new memory block
@@ -32,6 +34,13 @@ class Buffer {
   // The allocated memory block is owned by this Buffer.
   static util::StatusOr<std::unique_ptr<Buffer>> New(int allocated_size);
 
+  // Creates a new Buffer of size 'allocated_size' whose memory block
+  // comes from 'pool' (see BufferPool), and is returned to the pool
+  // when the Buffer is destroyed.  If 'pool' is null, behaves like
+  // New(allocated_size).
+  static util::StatusOr<std::unique_ptr<Buffer>> New(int allocated_size,
+                                                     BufferPool* pool);
+
   // Creates a new Buffer which uses the given 'mem_block' as a buffer
   // for the actual data.
   // Does NOT take the ownership of 'mem_block' which must be non-null,
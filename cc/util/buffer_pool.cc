@@ -0,0 +1,352 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/buffer_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/mem.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Size classes are powers of two, from 2^kMinClassShift to 2^kMaxClassShift.
+const int kMinClassShift = 8;   // 256 bytes
+const int kMaxClassShift = 26;  // 64 MB
+const int kNumClasses = kMaxClassShift - kMinClassShift + 1;
+
+// Returns the size (in bytes) of the blocks of size class 'size_class'.
+int ClassSize(int size_class) {
+  return 1 << (kMinClassShift + size_class);
+}
+
+// The maximal number of recycled Buffer objects kept by each thread.
+const int kMaxThreadCachedBuffers = 16;
+
+// Returns the smallest size class whose blocks can hold 'size' bytes,
+// or -1 if 'size' is too large for pooling.
+int SizeClass(int size) {
+  for (int size_class = 0; size_class < kNumClasses; size_class++) {
+    if (size <= ClassSize(size_class)) return size_class;
+  }
+  return -1;
+}
+
+}  // namespace
+
+class BufferPool::State : public std::enable_shared_from_this<State> {
+ public:
+  explicit State(const Options& options)
+      : options_(options), cached_bytes_(0), allocation_count_(0) {}
+
+  ~State() {
+    for (int size_class = 0; size_class < kNumClasses; size_class++) {
+      for (char* block : shared_blocks_[size_class]) delete[] block;
+    }
+  }
+
+  // Returns a block of size class 'size_class', preferably from the caches.
+  char* Acquire(int size_class) {
+    ThreadCache::Entry* entry = ThreadCache::GetEntry(this);
+    if (entry != nullptr && !entry->blocks[size_class].empty()) {
+      char* block = entry->blocks[size_class].back();
+      entry->blocks[size_class].pop_back();
+      cached_bytes_ -= ClassSize(size_class);
+      return block;
+    }
+    {
+      absl::MutexLock lock(&mutex_);
+      if (!shared_blocks_[size_class].empty()) {
+        char* block = shared_blocks_[size_class].back();
+        shared_blocks_[size_class].pop_back();
+        cached_bytes_ -= ClassSize(size_class);
+        return block;
+      }
+    }
+    allocation_count_++;
+    return new char[ClassSize(size_class)];
+  }
+
+  // Returns 'block' of size class 'size_class', whose first 'used_size'
+  // bytes may have been written, to the caches, or frees it if the caches
+  // are full.
+  void Release(char* block, int size_class, int used_size) {
+    Wipe(block, used_size);
+    if (!ReserveCachedBytes(ClassSize(size_class))) {
+      delete[] block;
+      return;
+    }
+    ThreadCache::Entry* entry = ThreadCache::GetEntry(this);
+    if (entry != nullptr && entry->blocks[size_class].size() <
+        static_cast<size_t>(options_.max_thread_cached_blocks)) {
+      entry->blocks[size_class].push_back(block);
+      return;
+    }
+    absl::MutexLock lock(&mutex_);
+    shared_blocks_[size_class].push_back(block);
+  }
+
+  // Wipes the first 'size' bytes of 'block', if so configured.
+  void Wipe(char* block, int size) const {
+    if (options_.wipe_released_blocks) OPENSSL_cleanse(block, size);
+  }
+
+  void CountAllocation() { allocation_count_++; }
+  int64_t cached_bytes() const { return cached_bytes_; }
+  int64_t allocation_count() const { return allocation_count_; }
+
+ private:
+  // The blocks cached by the current thread, for all the pools.
+  class ThreadCache {
+   public:
+    struct Entry {
+      std::weak_ptr<State> state;
+      const State* raw_state;
+      std::vector<char*> blocks[kNumClasses];
+    };
+
+    ~ThreadCache() {
+      destroyed_ = true;
+      for (auto& entry : entries_) Free(entry.get());
+    }
+
+    // Returns the cache entry of the current thread for 'state',
+    // or nullptr if the cache of the current thread is not available
+    // (i.e. during thread exit).
+    static Entry* GetEntry(State* state) {
+      if (destroyed_) return nullptr;
+      static thread_local ThreadCache cache;
+      return cache.FindOrAdd(state);
+    }
+
+   private:
+    Entry* FindOrAdd(State* state) {
+      // Drop the entries of destroyed pools first, as a new pool
+      // can have the address of a destroyed one.
+      for (size_t i = 0; i < entries_.size();) {
+        if (entries_[i]->state.expired()) {
+          Free(entries_[i].get());
+          entries_[i] = std::move(entries_.back());
+          entries_.pop_back();
+        } else {
+          i++;
+        }
+      }
+      for (auto& entry : entries_) {
+        if (entry->raw_state == state) return entry.get();
+      }
+      auto entry = absl::make_unique<Entry>();
+      entry->state = state->shared_from_this();
+      entry->raw_state = state;
+      entries_.push_back(std::move(entry));
+      return entries_.back().get();
+    }
+
+    // Frees all the blocks of 'entry'.
+    static void Free(Entry* entry) {
+      std::shared_ptr<State> state = entry->state.lock();
+      for (int size_class = 0; size_class < kNumClasses; size_class++) {
+        for (char* block : entry->blocks[size_class]) {
+          delete[] block;
+          if (state != nullptr) state->cached_bytes_ -= ClassSize(size_class);
+        }
+        entry->blocks[size_class].clear();
+      }
+    }
+
+    static thread_local bool destroyed_;
+    std::vector<std::unique_ptr<Entry>> entries_;
+  };
+
+  // Adds 'bytes' to cached_bytes_, unless that would exceed the limit.
+  bool ReserveCachedBytes(int64_t bytes) {
+    int64_t current = cached_bytes_.load();
+    do {
+      if (current + bytes > options_.max_cached_bytes) return false;
+    } while (!cached_bytes_.compare_exchange_weak(current, current + bytes));
+    return true;
+  }
+
+  const Options options_;
+  std::atomic<int64_t> cached_bytes_;
+  std::atomic<int64_t> allocation_count_;
+  absl::Mutex mutex_;
+  std::vector<char*> shared_blocks_[kNumClasses] GUARDED_BY(mutex_);
+};
+
+thread_local bool BufferPool::State::ThreadCache::destroyed_ = false;
+
+// A Buffer whose memory block is returned to the pool upon destruction.
+// The memory of PooledBuffer objects is recycled via per-thread free lists.
+class BufferPool::PooledBuffer : public Buffer {
+ public:
+  static void* operator new(size_t size) {
+    if (size == sizeof(PooledBuffer)) {
+      void* storage = FreeList::Pop();
+      if (storage != nullptr) return storage;
+    }
+    return ::operator new(size);
+  }
+
+  static void operator delete(void* storage, size_t size) {
+    if (size == sizeof(PooledBuffer) && FreeList::Push(storage)) return;
+    ::operator delete(storage);
+  }
+
+  PooledBuffer(std::shared_ptr<State> state, int size_class,
+               int allocated_size)
+      : state_(std::move(state)), size_class_(size_class),
+        allocated_size_(allocated_size), size_(allocated_size) {
+    if (size_class_ >= 0) {
+      mem_block_ = state_->Acquire(size_class_);
+    } else {
+      state_->CountAllocation();
+      mem_block_ = new char[allocated_size_];
+    }
+  }
+
+  char* const get_mem_block() const override { return mem_block_; }
+
+  int allocated_size() const override { return allocated_size_; }
+
+  int size() const override { return size_; }
+
+  util::Status set_size(int new_size) override {
+    if (new_size < 0  || new_size > allocated_size_) {
+      return Status(crypto::tink::util::error::INVALID_ARGUMENT,
+                    "new_size must satisfy 0 <= new_size <= allocated_size()");
+    }
+    size_ = new_size;
+    return Status::OK;
+  }
+
+  ~PooledBuffer() override {
+    if (size_class_ >= 0) {
+      state_->Release(mem_block_, size_class_, allocated_size_);
+    } else {
+      state_->Wipe(mem_block_, allocated_size_);
+      delete[] mem_block_;
+    }
+  }
+
+ private:
+  // The storage of destroyed PooledBuffers kept by the current thread,
+  // as an intrusive singly-linked list.
+  class FreeList {
+   public:
+    ~FreeList() {
+      destroyed_ = true;
+      while (head_ != nullptr) {
+        Node* node = head_;
+        head_ = node->next;
+        ::operator delete(node);
+      }
+    }
+
+    // Returns storage for a PooledBuffer, or nullptr if there is none.
+    static void* Pop() {
+      FreeList* list = Get();
+      if (list == nullptr || list->head_ == nullptr) return nullptr;
+      Node* node = list->head_;
+      list->head_ = node->next;
+      list->size_--;
+      return node;
+    }
+
+    // Keeps 'storage' for reuse, unless the list is full.
+    static bool Push(void* storage) {
+      FreeList* list = Get();
+      if (list == nullptr || list->size_ >= kMaxThreadCachedBuffers) {
+        return false;
+      }
+      Node* node = static_cast<Node*>(storage);
+      node->next = list->head_;
+      list->head_ = node;
+      list->size_++;
+      return true;
+    }
+
+   private:
+    struct Node {
+      Node* next;
+    };
+
+    FreeList() : head_(nullptr), size_(0) {}
+
+    // Returns the list of the current thread, or nullptr if it is not
+    // available (i.e. during thread exit).
+    static FreeList* Get() {
+      if (destroyed_) return nullptr;
+      static thread_local FreeList list;
+      return &list;
+    }
+
+    static thread_local bool destroyed_;
+    Node* head_;
+    int size_;
+  };
+
+  const std::shared_ptr<State> state_;
+  const int size_class_;  // -1 if the block is not pooled
+  const int allocated_size_;
+  char* mem_block_;
+  int size_;
+};
+
+thread_local bool BufferPool::PooledBuffer::FreeList::destroyed_ = false;
+
+BufferPool::BufferPool() : BufferPool(Options()) {}
+
+BufferPool::BufferPool(const Options& options)
+    : state_(std::make_shared<State>(options)) {}
+
+BufferPool::~BufferPool() {}
+
+StatusOr<std::unique_ptr<Buffer>> BufferPool::NewBuffer(int allocated_size) {
+  if (allocated_size <= 0) {
+    return Status(crypto::tink::util::error::INVALID_ARGUMENT,
+                  "allocated_size must be positive");
+  }
+  return {std::unique_ptr<Buffer>(
+      new PooledBuffer(state_, SizeClass(allocated_size), allocated_size))};
+}
+
+int64_t BufferPool::cached_bytes() const { return state_->cached_bytes(); }
+
+int64_t BufferPool::allocation_count() const {
+  return state_->allocation_count();
+}
+
+// static
+BufferPool* BufferPool::GetDefault() {
+  static BufferPool* default_pool = new BufferPool();
+  return default_pool;
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,109 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_UTIL_BUFFER_POOL_H_
+#define TINK_UTIL_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tink/util/buffer.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A pool of reusable memory blocks for Buffers.
+//
+// Blocks are grouped into size classes (powers of two, from 256 bytes
+// up to 64 MB); a request is served by a block of the smallest class that
+// fits it, and larger requests are not pooled.  When a Buffer obtained
+// from the pool is destroyed, its block is returned to a small per-thread
+// cache, or, once that is full, to a cache shared by all the threads.
+// The Buffer objects themselves are recycled as well, via a small
+// per-thread free list.  Hence in a steady state (i.e. a bounded number
+// of buffers of similar sizes in use at a time) NewBuffer() does not
+// allocate any memory.
+//
+// The blocks may hold secrets, like decrypted plaintext, so by default
+// they are wiped when their Buffer is destroyed, before other callers
+// can obtain them (see Options::wipe_released_blocks).
+//
+// The total size of the blocks kept by the caches (but not of the blocks
+// in use) is bounded by Options::max_cached_bytes; blocks that would
+// exceed the limit are freed.
+//
+// BufferPool is thread safe.  Buffers obtained from a pool can outlive it.
+class BufferPool {
+ public:
+  struct Options {
+    Options()
+        : max_cached_bytes(64 * 1024 * 1024),  // 64 MB
+          max_thread_cached_blocks(4),
+          wipe_released_blocks(true) {}
+
+    // The maximal total size of the blocks kept in the caches of the pool.
+    int64_t max_cached_bytes;
+
+    // The maximal number of blocks of each size class kept
+    // in the cache of each thread.
+    int max_thread_cached_blocks;
+
+    // Whether the first allocated_size() bytes of the block of a Buffer
+    // are wiped when the Buffer is destroyed.  Should be disabled only
+    // for pools whose Buffers never hold secrets.
+    bool wipe_released_blocks;
+  };
+
+  BufferPool();
+  explicit BufferPool(const Options& options);
+  ~BufferPool();
+
+  // Returns a new Buffer of 'allocated_size' bytes (which must be positive),
+  // whose memory block comes from this pool and is returned to the pool
+  // when the Buffer is destroyed.
+  StatusOr<std::unique_ptr<Buffer>> NewBuffer(int allocated_size);
+
+  // Returns the total size of the blocks currently kept in the caches.
+  int64_t cached_bytes() const;
+
+  // Returns the number of blocks allocated by this pool so far,
+  // i.e. the number of NewBuffer()-calls not served from a cache.
+  int64_t allocation_count() const;
+
+  // Returns a process-wide pool with default options, which wipes
+  // the released blocks.
+  static BufferPool* GetDefault();
+
+ private:
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  class State;
+  class PooledBuffer;
+
+  // Shared with the Buffers obtained from the pool and (weakly)
+  // with the per-thread caches.
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_BUFFER_POOL_H_
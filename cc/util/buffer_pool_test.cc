@@ -0,0 +1,217 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/buffer_pool.h"
+
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/util/allocation_matchers.h"
+#include "tink/util/buffer.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using crypto::tink::test::DoesNotAllocate;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+TEST(BufferPoolTest, NewBuffer) {
+  BufferPool pool;
+  for (int size : {1, 10, 255, 256, 257, 1000, 100000}) {
+    SCOPED_TRACE(absl::StrCat("size = ", size));
+    auto buf_result = pool.NewBuffer(size);
+    ASSERT_THAT(buf_result.status(), IsOk());
+    auto buf = std::move(buf_result.ValueOrDie());
+    EXPECT_EQ(size, buf->size());
+    EXPECT_EQ(size, buf->allocated_size());
+    std::memset(buf->get_mem_block(), 'x', size);
+    EXPECT_THAT(buf->set_size(size / 2), IsOk());
+    EXPECT_EQ(size / 2, buf->size());
+    EXPECT_THAT(buf->set_size(size + 1),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_THAT(buf->set_size(-1), StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  EXPECT_THAT(pool.NewBuffer(0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(pool.NewBuffer(-1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(BufferPoolTest, ReusesBlocks) {
+  BufferPool pool;
+  for (int i = 0; i < 100; i++) {
+    auto buf1 = std::move(pool.NewBuffer(4000).ValueOrDie());
+    auto buf2 = std::move(pool.NewBuffer(3000).ValueOrDie());
+    auto buf3 = std::move(pool.NewBuffer(100).ValueOrDie());
+  }
+  // Two blocks of 4096 bytes and one of 256 bytes.
+  EXPECT_EQ(3, pool.allocation_count());
+  EXPECT_EQ(2 * 4096 + 256, pool.cached_bytes());
+}
+
+TEST(BufferPoolTest, NewBufferDoesNotAllocate) {
+  BufferPool pool;
+  EXPECT_THAT([&]() { pool.NewBuffer(1000); }, DoesNotAllocate());
+  EXPECT_THAT([&]() { Buffer::New(1000, &pool); }, DoesNotAllocate());
+  EXPECT_THAT([&]() {
+    auto buf1 = std::move(pool.NewBuffer(4000).ValueOrDie());
+    auto buf2 = std::move(pool.NewBuffer(100).ValueOrDie());
+  }, DoesNotAllocate());
+}
+
+TEST(BufferPoolTest, WipesReleasedBlocks) {
+  for (bool wipe : {true, false}) {
+    SCOPED_TRACE(absl::StrCat("wipe_released_blocks = ", wipe));
+    BufferPool::Options options;
+    options.wipe_released_blocks = wipe;
+    BufferPool pool(options);
+    const char* block;
+    {
+      auto buf = std::move(pool.NewBuffer(1000).ValueOrDie());
+      block = buf->get_mem_block();
+      std::memset(buf->get_mem_block(), 'x', 1000);
+    }
+    auto buf = std::move(pool.NewBuffer(1000).ValueOrDie());
+    ASSERT_EQ(block, buf->get_mem_block());  // The block is reused.
+    EXPECT_EQ(wipe ? std::string(1000, '\0') : std::string(1000, 'x'),
+              std::string(buf->get_mem_block(), 1000));
+  }
+}
+
+TEST(BufferPoolTest, SharedCache) {
+  BufferPool::Options options;
+  options.max_thread_cached_blocks = 1;
+  BufferPool pool(options);
+  {
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    for (int i = 0; i < 10; i++) {
+      buffers.push_back(std::move(pool.NewBuffer(1024).ValueOrDie()));
+    }
+  }
+  EXPECT_EQ(10, pool.allocation_count());
+  EXPECT_EQ(10 * 1024, pool.cached_bytes());
+  {
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    for (int i = 0; i < 10; i++) {
+      buffers.push_back(std::move(pool.NewBuffer(1024).ValueOrDie()));
+    }
+    EXPECT_EQ(0, pool.cached_bytes());
+  }
+  EXPECT_EQ(10, pool.allocation_count());
+}
+
+TEST(BufferPoolTest, MaxCachedBytes) {
+  BufferPool::Options options;
+  options.max_cached_bytes = 3 * 1024;
+  BufferPool pool(options);
+  {
+    std::vector<std::unique_ptr<Buffer>> buffers;
+    for (int i = 0; i < 10; i++) {
+      buffers.push_back(std::move(pool.NewBuffer(1024).ValueOrDie()));
+    }
+  }
+  EXPECT_EQ(3 * 1024, pool.cached_bytes());
+  auto buf = std::move(pool.NewBuffer(1024).ValueOrDie());
+  EXPECT_EQ(10, pool.allocation_count());
+  EXPECT_EQ(2 * 1024, pool.cached_bytes());
+}
+
+TEST(BufferPoolTest, LargeBuffersAreNotPooled) {
+  BufferPool pool;
+  const int size = 64 * 1024 * 1024 + 1;
+  for (int i = 0; i < 2; i++) {
+    auto buf = std::move(pool.NewBuffer(size).ValueOrDie());
+    EXPECT_EQ(size, buf->allocated_size());
+  }
+  EXPECT_EQ(2, pool.allocation_count());
+  EXPECT_EQ(0, pool.cached_bytes());
+}
+
+TEST(BufferPoolTest, BuffersOutliveThePool) {
+  std::unique_ptr<Buffer> buf;
+  {
+    BufferPool pool;
+    buf = std::move(pool.NewBuffer(1000).ValueOrDie());
+    auto other_buf = std::move(pool.NewBuffer(1000).ValueOrDie());
+  }
+  std::memset(buf->get_mem_block(), 'x', buf->allocated_size());
+  buf.reset();
+  // A new pool does not get the blocks of the destroyed one.
+  BufferPool pool;
+  auto new_buf = std::move(pool.NewBuffer(1000).ValueOrDie());
+  EXPECT_EQ(1, pool.allocation_count());
+}
+
+TEST(BufferPoolTest, MultipleThreads) {
+  BufferPool pool;
+  const int num_threads = 8;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&pool, t]() {
+      std::vector<std::unique_ptr<Buffer>> buffers;
+      for (int i = 0; i < 1000; i++) {
+        auto buf = std::move(pool.NewBuffer(100 + i % 500).ValueOrDie());
+        std::memset(buf->get_mem_block(), t, buf->allocated_size());
+        buffers.push_back(std::move(buf));
+        if (buffers.size() > 3) buffers.erase(buffers.begin());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  // Each thread uses at most 4 blocks of each of the 3 size classes.
+  EXPECT_GE(num_threads * 12, pool.allocation_count());
+  // The caches of the finished threads have been released.
+  EXPECT_EQ(0, pool.cached_bytes());
+}
+
+TEST(BufferPoolTest, BufferNewWithPool) {
+  BufferPool pool;
+  for (int i = 0; i < 10; i++) {
+    auto buf_result = Buffer::New(2048, &pool);
+    ASSERT_THAT(buf_result.status(), IsOk());
+    EXPECT_EQ(2048, buf_result.ValueOrDie()->allocated_size());
+  }
+  EXPECT_EQ(1, pool.allocation_count());
+
+  auto buf_result = Buffer::New(2048, nullptr);
+  ASSERT_THAT(buf_result.status(), IsOk());
+  EXPECT_EQ(2048, buf_result.ValueOrDie()->allocated_size());
+  EXPECT_THAT(Buffer::New(0, &pool).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_EQ(1, pool.allocation_count());
+}
+
+TEST(BufferPoolTest, DefaultPool) {
+  BufferPool* pool = BufferPool::GetDefault();
+  ASSERT_NE(nullptr, pool);
+  EXPECT_EQ(pool, BufferPool::GetDefault());
+  auto buf_result = pool->NewBuffer(100);
+  EXPECT_THAT(buf_result.status(), IsOk());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
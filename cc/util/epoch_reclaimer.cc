@@ -0,0 +1,75 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/epoch_reclaimer.h"
+
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+constexpr int EpochReclaimer::kNumSlots;
+
+EpochReclaimer::EpochReclaimer() : epoch_(0), slots_(new Slot[kNumSlots]) {
+  for (int i = 0; i < kNumSlots; i++) {
+    slots_[i].readers[0].store(0);
+    slots_[i].readers[1].store(0);
+  }
+}
+
+// static
+int EpochReclaimer::ThreadSlot() {
+  // Threads are assigned to the slots round-robin, on first use.
+  static std::atomic<int> next_slot(0);
+  thread_local int slot = next_slot.fetch_add(1) % kNumSlots;
+  return slot;
+}
+
+void EpochReclaimer::Synchronize() {
+  absl::MutexLock lock(&synchronize_mutex_);
+  // After the first increment, new readers are counted for the other
+  // parity; a reader that loaded the epoch just before the increment
+  // may still be counted for the old one, hence both are waited for.
+  for (int i = 0; i < 2; i++) {
+    uint64_t previous_epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    WaitForReaders(previous_epoch & 1);
+  }
+}
+
+void EpochReclaimer::WaitForReaders(int parity) {
+  for (int attempt = 0;; attempt++) {
+    int64_t readers = 0;
+    for (int i = 0; i < kNumSlots; i++) {
+      readers += slots_[i].readers[parity].load(std::memory_order_seq_cst);
+    }
+    if (readers == 0) return;
+    // Read-side sections are short, so spin briefly before sleeping.
+    if (attempt < 100) {
+      std::this_thread::yield();
+    } else {
+      absl::SleepFor(absl::Microseconds(50));
+    }
+  }
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
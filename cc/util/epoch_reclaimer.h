@@ -0,0 +1,100 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_UTIL_EPOCH_RECLAIMER_H_
+#define TINK_UTIL_EPOCH_RECLAIMER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// Lets readers use objects that are published through atomic pointers
+// without taking any lock, and lets writers find out when an object that
+// they have unpublished is no longer used by any reader, so that it can
+// be deleted.
+//
+// Readers bracket their accesses with EnterRead() and ExitRead().
+// A writer replaces the published pointer, and then calls Synchronize(),
+// which waits until all the readers that were active when it was called
+// have exited, i.e. until no reader can still use the old object.
+//
+// Readers are counted per epoch (of which only the parity is tracked),
+// on counters that are spread over several cache lines, so that readers
+// on different threads rarely contend.  Readers never wait; the writer
+// advances the epoch twice and waits for the readers of each of the
+// previous epochs to drain.
+//
+// EpochReclaimer is thread safe.
+class EpochReclaimer {
+ public:
+  EpochReclaimer();
+
+  // Enters a read-side section, and returns a token for ExitRead().
+  // The objects read in the section (via atomic loads that follow
+  // EnterRead()) stay valid until ExitRead().
+  int EnterRead() {
+    int token = 2 * ThreadSlot() +
+        static_cast<int>(epoch_.load(std::memory_order_seq_cst) & 1);
+    slots_[token / 2].readers[token % 2].fetch_add(
+        1, std::memory_order_seq_cst);
+    return token;
+  }
+
+  // Exits the read-side section that returned 'token'.
+  void ExitRead(int token) {
+    slots_[token / 2].readers[token % 2].fetch_sub(
+        1, std::memory_order_seq_cst);
+  }
+
+  // Waits until all the read-side sections entered before the call
+  // have been exited.  Calls are serialized.
+  void Synchronize() LOCKS_EXCLUDED(synchronize_mutex_);
+
+ private:
+  EpochReclaimer(const EpochReclaimer&) = delete;
+  EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+  static constexpr int kNumSlots = 32;
+
+  // The reader counts of the two epoch parities, padded to a cache line.
+  struct Slot {
+    std::atomic<int64_t> readers[2];
+    char padding[64 - 2 * sizeof(std::atomic<int64_t>)];
+  };
+
+  // Returns the slot of the calling thread.
+  static int ThreadSlot();
+
+  // Waits until no reader is counted for the epochs with 'parity'.
+  void WaitForReaders(int parity) EXCLUSIVE_LOCKS_REQUIRED(synchronize_mutex_);
+
+  absl::Mutex synchronize_mutex_;
+  std::atomic<uint64_t> epoch_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_EPOCH_RECLAIMER_H_
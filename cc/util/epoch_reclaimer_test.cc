@@ -0,0 +1,85 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/epoch_reclaimer.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+TEST(EpochReclaimerTest, SynchronizeWithoutReaders) {
+  EpochReclaimer reclaimer;
+  reclaimer.Synchronize();
+  reclaimer.ExitRead(reclaimer.EnterRead());
+  reclaimer.Synchronize();
+}
+
+TEST(EpochReclaimerTest, SynchronizeWaitsForActiveReaders) {
+  EpochReclaimer reclaimer;
+  int token = reclaimer.EnterRead();
+  absl::Notification synchronized;
+  std::thread writer([&reclaimer, &synchronized]() {
+    reclaimer.Synchronize();
+    synchronized.Notify();
+  });
+  EXPECT_FALSE(
+      synchronized.WaitForNotificationWithTimeout(absl::Milliseconds(50)));
+  reclaimer.ExitRead(token);
+  writer.join();
+  EXPECT_TRUE(synchronized.HasBeenNotified());
+}
+
+TEST(EpochReclaimerTest, ReclaimsReplacedObjects) {
+  EpochReclaimer reclaimer;
+  std::atomic<std::vector<int>*> published(new std::vector<int>(100, 0));
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&reclaimer, &published, &done]() {
+      while (!done) {
+        int token = reclaimer.EnterRead();
+        const std::vector<int>& values = *published.load();
+        for (int value : values) ASSERT_EQ(values[0], value);
+        reclaimer.ExitRead(token);
+      }
+    });
+  }
+  for (int i = 1; i <= 1000; i++) {
+    std::vector<int>* previous =
+        published.exchange(new std::vector<int>(100, i));
+    reclaimer.Synchronize();
+    // Would be reported by ASan if a reader still used it.
+    delete previous;
+  }
+  done = true;
+  for (auto& reader : readers) reader.join();
+  delete published.load();
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -16,9 +16,12 @@
 
 #include "tink/util/file_random_access_stream.h"
 
+#include <limits.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <algorithm>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "tink/random_access_stream.h"
@@ -44,12 +47,56 @@ int close_ignoring_eintr(int fd) {
   return result;
 }
 
+#ifdef IOV_MAX
+const int kMaxIovecs = IOV_MAX;
+#else
+const int kMaxIovecs = 16;
+#endif
+
+// Ranges separated by at most this many bytes are read by a single
+// preadv()-call, discarding the bytes in between: reading (at most)
+// a page more is cheaper than an additional syscall.
+const int kMaxGapSize = 4096;
+
+// The maximal number of bytes to be read by a single preadv()-call.
+const int64_t kMaxBytesPerRead = 1 << 30;
+
+// Checks the arguments of a range, as FileRandomAccessStream::PRead() does.
+Status ValidateRange(const RandomAccessStream::ReadRange& range) {
+  if (range.dest_buffer == nullptr) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "dest_buffer must be non-null");
+  }
+  if (range.count < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "count cannot be negative");
+  }
+  if (range.count > range.dest_buffer->allocated_size()) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "buffer too small");
+  }
+  if (range.position < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "position cannot be negative");
+  }
+  return Status::OK;
+}
+
 }  // anonymous namespace
 
 FileRandomAccessStream::FileRandomAccessStream(int file_descriptor) {
   fd_ = file_descriptor;
 }
 
+ssize_t FileRandomAccessStream::ReadVector(const struct iovec* iov,
+                                           int iov_count, int64_t position) {
+  ssize_t result;
+  do {
+    result = preadv(fd_, iov, iov_count, position);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
 Status FileRandomAccessStream::PRead(int64_t position, int count,
                                      Buffer* dest_buffer) {
   if (dest_buffer == nullptr) {
@@ -85,6 +132,102 @@ Status FileRandomAccessStream::PRead(int64_t position, int count,
   return Status::OK;
 }
 
+Status FileRandomAccessStream::PReadRanges(std::vector<ReadRange>* ranges) {
+  if (ranges == nullptr) {
+    return ToStatusF(util::error::INVALID_ARGUMENT, "ranges must be non-null");
+  }
+  // Indices of the ranges to be read, sorted by position.
+  std::vector<int> sorted;
+  for (int i = 0; i < ranges->size(); i++) {
+    ReadRange& range = (*ranges)[i];
+    range.status = ValidateRange(range);
+    if (!range.status.ok()) continue;
+    range.dest_buffer->set_size(range.count);
+    if (range.count > 0) sorted.push_back(i);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(), [ranges](int a, int b) {
+    return (*ranges)[a].position < (*ranges)[b].position;
+  });
+
+  std::vector<uint8_t> gap_buffer(kMaxGapSize);
+  std::vector<struct iovec> iov;
+  std::vector<int> group;  // indices of the ranges in the current group
+  auto group_start = sorted.begin();
+  while (group_start != sorted.end()) {
+    // Collect a group of ranges that can be read with a single preadv().
+    iov.clear();
+    group.clear();
+    int64_t position = (*ranges)[*group_start].position;
+    int64_t group_end = position;
+    auto next = group_start;
+    while (next != sorted.end()) {
+      const ReadRange& range = (*ranges)[*next];
+      int64_t gap = range.position - group_end;
+      bool fits_in_group =
+          gap >= 0 && gap <= kMaxGapSize &&
+          iov.size() + 2 <= static_cast<size_t>(kMaxIovecs) &&
+          range.position + range.count - position <= kMaxBytesPerRead;
+      if (!group.empty() && !fits_in_group) break;
+      if (gap > 0) {
+        iov.push_back({gap_buffer.data(), static_cast<size_t>(gap)});
+      }
+      iov.push_back({range.dest_buffer->get_mem_block(),
+                     static_cast<size_t>(range.count)});
+      group.push_back(*next);
+      group_end = range.position + range.count;
+      ++next;
+    }
+    group_start = next;
+
+    // A short read is continued until the end of the file is reached
+    // or an error occurs.
+    int64_t read_count = 0;
+    int saved_errno = 0;
+    auto first_iov = iov.begin();
+    while (first_iov != iov.end()) {
+      ssize_t result = ReadVector(&*first_iov, iov.end() - first_iov,
+                                  position + read_count);
+      if (result <= 0) {
+        if (result < 0) saved_errno = errno;
+        break;
+      }
+      read_count += result;
+      // Skip the buffers that have been filled, and the filled part
+      // of the next one.
+      while (first_iov != iov.end() &&
+             static_cast<size_t>(result) >= first_iov->iov_len) {
+        result -= first_iov->iov_len;
+        ++first_iov;
+      }
+      if (first_iov != iov.end()) {
+        first_iov->iov_base = static_cast<uint8_t*>(first_iov->iov_base) +
+                              result;
+        first_iov->iov_len -= result;
+      }
+    }
+    for (int index : group) {
+      ReadRange& range = (*ranges)[index];
+      // The number of bytes read into this range.
+      int64_t range_count = std::min<int64_t>(
+          std::max<int64_t>(position + read_count - range.position, 0),
+          range.count);
+      if (saved_errno != 0 && range_count < range.count) {
+        range.dest_buffer->set_size(0);
+        range.status = ToStatusF(util::error::UNKNOWN, "I/O error: %d",
+                                 saved_errno);
+        continue;
+      }
+      range.dest_buffer->set_size(range_count);
+      if (range_count == 0) {
+        range.status = Status(util::error::OUT_OF_RANGE, "EOF");
+      } else {
+        range.status = Status::OK;
+      }
+    }
+  }
+  return Status::OK;
+}
+
 FileRandomAccessStream::~FileRandomAccessStream() {
   close_ignoring_eintr(fd_);
 }
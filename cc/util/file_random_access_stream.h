@@ -17,7 +17,11 @@
 #ifndef TINK_UTIL_FILE_RANDOM_ACCESS_STREAM_H_
 #define TINK_UTIL_FILE_RANDOM_ACCESS_STREAM_H_
 
+#include <sys/types.h>
+#include <sys/uio.h>
+
 #include <memory>
+#include <vector>
 
 #include "tink/random_access_stream.h"
 #include "tink/util/buffer.h"
@@ -41,8 +45,21 @@ class FileRandomAccessStream : public crypto::tink::RandomAccessStream {
                                    int count,
                                    Buffer* dest_buffer) override;
 
+  // Coalesces ranges that are adjacent or separated by small gaps,
+  // and reads each group of ranges with a single preadv()-call.
+  crypto::tink::util::Status PReadRanges(
+      std::vector<ReadRange>* ranges) override;
+
   int64_t size() const override;
 
+ protected:
+  // Reads from the file into the 'iov_count' buffers specified by 'iov',
+  // starting at 'position', like preadv() while ignoring EINTR.  Like
+  // preadv(), it may read fewer bytes than requested.
+  // Can be overridden in tests to simulate short reads.
+  virtual ssize_t ReadVector(const struct iovec* iov, int iov_count,
+                             int64_t position);
+
  private:
   int fd_;
 };
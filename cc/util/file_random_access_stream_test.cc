@@ -16,7 +16,10 @@
 
 #include "tink/util/file_random_access_stream.h"
 
+#include <algorithm>
 #include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
@@ -117,6 +120,115 @@ TEST(FileRandomAccessStreamTest, ConcurrentReads) {
   }
 }
 
+// Reads 'ranges' (pairs of position and count) from 'ra_stream' with
+// a single PReadRanges()-call, and verifies that the result of each range
+// is the same as the result of a separate PRead()-call.
+void ReadAndVerifyRanges(RandomAccessStream* ra_stream,
+                         const std::vector<std::pair<int64_t, int>>& ranges) {
+  std::vector<std::unique_ptr<Buffer>> buffers;
+  std::vector<RandomAccessStream::ReadRange> read_ranges;
+  for (const auto& range : ranges) {
+    buffers.push_back(
+        std::move(Buffer::New(std::max(range.second, 1)).ValueOrDie()));
+    read_ranges.push_back({range.first, range.second, buffers.back().get()});
+  }
+  ASSERT_TRUE(ra_stream->PReadRanges(&read_ranges).ok());
+  auto expected_buffer = std::move(Buffer::New(1000000).ValueOrDie());
+  for (const auto& read_range : read_ranges) {
+    SCOPED_TRACE(absl::StrCat("position = ", read_range.position,
+                              ", count = ", read_range.count));
+    auto expected_status = ra_stream->PRead(
+        read_range.position, read_range.count, expected_buffer.get());
+    EXPECT_EQ(expected_status.error_code(), read_range.status.error_code());
+    if (!expected_status.ok() &&
+        expected_status.error_code() != util::error::OUT_OF_RANGE) {
+      continue;
+    }
+    EXPECT_EQ(expected_buffer->size(), read_range.dest_buffer->size());
+    EXPECT_EQ(0, memcmp(expected_buffer->get_mem_block(),
+                        read_range.dest_buffer->get_mem_block(),
+                        read_range.dest_buffer->size()));
+  }
+}
+
+TEST(FileRandomAccessStreamTest, ReadRanges) {
+  int stream_size = 100000;
+  std::string file_contents;
+  int input_fd = test::GetTestFileDescriptor(
+      "read_ranges_test.bin", stream_size, &file_contents);
+  auto ra_stream = absl::make_unique<util::FileRandomAccessStream>(input_fd);
+
+  // Adjacent, overlapping, nearby and distant ranges, in arbitrary order.
+  ReadAndVerifyRanges(ra_stream.get(), {{0, 100}, {100, 50}, {150, 1}});
+  ReadAndVerifyRanges(ra_stream.get(), {{500, 100}, {0, 100}, {550, 100}});
+  ReadAndVerifyRanges(ra_stream.get(), {{10, 10}, {30, 10}, {5000, 10},
+                                        {9000, 42}, {90000, 4000}});
+  // Ranges at the end of the stream and after it.
+  ReadAndVerifyRanges(ra_stream.get(), {{stream_size - 10, 10},
+                                        {stream_size - 5, 10},
+                                        {stream_size, 10},
+                                        {stream_size + 100, 10}});
+  // Empty and invalid ranges.
+  ReadAndVerifyRanges(ra_stream.get(), {{100, 0}, {-1, 10}, {200, -5},
+                                        {300, 10}});
+
+  // Many small ranges, each 10 bytes apart.
+  std::vector<std::pair<int64_t, int>> ranges;
+  for (int i = 0; i < 3000; i++) {
+    ranges.push_back({(i * 7919) % 3000 * 30, 20});
+  }
+  ReadAndVerifyRanges(ra_stream.get(), ranges);
+
+  EXPECT_FALSE(ra_stream->PReadRanges(nullptr).ok());
+}
+
+// A FileRandomAccessStream whose reads return at most 'max_read_size'
+// bytes per call, like preadv() may do.
+class ShortReadingFileRandomAccessStream : public FileRandomAccessStream {
+ public:
+  ShortReadingFileRandomAccessStream(int file_descriptor, int max_read_size)
+      : FileRandomAccessStream(file_descriptor),
+        max_read_size_(max_read_size),
+        read_count_(0) {}
+
+  int read_count() const { return read_count_; }
+
+ protected:
+  ssize_t ReadVector(const struct iovec* iov, int iov_count,
+                     int64_t position) override {
+    read_count_++;
+    std::vector<struct iovec> short_iov;
+    size_t remaining = max_read_size_;
+    for (int i = 0; i < iov_count && remaining > 0; i++) {
+      size_t length = std::min(iov[i].iov_len, remaining);
+      short_iov.push_back({iov[i].iov_base, length});
+      remaining -= length;
+    }
+    return FileRandomAccessStream::ReadVector(short_iov.data(),
+                                              short_iov.size(), position);
+  }
+
+ private:
+  const int max_read_size_;
+  int read_count_;
+};
+
+TEST(FileRandomAccessStreamTest, ReadRangesContinuesShortReads) {
+  int stream_size = 10000;
+  std::string file_contents;
+  int input_fd = test::GetTestFileDescriptor(
+      "short_reads_test.bin", stream_size, &file_contents);
+  auto ra_stream =
+      absl::make_unique<ShortReadingFileRandomAccessStream>(input_fd, 7);
+
+  ReadAndVerifyRanges(ra_stream.get(), {{0, 100}, {100, 50}, {150, 1},
+                                        {3000, 20}});
+  EXPECT_GT(ra_stream->read_count(), 4);
+  ReadAndVerifyRanges(ra_stream.get(), {{stream_size - 30, 20},
+                                        {stream_size - 5, 10},
+                                        {stream_size, 10}});
+}
+
 TEST(FileRandomAccessStreamTest, NegativeReadPosition) {
   for (auto stream_size : {0, 10, 100, 1000, 10000}) {
     std::string file_contents;
@@ -0,0 +1,121 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/mmap_input_stream.h"
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+
+#include "tink/input_stream.h"
+#include "tink/util/errors.h"
+#include "tink/util/mmap_region.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+}  // anonymous namespace
+
+MmapInputStream::MmapInputStream(int file_descriptor, MmapAdvice advice,
+                                 int64_t chunk_size)
+    : status_(Status::OK),
+      fd_(file_descriptor),
+      advice_(advice),
+      chunk_size_(MmapRegion::GetChunkSize(chunk_size)),
+      position_(0),
+      last_returned_count_(0),
+      count_backedup_(0) {}
+
+crypto::tink::util::StatusOr<int> MmapInputStream::Next(const void** data) {
+  if (!status_.ok()) return status_;
+  if (count_backedup_ > 0) {  // Return the backed-up bytes.
+    *data = chunk_->data() + (position_ - chunk_->offset());
+    last_returned_count_ = count_backedup_;
+    count_backedup_ = 0;
+    position_ += last_returned_count_;
+    return last_returned_count_;
+  }
+  if (chunk_ == nullptr ||
+      position_ == chunk_->offset() + chunk_->size()) {
+    // Map the chunk that starts at position_.  The size of the file
+    // is checked anew, as the file might have grown in the meantime.
+    int64_t chunk_offset = (position_ / chunk_size_) * chunk_size_;
+    struct stat s;
+    if (fstat(fd_, &s) == -1) {
+      status_ = ToStatusF(util::error::INTERNAL, "I/O error: %d", errno);
+      return status_;
+    }
+    int64_t chunk_end =
+        std::min<int64_t>(chunk_offset + chunk_size_, s.st_size);
+    if (chunk_end <= position_) {
+      status_ = Status(util::error::OUT_OF_RANGE, "EOF");
+      return status_;
+    }
+    chunk_.reset();  // Unmap the previous chunk first.
+    auto region_result = MmapRegion::New(fd_, chunk_offset,
+                                         chunk_end - chunk_offset, advice_);
+    if (!region_result.ok()) {
+      status_ = region_result.status();
+      return status_;
+    }
+    chunk_ = std::move(region_result.ValueOrDie());
+  }
+  int64_t available = chunk_->offset() + chunk_->size() - position_;
+  last_returned_count_ = static_cast<int>(std::min<int64_t>(
+      available, std::numeric_limits<int>::max()));
+  *data = chunk_->data() + (position_ - chunk_->offset());
+  position_ += last_returned_count_;
+  return last_returned_count_;
+}
+
+void MmapInputStream::BackUp(int count) {
+  if (!status_.ok() || count < 1 || count_backedup_ == last_returned_count_) {
+    return;
+  }
+  int actual_count = std::min(count, last_returned_count_ - count_backedup_);
+  count_backedup_ += actual_count;
+  position_ -= actual_count;
+}
+
+MmapInputStream::~MmapInputStream() {
+  chunk_.reset();
+  close_ignoring_eintr(fd_);
+}
+
+int64_t MmapInputStream::Position() const {
+  return position_;
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,70 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_MMAP_INPUT_STREAM_H_
+#define TINK_UTIL_MMAP_INPUT_STREAM_H_
+
+#include <memory>
+
+#include "tink/input_stream.h"
+#include "tink/util/mmap_region.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// An InputStream that reads from a memory-mapped file.  Next() returns
+// pointers directly into the mapping, so no data is copied.
+// The file is mapped (from its beginning) in page-aligned chunks,
+// and only the chunk that is currently being read stays mapped.
+// The file must not be truncated while the stream exists.
+class MmapInputStream : public crypto::tink::InputStream {
+ public:
+  // Constructs an InputStream that will read from the file specified
+  // via 'file_descriptor', mapping it in chunks of 'chunk_size' bytes
+  // (if no legal 'chunk_size' is given, a reasonable default will be used),
+  // and passing 'advice' as a hint about the access pattern.
+  // Takes the ownership of the file, and will close it upon destruction.
+  explicit MmapInputStream(int file_descriptor,
+                           MmapAdvice advice = MMAP_ADVICE_SEQUENTIAL,
+                           int64_t chunk_size = -1);
+
+  ~MmapInputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(const void** data) override;
+
+  void BackUp(int count) override;
+
+  int64_t Position() const override;
+
+ private:
+  util::Status status_;
+  const int fd_;
+  const MmapAdvice advice_;
+  const int64_t chunk_size_;
+  std::unique_ptr<MmapRegion> chunk_;  // the currently mapped chunk, if any
+  int64_t position_;  // current position in the file (from the beginning)
+  int last_returned_count_;  // # of bytes returned by the last Next()
+  int count_backedup_;  // # of those bytes that were backed up
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_MMAP_INPUT_STREAM_H_
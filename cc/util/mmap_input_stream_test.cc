@@ -0,0 +1,163 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/mmap_input_stream.h"
+
+#include <unistd.h>
+#include <algorithm>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/util/mmap_region.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+// Reads the specified 'input_stream' until no more bytes can be read,
+// and puts the read bytes into 'contents'.
+// Returns the status of the last input_stream->Next()-operation.
+util::Status ReadTillEnd(util::MmapInputStream* input_stream,
+                         std::string* contents) {
+  contents->clear();
+  const void* buffer;
+  auto next_result = input_stream->Next(&buffer);
+  while (next_result.ok()) {
+    contents->append(static_cast<const char*>(buffer),
+                     next_result.ValueOrDie());
+    next_result = input_stream->Next(&buffer);
+  }
+  return next_result.status();
+}
+
+class MmapInputStreamTest : public ::testing::Test {
+};
+
+TEST_F(MmapInputStreamTest, testReadingStreams) {
+  for (auto stream_size : {0, 10, 100, 1000, 10000, 100000, 1000000}) {
+    for (auto advice : {util::MMAP_ADVICE_NORMAL, util::MMAP_ADVICE_SEQUENTIAL,
+                        util::MMAP_ADVICE_RANDOM, util::MMAP_ADVICE_WILLNEED}) {
+      SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size,
+                                ", advice = ", advice));
+      std::string file_contents;
+      std::string filename =
+          absl::StrCat(stream_size, "_mmap_reading_test.bin");
+      int input_fd =
+          test::GetTestFileDescriptor(filename, stream_size, &file_contents);
+      EXPECT_EQ(stream_size, file_contents.size());
+      auto input_stream =
+          absl::make_unique<util::MmapInputStream>(input_fd, advice);
+      std::string stream_contents;
+      auto status = ReadTillEnd(input_stream.get(), &stream_contents);
+      EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+      EXPECT_EQ("EOF", status.error_message());
+      EXPECT_EQ(file_contents, stream_contents);
+      EXPECT_EQ(stream_size, input_stream->Position());
+    }
+  }
+}
+
+TEST_F(MmapInputStreamTest, testCustomChunkSizes) {
+  int stream_size = 100000;
+  int page_size = sysconf(_SC_PAGESIZE);
+  for (auto chunk_size : {1, page_size, 3 * page_size, 10 * page_size}) {
+    SCOPED_TRACE(absl::StrCat("chunk_size = ", chunk_size));
+    int expected_chunk_size = util::MmapRegion::GetChunkSize(chunk_size);
+    EXPECT_EQ(0, expected_chunk_size % page_size);
+    std::string file_contents;
+    std::string filename = absl::StrCat(chunk_size, "_chunk_size_test.bin");
+    int input_fd =
+        test::GetTestFileDescriptor(filename, stream_size, &file_contents);
+    auto input_stream = absl::make_unique<util::MmapInputStream>(
+        input_fd, util::MMAP_ADVICE_SEQUENTIAL, chunk_size);
+    const void* buffer;
+    auto next_result = input_stream->Next(&buffer);
+    EXPECT_TRUE(next_result.ok()) << next_result.status();
+    EXPECT_EQ(expected_chunk_size, next_result.ValueOrDie());
+    EXPECT_EQ(file_contents.substr(0, expected_chunk_size),
+              std::string(static_cast<const char*>(buffer),
+                          expected_chunk_size));
+    std::string stream_contents;
+    auto status = ReadTillEnd(input_stream.get(), &stream_contents);
+    EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+    EXPECT_EQ(file_contents.substr(expected_chunk_size), stream_contents);
+  }
+}
+
+TEST_F(MmapInputStreamTest, testBackupAndPosition) {
+  int stream_size = 100000;
+  int chunk_size = sysconf(_SC_PAGESIZE);
+  const void* buffer;
+  std::string file_contents;
+  std::string filename = "mmap_backup_test.bin";
+  int input_fd =
+      test::GetTestFileDescriptor(filename, stream_size, &file_contents);
+
+  auto input_stream = absl::make_unique<util::MmapInputStream>(
+      input_fd, util::MMAP_ADVICE_SEQUENTIAL, chunk_size);
+  EXPECT_EQ(0, input_stream->Position());
+  auto next_result = input_stream->Next(&buffer);
+  EXPECT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(chunk_size, next_result.ValueOrDie());
+  EXPECT_EQ(chunk_size, input_stream->Position());
+
+  // BackUp several times, but in total fewer bytes than returned by Next().
+  int total_backup_size = 0;
+  for (auto backup_size : {0, 1, 5, 0, 10, 100, -42, 400, 20, -100}) {
+    SCOPED_TRACE(absl::StrCat("backup_size = ", backup_size));
+    input_stream->BackUp(backup_size);
+    total_backup_size += std::max(0, backup_size);
+    EXPECT_EQ(chunk_size - total_backup_size, input_stream->Position());
+  }
+  // Call Next(), it should return exactly the backed up bytes.
+  next_result = input_stream->Next(&buffer);
+  EXPECT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(total_backup_size, next_result.ValueOrDie());
+  EXPECT_EQ(chunk_size, input_stream->Position());
+  EXPECT_EQ(
+      file_contents.substr(chunk_size - total_backup_size, total_backup_size),
+      std::string(static_cast<const char*>(buffer), total_backup_size));
+
+  // Call Next() again, it should return the second chunk.
+  next_result = input_stream->Next(&buffer);
+  EXPECT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(chunk_size, next_result.ValueOrDie());
+  EXPECT_EQ(2 * chunk_size, input_stream->Position());
+  EXPECT_EQ(file_contents.substr(chunk_size, chunk_size),
+            std::string(static_cast<const char*>(buffer), chunk_size));
+
+  // BackUp a few times, with total over the returned chunk_size.
+  total_backup_size = 0;
+  for (auto backup_size : {0, 72, -100, chunk_size / 2, chunk_size, 42}) {
+    SCOPED_TRACE(absl::StrCat("backup_size = ", backup_size));
+    input_stream->BackUp(backup_size);
+    total_backup_size = std::min(chunk_size,
+                                 total_backup_size + std::max(0, backup_size));
+    EXPECT_EQ(2 * chunk_size - total_backup_size, input_stream->Position());
+  }
+  next_result = input_stream->Next(&buffer);
+  EXPECT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(chunk_size, next_result.ValueOrDie());
+  EXPECT_EQ(file_contents.substr(chunk_size, chunk_size),
+            std::string(static_cast<const char*>(buffer), chunk_size));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,172 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/mmap_random_access_stream.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <limits>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/errors.h"
+#include "tink/util/mmap_region.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+}  // anonymous namespace
+
+MmapRandomAccessStream::MmapRandomAccessStream(int file_descriptor,
+                                               MmapAdvice advice,
+                                               int64_t chunk_size)
+    : fd_(file_descriptor),
+      advice_(advice),
+      chunk_size_(MmapRegion::GetChunkSize(chunk_size)),
+      known_size_(0) {}
+
+int64_t MmapRandomAccessStream::FileSize(int64_t min_size) {
+  int64_t known_size = known_size_.load(std::memory_order_relaxed);
+  if (known_size >= min_size) return known_size;
+  int64_t file_size = size();
+  if (file_size < 0) return file_size;
+  // Keep the largest size seen, if concurrent calls race.
+  while (known_size < file_size &&
+         !known_size_.compare_exchange_weak(known_size, file_size,
+                                            std::memory_order_relaxed)) {
+  }
+  return file_size;
+}
+
+StatusOr<std::shared_ptr<MmapRegion>> MmapRandomAccessStream::GetChunk(
+    int64_t chunk_index, int64_t min_end, int64_t file_size) {
+  {
+    absl::ReaderMutexLock lock(&chunks_mutex_);
+    if (chunk_index < static_cast<int64_t>(chunks_.size())) {
+      const std::shared_ptr<MmapRegion>& chunk = chunks_[chunk_index];
+      if (chunk != nullptr && chunk->offset() + chunk->size() >= min_end) {
+        return chunk;
+      }
+    }
+  }
+  absl::MutexLock lock(&chunks_mutex_);
+  if (chunk_index >= static_cast<int64_t>(chunks_.size())) {
+    chunks_.resize(chunk_index + 1);
+  }
+  std::shared_ptr<MmapRegion>& chunk = chunks_[chunk_index];
+  // Re-check, as the chunk might have been mapped by a concurrent call.
+  if (chunk == nullptr || chunk->offset() + chunk->size() < min_end) {
+    int64_t offset = chunk_index * chunk_size_;
+    auto region_result = MmapRegion::New(
+        fd_, offset, std::min(chunk_size_, file_size - offset), advice_);
+    if (!region_result.ok()) return region_result.status();
+    chunk = std::move(region_result.ValueOrDie());
+  }
+  return chunk;
+}
+
+Status MmapRandomAccessStream::PRead(int64_t position, int count,
+                                     Buffer* dest_buffer) {
+  if (dest_buffer == nullptr) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "dest_buffer must be non-null");
+  }
+  if (count < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "count cannot be negative");
+  }
+  if (count > dest_buffer->allocated_size()) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "buffer too small");
+  }
+  if (position < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "position cannot be negative");
+  }
+  dest_buffer->set_size(count);
+  if (count == 0) {
+    return Status::OK;
+  }
+  // Avoids overflowing position + count.
+  const int64_t kMaxSize = std::numeric_limits<int64_t>::max();
+  int64_t min_size =
+      position <= kMaxSize - count ? position + count : kMaxSize;
+  int64_t file_size = FileSize(min_size);
+  if (file_size < 0) {
+    dest_buffer->set_size(0);
+    return ToStatusF(util::error::UNKNOWN, "I/O error: %d", errno);
+  }
+  if (position >= file_size) {
+    dest_buffer->set_size(0);
+    return Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  int64_t end = std::min(position + count, file_size);
+  int64_t current = position;
+  while (current < end) {
+    int64_t chunk_index = current / chunk_size_;
+    int64_t chunk_end = std::min((chunk_index + 1) * chunk_size_, end);
+    auto chunk_result = GetChunk(chunk_index, chunk_end, file_size);
+    if (!chunk_result.ok()) {
+      dest_buffer->set_size(0);
+      return chunk_result.status();
+    }
+    const MmapRegion& chunk = *chunk_result.ValueOrDie();
+    memcpy(dest_buffer->get_mem_block() + (current - position),
+           chunk.data() + (current - chunk.offset()), chunk_end - current);
+    current = chunk_end;
+  }
+  dest_buffer->set_size(end - position);
+  return Status::OK;
+}
+
+MmapRandomAccessStream::~MmapRandomAccessStream() {
+  close_ignoring_eintr(fd_);
+}
+
+int64_t MmapRandomAccessStream::size() const {
+  struct stat s;
+  if (fstat(fd_, &s) == -1) {
+    return -1;
+  } else {
+    return s.st_size;
+  }
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
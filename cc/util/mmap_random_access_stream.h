@@ -0,0 +1,90 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_MMAP_RANDOM_ACCESS_STREAM_H_
+#define TINK_UTIL_MMAP_RANDOM_ACCESS_STREAM_H_
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/mmap_region.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A RandomAccessStream that reads from a memory-mapped file, so that
+// PRead() copies directly from the page cache, without any syscalls
+// (except for reads that go past the end of the file as last seen).
+// The file is mapped lazily, in page-aligned chunks, hence also files
+// that are larger than the available address space can be read.
+// A file that grows is remapped as needed, but the file must not
+// be truncated while the stream exists.
+// Concurrent PRead()-calls are supported.
+class MmapRandomAccessStream : public crypto::tink::RandomAccessStream {
+ public:
+  // Constructs a MmapRandomAccessStream that will read from the file
+  // specified via 'file_descriptor', mapping it in chunks of 'chunk_size'
+  // bytes (if no legal 'chunk_size' is given, a reasonable default will
+  // be used), and passing 'advice' as a hint about the access pattern.
+  // Takes the ownership of the file, and will close it upon destruction.
+  explicit MmapRandomAccessStream(int file_descriptor,
+                                  MmapAdvice advice = MMAP_ADVICE_RANDOM,
+                                  int64_t chunk_size = -1);
+
+  ~MmapRandomAccessStream() override;
+
+  crypto::tink::util::Status PRead(int64_t position,
+                                   int count,
+                                   Buffer* dest_buffer) override;
+
+  int64_t size() const override;
+
+ private:
+  // Returns the mapping of the chunk with index 'chunk_index',
+  // which covers at least the bytes up to 'min_end' (a position
+  // within the file of size 'file_size').
+  crypto::tink::util::StatusOr<std::shared_ptr<MmapRegion>> GetChunk(
+      int64_t chunk_index, int64_t min_end, int64_t file_size)
+      LOCKS_EXCLUDED(chunks_mutex_);
+
+  // Returns the size of the file, which is re-read only if the cached
+  // size is less than 'min_size'. As the file never shrinks, the cached
+  // size is a lower bound of the current size.
+  int64_t FileSize(int64_t min_size);
+
+  const int fd_;
+  const MmapAdvice advice_;
+  const int64_t chunk_size_;
+  std::atomic<int64_t> known_size_;
+  absl::Mutex chunks_mutex_;
+  // Chunks that have been mapped so far, indexed by chunk number.
+  // The mappings are shared with ongoing PRead()-calls, so that
+  // a chunk can be remapped (after the file has grown) concurrently.
+  std::vector<std::shared_ptr<MmapRegion>> chunks_ GUARDED_BY(chunks_mutex_);
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_MMAP_RANDOM_ACCESS_STREAM_H_
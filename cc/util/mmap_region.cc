@@ -0,0 +1,90 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/mmap_region.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Default sizes of the chunks in which files are mapped; mapping large
+// files piecewise keeps the address space usage bounded on 32-bit platforms.
+const int64_t kDefaultChunkSize64 = 1LL << 30;  // 1 GB
+const int64_t kDefaultChunkSize32 = 1LL << 26;  // 64 MB
+
+int ToMadviseAdvice(MmapAdvice advice) {
+  switch (advice) {
+    case MMAP_ADVICE_SEQUENTIAL:
+      return MADV_SEQUENTIAL;
+    case MMAP_ADVICE_RANDOM:
+      return MADV_RANDOM;
+    case MMAP_ADVICE_WILLNEED:
+      return MADV_WILLNEED;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+}  // anonymous namespace
+
+// static
+StatusOr<std::unique_ptr<MmapRegion>> MmapRegion::New(
+    int file_descriptor, int64_t offset, int64_t length, MmapAdvice advice) {
+  if (offset < 0 || offset % sysconf(_SC_PAGESIZE) != 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "offset must be a non-negative multiple of page size");
+  }
+  if (length <= 0 || static_cast<uint64_t>(length) > SIZE_MAX) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "length must be positive and addressable");
+  }
+  void* data = mmap(nullptr, length, PROT_READ, MAP_SHARED, file_descriptor,
+                    offset);
+  if (data == MAP_FAILED) {
+    return ToStatusF(util::error::UNKNOWN, "mmap failed: %d", errno);
+  }
+  // The advice is only a hint, hence failures are ignored.
+  madvise(data, length, ToMadviseAdvice(advice));
+  return {std::unique_ptr<MmapRegion>(
+      new MmapRegion(static_cast<const uint8_t*>(data), offset, length))};
+}
+
+// static
+int64_t MmapRegion::GetChunkSize(int64_t chunk_size) {
+  if (chunk_size <= 0) {
+    return sizeof(void*) >= 8 ? kDefaultChunkSize64 : kDefaultChunkSize32;
+  }
+  int64_t page_size = sysconf(_SC_PAGESIZE);
+  return ((chunk_size + page_size - 1) / page_size) * page_size;
+}
+
+MmapRegion::~MmapRegion() {
+  munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,76 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_MMAP_REGION_H_
+#define TINK_UTIL_MMAP_REGION_H_
+
+#include <stdint.h>
+#include <memory>
+
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// Hints about the expected access pattern to a mapped file,
+// passed to madvise(2) for each mapped region.
+enum MmapAdvice {
+  MMAP_ADVICE_NORMAL = 0,
+  MMAP_ADVICE_SEQUENTIAL = 1,  // Aggressive read-ahead, early reclaim.
+  MMAP_ADVICE_RANDOM = 2,      // No read-ahead.
+  MMAP_ADVICE_WILLNEED = 3,    // Start reading the whole region right away.
+};
+
+// A read-only mapping of a contiguous region of a file, which is unmapped
+// upon destruction.  The mapped file must not be truncated while the region
+// exists, as accessing mapped pages beyond the end of a file raises SIGBUS.
+class MmapRegion {
+ public:
+  // Maps 'length' bytes of the file specified via 'file_descriptor',
+  // starting at 'offset', which must be a multiple of the page size.
+  // Does not take the ownership of the file.
+  static crypto::tink::util::StatusOr<std::unique_ptr<MmapRegion>> New(
+      int file_descriptor, int64_t offset, int64_t length, MmapAdvice advice);
+
+  // Returns a chunk size for mapping files piecewise: 'chunk_size'
+  // rounded up to a multiple of the page size, or (if 'chunk_size'
+  // is not positive) a default that is suitable for the address space
+  // of the platform.
+  static int64_t GetChunkSize(int64_t chunk_size);
+
+  ~MmapRegion();
+
+  const uint8_t* data() const { return data_; }
+  int64_t offset() const { return offset_; }
+  int64_t size() const { return size_; }
+
+ private:
+  MmapRegion(const uint8_t* data, int64_t offset, int64_t size)
+      : data_(data), offset_(offset), size_(size) {}
+  MmapRegion(const MmapRegion&) = delete;
+  MmapRegion& operator=(const MmapRegion&) = delete;
+
+  const uint8_t* data_;
+  const int64_t offset_;
+  const int64_t size_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_MMAP_REGION_H_
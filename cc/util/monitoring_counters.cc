@@ -0,0 +1,192 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/monitoring_counters.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/monitoring.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// The number of counters in a cache line.
+constexpr int kCellsPerLine = 64 / sizeof(std::atomic<int64_t>);
+
+// Returns the shard of the calling thread.
+int ThreadShard() {
+  // Threads are assigned to the shards round-robin, on first use.
+  static std::atomic<int> next_shard(0);
+  thread_local int shard =
+      next_shard.fetch_add(1) % MonitoringCounters::kNumShards;
+  return shard;
+}
+
+// Returns the bucket of the latency histogram for 'nanoseconds'.
+int LatencyBucket(int64_t nanoseconds) {
+  int bucket = 0;
+  for (uint64_t n = nanoseconds > 0 ? nanoseconds : 0; n > 1; n >>= 1) {
+    bucket++;
+  }
+  return bucket;
+}
+
+}  // namespace
+
+constexpr int MonitoringCounters::kNumShards;
+constexpr int MonitoringCounters::kNumLatencyBuckets;
+
+// The counters of a shard are laid out as
+//   [failures, (calls, bytes, key failures) per key, latency buckets],
+// followed by at least a cache line of padding, so that the counters
+// of different shards never share a cache line.
+class MonitoringCounters::Client : public MonitoringClient {
+ public:
+  Client(std::shared_ptr<State> state, const MonitoringContext& context)
+      : state_(std::move(state)),
+        function_(context.primitive, context.api_function),
+        key_ids_(context.key_ids),
+        primary_key_id_(context.primary_key_id),
+        primary_index_(FindKey(context.primary_key_id)),
+        latency_offset_(1 + 3 * key_ids_.size()),
+        shard_size_(((latency_offset_ +
+                      (state_->record_latency ? kNumLatencyBuckets : 0)) /
+                         kCellsPerLine + 2) * kCellsPerLine),
+        cells_(new std::atomic<int64_t>[kNumShards * shard_size_]()) {
+    absl::MutexLock lock(&state_->mutex);
+    state_->live_clients.insert(this);
+  }
+
+  ~Client() override {
+    absl::MutexLock lock(&state_->mutex);
+    state_->live_clients.erase(this);
+    AddTo(&state_->retired_counts);
+  }
+
+  void Log(uint32_t key_id, int64_t num_bytes) override {
+    int index = KeyIndex(key_id);
+    if (index < 0) return;
+    std::atomic<int64_t>* shard = Shard();
+    shard[1 + 3 * index].fetch_add(1, std::memory_order_relaxed);
+    shard[2 + 3 * index].fetch_add(num_bytes, std::memory_order_relaxed);
+  }
+
+  void LogFailure() override {
+    Shard()[0].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void LogKeyFailure(uint32_t key_id) override {
+    int index = KeyIndex(key_id);
+    if (index < 0) return;
+    Shard()[3 + 3 * index].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  bool records_latency() const override { return state_->record_latency; }
+
+  void LogLatency(int64_t nanoseconds) override {
+    Shard()[latency_offset_ + LatencyBucket(nanoseconds)].fetch_add(
+        1, std::memory_order_relaxed);
+  }
+
+  // Adds the counts of this client to 'counts'.
+  void AddTo(Counts* counts) const {
+    FunctionCounts& function_counts = (*counts)[function_];
+    if (state_->record_latency) {
+      function_counts.latency_histogram.resize(kNumLatencyBuckets);
+    }
+    for (int shard = 0; shard < kNumShards; shard++) {
+      const std::atomic<int64_t>* cells = &cells_[shard * shard_size_];
+      function_counts.failures += cells[0].load(std::memory_order_relaxed);
+      for (size_t i = 0; i < key_ids_.size(); i++) {
+        KeyCounts& key_counts = function_counts.keys[key_ids_[i]];
+        key_counts.calls += cells[1 + 3 * i].load(std::memory_order_relaxed);
+        key_counts.bytes += cells[2 + 3 * i].load(std::memory_order_relaxed);
+        key_counts.failures +=
+            cells[3 + 3 * i].load(std::memory_order_relaxed);
+      }
+      if (state_->record_latency) {
+        for (int i = 0; i < kNumLatencyBuckets; i++) {
+          function_counts.latency_histogram[i] +=
+              cells[latency_offset_ + i].load(std::memory_order_relaxed);
+        }
+      }
+    }
+  }
+
+ private:
+  // Returns the index of 'key_id' in key_ids_, or -1.
+  int FindKey(uint32_t key_id) const {
+    for (size_t i = 0; i < key_ids_.size(); i++) {
+      if (key_ids_[i] == key_id) return i;
+    }
+    return -1;
+  }
+
+  // Like FindKey(), with a shortcut for the primary key, which is used
+  // by most of the calls.  Keysets are small, so the other keys are
+  // searched linearly.
+  int KeyIndex(uint32_t key_id) const {
+    if (key_id == primary_key_id_ && primary_index_ >= 0) {
+      return primary_index_;
+    }
+    return FindKey(key_id);
+  }
+
+  std::atomic<int64_t>* Shard() const {
+    return &cells_[ThreadShard() * shard_size_];
+  }
+
+  const std::shared_ptr<State> state_;
+  const std::pair<std::string, std::string> function_;
+  const std::vector<uint32_t> key_ids_;
+  const uint32_t primary_key_id_;
+  const int primary_index_;
+  const size_t latency_offset_;
+  const size_t shard_size_;
+  const std::unique_ptr<std::atomic<int64_t>[]> cells_;
+};
+
+MonitoringCounters::MonitoringCounters(bool record_latency)
+    : state_(std::make_shared<State>(record_latency)) {}
+
+StatusOr<std::unique_ptr<MonitoringClient>> MonitoringCounters::New(
+    const MonitoringContext& context) {
+  std::unique_ptr<MonitoringClient> client =
+      absl::make_unique<Client>(state_, context);
+  return std::move(client);
+}
+
+MonitoringCounters::Counts MonitoringCounters::GetCounts() const {
+  absl::MutexLock lock(&state_->mutex);
+  Counts counts = state_->retired_counts;
+  for (const Client* client : state_->live_clients) {
+    client->AddTo(&counts);
+  }
+  return counts;
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,111 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_UTIL_MONITORING_COUNTERS_H_
+#define TINK_UTIL_MONITORING_COUNTERS_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "tink/monitoring.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A MonitoringClientFactory whose clients count the calls, the processed
+// bytes and the failures of each function of the wrapped primitives,
+// per key.  The counts can be read at any time with GetCounts(), e.g.
+//
+//   auto counters = std::make_shared<util::MonitoringCounters>();
+//   Registry::RegisterMonitoringClientFactory(counters);
+//   ...
+//   for (const auto& function : counters->GetCounts()) { ... }
+//
+// Each client keeps its counters in shards padded to whole cache lines,
+// and a thread always updates the same shard, so that concurrent calls
+// of a primitive rarely share a cache line.  Logging a call costs
+// a couple of relaxed atomic increments; the shards are summed only
+// by GetCounts().  The counts of destroyed clients are retained.
+//
+// MonitoringCounters is thread safe.
+class MonitoringCounters : public MonitoringClientFactory {
+ public:
+  static constexpr int kNumShards = 16;
+  // The number of buckets of the latency histograms.
+  static constexpr int kNumLatencyBuckets = 64;
+
+  struct KeyCounts {
+    int64_t calls = 0;
+    int64_t bytes = 0;
+    // The number of times that the key was tried, and failed.
+    int64_t failures = 0;
+  };
+
+  struct FunctionCounts {
+    std::map<uint32_t, KeyCounts> keys;
+    // The number of failed calls.
+    int64_t failures = 0;
+    // If latencies are recorded, latency_histogram[i] is the number
+    // of calls that took [2^i, 2^(i+1)) nanoseconds (the first bucket
+    // includes 0).  Otherwise it is empty.
+    std::vector<int64_t> latency_histogram;
+  };
+
+  // The counts per (primitive, api_function).
+  typedef std::map<std::pair<std::string, std::string>, FunctionCounts>
+      Counts;
+
+  // If 'record_latency' is true, the clients also record histograms
+  // of the latencies of the calls, which adds two clock reads per call.
+  explicit MonitoringCounters(bool record_latency = false);
+
+  crypto::tink::util::StatusOr<std::unique_ptr<MonitoringClient>> New(
+      const MonitoringContext& context) override;
+
+  // Returns the counts of all the clients created by this factory.
+  Counts GetCounts() const;
+
+ private:
+  class Client;
+
+  // Shared with the clients, which may outlive the factory.
+  struct State {
+    const bool record_latency;
+    absl::Mutex mutex;
+    std::set<const Client*> live_clients GUARDED_BY(mutex);
+    // The counts of the destroyed clients.
+    Counts retired_counts GUARDED_BY(mutex);
+
+    explicit State(bool record_latency) : record_latency(record_latency) {}
+  };
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_MONITORING_COUNTERS_H_
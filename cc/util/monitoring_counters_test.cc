@@ -0,0 +1,147 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/monitoring_counters.h"
+
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tink/monitoring.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+MonitoringContext GetContext(const std::string& api_function) {
+  MonitoringContext context;
+  context.primitive = "aead";
+  context.api_function = api_function;
+  context.key_ids = {10, 11, 12};
+  context.primary_key_id = 11;
+  return context;
+}
+
+TEST(MonitoringCountersTest, CountsPerKeyAndFunction) {
+  MonitoringCounters counters;
+  auto encrypt = std::move(counters.New(GetContext("encrypt")).ValueOrDie());
+  auto decrypt = std::move(counters.New(GetContext("decrypt")).ValueOrDie());
+  EXPECT_FALSE(encrypt->records_latency());
+
+  encrypt->Log(11, 100);
+  encrypt->Log(11, 20);
+  encrypt->LogFailure();
+  decrypt->Log(10, 50);
+  decrypt->LogKeyFailure(11);
+  decrypt->LogKeyFailure(12);
+  decrypt->LogFailure();
+  decrypt->Log(42, 1000);  // Not in the keyset: ignored.
+
+  auto counts = counters.GetCounts();
+  ASSERT_EQ(2, counts.size());
+  const auto& encrypt_counts = counts[{"aead", "encrypt"}];
+  EXPECT_EQ(1, encrypt_counts.failures);
+  EXPECT_EQ(3, encrypt_counts.keys.size());
+  EXPECT_EQ(2, encrypt_counts.keys.at(11).calls);
+  EXPECT_EQ(120, encrypt_counts.keys.at(11).bytes);
+  EXPECT_EQ(0, encrypt_counts.keys.at(10).calls);
+  EXPECT_TRUE(encrypt_counts.latency_histogram.empty());
+
+  const auto& decrypt_counts = counts[{"aead", "decrypt"}];
+  EXPECT_EQ(1, decrypt_counts.failures);
+  EXPECT_EQ(1, decrypt_counts.keys.at(10).calls);
+  EXPECT_EQ(50, decrypt_counts.keys.at(10).bytes);
+  EXPECT_EQ(0, decrypt_counts.keys.at(10).failures);
+  EXPECT_EQ(1, decrypt_counts.keys.at(11).failures);
+  EXPECT_EQ(1, decrypt_counts.keys.at(12).failures);
+  EXPECT_EQ(0, decrypt_counts.keys.count(42));
+}
+
+TEST(MonitoringCountersTest, RetainsCountsOfDestroyedClients) {
+  MonitoringCounters counters;
+  for (int i = 0; i < 3; i++) {
+    auto client = std::move(counters.New(GetContext("encrypt")).ValueOrDie());
+    client->Log(12, 10);
+  }
+  auto live_client =
+      std::move(counters.New(GetContext("encrypt")).ValueOrDie());
+  live_client->Log(12, 10);
+  auto counts = counters.GetCounts();
+  EXPECT_EQ(4, (counts[{"aead", "encrypt"}].keys.at(12).calls));
+  EXPECT_EQ(40, (counts[{"aead", "encrypt"}].keys.at(12).bytes));
+}
+
+TEST(MonitoringCountersTest, ClientsOutliveTheFactory) {
+  std::unique_ptr<MonitoringClient> client;
+  {
+    MonitoringCounters counters;
+    client = std::move(counters.New(GetContext("encrypt")).ValueOrDie());
+  }
+  client->Log(11, 1);
+  client.reset();
+}
+
+TEST(MonitoringCountersTest, LatencyHistogram) {
+  MonitoringCounters counters(/*record_latency=*/true);
+  auto client = std::move(counters.New(GetContext("encrypt")).ValueOrDie());
+  EXPECT_TRUE(client->records_latency());
+  client->LogLatency(0);
+  client->LogLatency(1);
+  client->LogLatency(3);
+  client->LogLatency(1024);
+  client->LogLatency(2047);
+  auto counts = counters.GetCounts();
+  const auto& histogram = counts[{"aead", "encrypt"}].latency_histogram;
+  ASSERT_EQ(MonitoringCounters::kNumLatencyBuckets, histogram.size());
+  EXPECT_EQ(2, histogram[0]);
+  EXPECT_EQ(1, histogram[1]);
+  EXPECT_EQ(2, histogram[10]);
+}
+
+TEST(MonitoringCountersTest, ConcurrentCalls) {
+  const int kNumThreads = 8;
+  const int kCallsPerThread = 10000;
+  MonitoringCounters counters;
+  auto client = std::move(counters.New(GetContext("encrypt")).ValueOrDie());
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&client, t]() {
+      for (int i = 0; i < kCallsPerThread; i++) {
+        client->Log(10 + t % 3, 2);
+        if (i % 10 == 0) client->LogFailure();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  auto counts = counters.GetCounts();
+  const auto& function_counts = counts[{"aead", "encrypt"}];
+  int64_t calls = 0;
+  int64_t bytes = 0;
+  for (const auto& key_counts : function_counts.keys) {
+    calls += key_counts.second.calls;
+    bytes += key_counts.second.bytes;
+  }
+  EXPECT_EQ(kNumThreads * kCallsPerThread, calls);
+  EXPECT_EQ(2 * kNumThreads * kCallsPerThread, bytes);
+  EXPECT_EQ(kNumThreads * kCallsPerThread / 10, function_counts.failures);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
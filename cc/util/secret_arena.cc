@@ -0,0 +1,77 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/secret_arena.h"
+
+#include <stdlib.h>
+
+#include "absl/memory/memory.h"
+#include "openssl/mem.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Heap blocks grow from the start size up to the maximal size, so that
+// a keyset with many keys takes a handful of blocks.
+constexpr size_t kStartBlockSize = 1024;
+constexpr size_t kMaxBlockSize = 64 * 1024;
+
+void* AllocateBlock(size_t size) { return malloc(size); }
+
+void WipeAndFreeBlock(void* block, size_t size) {
+  OPENSSL_cleanse(block, size);
+  free(block);
+}
+
+google::protobuf::ArenaOptions GetOptions(char* initial_block,
+                                          size_t initial_block_size) {
+  google::protobuf::ArenaOptions options;
+  options.start_block_size = kStartBlockSize;
+  options.max_block_size = kMaxBlockSize;
+  options.initial_block = initial_block;
+  options.initial_block_size = initial_block_size;
+  options.block_alloc = &AllocateBlock;
+  options.block_dealloc = &WipeAndFreeBlock;
+  return options;
+}
+
+}  // namespace
+
+constexpr size_t SecretArena::kInitialBlockSize;
+
+SecretArena::SecretArena() : SecretArena(nullptr, 0) {}
+
+SecretArena::SecretArena(char* initial_block, size_t initial_block_size)
+    : initial_block_(initial_block),
+      initial_block_size_(initial_block_size),
+      arena_(absl::make_unique<google::protobuf::Arena>(
+          GetOptions(initial_block, initial_block_size))) {}
+
+SecretArena::~SecretArena() {
+  // Destroys the messages, and wipes and frees the heap blocks.
+  arena_.reset();
+  if (initial_block_ != nullptr) {
+    OPENSSL_cleanse(initial_block_, initial_block_size_);
+  }
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,86 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_UTIL_SECRET_ARENA_H_
+#define TINK_UTIL_SECRET_ARENA_H_
+
+#include <stddef.h>
+
+#include <memory>
+
+#include "google/protobuf/arena.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A protobuf arena for messages with key material, e.g. Keysets and
+// key protos.  Messages on the arena are allocated from a few large
+// blocks, which are freed together when the arena is destroyed.
+// The blocks are wiped before they are freed.
+//
+// Note that the character data of long string fields is not stored
+// on the arena (only the std::string objects are), hence it is
+// neither allocated from the blocks nor wiped with them.
+class SecretArena {
+ public:
+  // A size of initial blocks (see below) that suffices for typical
+  // key protos.  Initial blocks must be 8-byte aligned.
+  static constexpr size_t kInitialBlockSize = 1024;
+
+  // Constructs an arena that allocates its blocks on the heap.
+  SecretArena();
+
+  // Constructs an arena that uses 'initial_block' (e.g. a buffer on the
+  // stack) before it allocates blocks on the heap.  Does NOT take the
+  // ownership of 'initial_block', which must remain alive as long as
+  // this arena, and is wiped when this arena is destroyed.
+  SecretArena(char* initial_block, size_t initial_block_size);
+
+  ~SecretArena();
+
+  // Returns a new message of type T, which is owned by this arena.
+  template <class T>
+  T* Create() {
+    return google::protobuf::Arena::CreateMessage<T>(arena_.get());
+  }
+
+  // Returns a new message of type T, allocated on a new SecretArena
+  // that lives as long as the returned pointer (or its copies).
+  template <class T>
+  static std::shared_ptr<T> MakeShared() {
+    auto arena = std::make_shared<SecretArena>();
+    T* message = arena->Create<T>();
+    return std::shared_ptr<T>(std::move(arena), message);
+  }
+
+  google::protobuf::Arena* get() const { return arena_.get(); }
+
+ private:
+  SecretArena(const SecretArena&) = delete;
+  SecretArena& operator=(const SecretArena&) = delete;
+
+  char* initial_block_;
+  size_t initial_block_size_;
+  std::unique_ptr<google::protobuf::Arena> arena_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_SECRET_ARENA_H_
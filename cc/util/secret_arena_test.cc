@@ -0,0 +1,82 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/secret_arena.h"
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using google::crypto::tink::Keyset;
+
+TEST(SecretArenaTest, CreatesMessagesOnTheArena) {
+  SecretArena arena;
+  Keyset* keyset = arena.Create<Keyset>();
+  EXPECT_EQ(arena.get(), keyset->GetArena());
+  for (int key_id = 1; key_id <= 100; key_id++) {
+    Keyset::Key* key = keyset->add_key();
+    key->set_key_id(key_id);
+    key->mutable_key_data()->set_value(std::string(64, 'k'));
+    EXPECT_EQ(arena.get(), key->GetArena());
+  }
+  EXPECT_EQ(100, keyset->key_size());
+
+  // Parsing also allocates on the arena.
+  Keyset* parsed_keyset = arena.Create<Keyset>();
+  ASSERT_TRUE(parsed_keyset->ParseFromString(keyset->SerializeAsString()));
+  EXPECT_EQ(arena.get(), parsed_keyset->key(99).GetArena());
+  EXPECT_EQ(100, parsed_keyset->key(99).key_id());
+}
+
+TEST(SecretArenaTest, MakeShared) {
+  std::shared_ptr<Keyset> keyset = SecretArena::MakeShared<Keyset>();
+  ASSERT_NE(nullptr, keyset->GetArena());
+  keyset->set_primary_key_id(42);
+  std::shared_ptr<const Keyset> copy = keyset;
+  keyset.reset();
+  // The arena lives as long as any copy of the pointer.
+  EXPECT_EQ(42, copy->primary_key_id());
+  EXPECT_EQ(0, copy->key_size());
+}
+
+TEST(SecretArenaTest, WipesTheInitialBlock) {
+  alignas(8) char block[SecretArena::kInitialBlockSize];
+  std::fill(block, block + sizeof(block), 'x');
+  {
+    SecretArena arena(block, sizeof(block));
+    Keyset* keyset = arena.Create<Keyset>();
+    // The message lives in the initial block.
+    EXPECT_LE(static_cast<void*>(block), static_cast<void*>(keyset));
+    EXPECT_GT(static_cast<void*>(block + sizeof(block)),
+              static_cast<void*>(keyset));
+    keyset->set_primary_key_id(0x12345678);
+  }
+  EXPECT_EQ(std::string(sizeof(block), '\0'),
+            std::string(block, sizeof(block)));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -256,6 +256,62 @@ class DummyStreamingAead : public StreamingAead {
         absl::StrCat(streaming_aead_name_, associated_data))};
   }
 
+  // The ciphertext is verified by matching its header, the rest
+  // of the stream is treated as a single (always authentic) segment.
+  crypto::tink::util::StatusOr<VerificationResult> VerifyStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data) override {
+    DummyDecryptingStream dec_stream(
+        std::move(ciphertext_source),
+        absl::StrCat(streaming_aead_name_, associated_data));
+    const void* data;
+    auto next_result = dec_stream.Next(&data);
+    while (next_result.ok()) next_result = dec_stream.Next(&data);
+    return GetVerificationResult(next_result.status());
+  }
+
+  crypto::tink::util::StatusOr<VerificationResult> VerifyRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) override {
+    DummyDecryptingRandomAccessStream dec_stream(
+        std::move(ciphertext_source),
+        absl::StrCat(streaming_aead_name_, associated_data));
+    auto buf = std::move(util::Buffer::New(1).ValueOrDie());
+    return GetVerificationResult(dec_stream.PRead(0, 1, buf.get()));
+  }
+
+  // The ciphertext is the header followed by the plaintext.
+  crypto::tink::util::Status EncryptBuffer(
+      absl::string_view plaintext,
+      absl::string_view associated_data,
+      char* ciphertext, int64_t ciphertext_size) override {
+    std::string ct =
+        absl::StrCat(streaming_aead_name_, associated_data, plaintext);
+    if (ct.size() != ciphertext_size) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "wrong ciphertext_size");
+    }
+    memcpy(ciphertext, ct.data(), ct.size());
+    return util::OkStatus();
+  }
+
+  crypto::tink::util::StatusOr<int64_t> DecryptBuffer(
+      absl::string_view ciphertext,
+      absl::string_view associated_data,
+      char* plaintext, int64_t plaintext_capacity) override {
+    std::string header = absl::StrCat(streaming_aead_name_, associated_data);
+    if (!absl::StartsWith(ciphertext, header)) {
+      return util::Status(util::error::INVALID_ARGUMENT, "Corrupted header");
+    }
+    int64_t plaintext_size = ciphertext.size() - header.size();
+    if (plaintext_size > plaintext_capacity) {
+      return util::Status(util::error::RESOURCE_EXHAUSTED,
+                          "plaintext_capacity too small");
+    }
+    memcpy(plaintext, ciphertext.data() + header.size(), plaintext_size);
+    return plaintext_size;
+  }
+
   // Upon first call to Next() writes to 'ct_dest' the specifed 'header',
   // and subsequently forwards all methods calls to the corresponding
   // methods of 'cd_dest'.
@@ -432,6 +488,19 @@ class DummyStreamingAead : public StreamingAead {
   };  // class DummyDecryptingRandomAccessStream
 
  private:
+  static VerificationResult GetVerificationResult(
+      const util::Status& read_status) {
+    VerificationResult result;
+    if (read_status.ok() ||
+        read_status.error_code() == util::error::OUT_OF_RANGE) {
+      result.verified_segments = 1;
+    } else {
+      result.first_invalid_segment = 0;
+      result.first_invalid_segment_offset = 0;
+    }
+    return result;
+  }
+
   std::string streaming_aead_name_;
 };
 
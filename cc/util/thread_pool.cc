@@ -0,0 +1,77 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/thread_pool.h"
+
+#include <functional>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+ThreadPool::ThreadPool(int num_threads) : stopping_(false) {
+  if (num_threads < 1) num_threads = 1;
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads_.push_back(std::thread(&ThreadPool::WorkLoop, this));
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Schedule(std::function<void()> func) {
+  absl::MutexLock lock(&mutex_);
+  queue_.push(std::move(func));
+}
+
+// static
+int ThreadPool::DefaultNumThreads() {
+  int num_cores = std::thread::hardware_concurrency();
+  return num_cores > 0 ? num_cores : 1;
+}
+
+bool ThreadPool::HasWorkOrStopping() const {
+  return !queue_.empty() || stopping_;
+}
+
+void ThreadPool::WorkLoop() {
+  while (true) {
+    std::function<void()> func;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &ThreadPool::HasWorkOrStopping));
+      if (queue_.empty()) return;  // stopping_ and no pending work
+      func = std::move(queue_.front());
+      queue_.pop();
+    }
+    func();
+  }
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,78 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_THREAD_POOL_H_
+#define TINK_UTIL_THREAD_POOL_H_
+
+#include <functional>
+#include <queue>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A fixed-size pool of worker threads that execute scheduled closures
+// in FIFO order.
+//
+// For CPU-bound work (e.g. processing independent segments of
+// a ciphertext stream) the closures should not block for long periods
+// of time.  A pool can also bound the concurrency of blocking calls
+// (e.g. RPCs to a KMS), by having one thread per allowed call.
+class ThreadPool {
+ public:
+  // Constructs a pool with 'num_threads' worker threads.
+  // If 'num_threads' is not positive, a single worker thread is started.
+  explicit ThreadPool(int num_threads);
+
+  // Waits until all the scheduled closures have finished,
+  // and joins the worker threads.
+  ~ThreadPool();
+
+  // Schedules 'func' for execution on one of the worker threads.
+  void Schedule(std::function<void()> func);
+
+  // Returns the number of worker threads of this pool.
+  int num_threads() const { return threads_.size(); }
+
+  // Returns a reasonable default for the number of threads of a pool
+  // used for CPU-bound work, i.e. the number of available cores.
+  static int DefaultNumThreads();
+
+ private:
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Returns true iff there are pending closures or the pool is stopping.
+  bool HasWorkOrStopping() const EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // The main loop of each worker thread.
+  void WorkLoop();
+
+  absl::Mutex mutex_;
+  std::queue<std::function<void()>> queue_ GUARDED_BY(mutex_);
+  bool stopping_ GUARDED_BY(mutex_);
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_THREAD_POOL_H_
@@ -0,0 +1,85 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/thread_pool.h"
+
+#include <atomic>
+#include <set>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/barrier.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+TEST(ThreadPoolTest, NumThreads) {
+  for (int num_threads : {1, 2, 5, 16}) {
+    ThreadPool pool(num_threads);
+    EXPECT_EQ(num_threads, pool.num_threads());
+  }
+  ThreadPool pool(0);
+  EXPECT_EQ(1, pool.num_threads());
+  EXPECT_LE(1, ThreadPool::DefaultNumThreads());
+}
+
+TEST(ThreadPoolTest, RunsAllScheduledClosures) {
+  for (int num_threads : {1, 2, 4, 8}) {
+    SCOPED_TRACE(absl::StrCat("num_threads = ", num_threads));
+    std::atomic<int> sum(0);
+    {
+      ThreadPool pool(num_threads);
+      for (int i = 1; i <= 1000; i++) {
+        pool.Schedule([&sum, i]() { sum += i; });
+      }
+    }  // The destructor waits for all the closures.
+    EXPECT_EQ(500500, sum.load());
+  }
+}
+
+TEST(ThreadPoolTest, UsesSeveralThreads) {
+  const int num_threads = 4;
+  ThreadPool pool(num_threads);
+  absl::Mutex mutex;
+  std::set<std::thread::id> thread_ids;
+  absl::Barrier all_started(num_threads);
+  absl::BlockingCounter done(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    pool.Schedule([&]() {
+      {
+        absl::MutexLock lock(&mutex);
+        thread_ids.insert(std::this_thread::get_id());
+      }
+      // Block until all the closures are running concurrently.
+      all_started.Block();
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  absl::MutexLock lock(&mutex);
+  EXPECT_EQ(num_threads, thread_ids.size());
+  EXPECT_EQ(0, thread_ids.count(std::this_thread::get_id()));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
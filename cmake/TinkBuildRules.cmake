@@ -26,6 +26,7 @@
 #   TINK_INCLUDE_DIRS list of global include paths.
 #   TINK_CXX_STANDARD C++ standard to enforce, 11 for now.
 #   TINK_BUILD_TESTS flag, set to false to disable tests (default false).
+#   TINK_BUILD_BENCHMARKS flag, set to true to build benchmarks (default false).
 #
 # Sensible defaults are provided for all variables, except TINK_MODULE, which is
 # defined by calls to tink_module(). Please don't alter it directly.
@@ -189,6 +190,42 @@ function(tink_cc_test)
   endif()
 endfunction(tink_cc_test)
 
+#
+# Benchmarks added with this macro are built, but not registered as tests.
+# Each benchmark produces a build target named tink_benchmark_<MODULE>_<NAME>.
+#
+function(tink_cc_benchmark)
+  cmake_parse_arguments(PARSE_ARGV 0 tink_cc_benchmark
+    ""
+    "NAME"
+    "SRCS;DEPS"
+  )
+
+  if (NOT TINK_BUILD_BENCHMARKS)
+    return()
+  endif()
+
+  if (NOT DEFINED TINK_MODULE)
+    message(FATAL_ERROR "TINK_MODULE not defined")
+  endif()
+
+  set(_target_name "tink_benchmark_${TINK_MODULE}_${tink_cc_benchmark_NAME}")
+
+  add_executable(${_target_name}
+    ${tink_cc_benchmark_SRCS}
+  )
+
+  target_link_libraries(${_target_name}
+    benchmark_main
+    ${tink_cc_benchmark_DEPS}
+  )
+
+  set_property(TARGET ${_target_name}
+               PROPERTY FOLDER "${TINK_IDE_FOLDER}/Benchmarks")
+  set_property(TARGET ${_target_name} PROPERTY CXX_STANDARD ${TINK_CXX_STANDARD})
+  set_property(TARGET ${_target_name} PROPERTY CXX_STANDARD_REQUIRED true)
+endfunction(tink_cc_benchmark)
+
 # Declare a C++ Proto library.
 #
 # Parameters:
@@ -42,6 +42,18 @@ http_archive(
   SHA256 a7db7d1295ce46b93f3d1a90dbbc55a48409c00d19684fcd87823037add88118
 )
 
+if (TINK_BUILD_BENCHMARKS)
+  set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "Tink dependency override" FORCE)
+  set(BENCHMARK_ENABLE_GTEST_TESTS OFF CACHE BOOL "Tink dependency override" FORCE)
+  set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "Tink dependency override" FORCE)
+
+  http_archive(
+    NAME com_github_google_benchmark
+    URL https://github.com/google/benchmark/archive/v1.5.0.tar.gz
+    SHA256 3c6a165b6ecc948967a1ead710d4a181d7b0fbcaa183ef7ea84604994966221a
+  )
+endif()
+
 http_archive(
   NAME com_google_absl
   URL https://github.com/abseil/abseil-cpp/archive/c476da141ca9cffc2137baf85872f0cae9ffa9ad.zip